@@ -0,0 +1,140 @@
+/*
+ * RmlUi CPU Software Renderer
+ *
+ * Headless reference implementation of the GX2 renderer semantics (premultiplied alpha blending, scissor,
+ * stencil clip masks, transforms, RGBA and distance field textures) rasterizing into an RGBA8 framebuffer.
+ * Draw calls are recorded during the frame, binned into screen tiles and rasterized in EndFrame by a pool of
+ * worker threads, each tile replaying its commands in submission order. Host only, the golden image test of
+ * Host/Tests/software_renderer_test.cpp renders UI/demo.rml with it.
+ */
+
+#ifndef RMLUI_BACKENDS_RENDERER_SOFTWARE_H
+#define RMLUI_BACKENDS_RENDERER_SOFTWARE_H
+
+#include <RmlUi/Core/RenderInterface.h>
+#include <RmlUi/Core/Types.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+class RenderInterface_Software : public Rml::RenderInterface {
+public:
+	// num_threads = 0 uses one thread per hardware thread
+	RenderInterface_Software(int width, int height, unsigned int num_threads = 0);
+	~RenderInterface_Software();
+
+	// Resizes the framebuffer, its contents are cleared.
+	void SetViewport(int viewport_width, int viewport_height);
+
+	// Starts recording a frame.
+	void BeginFrame();
+	// Rasterizes all commands recorded since BeginFrame.
+	void EndFrame();
+
+	// Clears the framebuffer to a premultiplied colour.
+	void Clear(Rml::ColourbPremultiplied colour = Rml::ColourbPremultiplied(0, 0, 0, 0));
+
+	// RGBA8 premultiplied pixels, top row first, tightly packed.
+	const Rml::byte* GetPixels() const { return framebuffer.data(); }
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+
+	// Writes the framebuffer as an uncompressed 32-bit TGA, for golden image comparisons.
+	bool SaveTGA(const char* path) const;
+
+	// -- Inherited from Rml::RenderInterface --
+
+	Rml::CompiledGeometryHandle CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices) override;
+	void ReleaseGeometry(Rml::CompiledGeometryHandle geometry) override;
+	void RenderGeometry(Rml::CompiledGeometryHandle handle, Rml::Vector2f translation, Rml::TextureHandle texture) override;
+
+	Rml::TextureHandle LoadTexture(Rml::Vector2i& texture_dimensions, const Rml::String& source) override;
+	Rml::TextureHandle GenerateTexture(Rml::Span<const Rml::byte> source, Rml::Vector2i source_dimensions) override;
+	void ReleaseTexture(Rml::TextureHandle texture_handle) override;
+
+	void EnableScissorRegion(bool enable) override;
+	void SetScissorRegion(Rml::Rectanglei region) override;
+
+	void EnableClipMask(bool enable) override;
+	void RenderToClipMask(Rml::ClipMaskOperation operation, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation) override;
+
+	void SetTransform(const Rml::Matrix4f* transform) override;
+
+private:
+	struct GeometryData {
+		Rml::Vector<Rml::Vertex> vertices;
+		Rml::Vector<int> indices;
+	};
+
+	// RGBA8 premultiplied texels, single-channel sources are distance fields resolved to white coverage
+	struct TextureData {
+		int width = 0;
+		int height = 0;
+		Rml::Vector<Rml::byte> texels;
+	};
+
+	// Screen-space triangle set up for rasterization
+	struct Triangle {
+		// Edge functions a * x + b * y + c, positive inside
+		float edge_a[3], edge_b[3], edge_c[3];
+		bool top_left[3];
+		// Attribute planes value = dx * x + dy * y + base for u, v, r, g, b, a
+		float plane_dx[6], plane_dy[6], plane_base[6];
+		// Inclusive pixel bounds, already clipped to the scissor region
+		int min_x, min_y, max_x, max_y;
+		const TextureData* texture;
+	};
+
+	enum class CommandType : uint8_t { Draw, StencilWrite, StencilClear };
+	enum class StencilOp : uint8_t { Replace, IncrementIfEqual };
+
+	struct Command {
+		CommandType type;
+		StencilOp stencil_op;
+		bool stencil_test;
+		uint8_t stencil_value;
+		uint32_t triangle;
+	};
+
+	void SubmitGeometry(const GeometryData* geometry, Rml::Vector2f translation, const TextureData* texture, Command command);
+	void RasterizeTile(uint32_t tile_index);
+	void RunTiles();
+	void WorkerMain();
+
+	int width = 0;
+	int height = 0;
+	Rml::Vector<Rml::byte> framebuffer;
+	Rml::Vector<uint8_t> stencil;
+
+	// Recorded frame
+	Rml::Vector<Triangle> triangles;
+	Rml::Vector<Command> commands;
+	Rml::Vector<TextureData*> released_textures;
+
+	// Tile bins of command indices
+	int tiles_x = 0;
+	int tiles_y = 0;
+	Rml::Vector<Rml::Vector<uint32_t>> tile_commands;
+
+	// Render state
+	bool scissor_enabled = false;
+	Rml::Rectanglei scissor_region;
+	bool clip_mask_enabled = false;
+	uint8_t stencil_test_value = 0;
+	bool transform_enabled = false;
+	Rml::Matrix4f transform_matrix = Rml::Matrix4f::Identity();
+
+	// Worker pool, woken once per EndFrame
+	Rml::Vector<std::thread> workers;
+	std::mutex pool_mutex;
+	std::condition_variable pool_start;
+	std::condition_variable pool_done;
+	uint64_t pool_generation = 0;
+	uint32_t pool_active = 0;
+	bool pool_quit = false;
+	std::atomic<uint32_t> next_tile{ 0 };
+};
+
+#endif
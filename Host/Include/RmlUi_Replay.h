@@ -0,0 +1,68 @@
+/*
+ * RmlUi render call-stream replay
+ *
+ * Plays back files written by RenderInterface_Capture into any render interface and reports per-frame call
+ * counts and timings. Host only, captures are copied off the SD card and replayed with Host/Tools/replay_main.cpp.
+ */
+
+#ifndef RMLUI_BACKENDS_REPLAY_H
+#define RMLUI_BACKENDS_REPLAY_H
+
+#include <RmlUi/Core/RenderInterface.h>
+#include <RmlUi/Core/Types.h>
+#include <cstdint>
+
+namespace Replay {
+
+struct FrameReport {
+	uint32_t frame = 0;
+	uint32_t geometry_compiled = 0;
+	uint32_t geometry_released = 0;
+	uint32_t draw_calls = 0;
+	uint32_t triangles = 0;
+	uint32_t textures_generated = 0;
+	uint32_t textures_released = 0;
+	uint32_t scissor_changes = 0;
+	uint32_t clip_mask_calls = 0;
+	uint32_t transform_changes = 0;
+	uint64_t time_us = 0;
+};
+
+struct Report {
+	Rml::Vector<FrameReport> frames;
+	Rml::String error;
+};
+
+// Replays the capture at path into target. Handles are remapped, so the result only depends on the file contents.
+// Returns false and sets report.error if the file is missing, truncated or of an unknown version.
+bool Run(const char* path, Rml::RenderInterface* target, Report& report);
+
+// Writes the report as JSON, one object per frame followed by the totals.
+bool WriteReport(const Report& report, const char* path);
+
+} // namespace Replay
+
+// Stand-in backend for replays without a GPU. Hands out sequential handles and does no work.
+class RenderInterface_Null : public Rml::RenderInterface {
+public:
+	Rml::CompiledGeometryHandle CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices) override;
+	void ReleaseGeometry(Rml::CompiledGeometryHandle geometry) override;
+	void RenderGeometry(Rml::CompiledGeometryHandle handle, Rml::Vector2f translation, Rml::TextureHandle texture) override;
+
+	Rml::TextureHandle LoadTexture(Rml::Vector2i& texture_dimensions, const Rml::String& source) override;
+	Rml::TextureHandle GenerateTexture(Rml::Span<const Rml::byte> source, Rml::Vector2i source_dimensions) override;
+	void ReleaseTexture(Rml::TextureHandle texture_handle) override;
+
+	void EnableScissorRegion(bool enable) override;
+	void SetScissorRegion(Rml::Rectanglei region) override;
+
+	void EnableClipMask(bool enable) override;
+	void RenderToClipMask(Rml::ClipMaskOperation operation, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation) override;
+
+	void SetTransform(const Rml::Matrix4f* transform) override;
+
+private:
+	uintptr_t next_handle = 1;
+};
+
+#endif
@@ -0,0 +1,536 @@
+/*
+ * RmlUi CPU Software Renderer Implementation
+ */
+
+#include "RmlUi_Renderer_Software.h"
+#include "RmlUi_Image_TGA.h"
+#include <RmlUi/Core.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr int TILE_SIZE = 64;
+constexpr int LANES = 4;
+
+// Four pixels of a span are evaluated at once, GCC lowers these to SSE/NEON/paired singles or scalar code
+typedef float f32x4 __attribute__((vector_size(16)));
+typedef int32_t i32x4 __attribute__((vector_size(16)));
+
+inline f32x4 Splat(float value) {
+	return f32x4{ value, value, value, value };
+}
+
+inline float Clamp01(float value) {
+	return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+inline Rml::byte ToByte(float value) {
+	return (Rml::byte)(Clamp01(value) * 255.0f + 0.5f);
+}
+
+// Bilinear sample with clamp to edge, matching GX2_TEX_XY_FILTER_MODE_LINEAR + GX2_TEX_CLAMP_MODE_CLAMP
+void SampleBilinear(const Rml::byte* texels, int width, int height, float u, float v, float out[4]) {
+	float x = u * (float)width - 0.5f;
+	float y = v * (float)height - 0.5f;
+	float fx = std::floor(x);
+	float fy = std::floor(y);
+	float tx = x - fx;
+	float ty = y - fy;
+
+	int x0 = std::clamp((int)fx, 0, width - 1);
+	int x1 = std::clamp((int)fx + 1, 0, width - 1);
+	int y0 = std::clamp((int)fy, 0, height - 1);
+	int y1 = std::clamp((int)fy + 1, 0, height - 1);
+
+	const Rml::byte* p00 = texels + (y0 * width + x0) * 4;
+	const Rml::byte* p10 = texels + (y0 * width + x1) * 4;
+	const Rml::byte* p01 = texels + (y1 * width + x0) * 4;
+	const Rml::byte* p11 = texels + (y1 * width + x1) * 4;
+
+	for (int c = 0; c < 4; c++) {
+		float top = (float)p00[c] + ((float)p10[c] - (float)p00[c]) * tx;
+		float bottom = (float)p01[c] + ((float)p11[c] - (float)p01[c]) * tx;
+		out[c] = (top + (bottom - top) * ty) * (1.0f / 255.0f);
+	}
+}
+
+} // namespace
+
+RenderInterface_Software::RenderInterface_Software(int width, int height, unsigned int num_threads) {
+	SetViewport(width, height);
+
+	if (num_threads == 0) {
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	// The calling thread rasterizes as well
+	for (unsigned int i = 1; i < num_threads; i++) {
+		workers.emplace_back(&RenderInterface_Software::WorkerMain, this);
+	}
+}
+
+RenderInterface_Software::~RenderInterface_Software() {
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		pool_quit = true;
+	}
+	pool_start.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	for (TextureData* texture : released_textures) {
+		delete texture;
+	}
+}
+
+void RenderInterface_Software::SetViewport(int viewport_width, int viewport_height) {
+	width = std::max(viewport_width, 1);
+	height = std::max(viewport_height, 1);
+	framebuffer.assign(width * height * 4, 0);
+	stencil.assign(width * height, 0);
+
+	tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+	tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+	tile_commands.assign(tiles_x * tiles_y, Rml::Vector<uint32_t>());
+
+	scissor_region = Rml::Rectanglei::FromSize({ width, height });
+}
+
+void RenderInterface_Software::BeginFrame() {
+	triangles.clear();
+	commands.clear();
+	scissor_enabled = false;
+	clip_mask_enabled = false;
+	stencil_test_value = 0;
+	SetTransform(nullptr);
+}
+
+void RenderInterface_Software::EndFrame() {
+	// Bin commands into the tiles their bounds touch, stencil clears go to every tile
+	for (Rml::Vector<uint32_t>& bin : tile_commands) {
+		bin.clear();
+	}
+	for (uint32_t i = 0; i < (uint32_t)commands.size(); i++) {
+		const Command& command = commands[i];
+		if (command.type == CommandType::StencilClear) {
+			for (Rml::Vector<uint32_t>& bin : tile_commands) {
+				bin.push_back(i);
+			}
+			continue;
+		}
+
+		const Triangle& triangle = triangles[command.triangle];
+		int tile_x0 = triangle.min_x / TILE_SIZE;
+		int tile_x1 = triangle.max_x / TILE_SIZE;
+		int tile_y0 = triangle.min_y / TILE_SIZE;
+		int tile_y1 = triangle.max_y / TILE_SIZE;
+		for (int ty = tile_y0; ty <= tile_y1; ty++) {
+			for (int tx = tile_x0; tx <= tile_x1; tx++) {
+				tile_commands[ty * tiles_x + tx].push_back(i);
+			}
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		next_tile.store(0, std::memory_order_relaxed);
+		pool_active = (uint32_t)workers.size();
+		pool_generation++;
+	}
+	pool_start.notify_all();
+
+	RunTiles();
+
+	std::unique_lock<std::mutex> lock(pool_mutex);
+	pool_done.wait(lock, [this] { return pool_active == 0; });
+	lock.unlock();
+
+	// Textures released during the frame may have been referenced by recorded triangles
+	for (TextureData* texture : released_textures) {
+		delete texture;
+	}
+	released_textures.clear();
+	triangles.clear();
+	commands.clear();
+}
+
+void RenderInterface_Software::Clear(Rml::ColourbPremultiplied colour) {
+	for (size_t i = 0; i < framebuffer.size(); i += 4) {
+		framebuffer[i + 0] = colour.red;
+		framebuffer[i + 1] = colour.green;
+		framebuffer[i + 2] = colour.blue;
+		framebuffer[i + 3] = colour.alpha;
+	}
+	std::fill(stencil.begin(), stencil.end(), 0);
+}
+
+bool RenderInterface_Software::SaveTGA(const char* path) const {
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return false;
+
+	// Uncompressed true colour, 32 bits per pixel, top-left origin
+	Rml::byte header[18] = {};
+	header[2] = 2;
+	header[12] = (Rml::byte)(width & 0xFF);
+	header[13] = (Rml::byte)(width >> 8);
+	header[14] = (Rml::byte)(height & 0xFF);
+	header[15] = (Rml::byte)(height >> 8);
+	header[16] = 32;
+	header[17] = 0x28;
+	fwrite(header, 1, sizeof(header), file);
+
+	Rml::Vector<Rml::byte> row(width * 4);
+	for (int y = 0; y < height; y++) {
+		const Rml::byte* src = framebuffer.data() + y * width * 4;
+		for (int x = 0; x < width; x++) {
+			row[x * 4 + 0] = src[x * 4 + 2];
+			row[x * 4 + 1] = src[x * 4 + 1];
+			row[x * 4 + 2] = src[x * 4 + 0];
+			row[x * 4 + 3] = src[x * 4 + 3];
+		}
+		fwrite(row.data(), 1, row.size(), file);
+	}
+
+	fclose(file);
+	return true;
+}
+
+Rml::CompiledGeometryHandle RenderInterface_Software::CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices) {
+	GeometryData* geometry = new GeometryData();
+	geometry->vertices.assign(vertices.begin(), vertices.end());
+	geometry->indices.assign(indices.begin(), indices.end());
+	return reinterpret_cast<Rml::CompiledGeometryHandle>(geometry);
+}
+
+void RenderInterface_Software::ReleaseGeometry(Rml::CompiledGeometryHandle geometry) {
+	// Recorded triangles hold copies of the vertex data, so geometry can be freed right away
+	delete reinterpret_cast<GeometryData*>(geometry);
+}
+
+void RenderInterface_Software::RenderGeometry(Rml::CompiledGeometryHandle handle, Rml::Vector2f translation, Rml::TextureHandle texture) {
+	if (!handle)
+		return;
+
+	Command command = {};
+	command.type = CommandType::Draw;
+	command.stencil_test = clip_mask_enabled;
+	command.stencil_value = stencil_test_value;
+	SubmitGeometry(reinterpret_cast<const GeometryData*>(handle), translation, reinterpret_cast<const TextureData*>(texture), command);
+}
+
+Rml::TextureHandle RenderInterface_Software::LoadTexture(Rml::Vector2i& texture_dimensions, const Rml::String& source) {
+	Rml::FileInterface* file_interface = Rml::GetFileInterface();
+	Rml::FileHandle file_handle = file_interface->Open(source);
+	if (!file_handle)
+		return 0;
+
+	Rml::Vector<Rml::byte> file_data(file_interface->Length(file_handle));
+	file_interface->Read(file_data.data(), file_data.size(), file_handle);
+	file_interface->Close(file_handle);
+
+	Rml::Vector<Rml::byte> pixels;
+	if (!TGA::Decode(Rml::Span<const Rml::byte>(file_data.data(), file_data.size()), pixels, texture_dimensions))
+		return 0;
+
+	return GenerateTexture(Rml::Span<const Rml::byte>(pixels.data(), pixels.size()), texture_dimensions);
+}
+
+Rml::TextureHandle RenderInterface_Software::GenerateTexture(Rml::Span<const Rml::byte> source, Rml::Vector2i source_dimensions) {
+	if (source_dimensions.x <= 0 || source_dimensions.y <= 0)
+		return 0;
+
+	const size_t num_pixels = (size_t)source_dimensions.x * source_dimensions.y;
+	const size_t bytes_per_pixel = source.size() / num_pixels;
+	if (bytes_per_pixel != 4 && bytes_per_pixel != 1)
+		return 0;
+
+	TextureData* texture = new TextureData();
+	texture->width = source_dimensions.x;
+	texture->height = source_dimensions.y;
+	if (bytes_per_pixel == 4) {
+		texture->texels.assign(source.begin(), source.begin() + num_pixels * 4);
+	} else {
+		// Single channel - a distance field like the GX2 renderer assumes. There is no screen-space derivative here,
+		// so the edge is resolved once with a fixed width of about one texel at the font engine's spread.
+		const float edge_width = 1.0f / 16.0f;
+		texture->texels.resize(num_pixels * 4);
+		for (size_t i = 0; i < num_pixels; i++) {
+			float t = std::clamp((source[i] / 255.0f - (0.5f - edge_width)) / (2.0f * edge_width), 0.0f, 1.0f);
+			Rml::byte coverage = (Rml::byte)(t * t * (3.0f - 2.0f * t) * 255.0f + 0.5f);
+			texture->texels[i * 4 + 0] = coverage;
+			texture->texels[i * 4 + 1] = coverage;
+			texture->texels[i * 4 + 2] = coverage;
+			texture->texels[i * 4 + 3] = coverage;
+		}
+	}
+	return reinterpret_cast<Rml::TextureHandle>(texture);
+}
+
+void RenderInterface_Software::ReleaseTexture(Rml::TextureHandle texture_handle) {
+	if (!texture_handle)
+		return;
+	released_textures.push_back(reinterpret_cast<TextureData*>(texture_handle));
+}
+
+void RenderInterface_Software::EnableScissorRegion(bool enable) {
+	scissor_enabled = enable;
+}
+
+void RenderInterface_Software::SetScissorRegion(Rml::Rectanglei region) {
+	scissor_region = region;
+}
+
+void RenderInterface_Software::EnableClipMask(bool enable) {
+	clip_mask_enabled = enable;
+}
+
+void RenderInterface_Software::RenderToClipMask(Rml::ClipMaskOperation operation, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation) {
+	if (!geometry)
+		return;
+
+	// Same stencil scheme as the RmlUi GL3 backend
+	Command command = {};
+	switch (operation) {
+	case Rml::ClipMaskOperation::Set:
+		commands.push_back({ CommandType::StencilClear, StencilOp::Replace, false, 0, 0 });
+		command = { CommandType::StencilWrite, StencilOp::Replace, false, 1, 0 };
+		stencil_test_value = 1;
+		break;
+	case Rml::ClipMaskOperation::SetInverse:
+		commands.push_back({ CommandType::StencilClear, StencilOp::Replace, false, 1, 0 });
+		command = { CommandType::StencilWrite, StencilOp::Replace, false, 0, 0 };
+		stencil_test_value = 1;
+		break;
+	case Rml::ClipMaskOperation::Intersect:
+		command = { CommandType::StencilWrite, StencilOp::IncrementIfEqual, true, stencil_test_value, 0 };
+		stencil_test_value++;
+		break;
+	}
+	SubmitGeometry(reinterpret_cast<const GeometryData*>(geometry), translation, nullptr, command);
+}
+
+void RenderInterface_Software::SetTransform(const Rml::Matrix4f* transform) {
+	transform_enabled = (transform != nullptr);
+	transform_matrix = transform ? *transform : Rml::Matrix4f::Identity();
+}
+
+void RenderInterface_Software::SubmitGeometry(const GeometryData* geometry, Rml::Vector2f translation, const TextureData* texture, Command command) {
+	// Clip bounds: viewport, intersected with the scissor region when enabled
+	int clip_x0 = 0, clip_y0 = 0, clip_x1 = width - 1, clip_y1 = height - 1;
+	if (scissor_enabled) {
+		clip_x0 = std::max(clip_x0, scissor_region.Left());
+		clip_y0 = std::max(clip_y0, scissor_region.Top());
+		clip_x1 = std::min(clip_x1, scissor_region.Right() - 1);
+		clip_y1 = std::min(clip_y1, scissor_region.Bottom() - 1);
+	}
+	if (clip_x0 > clip_x1 || clip_y0 > clip_y1)
+		return;
+
+	const float* m = transform_matrix.data();
+	const Rml::Vector<Rml::Vertex>& vertices = geometry->vertices;
+	const Rml::Vector<int>& indices = geometry->indices;
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		float sx[3], sy[3];
+		const Rml::Vertex* v[3];
+		bool visible = true;
+		for (int k = 0; k < 3; k++) {
+			v[k] = &vertices[indices[i + k]];
+			float x = v[k]->position.x + translation.x;
+			float y = v[k]->position.y + translation.y;
+			if (transform_enabled) {
+				// Column-major, z = 0
+				float tx = m[0] * x + m[4] * y + m[12];
+				float ty = m[1] * x + m[5] * y + m[13];
+				float tw = m[3] * x + m[7] * y + m[15];
+				if (tw <= 0.0f) {
+					visible = false;
+					break;
+				}
+				x = tx / tw;
+				y = ty / tw;
+			}
+			sx[k] = x;
+			sy[k] = y;
+		}
+		if (!visible)
+			continue;
+
+		float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+		if (area == 0.0f || !std::isfinite(area))
+			continue;
+		// No culling, flip clockwise triangles so the edge functions are positive inside
+		if (area < 0.0f) {
+			std::swap(sx[1], sx[2]);
+			std::swap(sy[1], sy[2]);
+			std::swap(v[1], v[2]);
+			area = -area;
+		}
+
+		Triangle triangle;
+		triangle.min_x = std::max(clip_x0, (int)std::floor(std::min({ sx[0], sx[1], sx[2] })));
+		triangle.min_y = std::max(clip_y0, (int)std::floor(std::min({ sy[0], sy[1], sy[2] })));
+		triangle.max_x = std::min(clip_x1, (int)std::ceil(std::max({ sx[0], sx[1], sx[2] })));
+		triangle.max_y = std::min(clip_y1, (int)std::ceil(std::max({ sy[0], sy[1], sy[2] })));
+		if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y)
+			continue;
+
+		// Edge k is opposite to vertex k
+		for (int k = 0; k < 3; k++) {
+			int a = (k + 1) % 3;
+			int b = (k + 2) % 3;
+			triangle.edge_a[k] = sy[a] - sy[b];
+			triangle.edge_b[k] = sx[b] - sx[a];
+			triangle.edge_c[k] = sx[a] * sy[b] - sy[a] * sx[b];
+			// Top-left fill rule, pixels exactly on other edges belong to the neighbouring triangle
+			triangle.top_left[k] = triangle.edge_a[k] > 0.0f || (triangle.edge_a[k] == 0.0f && triangle.edge_b[k] < 0.0f);
+		}
+
+		const float attributes[6][3] = {
+			{ v[0]->tex_coord.x, v[1]->tex_coord.x, v[2]->tex_coord.x },
+			{ v[0]->tex_coord.y, v[1]->tex_coord.y, v[2]->tex_coord.y },
+			{ v[0]->colour.red / 255.0f, v[1]->colour.red / 255.0f, v[2]->colour.red / 255.0f },
+			{ v[0]->colour.green / 255.0f, v[1]->colour.green / 255.0f, v[2]->colour.green / 255.0f },
+			{ v[0]->colour.blue / 255.0f, v[1]->colour.blue / 255.0f, v[2]->colour.blue / 255.0f },
+			{ v[0]->colour.alpha / 255.0f, v[1]->colour.alpha / 255.0f, v[2]->colour.alpha / 255.0f },
+		};
+		const float inv_area = 1.0f / area;
+		for (int n = 0; n < 6; n++) {
+			triangle.plane_dx[n] = (triangle.edge_a[0] * attributes[n][0] + triangle.edge_a[1] * attributes[n][1] + triangle.edge_a[2] * attributes[n][2]) * inv_area;
+			triangle.plane_dy[n] = (triangle.edge_b[0] * attributes[n][0] + triangle.edge_b[1] * attributes[n][1] + triangle.edge_b[2] * attributes[n][2]) * inv_area;
+			triangle.plane_base[n] = (triangle.edge_c[0] * attributes[n][0] + triangle.edge_c[1] * attributes[n][1] + triangle.edge_c[2] * attributes[n][2]) * inv_area;
+		}
+		triangle.texture = texture;
+
+		command.triangle = (uint32_t)triangles.size();
+		triangles.push_back(triangle);
+		commands.push_back(command);
+	}
+}
+
+void RenderInterface_Software::RasterizeTile(uint32_t tile_index) {
+	const int tile_x0 = (int)(tile_index % tiles_x) * TILE_SIZE;
+	const int tile_y0 = (int)(tile_index / tiles_x) * TILE_SIZE;
+	const int tile_x1 = std::min(tile_x0 + TILE_SIZE, width) - 1;
+	const int tile_y1 = std::min(tile_y0 + TILE_SIZE, height) - 1;
+
+	const f32x4 lane_offset = { 0.5f, 1.5f, 2.5f, 3.5f };
+	const i32x4 lane_index = { 0, 1, 2, 3 };
+
+	for (uint32_t command_index : tile_commands[tile_index]) {
+		const Command& command = commands[command_index];
+
+		if (command.type == CommandType::StencilClear) {
+			for (int y = tile_y0; y <= tile_y1; y++) {
+				std::memset(&stencil[y * width + tile_x0], command.stencil_value, tile_x1 - tile_x0 + 1);
+			}
+			continue;
+		}
+
+		const Triangle& triangle = triangles[command.triangle];
+		const int x0 = std::max(tile_x0, triangle.min_x);
+		const int x1 = std::min(tile_x1, triangle.max_x);
+		const int y0 = std::max(tile_y0, triangle.min_y);
+		const int y1 = std::min(tile_y1, triangle.max_y);
+		if (x0 > x1 || y0 > y1)
+			continue;
+
+		const TextureData* texture = triangle.texture;
+
+		for (int y = y0; y <= y1; y++) {
+			const float py = (float)y + 0.5f;
+			for (int x = x0; x <= x1; x += LANES) {
+				const f32x4 px = Splat((float)x) + lane_offset;
+				const f32x4 vy = Splat(py);
+
+				// Coverage of four pixels at once
+				i32x4 inside = (lane_index + x) <= x1;
+				for (int k = 0; k < 3; k++) {
+					const f32x4 w = Splat(triangle.edge_a[k]) * px + Splat(triangle.edge_b[k]) * vy + Splat(triangle.edge_c[k]);
+					if (triangle.top_left[k]) {
+						inside &= (w >= 0.0f);
+					} else {
+						inside &= (w > 0.0f);
+					}
+				}
+				if (!(inside[0] | inside[1] | inside[2] | inside[3]))
+					continue;
+
+				if (command.type == CommandType::StencilWrite) {
+					for (int lane = 0; lane < LANES; lane++) {
+						if (!inside[lane])
+							continue;
+						uint8_t& value = stencil[y * width + x + lane];
+						if (command.stencil_op == StencilOp::Replace) {
+							value = command.stencil_value;
+						} else if (value == command.stencil_value) {
+							value++;
+						}
+					}
+					continue;
+				}
+
+				// Interpolate u, v, r, g, b, a for all lanes
+				f32x4 attribute[6];
+				for (int n = 0; n < 6; n++) {
+					attribute[n] = Splat(triangle.plane_dx[n]) * px + Splat(triangle.plane_dy[n]) * vy + Splat(triangle.plane_base[n]);
+				}
+
+				for (int lane = 0; lane < LANES; lane++) {
+					if (!inside[lane])
+						continue;
+					const int pixel = y * width + x + lane;
+					if (command.stencil_test && stencil[pixel] != command.stencil_value)
+						continue;
+
+					float src[4] = { attribute[2][lane], attribute[3][lane], attribute[4][lane], attribute[5][lane] };
+					if (texture) {
+						float texel[4];
+						SampleBilinear(texture->texels.data(), texture->width, texture->height, attribute[0][lane], attribute[1][lane], texel);
+						for (int c = 0; c < 4; c++) {
+							src[c] *= texel[c];
+						}
+					}
+
+					// Premultiplied alpha: dst = src + dst * (1 - src.a)
+					Rml::byte* dst = &framebuffer[pixel * 4];
+					const float inv_alpha = 1.0f - Clamp01(src[3]);
+					for (int c = 0; c < 4; c++) {
+						dst[c] = ToByte(src[c] + (float)dst[c] * (1.0f / 255.0f) * inv_alpha);
+					}
+				}
+			}
+		}
+	}
+}
+
+void RenderInterface_Software::RunTiles() {
+	const uint32_t num_tiles = (uint32_t)tile_commands.size();
+	for (uint32_t tile = next_tile.fetch_add(1); tile < num_tiles; tile = next_tile.fetch_add(1)) {
+		RasterizeTile(tile);
+	}
+}
+
+void RenderInterface_Software::WorkerMain() {
+	uint64_t seen_generation = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(pool_mutex);
+			pool_start.wait(lock, [&] { return pool_quit || pool_generation != seen_generation; });
+			if (pool_quit)
+				return;
+			seen_generation = pool_generation;
+		}
+
+		RunTiles();
+
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		if (--pool_active == 0) {
+			pool_done.notify_one();
+		}
+	}
+}
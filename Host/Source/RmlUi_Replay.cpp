@@ -0,0 +1,379 @@
+/*
+ * RmlUi render call-stream replay implementation
+ */
+
+#include "RmlUi_Replay.h"
+#include "RmlUi_Capture.h"
+#include "profiler.hpp"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+uint32_t ByteSwap32(uint32_t x) {
+	return ((x >> 24) & 0x000000FF) | ((x >> 8) & 0x0000FF00) | ((x << 8) & 0x00FF0000) | ((x << 24) & 0xFF000000);
+}
+
+class Reader {
+public:
+	Reader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+	void SetSwap(bool enable) { swap = enable; }
+	bool AtEnd() const { return offset >= size; }
+
+	bool ReadBytes(void* out, size_t count) {
+		if (size - offset < count)
+			return false;
+		std::memcpy(out, data + offset, count);
+		offset += count;
+		return true;
+	}
+
+	template <typename T>
+	bool Read(T& out) {
+		static_assert(sizeof(T) == 1 || sizeof(T) == 4, "Capture values are 8 or 32 bits wide");
+		if (!ReadBytes(&out, sizeof(T)))
+			return false;
+		if (sizeof(T) == 4 && swap) {
+			uint32_t value;
+			std::memcpy(&value, &out, 4);
+			value = ByteSwap32(value);
+			std::memcpy(&out, &value, 4);
+		}
+		return true;
+	}
+
+private:
+	const uint8_t* data;
+	size_t size;
+	size_t offset = 0;
+	bool swap = false;
+};
+
+bool ReadFile(const char* path, Rml::Vector<uint8_t>& contents) {
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (length < 0) {
+		fclose(file);
+		return false;
+	}
+
+	contents.resize((size_t)length);
+	size_t read = fread(contents.data(), 1, contents.size(), file);
+	fclose(file);
+	return read == contents.size();
+}
+
+template <typename Handle>
+Handle Lookup(const Rml::UnorderedMap<uint32_t, Handle>& handles, uint32_t id) {
+	auto it = handles.find(id);
+	return it != handles.end() ? it->second : Handle(0);
+}
+
+} // namespace
+
+namespace Replay {
+
+bool Run(const char* path, Rml::RenderInterface* target, Report& report) {
+	report = Report();
+
+	Rml::Vector<uint8_t> contents;
+	if (!ReadFile(path, contents)) {
+		report.error = "Failed to read capture file";
+		return false;
+	}
+
+	Reader reader(contents.data(), contents.size());
+
+	char magic[4];
+	uint32_t version = 0;
+	uint32_t endian_marker = 0;
+	if (!reader.ReadBytes(magic, sizeof(magic)) || std::memcmp(magic, Capture::MAGIC, sizeof(magic)) != 0 ||
+		!reader.Read(version) || !reader.Read(endian_marker))
+	{
+		report.error = "Not a capture file";
+		return false;
+	}
+
+	if (endian_marker == ByteSwap32(Capture::ENDIAN_MARKER)) {
+		reader.SetSwap(true);
+		version = ByteSwap32(version);
+	} else if (endian_marker != Capture::ENDIAN_MARKER) {
+		report.error = "Invalid endian marker";
+		return false;
+	}
+
+	if (version != Capture::VERSION) {
+		report.error = "Unsupported capture version";
+		return false;
+	}
+
+	Rml::UnorderedMap<uint32_t, Rml::CompiledGeometryHandle> geometries;
+	Rml::UnorderedMap<uint32_t, Rml::TextureHandle> textures;
+
+	// Commands outside of a frame are counted into a scratch report
+	FrameReport scratch;
+	FrameReport* frame = &scratch;
+	uint64_t frame_start = 0;
+
+	Rml::Vector<Rml::Vertex> vertices;
+	Rml::Vector<int> indices;
+	Rml::Vector<Rml::byte> pixels;
+
+	bool ok = true;
+	while (ok && !reader.AtEnd()) {
+		uint8_t op = 0;
+		ok = reader.Read(op);
+		if (!ok)
+			break;
+
+		switch (static_cast<Capture::Op>(op)) {
+		case Capture::Op::BeginFrame: {
+			FrameReport next;
+			ok = reader.Read(next.frame);
+			report.frames.push_back(next);
+			frame = &report.frames.back();
+			frame_start = Profiler::GetTicks();
+			break;
+		}
+		case Capture::Op::EndFrame: {
+			frame->time_us = Profiler::TicksToMicroseconds(Profiler::GetTicks() - frame_start);
+			frame = &scratch;
+			break;
+		}
+		case Capture::Op::CompileGeometry: {
+			uint32_t id = 0, num_vertices = 0, num_indices = 0;
+			ok = reader.Read(id) && reader.Read(num_vertices) && reader.Read(num_indices);
+			if (!ok)
+				break;
+
+			vertices.resize(num_vertices);
+			for (Rml::Vertex& vertex : vertices) {
+				ok = ok && reader.Read(vertex.position.x) && reader.Read(vertex.position.y) &&
+					reader.Read(vertex.colour.red) && reader.Read(vertex.colour.green) && reader.Read(vertex.colour.blue) &&
+					reader.Read(vertex.colour.alpha) && reader.Read(vertex.tex_coord.x) && reader.Read(vertex.tex_coord.y);
+			}
+			indices.resize(num_indices);
+			for (int& index : indices) {
+				ok = ok && reader.Read(index);
+			}
+			if (!ok)
+				break;
+
+			geometries[id] = target->CompileGeometry(Rml::Span<const Rml::Vertex>(vertices.data(), vertices.size()),
+				Rml::Span<const int>(indices.data(), indices.size()));
+			frame->geometry_compiled++;
+			break;
+		}
+		case Capture::Op::ReleaseGeometry: {
+			uint32_t id = 0;
+			ok = reader.Read(id);
+			Rml::CompiledGeometryHandle handle = Lookup(geometries, id);
+			if (ok && handle) {
+				target->ReleaseGeometry(handle);
+				geometries.erase(id);
+			}
+			frame->geometry_released++;
+			break;
+		}
+		case Capture::Op::RenderGeometry: {
+			uint32_t id = 0, texture = 0;
+			Rml::Vector2f translation;
+			ok = reader.Read(id) && reader.Read(translation.x) && reader.Read(translation.y) && reader.Read(texture);
+			Rml::CompiledGeometryHandle handle = Lookup(geometries, id);
+			if (ok && handle) {
+				target->RenderGeometry(handle, translation, Lookup(textures, texture));
+			}
+			frame->draw_calls++;
+			break;
+		}
+		case Capture::Op::GenerateTexture: {
+			uint32_t id = 0, num_bytes = 0;
+			Rml::Vector2i dimensions;
+			ok = reader.Read(id) && reader.Read(dimensions.x) && reader.Read(dimensions.y) && reader.Read(num_bytes);
+			if (!ok)
+				break;
+
+			pixels.resize(num_bytes);
+			ok = reader.ReadBytes(pixels.data(), pixels.size());
+			if (!ok)
+				break;
+
+			textures[id] = target->GenerateTexture(Rml::Span<const Rml::byte>(pixels.data(), pixels.size()), dimensions);
+			frame->textures_generated++;
+			break;
+		}
+		case Capture::Op::ReleaseTexture: {
+			uint32_t id = 0;
+			ok = reader.Read(id);
+			Rml::TextureHandle handle = Lookup(textures, id);
+			if (ok && handle) {
+				target->ReleaseTexture(handle);
+				textures.erase(id);
+			}
+			frame->textures_released++;
+			break;
+		}
+		case Capture::Op::EnableScissorRegion: {
+			uint8_t enable = 0;
+			ok = reader.Read(enable);
+			target->EnableScissorRegion(enable != 0);
+			frame->scissor_changes++;
+			break;
+		}
+		case Capture::Op::SetScissorRegion: {
+			int32_t left = 0, top = 0, width = 0, height = 0;
+			ok = reader.Read(left) && reader.Read(top) && reader.Read(width) && reader.Read(height);
+			target->SetScissorRegion(Rml::Rectanglei::FromPositionSize({ left, top }, { width, height }));
+			frame->scissor_changes++;
+			break;
+		}
+		case Capture::Op::EnableClipMask: {
+			uint8_t enable = 0;
+			ok = reader.Read(enable);
+			target->EnableClipMask(enable != 0);
+			frame->clip_mask_calls++;
+			break;
+		}
+		case Capture::Op::RenderToClipMask: {
+			uint8_t operation = 0;
+			uint32_t id = 0;
+			Rml::Vector2f translation;
+			ok = reader.Read(operation) && reader.Read(id) && reader.Read(translation.x) && reader.Read(translation.y);
+			Rml::CompiledGeometryHandle handle = Lookup(geometries, id);
+			if (ok && handle) {
+				target->RenderToClipMask(static_cast<Rml::ClipMaskOperation>(operation), handle, translation);
+			}
+			frame->clip_mask_calls++;
+			break;
+		}
+		case Capture::Op::SetTransform: {
+			uint8_t has_transform = 0;
+			ok = reader.Read(has_transform);
+			if (ok && has_transform) {
+				float values[16];
+				for (float& value : values) {
+					ok = ok && reader.Read(value);
+				}
+				Rml::Matrix4f transform = Rml::Matrix4f::FromColumnMajor(values);
+				if (ok) {
+					target->SetTransform(&transform);
+				}
+			} else if (ok) {
+				target->SetTransform(nullptr);
+			}
+			frame->transform_changes++;
+			break;
+		}
+		default:
+			report.error = "Unknown opcode";
+			ok = false;
+			break;
+		}
+	}
+
+	// Release whatever the capture left alive so the target ends up empty
+	for (auto& geometry : geometries) {
+		target->ReleaseGeometry(geometry.second);
+	}
+	for (auto& texture : textures) {
+		target->ReleaseTexture(texture.second);
+	}
+
+	if (!ok && report.error.empty()) {
+		report.error = "Truncated capture file";
+	}
+	return ok;
+}
+
+bool WriteReport(const Report& report, const char* path) {
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	FrameReport totals;
+	fputs("{\n  \"frames\": [\n", file);
+	for (size_t i = 0; i < report.frames.size(); i++) {
+		const FrameReport& frame = report.frames[i];
+		fprintf(file,
+			"    {\"frame\": %u, \"compiled\": %u, \"released\": %u, \"draws\": %u, \"textures\": %u, \"textures_released\": %u, "
+			"\"scissor\": %u, \"clip_mask\": %u, \"transforms\": %u, \"us\": %llu}%s\n",
+			frame.frame, frame.geometry_compiled, frame.geometry_released, frame.draw_calls, frame.textures_generated,
+			frame.textures_released, frame.scissor_changes, frame.clip_mask_calls, frame.transform_changes,
+			(unsigned long long)frame.time_us, i + 1 < report.frames.size() ? "," : "");
+
+		totals.geometry_compiled += frame.geometry_compiled;
+		totals.geometry_released += frame.geometry_released;
+		totals.draw_calls += frame.draw_calls;
+		totals.textures_generated += frame.textures_generated;
+		totals.time_us += frame.time_us;
+	}
+	fprintf(file,
+		"  ],\n  \"totals\": {\"frames\": %u, \"compiled\": %u, \"released\": %u, \"draws\": %u, \"textures\": %u, \"us\": %llu},\n",
+		(unsigned)report.frames.size(), totals.geometry_compiled, totals.geometry_released, totals.draw_calls,
+		totals.textures_generated, (unsigned long long)totals.time_us);
+	fprintf(file, "  \"error\": \"%s\"\n}\n", report.error.c_str());
+	fclose(file);
+	return true;
+}
+
+} // namespace Replay
+
+Rml::CompiledGeometryHandle RenderInterface_Null::CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices) {
+	(void)vertices;
+	(void)indices;
+	return next_handle++;
+}
+
+void RenderInterface_Null::ReleaseGeometry(Rml::CompiledGeometryHandle geometry) {
+	(void)geometry;
+}
+
+void RenderInterface_Null::RenderGeometry(Rml::CompiledGeometryHandle handle, Rml::Vector2f translation, Rml::TextureHandle texture) {
+	(void)handle;
+	(void)translation;
+	(void)texture;
+}
+
+Rml::TextureHandle RenderInterface_Null::LoadTexture(Rml::Vector2i& texture_dimensions, const Rml::String& source) {
+	(void)source;
+	texture_dimensions = Rml::Vector2i(1, 1);
+	return next_handle++;
+}
+
+Rml::TextureHandle RenderInterface_Null::GenerateTexture(Rml::Span<const Rml::byte> source, Rml::Vector2i source_dimensions) {
+	(void)source;
+	(void)source_dimensions;
+	return next_handle++;
+}
+
+void RenderInterface_Null::ReleaseTexture(Rml::TextureHandle texture_handle) {
+	(void)texture_handle;
+}
+
+void RenderInterface_Null::EnableScissorRegion(bool enable) {
+	(void)enable;
+}
+
+void RenderInterface_Null::SetScissorRegion(Rml::Rectanglei region) {
+	(void)region;
+}
+
+void RenderInterface_Null::EnableClipMask(bool enable) {
+	(void)enable;
+}
+
+void RenderInterface_Null::RenderToClipMask(Rml::ClipMaskOperation operation, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation) {
+	(void)operation;
+	(void)geometry;
+	(void)translation;
+}
+
+void RenderInterface_Null::SetTransform(const Rml::Matrix4f* transform) {
+	(void)transform;
+}
@@ -0,0 +1,387 @@
+#include "wut_standin.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#include "gfx_shader_mappedmem.h"
+
+namespace
+{
+    WutStandin::Counters counters = {};
+    bool log_enabled = true;
+    const char* failing_shader = nullptr;
+
+    // Display list being recorded, calls append to it instead of counting as GX2 calls
+    uint32_t recording_capacity = 0;
+    uint32_t recording_bytes = 0;
+    bool recording = false;
+
+    uint32_t AlignUp(uint32_t value, uint32_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    void Command()
+    {
+        if (recording) {
+            recording_bytes += WutStandin::DISPLAY_LIST_BYTES_PER_CALL;
+            return;
+        }
+        counters.gx2_calls++;
+        counters.command_bytes += WutStandin::DISPLAY_LIST_BYTES_PER_CALL;
+    }
+
+    void StateCommand()
+    {
+        Command();
+        if (!recording)
+            counters.state_calls++;
+    }
+
+    // Stand-in shaders have no uniform blocks, lookups by name come back as -1 and the uploads are still counted
+    GX2VertexShader empty_vertex_shader = {};
+    GX2PixelShader empty_pixel_shader = {};
+}
+
+namespace WutStandin
+{
+
+Counters GetCounters()
+{
+    return counters;
+}
+
+void ResetCounters()
+{
+    counters = {};
+}
+
+void SetLogEnabled(bool enabled)
+{
+    log_enabled = enabled;
+}
+
+void SetFailingShader(const char* name)
+{
+    failing_shader = name;
+}
+
+} // namespace WutStandin
+
+extern "C"
+{
+
+void GX2BeginDisplayList(void* displayList, uint32_t bytes)
+{
+    (void)displayList;
+    recording = true;
+    recording_capacity = bytes;
+    recording_bytes = 0;
+}
+
+uint32_t GX2EndDisplayList(void* displayList)
+{
+    (void)displayList;
+    recording = false;
+    if (recording_bytes > recording_capacity)
+        return 0;
+    counters.display_lists_recorded++;
+    return recording_bytes;
+}
+
+void GX2CallDisplayList(const void* displayList, uint32_t bytes)
+{
+    (void)displayList;
+    Command();
+    counters.display_lists_called++;
+    counters.display_list_bytes_called += bytes;
+}
+
+void GX2CalcSurfaceSizeAndAlignment(GX2Surface* surface)
+{
+    uint32_t bytes_per_pixel = surface->format == GX2_SURFACE_FORMAT_UNORM_R8 ? 1 : 4;
+    surface->pitch = AlignUp(surface->width, 32);
+    surface->alignment = 0x100;
+    surface->imageSize = surface->pitch * surface->height * bytes_per_pixel;
+}
+
+void GX2ClearColor(GX2ColorBuffer* colorBuffer, float red, float green, float blue, float alpha)
+{
+    (void)colorBuffer;
+    (void)red;
+    (void)green;
+    (void)blue;
+    (void)alpha;
+    Command();
+}
+
+void GX2DrawDone()
+{
+    Command();
+}
+
+void GX2DrawIndexedEx(GX2PrimitiveMode mode, uint32_t count, GX2IndexType indexType, const void* indices, uint32_t offset, uint32_t numInstances)
+{
+    (void)mode;
+    (void)count;
+    (void)indexType;
+    (void)indices;
+    (void)offset;
+    (void)numInstances;
+    Command();
+    counters.draws++;
+}
+
+void GX2InitColorBufferRegs(GX2ColorBuffer* colorBuffer)
+{
+    (void)colorBuffer;
+}
+
+void GX2InitSampler(GX2Sampler* sampler, GX2TexClampMode clampMode, GX2TexXYFilterMode minMagFilterMode)
+{
+    sampler->regs[0] = (uint32_t)clampMode;
+    sampler->regs[1] = (uint32_t)minMagFilterMode;
+}
+
+void GX2InitTextureRegs(GX2Texture* texture)
+{
+    (void)texture;
+}
+
+void GX2Invalidate(GX2InvalidateMode mode, void* buffer, uint32_t size)
+{
+    (void)buffer;
+    (void)size;
+    // A CPU-only invalidation is a cache flush, not a command
+    if (mode & ~GX2_INVALIDATE_MODE_CPU) {
+        Command();
+    }
+    counters.invalidations++;
+}
+
+void GX2SetAttribBuffer(uint32_t index, uint32_t size, uint32_t stride, const void* buffer)
+{
+    (void)index;
+    (void)size;
+    (void)stride;
+    (void)buffer;
+    StateCommand();
+}
+
+void GX2SetBlendControl(GX2RenderTarget target, GX2BlendMode colorSrcBlend, GX2BlendMode colorDstBlend, GX2BlendCombineMode colorCombine,
+    BOOL useAlphaBlend, GX2BlendMode alphaSrcBlend, GX2BlendMode alphaDstBlend, GX2BlendCombineMode alphaCombine)
+{
+    (void)target;
+    (void)colorSrcBlend;
+    (void)colorDstBlend;
+    (void)colorCombine;
+    (void)useAlphaBlend;
+    (void)alphaSrcBlend;
+    (void)alphaDstBlend;
+    (void)alphaCombine;
+    StateCommand();
+}
+
+void GX2SetColorBuffer(const GX2ColorBuffer* colorBuffer, GX2RenderTarget target)
+{
+    (void)colorBuffer;
+    (void)target;
+    StateCommand();
+}
+
+void GX2SetColorControl(GX2LogicOp rop3, uint8_t targetBlendEnable, BOOL multiWriteEnable, BOOL colorWriteEnable)
+{
+    (void)rop3;
+    (void)targetBlendEnable;
+    (void)multiWriteEnable;
+    (void)colorWriteEnable;
+    StateCommand();
+}
+
+void GX2SetCullOnlyControl(GX2FrontFace frontFace, BOOL cullFront, BOOL cullBack)
+{
+    (void)frontFace;
+    (void)cullFront;
+    (void)cullBack;
+    StateCommand();
+}
+
+void GX2SetDefaultState()
+{
+    StateCommand();
+}
+
+void GX2SetDepthOnlyControl(BOOL depthTest, BOOL depthWrite, GX2CompareFunction depthCompare)
+{
+    (void)depthTest;
+    (void)depthWrite;
+    (void)depthCompare;
+    StateCommand();
+}
+
+void GX2SetFetchShader(const GX2FetchShader* shader)
+{
+    (void)shader;
+    StateCommand();
+}
+
+void GX2SetPixelSampler(const GX2Sampler* sampler, uint32_t unit)
+{
+    (void)sampler;
+    (void)unit;
+    StateCommand();
+}
+
+void GX2SetPixelShader(const GX2PixelShader* shader)
+{
+    (void)shader;
+    StateCommand();
+}
+
+void GX2SetPixelTexture(const GX2Texture* texture, uint32_t unit)
+{
+    (void)texture;
+    (void)unit;
+    StateCommand();
+}
+
+void GX2SetScissor(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+    (void)x;
+    (void)y;
+    (void)width;
+    (void)height;
+    StateCommand();
+}
+
+void GX2SetShaderMode(GX2ShaderMode mode)
+{
+    (void)mode;
+    StateCommand();
+}
+
+void GX2SetVertexShader(const GX2VertexShader* shader)
+{
+    (void)shader;
+    StateCommand();
+}
+
+void GX2SetViewport(float x, float y, float width, float height, float nearZ, float farZ)
+{
+    (void)x;
+    (void)y;
+    (void)width;
+    (void)height;
+    (void)nearZ;
+    (void)farZ;
+    StateCommand();
+}
+
+BOOL GX2RCreateBufferUserMemory(GX2RBuffer* buffer, void* memory, uint32_t size)
+{
+    (void)size;
+    buffer->flags = buffer->flags | GX2R_RESOURCE_USER_MEMORY;
+    buffer->buffer = memory;
+    return TRUE;
+}
+
+void GX2RDestroyBufferEx(GX2RBuffer* buffer, GX2RResourceFlags flags)
+{
+    (void)flags;
+    // Only user memory buffers are created, their memory belongs to the caller
+    buffer->buffer = nullptr;
+}
+
+uint32_t GX2RGetBufferAlignment(GX2RResourceFlags flags)
+{
+    return (flags & GX2R_RESOURCE_BIND_UNIFORM_BLOCK) ? GX2_UNIFORM_BLOCK_ALIGNMENT : 0x40;
+}
+
+uint32_t GX2RGetBufferAllocationSize(GX2RBuffer* buffer)
+{
+    return AlignUp(buffer->elemSize * buffer->elemCount, GX2RGetBufferAlignment(buffer->flags));
+}
+
+void* GX2RLockBufferEx(GX2RBuffer* buffer, GX2RResourceFlags flags)
+{
+    (void)flags;
+    return buffer->buffer;
+}
+
+void GX2RUnlockBufferEx(GX2RBuffer* buffer, GX2RResourceFlags flags)
+{
+    (void)buffer;
+    if (!(flags & GX2R_RESOURCE_DISABLE_GPU_INVALIDATE)) {
+        Command();
+        counters.invalidations++;
+    }
+}
+
+void GX2RSetVertexUniformBlock(GX2RBuffer* buffer, uint32_t location, uint32_t offset)
+{
+    (void)buffer;
+    (void)location;
+    (void)offset;
+    StateCommand();
+}
+
+void GX2RSetPixelUniformBlock(GX2RBuffer* buffer, uint32_t location, uint32_t offset)
+{
+    (void)buffer;
+    (void)location;
+    (void)offset;
+    StateCommand();
+}
+
+BOOL WHBGfxLoadGFDShaderGroupMappedMem(WHBGfxShaderGroup* group, uint32_t index, const void* file)
+{
+    (void)index;
+    if (!file || (failing_shader && std::strcmp(static_cast<const char*>(file), failing_shader) == 0))
+        return FALSE;
+    group->vertexShader = &empty_vertex_shader;
+    group->pixelShader = &empty_pixel_shader;
+    return TRUE;
+}
+
+BOOL WHBGfxInitShaderAttribute(WHBGfxShaderGroup* group, const char* name, uint32_t buffer, uint32_t offset, GX2AttribFormat format)
+{
+    (void)name;
+    if (group->numAttributes >= 16)
+        return FALSE;
+    GX2AttribStream& attribute = group->attributes[group->numAttributes];
+    attribute.location = group->numAttributes++;
+    attribute.buffer = buffer;
+    attribute.offset = offset;
+    attribute.format = format;
+    return TRUE;
+}
+
+BOOL WHBGfxInitFetchShaderMappedMem(WHBGfxShaderGroup* group)
+{
+    group->fetchShader.size = 0;
+    group->fetchShader.program = nullptr;
+    return TRUE;
+}
+
+BOOL WHBGfxFreeShaderGroupMappedMem(WHBGfxShaderGroup* group)
+{
+    group->vertexShader = nullptr;
+    group->pixelShader = nullptr;
+    return TRUE;
+}
+
+BOOL WHBLogPrintf(const char* fmt, ...)
+{
+    if (!log_enabled)
+        return TRUE;
+
+    va_list args;
+    va_start(args, fmt);
+    std::vfprintf(stderr, fmt, args);
+    va_end(args);
+    std::fputc('\n', stderr);
+    return TRUE;
+}
+
+} // extern "C"
@@ -0,0 +1,281 @@
+#pragma once
+
+// Thin stand-ins for the parts of wut the plugin uses outside of its hooks, so the renderer, gx2_extra and the file
+// interface build and run on Linux. Only the declarations the plugin needs are here, every header under this
+// directory includes this one. Types keep the wut member names the plugin touches, not the console layout.
+// GX2 calls do no GPU work, they are counted (see WutStandin) and display lists only grow by a fixed size per call.
+
+#include <cstddef>
+#include <cstdint>
+
+typedef int32_t BOOL;
+#define TRUE 1
+#define FALSE 0
+#define GX2_TRUE 1
+#define GX2_FALSE 0
+
+enum GX2AAMode { GX2_AA_MODE1X };
+enum GX2AttribFormat { GX2_ATTRIB_FORMAT_FLOAT_32_32, GX2_ATTRIB_FORMAT_UNORM_8_8_8_8 };
+enum GX2BlendCombineMode { GX2_BLEND_COMBINE_MODE_ADD };
+enum GX2BlendMode { GX2_BLEND_MODE_ONE, GX2_BLEND_MODE_ZERO, GX2_BLEND_MODE_INV_SRC_ALPHA, GX2_BLEND_MODE_SRC_ALPHA };
+enum GX2CompareFunction { GX2_COMPARE_FUNC_NEVER, GX2_COMPARE_FUNC_ALWAYS, GX2_COMPARE_FUNC_LEQUAL };
+enum GX2FrontFace { GX2_FRONT_FACE_CCW };
+enum GX2IndexType { GX2_INDEX_TYPE_U32 };
+enum GX2InvalidateMode
+{
+    GX2_INVALIDATE_MODE_TEXTURE = 0x2,
+    GX2_INVALIDATE_MODE_UNIFORM_BLOCK = 0x4,
+    GX2_INVALIDATE_MODE_COLOR_BUFFER = 0x8,
+    GX2_INVALIDATE_MODE_CPU = 0x40,
+    GX2_INVALIDATE_MODE_CPU_ATTRIBUTE_BUFFER = 0x41,
+    GX2_INVALIDATE_MODE_CPU_TEXTURE = 0x42,
+};
+enum GX2LogicOp { GX2_LOGIC_OP_COPY };
+enum GX2PrimitiveMode { GX2_PRIMITIVE_MODE_TRIANGLES };
+enum GX2RenderTarget { GX2_RENDER_TARGET_0 };
+enum GX2ShaderMode { GX2_SHADER_MODE_UNIFORM_BLOCK };
+enum GX2SurfaceDim { GX2_SURFACE_DIM_TEXTURE_2D };
+enum GX2SurfaceFormat { GX2_SURFACE_FORMAT_INVALID, GX2_SURFACE_FORMAT_UNORM_R8, GX2_SURFACE_FORMAT_UNORM_R8_G8_B8_A8 };
+enum GX2SurfaceUse { GX2_SURFACE_USE_TEXTURE = 1, GX2_SURFACE_USE_COLOR_BUFFER = 2 };
+enum GX2TexClampMode { GX2_TEX_CLAMP_MODE_CLAMP };
+enum GX2TexXYFilterMode { GX2_TEX_XY_FILTER_MODE_POINT, GX2_TEX_XY_FILTER_MODE_LINEAR };
+enum GX2TileMode { GX2_TILE_MODE_DEFAULT, GX2_TILE_MODE_LINEAR_ALIGNED };
+enum GX2RResourceFlags
+{
+    GX2R_RESOURCE_BIND_NONE = 0,
+    GX2R_RESOURCE_BIND_UNIFORM_BLOCK = 1 << 2,
+    GX2R_RESOURCE_USAGE_CPU_READ = 1 << 11,
+    GX2R_RESOURCE_USAGE_CPU_WRITE = 1 << 12,
+    GX2R_RESOURCE_USAGE_GPU_READ = 1 << 13,
+    GX2R_RESOURCE_DISABLE_CPU_INVALIDATE = 1 << 20,
+    GX2R_RESOURCE_DISABLE_GPU_INVALIDATE = 1 << 21,
+    GX2R_RESOURCE_USER_MEMORY = 1 << 29,
+};
+
+// The plugin combines these flags like wut's WUT_ENUM_BITMASK_TYPE allows
+inline GX2InvalidateMode operator|(GX2InvalidateMode a, GX2InvalidateMode b) { return (GX2InvalidateMode)((int)a | (int)b); }
+inline GX2SurfaceUse operator|(GX2SurfaceUse a, GX2SurfaceUse b) { return (GX2SurfaceUse)((int)a | (int)b); }
+inline GX2RResourceFlags operator|(GX2RResourceFlags a, GX2RResourceFlags b) { return (GX2RResourceFlags)((int)a | (int)b); }
+
+enum { GX2_SQ_SEL_R, GX2_SQ_SEL_G, GX2_SQ_SEL_B, GX2_SQ_SEL_A, GX2_SQ_SEL_0, GX2_SQ_SEL_1 };
+#define GX2_COMP_MAP(r, g, b, a) (((r) << 24) | ((g) << 16) | ((b) << 8) | (a))
+
+#define GX2_VERTEX_BUFFER_ALIGNMENT 0x40
+#define GX2_INDEX_BUFFER_ALIGNMENT 0x20
+#define GX2_UNIFORM_BLOCK_ALIGNMENT 0x100
+#define GX2_DISPLAY_LIST_ALIGNMENT 0x20
+
+struct GX2Surface
+{
+    GX2SurfaceDim dim;
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    uint32_t mipLevels;
+    GX2SurfaceFormat format;
+    GX2AAMode aa;
+    GX2SurfaceUse use;
+    uint32_t imageSize;
+    void* image;
+    uint32_t mipmapSize;
+    void* mipmaps;
+    GX2TileMode tileMode;
+    uint32_t swizzle;
+    uint32_t alignment;
+    uint32_t pitch;
+    uint32_t mipLevelOffset[13];
+};
+
+struct GX2Texture
+{
+    GX2Surface surface;
+    uint32_t viewFirstMip;
+    uint32_t viewNumMips;
+    uint32_t viewFirstSlice;
+    uint32_t viewNumSlices;
+    uint32_t compMap;
+    uint32_t regs[5];
+};
+
+struct GX2ColorBuffer
+{
+    GX2Surface surface;
+    uint32_t viewMip;
+    uint32_t viewFirstSlice;
+    uint32_t viewNumSlices;
+    void* aaBuffer;
+    uint32_t aaSize;
+    uint32_t regs[5];
+};
+
+struct GX2Sampler
+{
+    uint32_t regs[3];
+};
+
+struct GX2UniformBlock
+{
+    const char* name;
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct GX2UniformVar
+{
+    const char* name;
+    uint32_t type;
+    uint32_t count;
+    uint32_t offset;
+    int32_t block;
+};
+
+struct GX2VertexShader
+{
+    uint32_t uniformBlockCount;
+    GX2UniformBlock* uniformBlocks;
+    uint32_t uniformVarCount;
+    GX2UniformVar* uniformVars;
+};
+
+struct GX2PixelShader
+{
+    uint32_t uniformBlockCount;
+    GX2UniformBlock* uniformBlocks;
+    uint32_t uniformVarCount;
+    GX2UniformVar* uniformVars;
+};
+
+struct GX2FetchShader
+{
+    uint32_t size;
+    void* program;
+};
+
+struct GX2AttribStream
+{
+    uint32_t location;
+    uint32_t buffer;
+    uint32_t offset;
+    GX2AttribFormat format;
+};
+
+struct GX2RBuffer
+{
+    GX2RResourceFlags flags;
+    uint32_t elemSize;
+    uint32_t elemCount;
+    void* buffer;
+};
+
+enum VPADTouchPadValidity { VPAD_VALID = 0, VPAD_INVALID_X = 1, VPAD_INVALID_Y = 2 };
+enum VPADButtons
+{
+    VPAD_BUTTON_B = 0x4000,
+    VPAD_BUTTON_A = 0x8000,
+};
+
+struct VPADTouchData
+{
+    uint16_t x;
+    uint16_t y;
+    uint16_t touched;
+    uint16_t validity;
+};
+
+struct VPADStatus
+{
+    uint32_t hold;
+    uint32_t trigger;
+    uint32_t release;
+    VPADTouchData tpNormal;
+};
+
+struct WHBGfxShaderGroup
+{
+    GX2FetchShader fetchShader;
+    void* fetchShaderProgram;
+    GX2PixelShader* pixelShader;
+    GX2VertexShader* vertexShader;
+    uint32_t numAttributes;
+    GX2AttribStream attributes[16];
+};
+
+extern "C"
+{
+// gx2
+void GX2BeginDisplayList(void* displayList, uint32_t bytes);
+uint32_t GX2EndDisplayList(void* displayList);
+void GX2CallDisplayList(const void* displayList, uint32_t bytes);
+void GX2CalcSurfaceSizeAndAlignment(GX2Surface* surface);
+void GX2ClearColor(GX2ColorBuffer* colorBuffer, float red, float green, float blue, float alpha);
+void GX2DrawDone();
+void GX2DrawIndexedEx(GX2PrimitiveMode mode, uint32_t count, GX2IndexType indexType, const void* indices, uint32_t offset, uint32_t numInstances);
+void GX2InitColorBufferRegs(GX2ColorBuffer* colorBuffer);
+void GX2InitSampler(GX2Sampler* sampler, GX2TexClampMode clampMode, GX2TexXYFilterMode minMagFilterMode);
+void GX2InitTextureRegs(GX2Texture* texture);
+void GX2Invalidate(GX2InvalidateMode mode, void* buffer, uint32_t size);
+void GX2SetAttribBuffer(uint32_t index, uint32_t size, uint32_t stride, const void* buffer);
+void GX2SetBlendControl(GX2RenderTarget target, GX2BlendMode colorSrcBlend, GX2BlendMode colorDstBlend, GX2BlendCombineMode colorCombine,
+    BOOL useAlphaBlend, GX2BlendMode alphaSrcBlend, GX2BlendMode alphaDstBlend, GX2BlendCombineMode alphaCombine);
+void GX2SetColorBuffer(const GX2ColorBuffer* colorBuffer, GX2RenderTarget target);
+void GX2SetColorControl(GX2LogicOp rop3, uint8_t targetBlendEnable, BOOL multiWriteEnable, BOOL colorWriteEnable);
+void GX2SetCullOnlyControl(GX2FrontFace frontFace, BOOL cullFront, BOOL cullBack);
+void GX2SetDefaultState();
+void GX2SetDepthOnlyControl(BOOL depthTest, BOOL depthWrite, GX2CompareFunction depthCompare);
+void GX2SetFetchShader(const GX2FetchShader* shader);
+void GX2SetPixelSampler(const GX2Sampler* sampler, uint32_t unit);
+void GX2SetPixelShader(const GX2PixelShader* shader);
+void GX2SetPixelTexture(const GX2Texture* texture, uint32_t unit);
+void GX2SetScissor(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+void GX2SetShaderMode(GX2ShaderMode mode);
+void GX2SetVertexShader(const GX2VertexShader* shader);
+void GX2SetViewport(float x, float y, float width, float height, float nearZ, float farZ);
+
+// gx2r
+BOOL GX2RCreateBufferUserMemory(GX2RBuffer* buffer, void* memory, uint32_t size);
+void GX2RDestroyBufferEx(GX2RBuffer* buffer, GX2RResourceFlags flags);
+uint32_t GX2RGetBufferAlignment(GX2RResourceFlags flags);
+uint32_t GX2RGetBufferAllocationSize(GX2RBuffer* buffer);
+void* GX2RLockBufferEx(GX2RBuffer* buffer, GX2RResourceFlags flags);
+void GX2RUnlockBufferEx(GX2RBuffer* buffer, GX2RResourceFlags flags);
+void GX2RSetVertexUniformBlock(GX2RBuffer* buffer, uint32_t location, uint32_t offset);
+void GX2RSetPixelUniformBlock(GX2RBuffer* buffer, uint32_t location, uint32_t offset);
+
+// whb, the shader group loaders are those of gfx_shader_mappedmem.h
+BOOL WHBGfxInitShaderAttribute(WHBGfxShaderGroup* group, const char* name, uint32_t buffer, uint32_t offset, GX2AttribFormat format);
+BOOL WHBLogPrintf(const char* fmt, ...);
+}
+
+// Bookkeeping of the stand-ins, for the host tools and tests
+namespace WutStandin
+{
+
+struct Counters
+{
+    // Every GX2 and GX2R call made while not recording a display list, the cost the hooks care about
+    uint32_t gx2_calls;
+    uint32_t draws;
+    uint32_t state_calls;
+    uint32_t invalidations;
+    uint32_t display_lists_recorded;
+    uint32_t display_lists_called;
+    // Written to the command buffer by those calls, DISPLAY_LIST_BYTES_PER_CALL each
+    uint32_t command_bytes;
+    // Of the display lists called, the GPU reads them without the CPU writing them again
+    uint32_t display_list_bytes_called;
+};
+
+Counters GetCounters();
+void ResetCounters();
+
+// WHBLogPrintf goes to stderr while enabled, which is the default
+void SetLogEnabled(bool enabled);
+
+// Stand-in shader files hold the shader's name, loading the one named here fails. nullptr, the default, loads every one.
+void SetFailingShader(const char* name);
+
+// Bytes each call adds to a display list while recording, or to the command buffer otherwise. Real packets differ in
+// size from call to call, the stand-ins charge every one the same.
+constexpr uint32_t DISPLAY_LIST_BYTES_PER_CALL = 16;
+
+} // namespace WutStandin
@@ -0,0 +1,41 @@
+#pragma once
+
+// Assertions of the host tests. Every test is its own executable, failed checks are printed and counted and the
+// exit code of CheckResult tells make whether the test passed.
+
+#include <cstdio>
+
+namespace Check
+{
+    inline int failures = 0;
+}
+
+#define CHECK(condition)                                                                            \
+    do {                                                                                            \
+        if (!(condition)) {                                                                         \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);     \
+            Check::failures++;                                                                      \
+        }                                                                                           \
+    } while (0)
+
+// For integral values, prints both sides when they differ
+#define CHECK_EQ(actual, expected)                                                                  \
+    do {                                                                                            \
+        long long check_actual = (long long)(actual);                                               \
+        long long check_expected = (long long)(expected);                                           \
+        if (check_actual != check_expected) {                                                       \
+            std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, \
+                #actual, #expected, check_actual, check_expected);                                  \
+            Check::failures++;                                                                      \
+        }                                                                                           \
+    } while (0)
+
+inline int CheckResult(const char* test)
+{
+    if (Check::failures > 0) {
+        std::fprintf(stderr, "%s: %d check(s) failed\n", test, Check::failures);
+        return 1;
+    }
+    std::printf("%s: passed\n", test);
+    return 0;
+}
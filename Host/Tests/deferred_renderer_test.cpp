@@ -0,0 +1,386 @@
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <RmlUi/Core.h>
+#include "RmlUi_Renderer_Deferred.h"
+#include "check.hpp"
+
+// A recording thread and a present thread hand command lists over through RenderInterface_Deferred, like the UI
+// thread and the present hook. Every frame's geometry and texture carry the frame number, so a replay mixing commands
+// of two frames (tearing) or drawing a resource the present side already destroyed shows up in the checking target.
+// Layers, filters and shaders are replayed into a target logging its calls, with the handles it returned.
+
+namespace
+{
+    const int FRAMES = 2000;
+    const int DRAWS_PER_FRAME = 16;
+
+    // Present side target, only used by the present thread
+    class CheckingTarget : public Rml::RenderInterface
+    {
+    public:
+        struct Resource
+        {
+            int frame;
+            bool released;
+        };
+
+        std::vector<Resource> geometries;
+        std::vector<Resource> textures;
+
+        // Draws of the current replay
+        std::vector<int> draw_frames;
+        std::vector<int> draw_order;
+        int errors = 0;
+
+        Rml::CompiledGeometryHandle CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices) override
+        {
+            (void)indices;
+            geometries.push_back({ (int)vertices[0].position.x, false });
+            return geometries.size();
+        }
+
+        void ReleaseGeometry(Rml::CompiledGeometryHandle geometry) override
+        {
+            Resource& resource = geometries[geometry - 1];
+            errors += resource.released;
+            resource.released = true;
+        }
+
+        void RenderGeometry(Rml::CompiledGeometryHandle handle, Rml::Vector2f translation, Rml::TextureHandle texture) override
+        {
+            const Resource& geometry = geometries[handle - 1];
+            const Resource& bound = textures[texture - 1];
+            // Drawing a destroyed resource, or one of another frame than the command
+            errors += geometry.released || bound.released;
+            errors += geometry.frame != (int)translation.x || bound.frame != (int)translation.x;
+            draw_frames.push_back((int)translation.x);
+            draw_order.push_back((int)translation.y);
+        }
+
+        Rml::TextureHandle LoadTexture(Rml::Vector2i& texture_dimensions, const Rml::String& source) override
+        {
+            (void)texture_dimensions;
+            (void)source;
+            return 0;
+        }
+
+        Rml::TextureHandle GenerateTexture(Rml::Span<const Rml::byte> source, Rml::Vector2i source_dimensions) override
+        {
+            (void)source_dimensions;
+            int frame = source[0] | (source[1] << 8) | (source[2] << 16);
+            textures.push_back({ frame, false });
+            return textures.size();
+        }
+
+        void ReleaseTexture(Rml::TextureHandle texture) override
+        {
+            Resource& resource = textures[texture - 1];
+            errors += resource.released;
+            resource.released = true;
+        }
+
+        void EnableScissorRegion(bool enable) override { (void)enable; }
+        void SetScissorRegion(Rml::Rectanglei region) override { (void)region; }
+    };
+
+    void Record(RenderInterface_Deferred& deferred)
+    {
+        Rml::CompiledGeometryHandle previous_geometry = 0;
+        Rml::TextureHandle previous_texture = 0;
+        for (int frame = 1; frame <= FRAMES; frame++)
+        {
+            // Released while the previous frame's list may still be replayed
+            deferred.ReleaseGeometry(previous_geometry);
+            if (previous_texture)
+            {
+                deferred.ReleaseTexture(previous_texture);
+            }
+
+            Rml::Vertex vertices[3] = {};
+            vertices[0].position = Rml::Vector2f((float)frame, 0.0f);
+            const int indices[3] = { 0, 1, 2 };
+            Rml::CompiledGeometryHandle geometry = deferred.CompileGeometry(Rml::Span<const Rml::Vertex>(vertices, 3), Rml::Span<const int>(indices, 3));
+            const Rml::byte pixel[4] = { (Rml::byte)(frame & 0xFF), (Rml::byte)((frame >> 8) & 0xFF), (Rml::byte)(frame >> 16), 255 };
+            Rml::TextureHandle texture = deferred.GenerateTexture(Rml::Span<const Rml::byte>(pixel, 4), Rml::Vector2i(1, 1));
+
+            deferred.BeginRecording();
+            for (int draw = 0; draw < DRAWS_PER_FRAME; draw++)
+            {
+                deferred.RenderGeometry(geometry, Rml::Vector2f((float)frame, (float)draw), texture);
+                if (draw % 4 == 0)
+                {
+                    // Give the present side a chance to run in the middle of a recording
+                    std::this_thread::yield();
+                }
+            }
+            deferred.EndRecording();
+
+            previous_geometry = geometry;
+            previous_texture = texture;
+        }
+    }
+
+    // Handles of each kind in their own range, the log shows which one a call got
+    class LoggingTarget : public Rml::RenderInterface
+    {
+    public:
+        std::vector<std::string> log;
+        std::set<uintptr_t> live;
+        uintptr_t next_layer = 10;
+        uintptr_t next_filter = 100;
+        uintptr_t next_mask = 200;
+        uintptr_t next_saved = 300;
+        uintptr_t next_shader = 400;
+        int errors = 0;
+
+        void Log(const std::string& call, uintptr_t a = 0, uintptr_t b = 0)
+        {
+            log.push_back(call + " " + std::to_string(a) + " " + std::to_string(b));
+        }
+
+        uintptr_t Create(uintptr_t& next)
+        {
+            live.insert(next);
+            return next++;
+        }
+
+        void Destroy(uintptr_t handle)
+        {
+            errors += live.erase(handle) != 1;
+        }
+
+        Rml::CompiledGeometryHandle CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices) override
+        {
+            (void)vertices;
+            (void)indices;
+            return 1;
+        }
+
+        void ReleaseGeometry(Rml::CompiledGeometryHandle geometry) override { (void)geometry; }
+
+        void RenderGeometry(Rml::CompiledGeometryHandle handle, Rml::Vector2f translation, Rml::TextureHandle texture) override
+        {
+            (void)handle;
+            (void)translation;
+            Log("RenderGeometry", texture);
+        }
+
+        Rml::TextureHandle LoadTexture(Rml::Vector2i& texture_dimensions, const Rml::String& source) override
+        {
+            (void)texture_dimensions;
+            (void)source;
+            return 0;
+        }
+
+        Rml::TextureHandle GenerateTexture(Rml::Span<const Rml::byte> source, Rml::Vector2i source_dimensions) override
+        {
+            (void)source;
+            (void)source_dimensions;
+            return 0;
+        }
+
+        void ReleaseTexture(Rml::TextureHandle texture) override { Destroy(texture); }
+        void EnableScissorRegion(bool enable) override { (void)enable; }
+        void SetScissorRegion(Rml::Rectanglei region) override { (void)region; }
+
+        Rml::LayerHandle PushLayer() override
+        {
+            Log("PushLayer", next_layer);
+            return next_layer++;
+        }
+
+        void CompositeLayers(Rml::LayerHandle source, Rml::LayerHandle destination, Rml::BlendMode blend_mode,
+            Rml::Span<const Rml::CompiledFilterHandle> filters) override
+        {
+            Log("CompositeLayers", source, destination);
+            errors += blend_mode != Rml::BlendMode::Replace;
+            for (Rml::CompiledFilterHandle filter : filters)
+            {
+                Log("Filter", filter);
+            }
+        }
+
+        void PopLayer() override { Log("PopLayer"); }
+
+        Rml::TextureHandle SaveLayerAsTexture() override
+        {
+            Log("SaveLayerAsTexture", next_saved);
+            return Create(next_saved);
+        }
+
+        Rml::CompiledFilterHandle SaveLayerAsMaskImage() override
+        {
+            Log("SaveLayerAsMaskImage", next_mask);
+            return Create(next_mask);
+        }
+
+        Rml::CompiledFilterHandle CompileFilter(const Rml::String& name, const Rml::Dictionary& parameters) override
+        {
+            Log("CompileFilter " + name, next_filter, parameters.size());
+            return Create(next_filter);
+        }
+
+        void ReleaseFilter(Rml::CompiledFilterHandle filter) override { Destroy(filter); }
+
+        Rml::CompiledShaderHandle CompileShader(const Rml::String& name, const Rml::Dictionary& parameters) override
+        {
+            Log("CompileShader " + name, next_shader, parameters.size());
+            return Create(next_shader);
+        }
+
+        void RenderShader(Rml::CompiledShaderHandle shader, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation,
+            Rml::TextureHandle texture) override
+        {
+            (void)geometry;
+            (void)translation;
+            Log("RenderShader", shader, texture);
+        }
+
+        void ReleaseShader(Rml::CompiledShaderHandle shader) override { Destroy(shader); }
+    };
+
+    void TestLayersFiltersShaders()
+    {
+        RenderInterface_Deferred deferred;
+        LoggingTarget target;
+
+        Rml::Vertex vertices[3] = {};
+        const int indices[3] = { 0, 1, 2 };
+        Rml::CompiledGeometryHandle geometry = deferred.CompileGeometry(Rml::Span<const Rml::Vertex>(vertices, 3), Rml::Span<const int>(indices, 3));
+        Rml::Dictionary parameters;
+        parameters["value"] = Rml::Variant(0.5f);
+        Rml::CompiledFilterHandle opacity = deferred.CompileFilter("opacity", parameters);
+        Rml::CompiledShaderHandle gradient = deferred.CompileShader("linear-gradient", parameters);
+
+        // Like a backdrop filter and a mask image on an element drawn with a gradient
+        deferred.BeginRecording();
+        Rml::LayerHandle layer = deferred.PushLayer();
+        CHECK(layer != 0);
+        Rml::TextureHandle saved = deferred.SaveLayerAsTexture();
+        deferred.RenderGeometry(geometry, Rml::Vector2f(), saved);
+        Rml::CompiledFilterHandle mask = deferred.SaveLayerAsMaskImage();
+        deferred.RenderShader(gradient, geometry, Rml::Vector2f(), saved);
+        const Rml::CompiledFilterHandle filters[2] = { opacity, mask };
+        deferred.CompositeLayers(layer, 0, Rml::BlendMode::Replace, Rml::Span<const Rml::CompiledFilterHandle>(filters, 2));
+        deferred.PopLayer();
+        deferred.EndRecording();
+
+        CHECK(target.log.empty());
+        CHECK(deferred.Replay(&target));
+        const std::vector<std::string> first = {
+            "PushLayer 10 0",
+            "SaveLayerAsTexture 300 0",
+            "RenderGeometry 300 0",
+            "SaveLayerAsMaskImage 200 0",
+            "CompileShader linear-gradient 400 1",
+            "RenderShader 400 300",
+            "CompileFilter opacity 100 1",
+            "CompositeLayers 10 0",
+            "Filter 100 0",
+            "Filter 200 0",
+            "PopLayer 0 0",
+        };
+        CHECK(target.log == first);
+
+        // Replayed again, filters and shaders stay compiled, the layer is saved again and the previous copy released
+        target.log.clear();
+        CHECK(deferred.Replay(&target));
+        const std::vector<std::string> second = {
+            "PushLayer 11 0",
+            "SaveLayerAsTexture 301 0",
+            "RenderGeometry 301 0",
+            "SaveLayerAsMaskImage 201 0",
+            "RenderShader 400 301",
+            "CompositeLayers 11 0",
+            "Filter 100 0",
+            "Filter 201 0",
+            "PopLayer 0 0",
+        };
+        CHECK(target.log == second);
+        CHECK_EQ(target.live.size(), 4);
+
+        // Released like geometry and textures, once no list can replay them anymore
+        deferred.ReleaseTexture(saved);
+        deferred.ReleaseFilter(mask);
+        deferred.ReleaseFilter(opacity);
+        deferred.ReleaseShader(gradient);
+        deferred.ReleaseGeometry(geometry);
+        CHECK(deferred.Replay(&target));
+        CHECK_EQ(target.live.size(), 4);
+        deferred.BeginRecording();
+        deferred.EndRecording();
+        CHECK(deferred.Replay(&target));
+        CHECK_EQ(target.live.size(), 0);
+        CHECK_EQ(target.errors, 0);
+    }
+
+    void TestHandoff()
+    {
+        RenderInterface_Deferred deferred;
+        CheckingTarget target;
+        std::thread recorder(Record, std::ref(deferred));
+
+        std::set<int> frames_seen;
+        int last_frame = 0;
+        int torn = 0;
+        int reordered = 0;
+        int went_back = 0;
+        // The last published list is never replaced, so the present side always gets to it
+        while (last_frame < FRAMES)
+        {
+            target.draw_frames.clear();
+            target.draw_order.clear();
+            if (!deferred.Replay(&target))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            torn += (int)target.draw_frames.size() != DRAWS_PER_FRAME;
+            for (int draw = 0; draw < (int)target.draw_frames.size(); draw++)
+            {
+                torn += target.draw_frames[draw] != target.draw_frames[0];
+                reordered += target.draw_order[draw] != draw;
+            }
+            if (!target.draw_frames.empty())
+            {
+                went_back += target.draw_frames[0] < last_frame;
+                last_frame = target.draw_frames[0];
+                frames_seen.insert(last_frame);
+            }
+        }
+        recorder.join();
+
+        CHECK_EQ(torn, 0);
+        CHECK_EQ(reordered, 0);
+        CHECK_EQ(went_back, 0);
+        CHECK_EQ(target.errors, 0);
+        CHECK_EQ(last_frame, FRAMES);
+
+        // Every published list was either replayed or replaced before the present side got to it
+        RenderInterface_Deferred::Counters counters = deferred.GetCounters();
+        CHECK_EQ(counters.lists_published, FRAMES);
+        CHECK_EQ(counters.lists_dropped + frames_seen.size(), FRAMES);
+
+        // Everything the present side created is destroyed once both sides stopped, except the last frame's
+        // resources which RmlUi would still hold
+        deferred.ReleaseResources(&target);
+        int live_geometries = 0;
+        for (const CheckingTarget::Resource& geometry : target.geometries)
+        {
+            live_geometries += !geometry.released;
+        }
+        CHECK(live_geometries <= 1);
+        CHECK_EQ(target.errors, 0);
+    }
+}
+
+int main()
+{
+    TestHandoff();
+    TestLayersFiltersShaders();
+    return CheckResult("deferred_renderer_test");
+}
@@ -0,0 +1,348 @@
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "frame_scheduler.hpp"
+#include "check.hpp"
+
+// FrameScheduler on a fake clock: every slice advances the clock by its task's cost, and the frames add the cost of
+// the work they bracket. Budget 1000 us throughout. The hooks driving it from several threads at once run on the real
+// clock.
+
+namespace
+{
+    uint64_t now = 0;
+    // Names of the tasks in the order their slices ran
+    std::string order;
+
+    uint64_t FakeClock()
+    {
+        return now;
+    }
+
+    struct Work
+    {
+        char name;
+        int slices_left;
+        uint64_t slice_us;
+        FrameScheduler* requeue_into = nullptr;
+    };
+
+    bool Slice(void* user)
+    {
+        Work* work = static_cast<Work*>(user);
+        now += work->slice_us;
+        order += work->name;
+        // Deferring itself while running must not queue it twice
+        if (work->requeue_into)
+        {
+            work->requeue_into->Defer(Slice, work);
+        }
+        return --work->slices_left <= 0;
+    }
+
+    // Runs a frame that spends spent_us on its own work first, returns the slices run
+    uint32_t Frame(FrameScheduler& scheduler, uint64_t spent_us)
+    {
+        scheduler.Begin();
+        now += spent_us;
+        uint32_t slices = scheduler.RunDeferred();
+        scheduler.End();
+        scheduler.NextFrame();
+        return slices;
+    }
+
+    void Reset(FrameScheduler& scheduler)
+    {
+        now = 1000000;
+        order.clear();
+        scheduler.SetBudget(1000);
+    }
+
+    void TestBudgetAndTurns()
+    {
+        FrameScheduler scheduler(FakeClock);
+        Reset(scheduler);
+        Work a = { 'a', 10, 300 };
+        Work b = { 'b', 10, 300 };
+        Work c = { 'c', 10, 300 };
+        scheduler.Defer(Slice, &a);
+        scheduler.Defer(Slice, &b);
+        scheduler.Defer(Slice, &c);
+
+        // Tasks without a cost yet are tried while any budget is left, c takes the frame 100 us over
+        CHECK_EQ(Frame(scheduler, 200), 3);
+        CHECK(order == "abc");
+        CHECK_EQ(scheduler.GetStats().last_frame_us, 1100);
+
+        // Known costs, 300 each fit three times into a full budget
+        order.clear();
+        CHECK_EQ(Frame(scheduler, 0), 3);
+        CHECK(order == "abc");
+
+        // Only one fits next to 500 us of other work, the others keep their place
+        order.clear();
+        CHECK_EQ(Frame(scheduler, 500), 1);
+        CHECK(order == "a");
+        order.clear();
+        CHECK_EQ(Frame(scheduler, 0), 3);
+        CHECK(order == "bca");
+
+        // Within a frame every call gives each task one turn at most
+        order.clear();
+        scheduler.Begin();
+        CHECK_EQ(scheduler.GetRemaining(), 1000);
+        CHECK_EQ(scheduler.RunDeferred(), 3);
+        CHECK_EQ(scheduler.GetRemaining(), 100);
+        CHECK_EQ(scheduler.RunDeferred(), 0);
+        scheduler.End();
+        scheduler.NextFrame();
+        CHECK(order == "bca");
+
+        FrameScheduler::Stats stats = scheduler.GetStats();
+        CHECK_EQ(stats.slices, 13);
+        CHECK_EQ(stats.pending_tasks, 3);
+        CHECK_EQ(stats.forced_slices, 0);
+    }
+
+    void TestCheapTaskFitsFirst()
+    {
+        FrameScheduler scheduler(FakeClock);
+        Reset(scheduler);
+        Work expensive = { 'e', 10, 800 };
+        Work cheap = { 'c', 2, 50 };
+        scheduler.Defer(Slice, &expensive);
+        scheduler.Defer(Slice, &cheap);
+        Frame(scheduler, 0);
+        CHECK(order == "ec");
+
+        // 800 doesn't fit into the 300 left, the cheap one behind it does
+        order.clear();
+        CHECK_EQ(Frame(scheduler, 700), 1);
+        CHECK(order == "c");
+        FrameScheduler::Stats stats = scheduler.GetStats();
+        CHECK_EQ(stats.tasks_completed, 1);
+        CHECK_EQ(stats.pending_tasks, 1);
+    }
+
+    void TestDeferDedupe()
+    {
+        FrameScheduler scheduler(FakeClock);
+        Reset(scheduler);
+        Work a = { 'a', 3, 100 };
+        Work b = { 'b', 1, 100 };
+        CHECK(scheduler.Defer(Slice, &a));
+        CHECK(!scheduler.Defer(Slice, &a));
+        CHECK(scheduler.Defer(Slice, &b));
+        CHECK_EQ(scheduler.GetStats().pending_tasks, 2);
+
+        // A task deferring itself during its slice is still queued once
+        a.requeue_into = &scheduler;
+        Frame(scheduler, 0);
+        CHECK(order == "ab");
+        CHECK_EQ(scheduler.GetStats().pending_tasks, 1);
+
+        // A completed task can be queued again, Clear drops everything without running it
+        CHECK(scheduler.Defer(Slice, &b));
+        scheduler.Clear();
+        CHECK_EQ(scheduler.GetStats().pending_tasks, 0);
+        order.clear();
+        CHECK_EQ(Frame(scheduler, 0), 0);
+        CHECK(order.empty());
+    }
+
+    void TestStarvation()
+    {
+        FrameScheduler scheduler(FakeClock);
+        Reset(scheduler);
+        Work a = { 'a', 10, 100 };
+        scheduler.Defer(Slice, &a);
+
+        // Frames without budget left leave the task waiting, until it waited MAX_STARVED_FRAMES of them
+        for (uint32_t frame = 0; frame < FrameScheduler::MAX_STARVED_FRAMES; frame++)
+        {
+            CHECK_EQ(Frame(scheduler, 5000), 0);
+        }
+        CHECK(order.empty());
+        CHECK_EQ(Frame(scheduler, 5000), 1);
+        CHECK(order == "a");
+        CHECK_EQ(scheduler.GetStats().forced_slices, 1);
+
+        // Only one slice is forced, then the count starts over
+        for (uint32_t frame = 0; frame < FrameScheduler::MAX_STARVED_FRAMES; frame++)
+        {
+            CHECK_EQ(Frame(scheduler, 5000), 0);
+        }
+        CHECK_EQ(Frame(scheduler, 5000), 1);
+        CHECK_EQ(scheduler.GetStats().forced_slices, 2);
+
+        // A budget of 0 leaves tasks to starvation alone
+        scheduler.SetBudget(0);
+        for (uint32_t frame = 0; frame < FrameScheduler::MAX_STARVED_FRAMES; frame++)
+        {
+            CHECK_EQ(Frame(scheduler, 0), 0);
+        }
+        CHECK_EQ(Frame(scheduler, 0), 1);
+        CHECK_EQ(scheduler.GetStats().forced_slices, 3);
+    }
+
+    void TestHistogram()
+    {
+        FrameScheduler scheduler(FakeClock);
+        Reset(scheduler);
+        // At the budget, then over it by 10%, exactly 25%, 60%, 160%, 300% and 800%
+        const uint64_t frames[] = { 1000, 1100, 1250, 1600, 2600, 4000, 9000 };
+        for (uint64_t spent : frames)
+        {
+            Frame(scheduler, spent);
+        }
+
+        FrameScheduler::Stats stats = scheduler.GetStats();
+        CHECK_EQ(stats.frames, 7);
+        CHECK_EQ(stats.frames_over_budget, 6);
+        CHECK_EQ(stats.over_budget[0], 2);
+        CHECK_EQ(stats.over_budget[1], 0);
+        CHECK_EQ(stats.over_budget[2], 1);
+        CHECK_EQ(stats.over_budget[3], 1);
+        CHECK_EQ(stats.over_budget[4], 1);
+        CHECK_EQ(stats.over_budget[5], 1);
+        CHECK_EQ(stats.last_frame_us, 9000);
+
+        scheduler.ResetStats();
+        CHECK_EQ(scheduler.GetStats().frames, 0);
+        CHECK_EQ(scheduler.GetStats().over_budget[5], 0);
+    }
+
+    void TestSections()
+    {
+        FrameScheduler scheduler(FakeClock);
+        Reset(scheduler);
+
+        // Nested sections count once, time between sections doesn't count
+        scheduler.Begin();
+        now += 100;
+        scheduler.Begin();
+        now += 100;
+        scheduler.End();
+        CHECK_EQ(scheduler.GetRemaining(), 800);
+        scheduler.End();
+        now += 500;
+        scheduler.Begin();
+        now += 50;
+        scheduler.End();
+        // Unbalanced End is ignored
+        scheduler.End();
+        scheduler.NextFrame();
+        CHECK_EQ(scheduler.GetStats().last_frame_us, 250);
+
+        // A section still open at NextFrame is split between the two frames
+        scheduler.Begin();
+        now += 300;
+        scheduler.NextFrame();
+        CHECK_EQ(scheduler.GetStats().last_frame_us, 300);
+        now += 100;
+        scheduler.End();
+        scheduler.NextFrame();
+        CHECK_EQ(scheduler.GetStats().last_frame_us, 100);
+    }
+
+    void TestQueues()
+    {
+        FrameScheduler scheduler(FakeClock);
+        Reset(scheduler);
+        Work context = { 'c', 1, 100 };
+        Work render = { 'r', 1, 100 };
+        CHECK(scheduler.Defer(Slice, &context, 0));
+        CHECK(scheduler.Defer(Slice, &render, 1));
+        CHECK(!scheduler.Defer(Slice, &render, 2));
+
+        // Each queue only runs its own tasks
+        scheduler.Begin();
+        CHECK_EQ(scheduler.RunDeferred(1), 1);
+        CHECK(order == "r");
+        CHECK_EQ(scheduler.RunDeferred(1), 0);
+        scheduler.End();
+        scheduler.NextFrame();
+        CHECK_EQ(scheduler.GetStats().pending_tasks, 1);
+
+        // A queue run every frame doesn't keep another from starving, its task is forced as if alone. The frame above
+        // was its first one without a slice.
+        for (uint32_t frame = 1; frame < FrameScheduler::MAX_STARVED_FRAMES; frame++)
+        {
+            scheduler.Begin();
+            now += 5000;
+            CHECK_EQ(scheduler.RunDeferred(1), 0);
+            CHECK_EQ(scheduler.RunDeferred(0), 0);
+            scheduler.End();
+            scheduler.NextFrame();
+        }
+        scheduler.Begin();
+        CHECK_EQ(scheduler.RunDeferred(0), 1);
+        scheduler.End();
+        CHECK(order == "rc");
+        CHECK_EQ(scheduler.GetStats().forced_slices, 1);
+    }
+
+    std::atomic<uint32_t> slices_run{ 0 };
+
+    bool CountSlice(void* user)
+    {
+        (void)user;
+        slices_run++;
+        return true;
+    }
+
+    // Like the VPADRead hook updating the contexts, the GX2 hooks rendering them and the swap hook closing frames
+    void TestHookThreads()
+    {
+        FrameScheduler scheduler;
+        scheduler.SetBudget(1000000);
+        const uint32_t FRAMES = 20000;
+        std::atomic<bool> running{ true };
+
+        auto hook = [&](uint32_t queue, int* user)
+        {
+            while (running)
+            {
+                scheduler.Begin();
+                scheduler.Defer(CountSlice, user, queue);
+                scheduler.RunDeferred(queue);
+                scheduler.End();
+            }
+        };
+        int context_user = 0;
+        int render_user = 0;
+        std::thread context_thread(hook, 0, &context_user);
+        std::thread render_thread(hook, 1, &render_user);
+        for (uint32_t frame = 0; frame < FRAMES; frame++)
+        {
+            scheduler.NextFrame();
+            scheduler.GetStats();
+        }
+        running = false;
+        context_thread.join();
+        render_thread.join();
+
+        // Every slice and frame is counted once, the sections of both threads closed
+        FrameScheduler::Stats stats = scheduler.GetStats();
+        CHECK_EQ(stats.frames, FRAMES);
+        CHECK_EQ(stats.slices, slices_run.load());
+        CHECK_EQ(stats.tasks_completed, slices_run.load());
+        scheduler.NextFrame();
+        scheduler.NextFrame();
+        CHECK_EQ(scheduler.GetStats().last_frame_us, 0);
+    }
+}
+
+int main()
+{
+    TestBudgetAndTurns();
+    TestCheapTaskFitsFirst();
+    TestDeferDedupe();
+    TestStarvation();
+    TestHistogram();
+    TestSections();
+    TestQueues();
+    TestHookThreads();
+    return CheckResult("frame_scheduler_test");
+}
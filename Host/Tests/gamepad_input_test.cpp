@@ -0,0 +1,171 @@
+#include <vector>
+
+#include "gamepad_input.hpp"
+#include "check.hpp"
+
+// Synthetic VPADStatus sequences as the VPADRead hook would hand them over, newest first
+
+namespace
+{
+    struct Event
+    {
+        // 'm'ove, 'd'own, 'u'p or 'b'uttons
+        char kind;
+        int x;
+        int y;
+        uint32_t trigger;
+    };
+
+    void OnMove(void* user, const VPADTouchData& raw_touch)
+    {
+        static_cast<std::vector<Event>*>(user)->push_back({ 'm', raw_touch.x, raw_touch.y, 0 });
+    }
+
+    void OnTouch(void* user, bool down)
+    {
+        static_cast<std::vector<Event>*>(user)->push_back({ down ? 'd' : 'u', 0, 0, 0 });
+    }
+
+    void OnButtons(void* user, const VPADStatus& status)
+    {
+        static_cast<std::vector<Event>*>(user)->push_back({ 'b', 0, 0, status.trigger });
+    }
+
+    VPADStatus Sample(uint32_t trigger, bool touched = false, uint16_t x = 0, uint16_t y = 0, uint16_t validity = VPAD_VALID)
+    {
+        VPADStatus status = {};
+        status.trigger = trigger;
+        status.tpNormal.touched = touched ? 1 : 0;
+        status.tpNormal.x = x;
+        status.tpNormal.y = y;
+        status.tpNormal.validity = validity;
+        return status;
+    }
+
+    // Submits samples given oldest first the way VPADRead returns them, newest first
+    void SubmitInOrder(GamepadInput& input, std::vector<VPADStatus> samples)
+    {
+        std::vector<VPADStatus> newest_first(samples.rbegin(), samples.rend());
+        input.Submit(newest_first.data(), (uint32_t)newest_first.size());
+    }
+
+    std::vector<Event> Replay(GamepadInput& input)
+    {
+        VPADStatus samples[GamepadInput::MAX_SAMPLES];
+        uint32_t count = input.Take(samples);
+        std::vector<Event> events;
+        input.Process(samples, count, { &events, OnMove, OnTouch, OnButtons });
+        return events;
+    }
+
+    void TestQueueOrder()
+    {
+        GamepadInput input;
+        SubmitInOrder(input, { Sample(1), Sample(2), Sample(3) });
+        SubmitInOrder(input, { Sample(4) });
+
+        VPADStatus samples[GamepadInput::MAX_SAMPLES];
+        CHECK_EQ(input.Take(samples), 4);
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            CHECK_EQ(samples[i].trigger, i + 1);
+        }
+        CHECK_EQ(input.Take(samples), 0);
+    }
+
+    void TestOverflowKeepsNewest()
+    {
+        GamepadInput input;
+        std::vector<VPADStatus> first, second;
+        for (uint32_t i = 0; i < 10; i++)
+        {
+            first.push_back(Sample(1 + i));
+            second.push_back(Sample(11 + i));
+        }
+        SubmitInOrder(input, first);
+        SubmitInOrder(input, second);
+
+        VPADStatus samples[GamepadInput::MAX_SAMPLES];
+        CHECK_EQ(input.Take(samples), GamepadInput::MAX_SAMPLES);
+        CHECK_EQ(samples[0].trigger, 20 - GamepadInput::MAX_SAMPLES + 1);
+        CHECK_EQ(samples[GamepadInput::MAX_SAMPLES - 1].trigger, 20);
+    }
+
+    void TestButtonsOfEverySample()
+    {
+        GamepadInput input;
+        SubmitInOrder(input, { Sample(VPAD_BUTTON_A), Sample(0), Sample(VPAD_BUTTON_B) });
+        std::vector<Event> events = Replay(input);
+
+        CHECK_EQ(events.size(), 3);
+        if (events.size() == 3)
+        {
+            CHECK_EQ(events[0].trigger, VPAD_BUTTON_A);
+            CHECK_EQ(events[1].trigger, 0);
+            CHECK_EQ(events[2].trigger, VPAD_BUTTON_B);
+        }
+    }
+
+    void TestTouchMovesCoalesced()
+    {
+        GamepadInput input;
+        // Press at 10, drag over 20 and 30 with an invalid reading in between, released in the next frame
+        SubmitInOrder(input, { Sample(0), Sample(0, true, 10, 10), Sample(0, true, 20, 20), Sample(0, true, 99, 99, VPAD_INVALID_X),
+            Sample(0, true, 30, 30) });
+        std::vector<Event> events = Replay(input);
+
+        std::vector<Event> moves;
+        int downs = 0;
+        for (const Event& event : events)
+        {
+            if (event.kind == 'm')
+                moves.push_back(event);
+            downs += event.kind == 'd';
+        }
+        CHECK_EQ(downs, 1);
+        CHECK_EQ(moves.size(), 2);
+        if (moves.size() == 2)
+        {
+            CHECK_EQ(moves[0].x, 10);
+            CHECK_EQ(moves[1].x, 30);
+        }
+        // The press lands after the move to its position and before the buttons of its sample
+        CHECK(events.size() >= 4 && events[1].kind == 'm' && events[2].kind == 'd' && events[3].kind == 'b');
+        CHECK(!events.empty() && events.back().kind == 'm' && events.back().y == 30);
+
+        // Still held in the next call, no second press. Moved to 40 and released within the same call.
+        SubmitInOrder(input, { Sample(0, true, 40, 40), Sample(0) });
+        events = Replay(input);
+        CHECK_EQ(events.size(), 4);
+        if (events.size() == 4)
+        {
+            CHECK(events[0].kind == 'b');
+            CHECK(events[1].kind == 'm' && events[1].x == 40);
+            CHECK(events[2].kind == 'u');
+            CHECK(events[3].kind == 'b');
+        }
+    }
+
+    void TestHasInput()
+    {
+        VPADStatus held = Sample(0);
+        held.hold = VPAD_BUTTON_A;
+        VPADStatus samples[3] = { held, Sample(0), Sample(0, true, 1, 1) };
+        CHECK(!GamepadInput::HasInput(samples, 2));
+        CHECK(GamepadInput::HasInput(samples, 3));
+
+        VPADStatus released = Sample(0);
+        released.release = VPAD_BUTTON_B;
+        CHECK(GamepadInput::HasInput(&released, 1));
+    }
+}
+
+int main()
+{
+    TestQueueOrder();
+    TestOverflowKeepsNewest();
+    TestButtonsOfEverySample();
+    TestTouchMovesCoalesced();
+    TestHasInput();
+    return CheckResult("gamepad_input_test");
+}
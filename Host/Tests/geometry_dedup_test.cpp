@@ -0,0 +1,123 @@
+#include <vector>
+
+#include "RmlUi_Renderer_GX2.h"
+#include "wut_standin.h"
+#include "check.hpp"
+
+// The counters rmlui_document_stats reports for the geometry dedup table: hits and saved bytes of identical
+// geometry, the live entries as references come and go, and the private copies once the table is full.
+
+namespace
+{
+    struct Triangle
+    {
+        Rml::Vertex vertices[3] = {};
+        int indices[3] = { 0, 1, 2 };
+
+        explicit Triangle(float x)
+        {
+            vertices[0].position = Rml::Vector2f(x, 0.0f);
+            vertices[1].position = Rml::Vector2f(x + 8.0f, 0.0f);
+            vertices[2].position = Rml::Vector2f(x, 8.0f);
+        }
+
+        Rml::CompiledGeometryHandle Compile(RenderInterface_GX2& renderer) const
+        {
+            return renderer.CompileGeometry(Rml::Span<const Rml::Vertex>(vertices, 3), Rml::Span<const int>(indices, 3));
+        }
+    };
+
+    const uint32_t TRIANGLE_BYTES = 3 * sizeof(Rml::Vertex) + 3 * sizeof(int);
+
+    // CreateDeviceObjects compiles geometry of its own, the checks count from what it left behind
+    RenderInterface_GX2::Stats Since(const RenderInterface_GX2& renderer, const RenderInterface_GX2::Stats& base)
+    {
+        RenderInterface_GX2::Stats stats = renderer.GetCurrentStats();
+        stats.geometry_compiled -= base.geometry_compiled;
+        stats.geometry_dedup_hits -= base.geometry_dedup_hits;
+        stats.geometry_dedup_table_full -= base.geometry_dedup_table_full;
+        stats.geometry_dedup_saved_bytes -= base.geometry_dedup_saved_bytes;
+        stats.geometry_dedup_entries -= base.geometry_dedup_entries;
+        stats.geometry_bytes -= base.geometry_bytes;
+        return stats;
+    }
+
+    void TestHitsAndReferences()
+    {
+        RenderInterface_GX2 renderer;
+        renderer.CreateDeviceObjects();
+        const RenderInterface_GX2::Stats base = renderer.GetCurrentStats();
+
+        Rml::CompiledGeometryHandle first = Triangle(0).Compile(renderer);
+        Rml::CompiledGeometryHandle second = Triangle(0).Compile(renderer);
+        Rml::CompiledGeometryHandle other = Triangle(16).Compile(renderer);
+        RenderInterface_GX2::Stats stats = Since(renderer, base);
+        CHECK_EQ(stats.geometry_compiled, 3);
+        CHECK_EQ(stats.geometry_dedup_hits, 1);
+        CHECK_EQ(stats.geometry_dedup_saved_bytes, TRIANGLE_BYTES);
+        CHECK_EQ(stats.geometry_dedup_entries, 2);
+        CHECK_EQ(stats.geometry_bytes, 2 * TRIANGLE_BYTES);
+
+        // The payload stays shared until its last reference is released
+        renderer.ReleaseGeometry(first);
+        stats = Since(renderer, base);
+        CHECK_EQ(stats.geometry_dedup_saved_bytes, 0);
+        CHECK_EQ(stats.geometry_dedup_entries, 2);
+        renderer.ReleaseGeometry(second);
+        CHECK_EQ(Since(renderer, base).geometry_dedup_entries, 1);
+        renderer.ReleaseGeometry(other);
+        CHECK_EQ(Since(renderer, base).geometry_dedup_entries, 0);
+
+        // Entries are live state and carry over into the next frame, hits don't
+        Rml::CompiledGeometryHandle kept = Triangle(0).Compile(renderer);
+        Rml::CompiledGeometryHandle duplicate = Triangle(0).Compile(renderer);
+        renderer.BeginFrame();
+        stats = renderer.GetCurrentStats();
+        CHECK_EQ(stats.geometry_dedup_hits, 0);
+        CHECK_EQ(stats.geometry_dedup_entries, base.geometry_dedup_entries + 1);
+        renderer.EndFrame();
+        renderer.ReleaseGeometry(kept);
+        renderer.ReleaseGeometry(duplicate);
+
+        renderer.ReleaseDeviceObjects();
+    }
+
+    void TestTableFull()
+    {
+        RenderInterface_GX2 renderer;
+        renderer.CreateDeviceObjects();
+        const RenderInterface_GX2::Stats base = renderer.GetCurrentStats();
+
+        // One past what the table has room for
+        const uint32_t distinct = RenderInterface_GX2::MAX_SHARED_GEOMETRY - base.geometry_dedup_entries + 1;
+        std::vector<Rml::CompiledGeometryHandle> handles;
+        for (uint32_t i = 0; i < distinct; i++)
+        {
+            handles.push_back(Triangle((float)i).Compile(renderer));
+        }
+        RenderInterface_GX2::Stats stats = renderer.GetCurrentStats();
+        CHECK_EQ(stats.geometry_dedup_entries, RenderInterface_GX2::MAX_SHARED_GEOMETRY);
+        CHECK_EQ(stats.geometry_dedup_table_full - base.geometry_dedup_table_full, 1);
+
+        // The private copy is never found, identical geometry gets another one
+        handles.push_back(Triangle((float)(distinct - 1)).Compile(renderer));
+        stats = Since(renderer, base);
+        CHECK_EQ(stats.geometry_dedup_hits, 0);
+        CHECK_EQ(stats.geometry_dedup_table_full, 2);
+
+        for (Rml::CompiledGeometryHandle handle : handles)
+        {
+            renderer.ReleaseGeometry(handle);
+        }
+        CHECK_EQ(Since(renderer, base).geometry_dedup_entries, 0);
+        renderer.ReleaseDeviceObjects();
+    }
+}
+
+int main()
+{
+    WutStandin::SetLogEnabled(false);
+    TestHitsAndReferences();
+    TestTableFull();
+    return CheckResult("geometry_dedup_test");
+}
@@ -0,0 +1,262 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "RmlUi_GlyphCache.h"
+#include "check.hpp"
+
+// Glyph cache files of the size FontEngineInterface_SDF writes for printable ASCII: written, read back and parsed,
+// rejected when anything of the key or the layout doesn't match, and how long a hit takes to read and parse.
+
+namespace
+{
+    // Like FontEngineInterface_SDF's preloaded block
+    const uint32_t FIRST = 32;
+    const uint32_t LAST = 126;
+    const uint32_t ATLAS_WIDTH = 1024;
+    const uint32_t ATLAS_ROWS = 160;
+
+    GlyphCache::Key MakeKey()
+    {
+        const uint32_t range[2] = { FIRST, LAST };
+        GlyphCache::Key key = {};
+        key.font_hash = GlyphCache::Hash("font data", 9);
+        key.glyph_set_hash = GlyphCache::Hash(range, sizeof(range));
+        key.face_index = 0;
+        key.size = 32;
+        key.spread = 4;
+        key.atlas_width = ATLAS_WIDTH;
+        return key;
+    }
+
+    const GlyphCache::Metrics METRICS = { 25.5f, -6.5f, 38.0f, 15.0f, -3.0f, 1.5f };
+
+    struct Block
+    {
+        std::vector<GlyphCache::Glyph> glyphs;
+        std::vector<Rml::byte> atlas;
+
+        Block()
+        {
+            // 40x40 cells, 25 to a row of the atlas, the space has no bitmap
+            for (uint32_t character = FIRST; character <= LAST; character++)
+            {
+                const uint32_t index = character - FIRST;
+                GlyphCache::Glyph glyph = {};
+                glyph.character = character;
+                glyph.advance = 18.0f + (float)(index % 7);
+                glyph.left = (int16_t)(index % 3);
+                glyph.top = 24;
+                if (character != ' ')
+                {
+                    glyph.width = 36;
+                    glyph.height = 40;
+                    glyph.atlas_x = (uint16_t)((index % 25) * 40);
+                    glyph.atlas_y = (uint16_t)((index / 25) * 40);
+                }
+                glyphs.push_back(glyph);
+            }
+            atlas.resize((size_t)ATLAS_ROWS * ATLAS_WIDTH);
+            for (size_t i = 0; i < atlas.size(); i++)
+            {
+                atlas[i] = (Rml::byte)(i * 31 + i / ATLAS_WIDTH);
+            }
+        }
+
+        Rml::Vector<Rml::byte> Serialize(const GlyphCache::Key& key) const
+        {
+            return GlyphCache::Serialize(key, METRICS, Rml::Span<const GlyphCache::Glyph>(glyphs.data(), glyphs.size()),
+                atlas.data(), ATLAS_ROWS);
+        }
+    };
+
+    bool Parse(const Rml::Vector<Rml::byte>& contents, const GlyphCache::Key& key, GlyphCache::View& view)
+    {
+        return GlyphCache::Parse(Rml::Span<const Rml::byte>(contents.data(), contents.size()), key, view);
+    }
+
+    bool Parse(const Rml::Vector<Rml::byte>& contents, const GlyphCache::Key& key)
+    {
+        GlyphCache::View view;
+        return Parse(contents, key, view);
+    }
+
+    void TestRoundTrip()
+    {
+        const Block block;
+        const GlyphCache::Key key = MakeKey();
+        const Rml::Vector<Rml::byte> contents = block.Serialize(key);
+        CHECK_EQ(contents.size(), sizeof(GlyphCache::Header) + block.glyphs.size() * sizeof(GlyphCache::Glyph) +
+            block.atlas.size());
+
+        GlyphCache::View view;
+        CHECK(Parse(contents, key, view));
+        CHECK(std::memcmp(view.metrics, &METRICS, sizeof(METRICS)) == 0);
+        CHECK_EQ(view.glyphs.size(), block.glyphs.size());
+        CHECK(std::memcmp(view.glyphs.data(), block.glyphs.data(), block.glyphs.size() * sizeof(GlyphCache::Glyph)) == 0);
+        CHECK_EQ(view.atlas_rows, ATLAS_ROWS);
+        CHECK(std::memcmp(view.atlas, block.atlas.data(), block.atlas.size()) == 0);
+
+        // The view points into the buffer, nothing is copied
+        CHECK((const Rml::byte*)view.metrics >= contents.data());
+        CHECK(view.atlas + block.atlas.size() == contents.data() + contents.size());
+
+        // A face without glyphs or rows is still a valid block
+        GlyphCache::View empty;
+        Rml::Vector<Rml::byte> nothing = GlyphCache::Serialize(key, METRICS, Rml::Span<const GlyphCache::Glyph>(), nullptr, 0);
+        CHECK(Parse(nothing, key, empty));
+        CHECK_EQ(empty.glyphs.size(), 0);
+        CHECK_EQ(empty.atlas_rows, 0);
+    }
+
+    void TestWrongKey()
+    {
+        const Block block;
+        const GlyphCache::Key key = MakeKey();
+        const Rml::Vector<Rml::byte> contents = block.Serialize(key);
+
+        // Each field of the key on its own turns the file into a miss
+        GlyphCache::Key other = key;
+        other.font_hash ^= 1;
+        CHECK(!Parse(contents, other));
+        other = key;
+        other.glyph_set_hash ^= 1;
+        CHECK(!Parse(contents, other));
+        other = key;
+        other.face_index = 1;
+        CHECK(!Parse(contents, other));
+        other = key;
+        other.size = 48;
+        CHECK(!Parse(contents, other));
+        other = key;
+        other.spread = 8;
+        CHECK(!Parse(contents, other));
+        other = key;
+        other.atlas_width = 2048;
+        CHECK(!Parse(contents, other));
+
+        // So do another magic, version or byte order
+        Rml::Vector<Rml::byte> changed = contents;
+        changed[0] = 'X';
+        CHECK(!Parse(changed, key));
+        changed = contents;
+        GlyphCache::Header header;
+        std::memcpy(&header, changed.data(), sizeof(header));
+        header.version = GlyphCache::VERSION + 1;
+        std::memcpy(changed.data(), &header, sizeof(header));
+        CHECK(!Parse(changed, key));
+        header.version = GlyphCache::VERSION;
+        header.endian_marker = 0x04030201;
+        std::memcpy(changed.data(), &header, sizeof(header));
+        CHECK(!Parse(changed, key));
+    }
+
+    void TestTruncated()
+    {
+        const Block block;
+        const GlyphCache::Key key = MakeKey();
+        const Rml::Vector<Rml::byte> contents = block.Serialize(key);
+
+        // Cut inside the header, the glyph records and the atlas, and one byte too many
+        const size_t lengths[] = { 0, sizeof(GlyphCache::Header) - 1, sizeof(GlyphCache::Header) + 10,
+            contents.size() - block.atlas.size(), contents.size() - 1 };
+        for (size_t length : lengths)
+        {
+            Rml::Vector<Rml::byte> truncated(contents.begin(), contents.begin() + length);
+            CHECK(!Parse(truncated, key));
+        }
+        Rml::Vector<Rml::byte> longer = contents;
+        longer.push_back(0);
+        CHECK(!Parse(longer, key));
+
+        // A header claiming more glyphs than the file holds
+        Rml::Vector<Rml::byte> counted = contents;
+        GlyphCache::Header header;
+        std::memcpy(&header, counted.data(), sizeof(header));
+        header.glyph_count++;
+        std::memcpy(counted.data(), &header, sizeof(header));
+        CHECK(!Parse(counted, key));
+    }
+
+    void TestGlyphOutOfRange()
+    {
+        const GlyphCache::Key key = MakeKey();
+
+        // Reaching exactly to the right edge and the last row is fine, one past either is not
+        Block block;
+        GlyphCache::Glyph& glyph = block.glyphs.back();
+        glyph.atlas_x = (uint16_t)(ATLAS_WIDTH - glyph.width);
+        glyph.atlas_y = (uint16_t)(ATLAS_ROWS - glyph.height);
+        CHECK(Parse(block.Serialize(key), key));
+
+        glyph.atlas_x++;
+        CHECK(!Parse(block.Serialize(key), key));
+        glyph.atlas_x--;
+        glyph.atlas_y++;
+        CHECK(!Parse(block.Serialize(key), key));
+
+        // Sizes that would wrap around in 16 bits still fail
+        glyph.atlas_y = 0;
+        glyph.atlas_x = 0xffff;
+        glyph.width = 2;
+        CHECK(!Parse(block.Serialize(key), key));
+    }
+
+    void TestFileHit()
+    {
+        const Block block;
+        const GlyphCache::Key key = MakeKey();
+        const Rml::Vector<Rml::byte> contents = block.Serialize(key);
+        const std::string path = (std::filesystem::temp_directory_path() / "glyph_cache_test.sdf").string();
+
+        Rml::Vector<Rml::byte> missing;
+        std::remove(path.c_str());
+        CHECK(!GlyphCache::ReadFile(path.c_str(), missing));
+
+        // Written through a temporary file that doesn't stay behind
+        CHECK(GlyphCache::WriteFile(path.c_str(), contents));
+        CHECK(!std::filesystem::exists(path + ".tmp"));
+        CHECK(GlyphCache::WriteFile(path.c_str(), contents));
+
+        // What a later start does on a hit, timed over enough runs for the page cache to hold the file
+        const int RUNS = 200;
+        using Clock = std::chrono::steady_clock;
+        Clock::duration read_time = {};
+        Clock::duration parse_time = {};
+        bool hits = true;
+        for (int run = 0; run < RUNS; run++)
+        {
+            Rml::Vector<Rml::byte> read;
+            GlyphCache::View view;
+            Clock::time_point start = Clock::now();
+            hits &= GlyphCache::ReadFile(path.c_str(), read);
+            Clock::time_point parse_start = Clock::now();
+            hits &= Parse(read, key, view);
+            Clock::time_point end = Clock::now();
+            read_time += parse_start - start;
+            parse_time += end - parse_start;
+            hits &= read == contents;
+        }
+        CHECK(hits);
+        std::remove(path.c_str());
+
+        using std::chrono::nanoseconds;
+        std::printf("glyph_cache_test: hit of %zu glyphs and %u atlas rows (%zu bytes), read %lld ns, parsed %lld ns\n",
+            block.glyphs.size(), ATLAS_ROWS, contents.size(),
+            (long long)std::chrono::duration_cast<nanoseconds>(read_time).count() / RUNS,
+            (long long)std::chrono::duration_cast<nanoseconds>(parse_time).count() / RUNS);
+    }
+}
+
+int main()
+{
+    TestRoundTrip();
+    TestWrongKey();
+    TestTruncated();
+    TestGlyphOutOfRange();
+    TestFileHit();
+    return CheckResult("glyph_cache_test");
+}
@@ -0,0 +1,181 @@
+#include <chrono>
+#include <cstdio>
+
+#include <gx2/registers.h>
+#include <gx2/state.h>
+
+#include "RmlUi_Backend.h"
+#include "RmlUi_Renderer_GX2.h"
+#include "gx2_extra.hpp"
+#include "mapped_memory.hpp"
+#include "overlay_state.hpp"
+#include "wut_standin.h"
+#include "check.hpp"
+
+// OverlayState against the stand-in GX2 and the real renderer pipeline state. Counts the GX2 calls and command buffer
+// bytes each present costs the hook with the display lists and with the state set directly, as the hook did before
+// them, and times both. Stand-in calls cost nothing, so the host times only show the lookup and profiler scope Apply
+// adds. On console every call also writes to the command buffer, the counts are what the hook pays there.
+
+namespace
+{
+    RenderInterface_GX2* renderer = nullptr;
+
+    const uint32_t TIMED_PRESENTS = 10000;
+
+    GX2ColorBuffer MakeColorBuffer(void* image, uint32_t width, uint32_t height)
+    {
+        GX2ColorBuffer color_buffer = {};
+        color_buffer.surface.width = width;
+        color_buffer.surface.height = height;
+        color_buffer.surface.format = GX2_SURFACE_FORMAT_UNORM_R8_G8_B8_A8;
+        color_buffer.surface.image = image;
+        return color_buffer;
+    }
+
+    // The hook's setup before the display lists, what OverlayState::Apply still falls back to
+    void SetupDirectly(const GX2ColorBuffer* color_buffer)
+    {
+        GX2SetDefaultState();
+        GX2SetColorBuffer(color_buffer, GX2_RENDER_TARGET_0);
+        GX2SetViewport(0.0f, 0.0f, color_buffer->surface.width, color_buffer->surface.height, 0.0f, 1.0f);
+        GX2SetScissor(0, 0, color_buffer->surface.width, color_buffer->surface.height);
+        Backend::ApplyPipelineState();
+    }
+
+    template<typename Func>
+    double NanosecondsPerPresent(Func&& present)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < TIMED_PRESENTS; i++)
+        {
+            present();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / TIMED_PRESENTS;
+    }
+
+    void TestHookOverhead()
+    {
+        char image = 0;
+        GX2ColorBuffer color_buffer = MakeColorBuffer(&image, 1280, 720);
+
+        WutStandin::ResetCounters();
+        SetupDirectly(&color_buffer);
+        const WutStandin::Counters direct = WutStandin::GetCounters();
+
+        // The first present records the list, the following ones only call it
+        WutStandin::ResetCounters();
+        OverlayState::Apply(&color_buffer);
+        CHECK_EQ(WutStandin::GetCounters().display_lists_recorded, 1);
+
+        WutStandin::ResetCounters();
+        OverlayState::Apply(&color_buffer);
+        WutStandin::Counters applied = WutStandin::GetCounters();
+        CHECK_EQ(applied.gx2_calls, 1);
+        CHECK_EQ(applied.display_lists_called, 1);
+        CHECK_EQ(applied.display_lists_recorded, 0);
+        CHECK(applied.gx2_calls < direct.gx2_calls);
+
+        // The list holds what the direct setup writes every present, the hook only writes the call to it
+        CHECK_EQ(applied.command_bytes, WutStandin::DISPLAY_LIST_BYTES_PER_CALL);
+        CHECK(applied.command_bytes < direct.command_bytes);
+        CHECK_EQ(applied.display_list_bytes_called, direct.command_bytes);
+
+        double direct_ns = NanosecondsPerPresent([&]() { SetupDirectly(&color_buffer); });
+        double applied_ns = NanosecondsPerPresent([&]() { OverlayState::Apply(&color_buffer); });
+        std::printf("overlay_state_test: per present, direct %u GX2 calls %u bytes %.0f ns, "
+            "display list %u GX2 call %u bytes (list of %u) %.0f ns\n", direct.gx2_calls, direct.command_bytes, direct_ns,
+            applied.gx2_calls, applied.command_bytes, applied.display_list_bytes_called, applied_ns);
+
+        OverlayState::Release();
+    }
+
+    void TestRecordsPerConfiguration()
+    {
+        char images[OverlayState::MAX_TARGETS + 1] = {};
+        GX2ColorBuffer color_buffer = MakeColorBuffer(&images[0], 1280, 720);
+
+        WutStandin::ResetCounters();
+        OverlayState::Apply(&color_buffer);
+        // Swapped image, another size and another format each need their own list
+        color_buffer.surface.image = &images[1];
+        OverlayState::Apply(&color_buffer);
+        color_buffer.surface.width = 854;
+        color_buffer.surface.height = 480;
+        OverlayState::Apply(&color_buffer);
+        color_buffer.surface.format = GX2_SURFACE_FORMAT_UNORM_R8;
+        OverlayState::Apply(&color_buffer);
+        CHECK_EQ(WutStandin::GetCounters().display_lists_recorded, 4);
+
+        // Back to the first configuration, still cached
+        color_buffer = MakeColorBuffer(&images[0], 1280, 720);
+        WutStandin::ResetCounters();
+        OverlayState::Apply(&color_buffer);
+        CHECK_EQ(WutStandin::GetCounters().display_lists_recorded, 0);
+
+        OverlayState::Release();
+        CHECK_EQ(MappedMemory::GetTagStats(MappedMemory::Tag::DisplayList).live_count, 0);
+    }
+
+    void TestEvictsLeastRecentlyUsed()
+    {
+        char images[OverlayState::MAX_TARGETS + 1] = {};
+        GX2ColorBuffer buffers[OverlayState::MAX_TARGETS + 1];
+        for (uint32_t i = 0; i <= OverlayState::MAX_TARGETS; i++)
+        {
+            buffers[i] = MakeColorBuffer(&images[i], 1280, 720);
+        }
+
+        WutStandin::ResetCounters();
+        for (uint32_t i = 0; i < OverlayState::MAX_TARGETS; i++)
+        {
+            OverlayState::Apply(&buffers[i]);
+        }
+        // Keeps the first one in use, the second is the oldest when the extra buffer comes along
+        OverlayState::Apply(&buffers[0]);
+        OverlayState::Apply(&buffers[OverlayState::MAX_TARGETS]);
+        CHECK_EQ(WutStandin::GetCounters().display_lists_recorded, OverlayState::MAX_TARGETS + 1);
+        CHECK_EQ(MappedMemory::GetTagStats(MappedMemory::Tag::DisplayList).live_count, OverlayState::MAX_TARGETS);
+
+        WutStandin::ResetCounters();
+        OverlayState::Apply(&buffers[0]);
+        CHECK_EQ(WutStandin::GetCounters().display_lists_recorded, 0);
+        OverlayState::Apply(&buffers[1]);
+        CHECK_EQ(WutStandin::GetCounters().display_lists_recorded, 1);
+
+        OverlayState::Release();
+    }
+}
+
+// The parts of the backend OverlayState records
+namespace Backend
+{
+
+void PrepareRenderer()
+{
+    renderer->CreateDeviceObjects();
+    GX2FlushDeferredInvalidations();
+}
+
+void ApplyPipelineState()
+{
+    renderer->ApplyPipelineState();
+}
+
+} // namespace Backend
+
+int main()
+{
+    WutStandin::SetLogEnabled(false);
+    RenderInterface_GX2 render_interface;
+    renderer = &render_interface;
+    render_interface.CreateDeviceObjects();
+
+    TestHookOverhead();
+    TestRecordsPerConfiguration();
+    TestEvictsLeastRecentlyUsed();
+
+    render_interface.ReleaseDeviceObjects();
+    return CheckResult("overlay_state_test");
+}
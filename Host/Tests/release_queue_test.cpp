@@ -0,0 +1,116 @@
+#include <vector>
+
+#include "release_queue.hpp"
+#include "check.hpp"
+
+// ReleaseQueue driven by fake GPU timestamps, the submitted one advances with every flush of the command buffer and
+// the retired one trails behind it
+
+namespace
+{
+    uint64_t submitted = 0;
+    uint64_t retired = 0;
+    std::vector<void*> freed;
+
+    uint64_t GetSubmitted()
+    {
+        return submitted;
+    }
+
+    uint64_t GetRetired()
+    {
+        return retired;
+    }
+
+    void Free(void* memory)
+    {
+        freed.push_back(memory);
+    }
+
+    void Reset()
+    {
+        submitted = 0;
+        retired = 0;
+        freed.clear();
+    }
+
+    void TestWaitsForRetirement()
+    {
+        Reset();
+        int a = 0, b = 0;
+        ReleaseQueue queue(GetSubmitted, GetRetired);
+
+        // Released while recording the commands of submission 1
+        queue.Release(&a, 10, Free);
+        submitted = 1;
+        // Released while recording submission 2
+        queue.Release(&b, 20, Free);
+        CHECK_EQ(queue.GetPendingCount(), 2);
+        CHECK_EQ(queue.GetPendingBytes(), 30);
+
+        CHECK_EQ(queue.Drain(), 0);
+        CHECK(freed.empty());
+
+        retired = 1;
+        CHECK_EQ(queue.Drain(), 1);
+        CHECK(freed.size() == 1 && freed[0] == &a);
+        CHECK_EQ(queue.GetPendingBytes(), 20);
+
+        submitted = 2;
+        CHECK_EQ(queue.Drain(), 0);
+        retired = 2;
+        CHECK_EQ(queue.Drain(), 1);
+        CHECK(freed.size() == 2 && freed[1] == &b);
+        CHECK_EQ(queue.GetPendingCount(), 0);
+        CHECK_EQ(queue.GetPendingBytes(), 0);
+    }
+
+    void TestRetiresInOrder()
+    {
+        Reset();
+        int memory[8] = {};
+        ReleaseQueue queue(GetSubmitted, GetRetired);
+        for (int i = 0; i < 8; i++)
+        {
+            submitted = (uint64_t)(i / 2);
+            queue.Release(&memory[i], 1, Free);
+        }
+
+        // Submissions 1 to 3 retired at once, the two of submission 4 are left
+        retired = 3;
+        CHECK_EQ(queue.Drain(), 6);
+        CHECK_EQ(queue.GetPendingCount(), 2);
+        for (int i = 0; i < (int)freed.size(); i++)
+        {
+            CHECK(freed[i] == &memory[i]);
+        }
+    }
+
+    void TestFlushAndDestructorFreeEverything()
+    {
+        Reset();
+        int a = 0, b = 0, c = 0;
+        {
+            ReleaseQueue queue(GetSubmitted, GetRetired);
+            queue.Release(&a, 1, Free);
+            queue.Release(nullptr, 1, Free);
+            CHECK_EQ(queue.GetPendingCount(), 1);
+
+            queue.Flush();
+            CHECK_EQ(freed.size(), 1);
+            CHECK_EQ(queue.GetPendingBytes(), 0);
+
+            queue.Release(&b, 1, Free);
+            queue.Release(&c, 1, Free);
+        }
+        CHECK_EQ(freed.size(), 3);
+    }
+}
+
+int main()
+{
+    TestWaitsForRetirement();
+    TestRetiresInOrder();
+    TestFlushAndDestructorFreeEverything();
+    return CheckResult("release_queue_test");
+}
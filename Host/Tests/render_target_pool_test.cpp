@@ -0,0 +1,191 @@
+#include <vector>
+
+#include "render_target_pool.hpp"
+#include "check.hpp"
+
+// RenderTargetPool with fake targets: reuse by size and format, trimming of targets idle for longer than the 120
+// frames the GX2 renderer allows, and what is destroyed when.
+
+namespace
+{
+    using Key = RenderTargetPool::Key;
+
+    // RENDER_TARGET_IDLE_FRAMES of the GX2 renderer
+    const uint32_t IDLE_FRAMES = 120;
+
+    struct Target
+    {
+        Key key;
+        bool destroyed;
+    };
+
+    struct Targets
+    {
+        std::vector<Target*> created;
+        bool fail = false;
+
+        ~Targets()
+        {
+            for (Target* target : created)
+            {
+                delete target;
+            }
+        }
+
+        uint32_t Live() const
+        {
+            uint32_t live = 0;
+            for (const Target* target : created)
+            {
+                live += !target->destroyed;
+            }
+            return live;
+        }
+    };
+
+    int errors = 0;
+
+    void* Create(void* user, const Key& key, uint32_t* bytes)
+    {
+        Targets* targets = static_cast<Targets*>(user);
+        if (targets->fail)
+            return nullptr;
+        targets->created.push_back(new Target{ key, false });
+        *bytes = key.width * key.height * 4;
+        return targets->created.back();
+    }
+
+    void Destroy(void* user, void* target)
+    {
+        (void)user;
+        Target* destroyed = static_cast<Target*>(target);
+        errors += destroyed->destroyed;
+        destroyed->destroyed = true;
+    }
+
+    const Key TV = { 1280, 720, 1 };
+    const Key TV_FLOAT = { 1280, 720, 2 };
+    const Key GAMEPAD = { 854, 480, 1 };
+
+    void TestReuse()
+    {
+        Targets targets;
+        RenderTargetPool pool(Create, Destroy, &targets);
+
+        void* a = pool.Acquire(TV);
+        void* b = pool.Acquire(TV);
+        CHECK(a && b && a != b);
+        CHECK_EQ(pool.GetInUseCount(), 2);
+
+        // A released target comes back for the same key only
+        pool.Release(a);
+        void* other_format = pool.Acquire(TV_FLOAT);
+        void* other_size = pool.Acquire(GAMEPAD);
+        CHECK(other_format != a && other_size != a);
+        CHECK(pool.Acquire(TV) == a);
+        CHECK_EQ(pool.GetCreatedCount(), 4);
+        CHECK_EQ(pool.GetBytes(), 3 * 1280 * 720 * 4 + 854 * 480 * 4);
+
+        // A warm pool creates nothing, frame after frame
+        pool.Release(a);
+        pool.Release(b);
+        pool.Release(other_format);
+        pool.Release(other_size);
+        for (int frame = 0; frame < 10; frame++)
+        {
+            void* first = pool.Acquire(TV);
+            void* second = pool.Acquire(TV);
+            void* gamepad = pool.Acquire(GAMEPAD);
+            pool.Release(gamepad);
+            pool.Release(second);
+            pool.Release(first);
+            pool.NextFrame(IDLE_FRAMES);
+        }
+        CHECK_EQ(pool.GetCreatedCount(), 4);
+        CHECK_EQ(pool.GetInUseCount(), 0);
+
+        // Nothing is pooled when creating fails
+        targets.fail = true;
+        CHECK(pool.Acquire({ 64, 64, 1 }) == nullptr);
+        CHECK_EQ(pool.GetCount(), 4);
+    }
+
+    void TestIdleTrim()
+    {
+        Targets targets;
+        RenderTargetPool pool(Create, Destroy, &targets);
+
+        void* idle = pool.Acquire(TV);
+        void* busy = pool.Acquire(TV);
+        void* used = pool.Acquire(GAMEPAD);
+        pool.Release(idle);
+        pool.Release(used);
+
+        // Kept for IDLE_FRAMES frames after its last use, destroyed by the one after
+        for (uint32_t frame = 0; frame < IDLE_FRAMES; frame++)
+        {
+            if (frame == 60)
+            {
+                pool.Release(pool.Acquire(GAMEPAD));
+            }
+            pool.NextFrame(IDLE_FRAMES);
+        }
+        CHECK_EQ(targets.Live(), 3);
+        pool.NextFrame(IDLE_FRAMES);
+        CHECK(static_cast<Target*>(idle)->destroyed);
+        CHECK_EQ(targets.Live(), 2);
+        CHECK_EQ(pool.GetBytes(), 1280 * 720 * 4 + 854 * 480 * 4);
+
+        // The one used since goes 60 frames later, the one in use never does
+        for (uint32_t frame = 0; frame < 59; frame++)
+        {
+            pool.NextFrame(IDLE_FRAMES);
+        }
+        CHECK(!static_cast<Target*>(used)->destroyed);
+        pool.NextFrame(IDLE_FRAMES);
+        CHECK(static_cast<Target*>(used)->destroyed);
+        for (uint32_t frame = 0; frame < 4 * IDLE_FRAMES; frame++)
+        {
+            pool.NextFrame(IDLE_FRAMES);
+        }
+        CHECK(!static_cast<Target*>(busy)->destroyed);
+        CHECK_EQ(pool.GetCount(), 1);
+
+        // Its idle time starts when it's released
+        pool.Release(busy);
+        pool.NextFrame(IDLE_FRAMES);
+        CHECK(!static_cast<Target*>(busy)->destroyed);
+        CHECK(pool.Acquire(TV) == busy);
+        pool.Release(busy);
+        CHECK_EQ(errors, 0);
+    }
+
+    void TestTrimAndDestruction()
+    {
+        Targets targets;
+        {
+            RenderTargetPool pool(Create, Destroy, &targets);
+            void* kept = pool.Acquire(TV);
+            pool.Release(pool.Acquire(GAMEPAD));
+            pool.Release(pool.Acquire(TV_FLOAT));
+
+            // Trim leaves targets in use alone
+            pool.Trim();
+            CHECK_EQ(pool.GetCount(), 1);
+            CHECK_EQ(targets.Live(), 1);
+            CHECK(!static_cast<Target*>(kept)->destroyed);
+            CHECK_EQ(pool.GetBytes(), 1280 * 720 * 4);
+        }
+        // The pool destroys even those when it goes
+        CHECK_EQ(targets.Live(), 0);
+        CHECK_EQ(errors, 0);
+    }
+}
+
+int main()
+{
+    TestReuse();
+    TestIdleTrim();
+    TestTrimAndDestruction();
+    return CheckResult("render_target_pool_test");
+}
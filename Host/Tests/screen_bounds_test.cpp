@@ -0,0 +1,142 @@
+#include <cmath>
+
+#include "screen_bounds.hpp"
+#include "check.hpp"
+
+// Culling of a 100x50 quad against the viewport and scissor regions, plain and through the transforms RmlUi hands the
+// renderer: translations, scales, rotations and perspective, including corners behind the eye plane.
+
+namespace
+{
+    using ScreenBounds::Rect;
+
+    // Same layout as Rml::Vertex, position first
+    struct Vertex
+    {
+        float x;
+        float y;
+        uint32_t colour;
+        float u;
+        float v;
+    };
+
+    const Rect VIEWPORT = { 0.0f, 0.0f, 1280.0f, 720.0f };
+
+    struct Transform
+    {
+        // Column-major, m[column * 4 + row]
+        float m[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    };
+
+    Rect Quad()
+    {
+        const Vertex vertices[4] = { { 10, 20 }, { 110, 20 }, { 110, 70 }, { 10, 70 } };
+        return ScreenBounds::Compute(vertices, 4, sizeof(Vertex));
+    }
+
+    void TestCompute()
+    {
+        Rect bounds = Quad();
+        CHECK(bounds.left == 10 && bounds.top == 20 && bounds.right == 110 && bounds.bottom == 70);
+
+        Rect empty = ScreenBounds::Compute(nullptr, 0, sizeof(Vertex));
+        CHECK(empty.left > empty.right);
+        CHECK(!ScreenBounds::IsVisible(empty, 0, 0, nullptr, VIEWPORT));
+    }
+
+    void TestTranslation()
+    {
+        Rect bounds = Quad();
+        CHECK(ScreenBounds::IsVisible(bounds, 0, 0, nullptr, VIEWPORT));
+        // Touching edges cover no pixel
+        CHECK(!ScreenBounds::IsVisible(bounds, 0, -70, nullptr, VIEWPORT));
+        CHECK(ScreenBounds::IsVisible(bounds, 0, -69, nullptr, VIEWPORT));
+        CHECK(!ScreenBounds::IsVisible(bounds, 1270, 0, nullptr, VIEWPORT));
+        CHECK(ScreenBounds::IsVisible(bounds, 1269, 0, nullptr, VIEWPORT));
+
+        // Scissor of a scrolled container
+        Rect scissor = ScreenBounds::Intersect(VIEWPORT, { 200, 100, 600, 400 });
+        CHECK(!ScreenBounds::IsVisible(bounds, 0, 0, nullptr, scissor));
+        CHECK(ScreenBounds::IsVisible(bounds, 100, 90, nullptr, scissor));
+        CHECK(!ScreenBounds::IsVisible(bounds, 100, 400, nullptr, scissor));
+
+        // Scissor entirely off screen
+        Rect outside = ScreenBounds::Intersect(VIEWPORT, { 1300, 0, 1400, 720 });
+        CHECK(!ScreenBounds::IsVisible(bounds, 1250, 0, nullptr, outside));
+    }
+
+    void TestAffineTransforms()
+    {
+        Rect bounds = Quad();
+
+        // Identity culls like no transform
+        Transform identity;
+        CHECK(ScreenBounds::IsVisible(bounds, 0, 0, identity.m, VIEWPORT));
+        CHECK(!ScreenBounds::IsVisible(bounds, 0, -70, identity.m, VIEWPORT));
+
+        // The translation applies before the transform
+        Transform moved;
+        moved.m[12] = -200;
+        CHECK(!ScreenBounds::IsVisible(bounds, 0, 0, moved.m, VIEWPORT));
+        CHECK(ScreenBounds::IsVisible(bounds, 150, 0, moved.m, VIEWPORT));
+
+        // Scaled twice around the origin, x from 20 to 220
+        Transform scale;
+        scale.m[0] = 2;
+        scale.m[5] = 2;
+        CHECK(ScreenBounds::IsVisible(bounds, 0, 0, scale.m, { 215, 0, 300, 720 }));
+        CHECK(!ScreenBounds::IsVisible(bounds, 0, 0, scale.m, { 221, 0, 300, 720 }));
+
+        // Rotated by 90 degrees, (x, y) to (-y, x): x from -70 to -20 is left of the screen until moved by 100
+        Transform quarter;
+        quarter.m[0] = 0;
+        quarter.m[1] = 1;
+        quarter.m[4] = -1;
+        quarter.m[5] = 0;
+        CHECK(!ScreenBounds::IsVisible(bounds, 0, 0, quarter.m, VIEWPORT));
+        quarter.m[12] = 100;
+        CHECK(ScreenBounds::IsVisible(bounds, 0, 0, quarter.m, VIEWPORT));
+        CHECK(!ScreenBounds::IsVisible(bounds, 0, 0, quarter.m, { 81, 0, 1280, 720 }));
+
+        // A 10x10 square rotated by 45 degrees reaches x = -7.07, only its corner pokes into the clip
+        const Vertex square[3] = { { 0, 0 }, { 10, 0 }, { 10, 10 } };
+        Rect square_bounds = ScreenBounds::Compute(square, 3, sizeof(Vertex));
+        const float angle = 0.785398f;
+        Transform eighth;
+        eighth.m[0] = std::cos(angle);
+        eighth.m[1] = std::sin(angle);
+        eighth.m[4] = -std::sin(angle);
+        eighth.m[5] = std::cos(angle);
+        CHECK(ScreenBounds::IsVisible(square_bounds, 0, 0, eighth.m, { -7, 0, 0, 20 }));
+        CHECK(!ScreenBounds::IsVisible(square_bounds, 0, 0, eighth.m, { -20, 0, -7.2f, 20 }));
+    }
+
+    void TestPerspective()
+    {
+        Rect bounds = Quad();
+
+        // w = 1 + 0.01 x, the right edge lands at 110 / 2.1 = 52.4
+        Transform perspective;
+        perspective.m[3] = 0.01f;
+        CHECK(ScreenBounds::IsVisible(bounds, 0, 0, perspective.m, { 0, 0, 60, 720 }));
+        CHECK(!ScreenBounds::IsVisible(bounds, 0, 0, perspective.m, { 53, 0, 100, 720 }));
+
+        // Corners behind the eye plane can't be projected, always drawn
+        Transform behind;
+        behind.m[3] = -0.05f;
+        CHECK(ScreenBounds::IsVisible(bounds, 0, 0, behind.m, { 5000, 5000, 5001, 5001 }));
+        // Exactly on the eye plane as well
+        Transform on_plane;
+        on_plane.m[3] = -0.1f;
+        CHECK(ScreenBounds::IsVisible(bounds, 0, 0, on_plane.m, { 5000, 5000, 5001, 5001 }));
+    }
+}
+
+int main()
+{
+    TestCompute();
+    TestTranslation();
+    TestAffineTransforms();
+    TestPerspective();
+    return CheckResult("screen_bounds_test");
+}
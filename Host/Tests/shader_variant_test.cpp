@@ -0,0 +1,123 @@
+#include <string>
+
+#include "RmlUi_Renderer_GX2.h"
+#include "shader_variant.hpp"
+#include "wut_standin.h"
+#include "check.hpp"
+
+// Which shader variant the renderer draws with, told apart by what it uploads and binds: variants without TRANSFORM
+// upload a 16 byte translation instead of the 64 byte matrix, variants without TEXTURED bind no texture. Then the
+// same draws with a specialized variant failing to load, which must fall back to the generic one.
+
+namespace
+{
+    struct Draw
+    {
+        uint32_t uniform_bytes;
+        uint32_t texture_binds;
+    };
+
+    const uint32_t TRANSLATION_BYTES = sizeof(float) * 4;
+    const uint32_t MATRIX_BYTES = sizeof(float) * 16;
+
+    Draw Expected(uint32_t variant)
+    {
+        return { (variant & ShaderVariant::TRANSFORM) ? MATRIX_BYTES : TRANSLATION_BYTES,
+            (variant & ShaderVariant::TEXTURED) ? 1u : 0u };
+    }
+
+    // One draw in a frame of its own, so the bound texture doesn't carry over from the previous draw
+    Draw DrawOnce(RenderInterface_GX2& renderer, bool textured, bool transform)
+    {
+        Rml::Vertex vertices[3] = {};
+        vertices[1].position = Rml::Vector2f(64.0f, 0.0f);
+        vertices[2].position = Rml::Vector2f(0.0f, 64.0f);
+        const int indices[3] = { 0, 1, 2 };
+        const Rml::byte pixel[4] = { 255, 255, 255, 255 };
+
+        renderer.BeginFrame();
+        Rml::CompiledGeometryHandle geometry = renderer.CompileGeometry(Rml::Span<const Rml::Vertex>(vertices, 3),
+            Rml::Span<const int>(indices, 3));
+        Rml::TextureHandle texture = textured ? renderer.GenerateTexture(Rml::Span<const Rml::byte>(pixel, 4), Rml::Vector2i(1, 1)) : 0;
+        const Rml::Matrix4f scale = Rml::Matrix4f::Diag(1.5f, 1.5f, 1.0f, 1.0f);
+        renderer.SetTransform(transform ? &scale : nullptr);
+
+        const RenderInterface_GX2::Stats before = renderer.GetCurrentStats();
+        renderer.RenderGeometry(geometry, Rml::Vector2f(16.0f, 16.0f), texture);
+        const RenderInterface_GX2::Stats& after = renderer.GetCurrentStats();
+        Draw draw = { after.uniform_bytes - before.uniform_bytes, after.texture_binds - before.texture_binds };
+        CHECK_EQ(after.draw_calls - before.draw_calls, 1);
+
+        renderer.SetTransform(nullptr);
+        renderer.EndFrame();
+        renderer.ReleaseGeometry(geometry);
+        if (texture)
+        {
+            renderer.ReleaseTexture(texture);
+        }
+        return draw;
+    }
+
+    void CheckDraws(RenderInterface_GX2& renderer, uint32_t missing_variant)
+    {
+        for (uint32_t selected = 0; selected < ShaderVariant::COUNT; selected++)
+        {
+            const bool textured = (selected & ShaderVariant::TEXTURED) != 0;
+            const bool transform = (selected & ShaderVariant::TRANSFORM) != 0;
+            CHECK_EQ(ShaderVariant::Select(textured, transform), selected);
+
+            const uint32_t used = selected == missing_variant ? ShaderVariant::GENERIC : selected;
+            Draw draw = DrawOnce(renderer, textured, transform);
+            Draw expected = Expected(used);
+            CHECK_EQ(draw.uniform_bytes, expected.uniform_bytes);
+            CHECK_EQ(draw.texture_binds, expected.texture_binds);
+        }
+    }
+
+    void TestSelection()
+    {
+        RenderInterface_GX2 renderer;
+        renderer.CreateDeviceObjects();
+        renderer.SetViewport(1280, 720);
+        CheckDraws(renderer, ShaderVariant::COUNT);
+        renderer.ReleaseDeviceObjects();
+    }
+
+    void TestFallback()
+    {
+        for (uint32_t missing = 0; missing < ShaderVariant::COUNT; missing++)
+        {
+            if (missing == ShaderVariant::GENERIC)
+                continue;
+            WutStandin::SetFailingShader(ShaderVariant::Name(missing));
+            RenderInterface_GX2 renderer;
+            renderer.CreateDeviceObjects();
+            renderer.SetViewport(1280, 720);
+            CheckDraws(renderer, missing);
+            renderer.ReleaseDeviceObjects();
+        }
+        WutStandin::SetFailingShader(nullptr);
+    }
+
+    void TestNames()
+    {
+        // Shader/Source holds one file per variant, so every name is different
+        for (uint32_t a = 0; a < ShaderVariant::COUNT; a++)
+        {
+            for (uint32_t b = a + 1; b < ShaderVariant::COUNT; b++)
+            {
+                CHECK(std::string(ShaderVariant::Name(a)) != ShaderVariant::Name(b));
+            }
+        }
+        CHECK(std::string(ShaderVariant::Name(ShaderVariant::GENERIC)) == "rmlui");
+    }
+}
+
+int main()
+{
+    WutStandin::SetLogEnabled(false);
+    TestNames();
+    TestSelection();
+    TestFallback();
+    return CheckResult("shader_variant_test");
+}
@@ -0,0 +1,108 @@
+#include <vector>
+
+#include "slot_map.hpp"
+#include "check.hpp"
+
+// Generational handles of SlotMap: stale handles after erase and slot reuse, stable pointers across pages, and the
+// generation wrapping around without ever producing handle 0.
+
+namespace
+{
+    using Map = SlotMap<int, 4>;
+
+    void TestInsertAndErase()
+    {
+        Map map;
+        CHECK(map.Get(0) == nullptr);
+
+        Map::Handle a = map.Insert(1);
+        Map::Handle b = map.Insert(2);
+        CHECK(a != 0 && b != 0 && a != b);
+        CHECK(map.Get(a) && *map.Get(a) == 1);
+        CHECK(map.Resolve(b) && *map.Resolve(b) == 2);
+        CHECK_EQ(map.GetCount(), 2);
+
+        CHECK(map.Erase(a));
+        CHECK(!map.Erase(a));
+        CHECK(map.Get(a) == nullptr);
+        CHECK(map.Resolve(a) == nullptr);
+        CHECK_EQ(map.GetCount(), 1);
+
+        // The freed slot is reused, the old handle still resolves to nothing
+        Map::Handle c = map.Insert(3);
+        CHECK_EQ(c & (Map::MAX_SLOTS - 1), a & (Map::MAX_SLOTS - 1));
+        CHECK(c != a);
+        CHECK(map.Get(a) == nullptr);
+        CHECK(map.Get(c) && *map.Get(c) == 3);
+
+        // Handles past the slots in use
+        CHECK(map.Get(Map::MAX_SLOTS - 1) == nullptr);
+    }
+
+    void TestPagesKeepPointers()
+    {
+        Map map;
+        std::vector<Map::Handle> handles;
+        std::vector<int*> pointers;
+        for (int i = 0; i < 10; i++)
+        {
+            handles.push_back(map.Insert(i));
+            pointers.push_back(map.Get(handles.back()));
+        }
+        CHECK_EQ(map.GetCapacity(), 12);
+        for (int i = 0; i < 10; i++)
+        {
+            CHECK(map.Get(handles[i]) == pointers[i]);
+            CHECK_EQ(*pointers[i], i);
+        }
+
+        // Erased slots are filled before another page is added
+        map.Erase(handles[2]);
+        map.Erase(handles[7]);
+        map.Insert(20);
+        map.Insert(21);
+        map.Insert(22);
+        CHECK_EQ(map.GetCapacity(), 12);
+
+        std::vector<int> values;
+        map.ForEach([&](Map::Handle handle, int& value)
+        {
+            CHECK(map.Get(handle) == &value);
+            values.push_back(value);
+        });
+        CHECK_EQ(values.size(), 11);
+        if (values.size() == 11)
+        {
+            CHECK_EQ(values[2], 21);
+            CHECK_EQ(values[7], 20);
+            CHECK_EQ(values[10], 22);
+        }
+    }
+
+    void TestGenerationWraps()
+    {
+        Map map;
+        Map::Handle first = map.Insert(0);
+        Map::Handle handle = first;
+        bool zero_handle = false;
+        // Generation 0 is skipped, so after GENERATION_MASK reuses the slot's handles come round again
+        for (uint32_t i = 0; i < Map::GENERATION_MASK; i++)
+        {
+            map.Erase(handle);
+            handle = map.Insert((int)i);
+            zero_handle |= handle == 0;
+        }
+        CHECK(!zero_handle);
+        CHECK_EQ(handle >> Map::INDEX_BITS, 1);
+        CHECK_EQ(handle, first);
+        CHECK(map.Get(handle) && *map.Get(handle) == (int)Map::GENERATION_MASK - 1);
+    }
+}
+
+int main()
+{
+    TestInsertAndErase();
+    TestPagesKeepPointers();
+    TestGenerationWraps();
+    return CheckResult("slot_map_test");
+}
@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include <RmlUi/Core.h>
+#include "RmlUi_Image_TGA.h"
+#include "RmlUi_Renderer_Software.h"
+#include "check.hpp"
+
+// Direct draws with known results, the same frame rasterized by one and by several threads, and UI/demo.rml against
+// the golden image in Host/Tests/Golden. The golden part needs a font, TEST_FONT=<path to Lato-Regular.ttf> like the
+// plugin's, and UPDATE_GOLDEN=1 writes the image instead of comparing against it. Without the image it is skipped.
+//
+// The software renderer implements clip masks, RenderInterface_GX2 doesn't yet (EnableClipMask and RenderToClipMask
+// are stubs there), so content RmlUi clips with a mask would look different on the console. The golden document must
+// not use any, which the golden part checks.
+
+namespace
+{
+    const char* const GOLDEN_PATH = "Host/Tests/Golden/demo.tga";
+    const char* const DOCUMENT_PATH = "UI/demo.rml";
+    const int GOLDEN_WIDTH = 480;
+    const int GOLDEN_HEIGHT = 320;
+    // Per channel, rounding of the blend may differ between compilers
+    const int GOLDEN_TOLERANCE = 2;
+
+    struct Quad
+    {
+        Rml::Vertex vertices[4];
+        int indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+        Quad(float x0, float y0, float x1, float y1, Rml::ColourbPremultiplied colour)
+        {
+            const Rml::Vector2f corners[4] = { { x0, y0 }, { x1, y0 }, { x1, y1 }, { x0, y1 } };
+            for (int i = 0; i < 4; i++)
+            {
+                vertices[i].position = corners[i];
+                vertices[i].colour = colour;
+                vertices[i].tex_coord = Rml::Vector2f((i == 1 || i == 2) ? 1.0f : 0.0f, i >= 2 ? 1.0f : 0.0f);
+            }
+        }
+
+        Rml::CompiledGeometryHandle Compile(Rml::RenderInterface& renderer) const
+        {
+            return renderer.CompileGeometry(Rml::Span<const Rml::Vertex>(vertices, 4), Rml::Span<const int>(indices, 6));
+        }
+    };
+
+    const Rml::byte* Pixel(const RenderInterface_Software& renderer, int x, int y)
+    {
+        return renderer.GetPixels() + (y * renderer.GetWidth() + x) * 4;
+    }
+
+    // Counts the clip mask renders of the golden document, which GX2 would ignore
+    class MaskCountingRenderer : public RenderInterface_Software
+    {
+    public:
+        using RenderInterface_Software::RenderInterface_Software;
+
+        uint32_t clip_mask_renders = 0;
+
+        void RenderToClipMask(Rml::ClipMaskOperation operation, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation) override
+        {
+            clip_mask_renders++;
+            RenderInterface_Software::RenderToClipMask(operation, geometry, translation);
+        }
+    };
+
+    bool PixelIs(const RenderInterface_Software& renderer, int x, int y, Rml::ColourbPremultiplied colour)
+    {
+        const Rml::byte* pixel = Pixel(renderer, x, y);
+        return pixel[0] == colour.red && pixel[1] == colour.green && pixel[2] == colour.blue && pixel[3] == colour.alpha;
+    }
+
+    void TestDraws()
+    {
+        const Rml::ColourbPremultiplied red(255, 0, 0, 255);
+        const Rml::ColourbPremultiplied green(0, 255, 0, 255);
+        const Rml::ColourbPremultiplied blue(0, 0, 255, 255);
+        const Rml::ColourbPremultiplied clear(0, 0, 0, 0);
+
+        RenderInterface_Software renderer(128, 128, 1);
+        renderer.BeginFrame();
+        renderer.Clear();
+
+        Rml::CompiledGeometryHandle square = Quad(8, 8, 40, 40, red).Compile(renderer);
+        renderer.RenderGeometry(square, Rml::Vector2f(0, 0), 0);
+
+        // Scissored to the left half
+        Rml::CompiledGeometryHandle band = Quad(0, 48, 128, 64, green).Compile(renderer);
+        renderer.EnableScissorRegion(true);
+        renderer.SetScissorRegion(Rml::Rectanglei::FromPositionSize({ 0, 0 }, { 64, 128 }));
+        renderer.RenderGeometry(band, Rml::Vector2f(0, 0), 0);
+        renderer.EnableScissorRegion(false);
+
+        // Masked to the square moved to the bottom right
+        Rml::CompiledGeometryHandle bottom = Quad(0, 72, 128, 128, blue).Compile(renderer);
+        renderer.RenderToClipMask(Rml::ClipMaskOperation::Set, square, Rml::Vector2f(80, 80));
+        renderer.EnableClipMask(true);
+        renderer.RenderGeometry(bottom, Rml::Vector2f(0, 0), 0);
+        renderer.EnableClipMask(false);
+        renderer.EndFrame();
+
+        CHECK(PixelIs(renderer, 24, 24, red));
+        CHECK(PixelIs(renderer, 4, 4, clear));
+        CHECK(PixelIs(renderer, 44, 24, clear));
+
+        CHECK(PixelIs(renderer, 32, 56, green));
+        CHECK(PixelIs(renderer, 96, 56, clear));
+
+        CHECK(PixelIs(renderer, 104, 104, blue));
+        CHECK(PixelIs(renderer, 24, 104, clear));
+
+        renderer.ReleaseGeometry(square);
+        renderer.ReleaseGeometry(band);
+        renderer.ReleaseGeometry(bottom);
+    }
+
+    // Overlapping translucent and textured quads across tile borders, drawn into the given renderer
+    void DrawScene(RenderInterface_Software& renderer)
+    {
+        const Rml::byte texels[2 * 2 * 4] = { 255, 0, 0, 255, 0, 128, 0, 128, 0, 0, 64, 64, 255, 255, 255, 255 };
+        Rml::TextureHandle texture = renderer.GenerateTexture(Rml::Span<const Rml::byte>(texels, sizeof(texels)), Rml::Vector2i(2, 2));
+
+        renderer.BeginFrame();
+        renderer.Clear(Rml::ColourbPremultiplied(16, 16, 16, 255));
+        std::vector<Rml::CompiledGeometryHandle> handles;
+        for (int i = 0; i < 24; i++)
+        {
+            float x = (float)((i * 37) % 160);
+            float y = (float)((i * 53) % 120);
+            Rml::byte alpha = (Rml::byte)(64 + (i * 29) % 192);
+            Rml::ColourbPremultiplied colour((Rml::byte)(alpha * (i % 3 == 0)), (Rml::byte)(alpha * (i % 3 == 1)),
+                (Rml::byte)(alpha * (i % 3 == 2)), alpha);
+            handles.push_back(Quad(x, y, x + 70.5f, y + 45.25f, colour).Compile(renderer));
+            renderer.RenderGeometry(handles.back(), Rml::Vector2f(0.5f, 0.25f), (i % 4 == 0) ? texture : 0);
+        }
+        renderer.EndFrame();
+
+        for (Rml::CompiledGeometryHandle handle : handles)
+        {
+            renderer.ReleaseGeometry(handle);
+        }
+        renderer.ReleaseTexture(texture);
+    }
+
+    void TestThreadCountInvariance()
+    {
+        RenderInterface_Software single(240, 180, 1);
+        RenderInterface_Software pooled(240, 180, 4);
+        DrawScene(single);
+        DrawScene(pooled);
+        CHECK(std::memcmp(single.GetPixels(), pooled.GetPixels(), 240 * 180 * 4) == 0);
+    }
+
+    void TestGolden()
+    {
+        const char* font_path = std::getenv("TEST_FONT");
+        if (!font_path || !*font_path)
+        {
+            std::printf("software_renderer_test: golden image skipped, TEST_FONT is not set\n");
+            return;
+        }
+        const char* update = std::getenv("UPDATE_GOLDEN");
+        const bool update_golden = update && std::strcmp(update, "1") == 0;
+
+        if (!update_golden && !std::filesystem::exists(GOLDEN_PATH))
+        {
+            std::printf("software_renderer_test: golden image skipped, %s is missing, create it with UPDATE_GOLDEN=1\n", GOLDEN_PATH);
+            return;
+        }
+
+        MaskCountingRenderer renderer(GOLDEN_WIDTH, GOLDEN_HEIGHT);
+        Rml::SetRenderInterface(&renderer);
+        CHECK(Rml::Initialise());
+        CHECK(Rml::LoadFontFace(font_path, true));
+
+        Rml::Context* context = Rml::CreateContext("golden", Rml::Vector2i(GOLDEN_WIDTH, GOLDEN_HEIGHT));
+        CHECK(context != nullptr);
+        Rml::ElementDocument* document = context ? context->LoadDocument(DOCUMENT_PATH) : nullptr;
+        CHECK(document != nullptr);
+        if (document)
+        {
+            document->Show();
+            context->Update();
+            renderer.BeginFrame();
+            renderer.Clear();
+            context->Render();
+            renderer.EndFrame();
+            CHECK_EQ(renderer.clip_mask_renders, 0);
+        }
+
+        if (document && update_golden)
+        {
+            std::filesystem::create_directories(std::filesystem::path(GOLDEN_PATH).parent_path());
+            CHECK(renderer.SaveTGA(GOLDEN_PATH));
+            std::printf("software_renderer_test: wrote %s\n", GOLDEN_PATH);
+        }
+        else if (document)
+        {
+            std::vector<Rml::byte> golden;
+            Rml::Vector2i dimensions;
+            CHECK(TGA::Load(GOLDEN_PATH, golden, dimensions));
+            CHECK_EQ(dimensions.x, GOLDEN_WIDTH);
+            CHECK_EQ(dimensions.y, GOLDEN_HEIGHT);
+            if (golden.size() == (size_t)GOLDEN_WIDTH * GOLDEN_HEIGHT * 4)
+            {
+                uint32_t differing = 0;
+                for (size_t i = 0; i < golden.size(); i++)
+                {
+                    differing += std::abs((int)golden[i] - (int)renderer.GetPixels()[i]) > GOLDEN_TOLERANCE;
+                }
+                CHECK_EQ(differing, 0);
+            }
+        }
+
+        Rml::Shutdown();
+    }
+}
+
+int main()
+{
+    TestDraws();
+    TestThreadCountInvariance();
+    TestGolden();
+    return CheckResult("software_renderer_test");
+}
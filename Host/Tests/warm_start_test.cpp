@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <RmlUi/Core.h>
+#include "RmlUi_File_WiiU.h"
+#include "RmlUi_Image_TGA.h"
+#include "RmlUi_Renderer_GX2.h"
+#include "startup.hpp"
+#include "wut_standin.h"
+#include "check.hpp"
+
+// Cold and warm starts of the overlay as InitializeOverlay runs them on the startup thread, reduced to what runs on
+// the host: the renderer, the reads of UI/ through the file interface and the images of the first frame. RmlUi's own
+// work (initialising, parsing the documents, loading the font) is missing from the cold start, so on the console it
+// is only further ahead of the warm one. The GX2 stand-ins cost nothing, the GPU resources are CPU side only.
+
+namespace
+{
+    const int RUNS = 21;
+
+    // What the documents of UI/ read while RmlUi loads them, the warm start keeps them parsed
+    const char* const DOCUMENTS[] = { "UI/demo.rml", "UI/window.rml", "UI/rml.rcss", "UI/invader.rcss", "UI/profiler.rml",
+        "UI/stats.rml" };
+    const char* const IMAGE = "UI/invader.tga";
+
+    FileInterface_WiiU file_interface;
+    RenderInterface_GX2* render_interface = nullptr;
+    size_t document_bytes = 0;
+
+    bool ColdStart()
+    {
+        Startup::BeginPhase("backend");
+        render_interface = new RenderInterface_GX2();
+        render_interface->SetViewport(1280, 720);
+
+        Startup::BeginPhase("rmlui");
+        TGA::KeepDecoded(true);
+
+        Startup::BeginPhase("documents");
+        document_bytes = 0;
+        for (const char* path : DOCUMENTS)
+        {
+            Rml::FileHandle file = file_interface.Open(path);
+            if (!file)
+                return false;
+            std::vector<char> contents(file_interface.Length(file));
+            document_bytes += file_interface.Read(contents.data(), contents.size(), file);
+            file_interface.Close(file);
+        }
+
+        Startup::BeginPhase("gpu resources");
+        render_interface->CreateDeviceObjects();
+        return true;
+    }
+
+    bool WarmStart()
+    {
+        Startup::BeginPhase("gpu resources");
+        render_interface->CreateDeviceObjects();
+        return true;
+    }
+
+    struct Timing
+    {
+        uint64_t startup_us;
+        uint64_t first_frame_us;
+        uint32_t phases;
+    };
+
+    // Runs init on the startup thread like ON_APPLICATION_START, then loads the images of the first frame
+    Timing Start(Startup::InitFunction init, Rml::TextureHandle& texture)
+    {
+        Timing timing = {};
+        CHECK(Startup::Start(init));
+        Startup::Wait();
+        CHECK(Startup::IsReady());
+
+        Startup::Phase phases[Startup::MAX_PHASES];
+        timing.phases = Startup::GetPhases(phases, Startup::MAX_PHASES);
+        for (uint32_t i = 0; i < timing.phases; i++)
+        {
+            timing.startup_us += phases[i].microseconds;
+        }
+
+        const auto first_frame = std::chrono::steady_clock::now();
+        Rml::Vector2i dimensions;
+        texture = render_interface->LoadTexture(dimensions, IMAGE);
+        timing.first_frame_us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - first_frame).count();
+        return timing;
+    }
+
+    uint64_t Median(std::vector<uint64_t> values)
+    {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    void TestColdAndWarm()
+    {
+        Rml::SetFileInterface(&file_interface);
+        std::vector<uint64_t> cold_startup, cold_frame, warm_startup, warm_frame;
+
+        for (int run = 0; run < RUNS; run++)
+        {
+            // A cold start after the plugin's full teardown
+            Rml::TextureHandle texture = 0;
+            Timing cold = Start(ColdStart, texture);
+            CHECK(texture != 0);
+            CHECK_EQ(cold.phases, 4);
+            cold_startup.push_back(cold.startup_us);
+            cold_frame.push_back(cold.first_frame_us);
+
+            // Suspended when the application exits, and started again in the next one
+            render_interface->ReleaseTexture(texture);
+            render_interface->ReleaseDeviceObjects();
+            const uint32_t hits = TGA::GetCacheStats().hits;
+            Timing warm = Start(WarmStart, texture);
+            CHECK(texture != 0);
+            CHECK_EQ(warm.phases, 1);
+            CHECK_EQ(TGA::GetCacheStats().hits, hits + 1);
+            warm_startup.push_back(warm.startup_us);
+            warm_frame.push_back(warm.first_frame_us);
+
+            render_interface->ReleaseTexture(texture);
+            render_interface->ReleaseDeviceObjects();
+            delete render_interface;
+            render_interface = nullptr;
+            TGA::KeepDecoded(false);
+        }
+        Rml::SetFileInterface(nullptr);
+
+        std::printf("warm_start_test: median of %d, cold %llu us + first frame %llu us, warm %llu us + first frame %llu us "
+            "(%zu bytes of documents, %s)\n", RUNS,
+            (unsigned long long)Median(cold_startup), (unsigned long long)Median(cold_frame),
+            (unsigned long long)Median(warm_startup), (unsigned long long)Median(warm_frame), document_bytes, IMAGE);
+    }
+}
+
+int main()
+{
+    WutStandin::SetLogEnabled(false);
+    TestColdAndWarm();
+    return CheckResult("warm_start_test");
+}
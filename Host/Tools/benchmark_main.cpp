@@ -0,0 +1,79 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <RmlUi/Core.h>
+#include "RmlUi_File_WiiU.h"
+#include "RmlUi_Renderer_GX2.h"
+#include "benchmark.hpp"
+#include "wut_standin.h"
+
+// Runs Benchmark::Run against the stand-in GX2 of Host/Standin. GX2 calls cost nothing here, so the numbers cover the
+// CPU side of the renderer, gx2_extra and the file interface, which is what most changes to them move.
+int main(int argc, char** argv)
+{
+    std::string data_directory = "UI/";
+    const char* output_path = "bench.json";
+    const char* baseline_path = nullptr;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--data") == 0 && i + 1 < argc)
+        {
+            data_directory = argv[++i];
+            if (!data_directory.empty() && data_directory.back() != '/')
+                data_directory += '/';
+        }
+        else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+        {
+            output_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+        {
+            baseline_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--verbose") == 0)
+        {
+            verbose = true;
+        }
+        else
+        {
+            std::fprintf(stderr, "Usage: %s [--data <directory>] [--output <file>] [--baseline <file>] [--verbose]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // The file interface logs every open, which would end up in the file read results. The JSON carries the
+    // baseline comparison the log would show.
+    WutStandin::SetLogEnabled(verbose);
+
+    FileInterface_WiiU file_interface;
+    Rml::SetFileInterface(&file_interface);
+
+    RenderInterface_GX2 render_interface;
+    render_interface.CreateDeviceObjects();
+    render_interface.SetViewport(1280, 720);
+
+    bool written = Benchmark::Run(&render_interface, data_directory.c_str(), output_path, baseline_path);
+
+    render_interface.ReleaseDeviceObjects();
+    Rml::SetFileInterface(nullptr);
+
+    if (!written)
+    {
+        std::fprintf(stderr, "Failed to write %s\n", output_path);
+        return 1;
+    }
+    if (FILE* file = std::fopen(output_path, "r"))
+    {
+        char buffer[4096];
+        size_t read;
+        while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            std::fwrite(buffer, 1, read, stdout);
+        }
+        std::fclose(file);
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <RmlUi/Core.h>
+#include "RmlUi_File_WiiU.h"
+#include "RmlUi_Renderer_GX2.h"
+#include "wut_standin.h"
+
+// Loads a document into a 1280x720 context like the plugin's TV one, renders a frame through RenderInterface_GX2 on
+// the stand-ins and prints what the renderer counted, e.g. how much of the geometry the dedup table shared. Geometry
+// only depends on RmlUi, the font and the document, so the counts match the console's. The text is laid out by
+// RmlUi's own font engine, builds with RMLUI_SDF_FONTS generate their text geometry differently.
+int main(int argc, char** argv)
+{
+    const char* document_path = nullptr;
+    const char* font_path = nullptr;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--font") == 0 && i + 1 < argc)
+        {
+            font_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--verbose") == 0)
+        {
+            verbose = true;
+        }
+        else if (!document_path && argv[i][0] != '-')
+        {
+            document_path = argv[i];
+        }
+        else
+        {
+            document_path = nullptr;
+            break;
+        }
+    }
+    if (!document_path || !font_path)
+    {
+        std::fprintf(stderr, "Usage: %s <document> --font <file> [--verbose]\n", argv[0]);
+        return 2;
+    }
+
+    WutStandin::SetLogEnabled(verbose);
+    FileInterface_WiiU file_interface;
+    Rml::SetFileInterface(&file_interface);
+
+    RenderInterface_GX2 render_interface;
+    render_interface.CreateDeviceObjects();
+    render_interface.SetViewport(1280, 720);
+    Rml::SetRenderInterface(&render_interface);
+
+    if (!Rml::Initialise() || !Rml::LoadFontFace(font_path, true))
+    {
+        std::fprintf(stderr, "Failed to load %s\n", font_path);
+        Rml::Shutdown();
+        return 1;
+    }
+
+    Rml::Context* context = Rml::CreateContext("stats", Rml::Vector2i(1280, 720));
+    Rml::ElementDocument* document = context ? context->LoadDocument(document_path) : nullptr;
+    if (!document)
+    {
+        std::fprintf(stderr, "Failed to load %s\n", document_path);
+        Rml::Shutdown();
+        return 1;
+    }
+
+    // Everything the document needs is compiled during its first frame
+    document->Show();
+    context->Update();
+    render_interface.BeginFrame();
+    context->Render();
+    const RenderInterface_GX2::Stats stats = render_interface.GetCurrentStats();
+    render_interface.EndFrame();
+
+    const double hit_rate = stats.geometry_compiled ? 100.0 * stats.geometry_dedup_hits / stats.geometry_compiled : 0.0;
+    std::printf("%s\n", document_path);
+    std::printf("  geometry_compiled           %u\n", stats.geometry_compiled);
+    std::printf("  geometry_dedup_hits         %u (%.1f%%)\n", stats.geometry_dedup_hits, hit_rate);
+    std::printf("  geometry_bytes              %u\n", stats.geometry_bytes);
+    std::printf("  geometry_dedup_saved_bytes  %u\n", stats.geometry_dedup_saved_bytes);
+    std::printf("  geometry_dedup_entries      %u of %u\n", stats.geometry_dedup_entries,
+        (uint32_t)RenderInterface_GX2::MAX_SHARED_GEOMETRY);
+    std::printf("  geometry_dedup_table_full   %u\n", stats.geometry_dedup_table_full);
+    std::printf("  textures_generated          %u\n", stats.textures_generated);
+    std::printf("  draw_calls                  %u\n", stats.draw_calls);
+    std::printf("  draws_culled                %u\n", stats.draws_culled);
+
+    document->Close();
+    context->Update();
+    Rml::RemoveContext("stats");
+    Rml::Shutdown();
+    render_interface.ReleaseDeviceObjects();
+    Rml::SetFileInterface(nullptr);
+    return 0;
+}
@@ -33,6 +33,10 @@
 #include <RmlUi/Core/RenderInterface.h>
 #include <RmlUi/Core/SystemInterface.h>
 #include <RmlUi/Core/Types.h>
+#include <cstdint>
+
+struct VPADStatus;
+struct GX2ColorBuffer;
 
 using KeyDownCallback = bool (*)(Rml::Context* context, Rml::Input::KeyIdentifier key, int key_modifier, float native_dp_ratio, bool priority);
 
@@ -46,27 +50,90 @@ using KeyDownCallback = bool (*)(Rml::Context* context, Rml::Input::KeyIdentifie
  */
 namespace Backend {
 
+// Scan targets the overlay is drawn on, each can show its own context.
+enum class Screen { TV, GamePad };
+
 // Initializes the backend, including the custom system and render interfaces, and opens a window for rendering the RmlUi context.
 bool Initialize(const char* window_name, int width, int height, bool allow_resize);
 // Closes the window and release all resources owned by the backend, including the system and render interfaces.
 void Shutdown();
+// Stops the UI thread and frees every GPU resource, of RmlUi and of the renderer, but keeps RmlUi and the interfaces
+// alive. Call before the application's GX2 goes away to keep the contexts, documents and fonts for the next one.
+// Resources are created again as the contexts are rendered.
+void Suspend();
 
 // Returns a pointer to the custom system interface which should be provided to RmlUi.
 Rml::SystemInterface* GetSystemInterface();
 // Returns a pointer to the custom render interface which should be provided to RmlUi.
 Rml::RenderInterface* GetRenderInterface();
 
-// Polls and processes events from the current platform, and applies any relevant events to the provided RmlUi context and the key down callback.
+// Shows the context on the screen, nullptr shows nothing there. All contexts share the render interface, so textures
+// and font atlases are only created once however many screens use them.
+void SetScreenContext(Screen screen, Rml::Context* context);
+Rml::Context* GetScreenContext(Screen screen);
+// Context receiving GamePad input, the GamePad screen's one if set, the TV's otherwise.
+Rml::Context* GetInputContext();
+// Updates the context of every screen.
+void UpdateScreenContexts();
+
+// Queues GamePad samples as returned by VPADRead (newest first). They are consumed by the next ProcessEvents call.
+void SubmitGamepadSamples(const VPADStatus* samples, uint32_t count);
+// Processes the queued GamePad samples in order, and applies any relevant events to the provided RmlUi context and the key down callback.
+// Touch moves within one call are coalesced into a single mouse move.
+// With power_save, the backend goes idle after a number of calls without input, animations, data model changes or visible documents
+// in any of the screen contexts.
 // @return False to indicate that the application should be closed.
 bool ProcessEvents(Rml::Context* context, KeyDownCallback key_down_callback = nullptr, bool power_save = false);
 // Request application closure during the next event processing call.
 void RequestExit();
 
-// Prepares the render state to accept rendering commands from RmlUi, call before rendering the RmlUi context.
-void BeginFrame();
+// While idle, Context::Update can be skipped and RepeatFrame draws the last frame again.
+bool IsIdle();
+// Leaves the idle state immediately, call after changing documents or data models from outside of the event processing.
+void Wake();
+// Number of event processing calls spent idle.
+uint32_t GetFramesSkipped();
+// Microseconds per frame the overlay may take on the thread updating the contexts, event processing, updating and
+// rendering included. Data model syncs and texture uploads are deferred into what's left of it, and carried over to
+// later frames once it's used up. Frames over budget are counted in a histogram shown by the stats panel.
+void SetFrameBudget(uint32_t microseconds);
+// Closes the frame budget, call once per presented frame, e.g. from the swap hook.
+void NextFrame();
+// Redraws the last frame instead of rendering the context while idle, call between BeginFrame and PresentFrame.
+// @return False if not idle or the last frame can't be repeated, the context has to be rendered then.
+bool RepeatFrame();
+
+// Prepares the render state to accept rendering commands from RmlUi, call before rendering the context of the screen.
+// color_buffer is the buffer being drawn into, layers and filters (opacity, blur, shadows, masks) need it.
+void BeginFrame(Screen screen = Screen::TV, const GX2ColorBuffer* color_buffer = nullptr);
 // Presents the rendered frame to the screen, call after rendering the RmlUi context.
 void PresentFrame();
 
+// Moves ProcessEvents, Context::Update and Context::Render of the screen contexts to a dedicated UI thread on another core.
+// Render calls are recorded into one command list per screen and ReplayFrame draws the latest complete one.
+// Only available when built with UI_THREAD=1, the screen contexts must not be changed or updated from anywhere else while it runs.
+bool StartUiThread();
+// Waits for the UI thread to finish its frame and stops it, call before Rml::Shutdown.
+void StopUiThread();
+bool IsUiThreadRunning();
+// Creates the renderer's shaders and buffers, call before recording ApplyPipelineState into a display list.
+void PrepareRenderer();
+// Same for any thread but the game's GX2 one, e.g. a startup thread. Only CPU caches are flushed, the GPU cache
+// invalidations are issued by the next PrepareRenderer or BeginFrame on the GX2 thread.
+void PrepareRendererAsync();
+// Sets the renderer's fixed pipeline state (blending, culling, depth, viewport, shaders). From the first call on,
+// BeginFrame expects that state to be in place already, e.g. from a display list called at the start of every frame.
+void ApplyPipelineState();
+
+// Replays the latest list recorded by the UI thread for the screen of the frame, call between BeginFrame and PresentFrame.
+// The first screen with a context kicks off the next UI thread frame.
+// @return False if the UI thread is not running, the context has to be rendered directly then.
+bool ReplayFrame();
+
+// Creates the "render_stats" data model with the renderer counters of the last frame and loads the stats panel document.
+// The panel starts hidden and is toggled with ZL + X.
+bool LoadStatsPanel(Rml::Context* context, const char* path);
+
 } // namespace Backend
 
 #endif
@@ -0,0 +1,119 @@
+/*
+ * RmlUi render call-stream capture
+ *
+ * Wraps another render interface and records every call of the frame to a compact binary file,
+ * including geometry payloads and texture pixels, so it can be replayed offline (see Host/Include/RmlUi_Replay.h).
+ */
+
+#ifndef RMLUI_BACKENDS_CAPTURE_H
+#define RMLUI_BACKENDS_CAPTURE_H
+
+#include <RmlUi/Core/RenderInterface.h>
+#include <RmlUi/Core/Types.h>
+#include <cstdint>
+#include <cstdio>
+
+namespace Capture {
+
+// File layout: Header, then a stream of commands. Each command is one opcode byte followed by its payload.
+// Values are written in the byte order of the capturing machine, the endian marker tells the reader whether to swap.
+constexpr char MAGIC[4] = { 'R', 'M', 'L', 'C' };
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t ENDIAN_MARKER = 0x01020304;
+
+enum class Op : uint8_t {
+	BeginFrame = 1,        // u32 frame
+	EndFrame,              //
+	CompileGeometry,       // u32 id, u32 num_vertices, u32 num_indices, vertices (f32 x, f32 y, u8 rgba[4], f32 u, f32 v), i32 indices
+	ReleaseGeometry,       // u32 id
+	RenderGeometry,        // u32 geometry, f32 x, f32 y, u32 texture
+	GenerateTexture,       // u32 id, i32 width, i32 height, u32 num_bytes, bytes
+	ReleaseTexture,        // u32 id
+	EnableScissorRegion,   // u8 enable
+	SetScissorRegion,      // i32 left, i32 top, i32 width, i32 height
+	EnableClipMask,        // u8 enable
+	RenderToClipMask,      // u8 operation, u32 geometry, f32 x, f32 y
+	SetTransform,          // u8 has_transform, f32 matrix[16] when set
+};
+
+} // namespace Capture
+
+class RenderInterface_Capture : public Rml::RenderInterface {
+public:
+	explicit RenderInterface_Capture(Rml::RenderInterface* target);
+	~RenderInterface_Capture();
+
+	// Starts recording at the next BeginFrame. All compiled geometry and textures are released first so RmlUi
+	// regenerates them inside the capture, which makes the file self-contained.
+	void Start(const char* path, uint32_t max_frames);
+	void Stop();
+	bool IsCapturing() const { return file != nullptr || !pending_path.empty(); }
+
+	// Frame markers, forwarded from the backend
+	void BeginFrame();
+	void EndFrame();
+
+	// -- Inherited from Rml::RenderInterface --
+
+	Rml::CompiledGeometryHandle CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices) override;
+	void ReleaseGeometry(Rml::CompiledGeometryHandle geometry) override;
+	void RenderGeometry(Rml::CompiledGeometryHandle handle, Rml::Vector2f translation, Rml::TextureHandle texture) override;
+
+	Rml::TextureHandle LoadTexture(Rml::Vector2i& texture_dimensions, const Rml::String& source) override;
+	Rml::TextureHandle GenerateTexture(Rml::Span<const Rml::byte> source, Rml::Vector2i source_dimensions) override;
+	void ReleaseTexture(Rml::TextureHandle texture_handle) override;
+
+	void EnableScissorRegion(bool enable) override;
+	void SetScissorRegion(Rml::Rectanglei region) override;
+
+	void EnableClipMask(bool enable) override;
+	void RenderToClipMask(Rml::ClipMaskOperation operation, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation) override;
+
+	void SetTransform(const Rml::Matrix4f* transform) override;
+
+	// Layers, filters and shaders are passed through but not recorded, replays show the content without them
+	Rml::LayerHandle PushLayer() override;
+	void CompositeLayers(Rml::LayerHandle source, Rml::LayerHandle destination, Rml::BlendMode blend_mode,
+		Rml::Span<const Rml::CompiledFilterHandle> filters) override;
+	void PopLayer() override;
+
+	Rml::TextureHandle SaveLayerAsTexture() override;
+	Rml::CompiledFilterHandle SaveLayerAsMaskImage() override;
+
+	Rml::CompiledFilterHandle CompileFilter(const Rml::String& name, const Rml::Dictionary& parameters) override;
+	void ReleaseFilter(Rml::CompiledFilterHandle filter) override;
+
+	Rml::CompiledShaderHandle CompileShader(const Rml::String& name, const Rml::Dictionary& parameters) override;
+	void RenderShader(Rml::CompiledShaderHandle shader, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation,
+		Rml::TextureHandle texture) override;
+	void ReleaseShader(Rml::CompiledShaderHandle shader) override;
+
+private:
+	bool Recording() const { return file != nullptr; }
+
+	void WriteOp(Capture::Op op);
+	void WriteBytes(const void* data, size_t size);
+	template <typename T>
+	void Write(T value) { WriteBytes(&value, sizeof(T)); }
+
+	uint32_t GeometryId(Rml::CompiledGeometryHandle handle) const;
+	uint32_t TextureId(Rml::TextureHandle handle) const;
+	void RecordTexture(Rml::TextureHandle handle, Rml::Span<const Rml::byte> pixels, Rml::Vector2i dimensions);
+
+	Rml::RenderInterface* target;
+
+	FILE* file = nullptr;
+	Rml::String pending_path;
+	uint32_t frames_left = 0;
+	uint32_t frame = 0;
+
+	// Commands of the current frame, written with a single fwrite in EndFrame
+	Rml::Vector<uint8_t> frame_buffer;
+
+	// Capture ids of the handles created while recording, 0 is used for unknown handles
+	Rml::UnorderedMap<uintptr_t, uint32_t> geometry_ids;
+	Rml::UnorderedMap<uintptr_t, uint32_t> texture_ids;
+	uint32_t next_id = 1;
+};
+
+#endif
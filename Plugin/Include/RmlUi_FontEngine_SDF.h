@@ -0,0 +1,161 @@
+/*
+ * RmlUi signed distance field font engine
+ *
+ * Replaces RmlUi's FreeType font engine. Every glyph is rasterized once per face, as a signed distance field at
+ * BASE_SIZE, into a single-channel atlas shared by all faces. Text of any size and dp ratio is drawn from that atlas,
+ * the GX2 renderer keeps it at one byte per texel and turns distances into coverage with a smoothstep in its text shader.
+ * Printable ASCII is rasterized when a face is loaded, other glyphs on first use. With a cache directory set, the
+ * glyphs rasterized at load are kept there per face (see RmlUi_GlyphCache.h) and read back on the next start.
+ * Faces can be registered by family, style and weight without being read, they are loaded on first use.
+ * Font effects (outline, shadow, glow) are not supported, text is drawn without them.
+ */
+
+#ifndef RMLUI_BACKENDS_FONT_ENGINE_SDF_H
+#define RMLUI_BACKENDS_FONT_ENGINE_SDF_H
+
+#include <RmlUi/Core/CallbackTexture.h>
+#include <RmlUi/Core/FontEngineInterface.h>
+#include <RmlUi/Core/Types.h>
+#include <cstdint>
+
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+
+class FontEngineInterface_SDF : public Rml::FontEngineInterface {
+public:
+	// Pixel size glyphs are rasterized at, and the distance in pixels encoded on either side of their outline
+	static constexpr int BASE_SIZE = 32;
+	static constexpr int SPREAD = 4;
+	// Width of the atlas and its maximum height, the CPU copy and the texture only cover the rows in use
+	static constexpr int ATLAS_WIDTH = 1024;
+	static constexpr int ATLAS_MAX_HEIGHT = 1024;
+
+	FontEngineInterface_SDF();
+	~FontEngineInterface_SDF();
+
+	void Initialize() override;
+	void Shutdown() override;
+
+	bool LoadFontFace(const Rml::String& file_name, int face_index, bool fallback_face, Rml::Style::FontWeight weight) override;
+	bool LoadFontFace(Rml::Span<const Rml::byte> data, int face_index, const Rml::String& family, Rml::Style::FontStyle style,
+		Rml::Style::FontWeight weight, bool fallback_face) override;
+
+	Rml::FontFaceHandle GetFontFaceHandle(const Rml::String& family, Rml::Style::FontStyle style, Rml::Style::FontWeight weight, int size) override;
+	Rml::FontEffectsHandle PrepareFontEffects(Rml::FontFaceHandle handle, const Rml::FontEffectList& font_effects) override;
+	const Rml::FontMetrics& GetFontMetrics(Rml::FontFaceHandle handle) override;
+
+	int GetStringWidth(Rml::FontFaceHandle handle, Rml::StringView string, const Rml::TextShapingContext& text_shaping_context,
+		Rml::Character prior_character = Rml::Character::Null) override;
+	int GenerateString(Rml::RenderManager& render_manager, Rml::FontFaceHandle face_handle, Rml::FontEffectsHandle font_effects_handle,
+		Rml::StringView string, Rml::Vector2f position, Rml::ColourbPremultiplied colour, float opacity,
+		const Rml::TextShapingContext& text_shaping_context, Rml::TexturedMeshList& mesh_list) override;
+
+	// Changes whenever the atlas texture is replaced, RmlUi then regenerates the text geometry
+	int GetVersion(Rml::FontFaceHandle handle) override;
+	void ReleaseFontResources() override;
+
+	// Directory for the glyph cache, created if missing. Empty (the default) rasterizes every face on load.
+	void SetCacheDirectory(const Rml::String& directory);
+
+	// Makes the face available without touching the file. It is read in one go and parsed from memory the first time
+	// a document asks for it (or, for fallback faces, for a character the other faces lack).
+	void RegisterFontFace(const Rml::String& file_name, const Rml::String& family, Rml::Style::FontStyle style,
+		Rml::Style::FontWeight weight, bool fallback_face = false, int face_index = 0);
+
+	struct Stats {
+		uint32_t registered_faces;
+		uint32_t loaded_faces;
+		// Font files held in memory for FreeType, and the CPU copy of the atlas
+		uint32_t font_data_bytes;
+		uint32_t atlas_bytes;
+		uint32_t glyph_count;
+		uint32_t cache_hits;
+		// Spent reading and opening faces, eagerly or on first use
+		double load_time_ms;
+	};
+	Stats GetStats() const;
+
+	uint32_t GetGlyphCount() const { return glyph_count; }
+	uint32_t GetAtlasTextureBytes() const { return (uint32_t)(ATLAS_WIDTH * atlas_texture_height); }
+
+private:
+	// In pixels at BASE_SIZE, the bitmap includes the spread
+	struct Glyph {
+		float advance = 0.0f;
+		int left = 0;
+		int top = 0;
+		int width = 0;
+		int height = 0;
+		int atlas_x = 0;
+		int atlas_y = 0;
+		// False for glyphs without outline and glyphs that didn't fit, they only advance
+		bool in_atlas = false;
+	};
+
+	struct Face {
+		// Empty for faces loaded from memory
+		Rml::String path;
+		int face_index = 0;
+		bool load_failed = false;
+		Rml::String family;
+		Rml::Style::FontStyle style;
+		Rml::Style::FontWeight weight;
+		bool fallback;
+		// FreeType reads the outlines from here as glyphs are rasterized
+		Rml::Vector<Rml::byte> data;
+		FT_FaceRec_* ft_face = nullptr;
+		bool has_kerning = false;
+		Rml::UnorderedMap<Rml::Character, Glyph> glyphs;
+		// At BASE_SIZE, scaled per instance
+		Rml::FontMetrics metrics = {};
+	};
+
+	// One per face and size, the FontFaceHandle
+	struct Instance {
+		Face* face;
+		int size;
+		float scale;
+		Rml::FontMetrics metrics;
+	};
+
+	bool ReadFontFile(const Rml::String& file_name, Rml::Vector<Rml::byte>& data);
+	// Takes over the font data, FreeType reads from it for as long as the face is loaded
+	bool LoadFace(Rml::Vector<Rml::byte>&& data, int face_index, const Rml::String& family, Rml::Style::FontStyle style,
+		Rml::Style::FontWeight weight, bool fallback_face);
+	// Loads a registered face on first use
+	bool EnsureLoaded(Face* face);
+	// Opens face->data with FreeType and fills in whatever the face was registered without
+	bool OpenFace(Face* face);
+	// Restores the face's preloaded glyphs and metrics from the cache, or rasterizes them and writes the cache.
+	// Returns true on a cache hit.
+	bool LoadPreloadedGlyphs(Face* face);
+	void ComputeMetrics(Face* face);
+	// Rasterizes the glyph into the atlas on first use, looking through the fallback faces if the face lacks it
+	const Glyph* GetGlyph(Face* face, Rml::Character character, Face** glyph_face);
+	bool RasterizeGlyph(Face* face, Rml::Character character, Glyph& glyph);
+	// Shelf packing, returns false once the atlas is full
+	bool AllocateAtlasRegion(int width, int height, int& x, int& y);
+	float GetKerning(Face* face, Rml::Character left, Rml::Character right) const;
+	void ReserveAtlasRows(int rows);
+	// Replaces the atlas texture if glyphs were added since it was created
+	void UpdateAtlasTexture();
+
+	FT_LibraryRec_* library = nullptr;
+	Rml::String cache_directory;
+	Rml::Vector<Rml::UniquePtr<Face>> faces;
+	Rml::Vector<Rml::UniquePtr<Instance>> instances;
+
+	Rml::Vector<Rml::byte> atlas_pixels;
+	int shelf_x = 0;
+	int shelf_y = 0;
+	int shelf_height = 0;
+	bool atlas_dirty = false;
+	int atlas_texture_height = 0;
+	Rml::CallbackTextureSource atlas_texture;
+	int version = 1;
+	uint32_t glyph_count = 0;
+	uint32_t cache_hits = 0;
+	double load_time_ms = 0.0;
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * RmlUi glyph atlas cache
+ *
+ * Persists the distance field glyphs the SDF font engine rasterizes when a face is loaded, so later starts read them
+ * back instead of rasterizing them again. One file per face, holding its metrics, glyph records and the atlas rows
+ * its glyphs were packed into. The file is read with a single read and used in place.
+ */
+
+#ifndef RMLUI_BACKENDS_GLYPH_CACHE_H
+#define RMLUI_BACKENDS_GLYPH_CACHE_H
+
+#include <RmlUi/Core/Types.h>
+#include <cstdint>
+
+namespace GlyphCache {
+
+// File layout: Header, glyph_count Glyph records, then atlas_rows * key.atlas_width bytes of atlas.
+// Values are in the byte order of the writing machine. A cache from the other byte order is simply a miss.
+constexpr char MAGIC[4] = { 'R', 'M', 'L', 'G' };
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t ENDIAN_MARKER = 0x01020304;
+
+// Everything the cached glyphs depend on, a file only hits if all of it matches
+struct Key {
+	uint64_t font_hash;
+	uint64_t glyph_set_hash;
+	uint32_t face_index;
+	uint16_t size;
+	uint16_t spread;
+	uint32_t atlas_width;
+};
+
+// In pixels at Key::size
+struct Metrics {
+	float ascent;
+	float descent;
+	float line_spacing;
+	float x_height;
+	float underline_position;
+	float underline_thickness;
+};
+
+// atlas_y is relative to the first cached row. Glyphs without a bitmap have a width and height of 0.
+struct Glyph {
+	uint32_t character;
+	float advance;
+	int16_t left;
+	int16_t top;
+	uint16_t width;
+	uint16_t height;
+	uint16_t atlas_x;
+	uint16_t atlas_y;
+};
+
+struct Header {
+	char magic[4];
+	uint32_t version;
+	uint32_t endian_marker;
+	uint32_t glyph_count;
+	uint32_t atlas_rows;
+	uint32_t reserved;
+	Key key;
+	Metrics metrics;
+};
+
+// Points into the buffer passed to Parse
+struct View {
+	const Metrics* metrics;
+	Rml::Span<const Glyph> glyphs;
+	const Rml::byte* atlas;
+	uint32_t atlas_rows;
+};
+
+// FNV-1a, for the font data and the glyph set
+uint64_t Hash(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull);
+
+// atlas points to atlas_rows rows of key.atlas_width bytes
+Rml::Vector<Rml::byte> Serialize(const Key& key, const Metrics& metrics, Rml::Span<const Glyph> glyphs, const Rml::byte* atlas,
+	uint32_t atlas_rows);
+
+// Checks the header, key and sizes. The buffer must stay alive while the view is used, and be aligned like heap memory.
+bool Parse(Rml::Span<const Rml::byte> contents, const Key& key, View& view);
+
+// The whole file in one read, false if it doesn't exist
+bool ReadFile(const char* path, Rml::Vector<Rml::byte>& contents);
+// Writes next to the path and renames, an interrupted write never leaves a truncated cache behind
+bool WriteFile(const char* path, const Rml::Vector<Rml::byte>& contents);
+
+} // namespace GlyphCache
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * Minimal TGA decoder shared by the renderers and the capture
+ */
+
+#ifndef RMLUI_BACKENDS_IMAGE_TGA_H
+#define RMLUI_BACKENDS_IMAGE_TGA_H
+
+#include <RmlUi/Core/Span.h>
+#include <RmlUi/Core/Types.h>
+#include <cstdint>
+
+namespace TGA {
+
+// Decodes an uncompressed TGA file (RGB, RGBA or grayscale) to RGBA8 rows, top row first.
+bool Decode(Rml::Span<const Rml::byte> file_data, Rml::Vector<Rml::byte>& rgba, Rml::Vector2i& dimensions);
+
+// Reads the file through RmlUi's file interface and decodes it. While decoded images are kept, the pixels are also
+// kept by source, and later loads of the same source copy them without touching the file.
+bool Load(const Rml::String& source, Rml::Vector<Rml::byte>& rgba, Rml::Vector2i& dimensions);
+
+// Off by default. Turning it off drops the kept images.
+void KeepDecoded(bool keep);
+bool IsKeepingDecoded();
+
+struct CacheStats {
+	uint32_t images;
+	uint32_t bytes;
+	// Loads served from the kept images
+	uint32_t hits;
+};
+CacheStats GetCacheStats();
+
+} // namespace TGA
+
+#endif
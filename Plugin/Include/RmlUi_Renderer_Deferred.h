@@ -0,0 +1,206 @@
+/*
+ * RmlUi deferred render interface
+ *
+ * Lets a UI thread run Context::Update/Render while the present hook draws on the game's thread. Render calls are
+ * recorded into command lists, completed lists are handed over through a three slot buffer so neither side ever waits
+ * for the other, and the present side replays the latest complete list into the real renderer.
+ * Resource creation and release are marshalled to the present side: geometry and textures keep a CPU copy until they
+ * are first replayed, and released resources are only destroyed once no list that may reference them can be replayed.
+ * Several contexts, e.g. one per screen, can record into separate streams that share all resources.
+ * Layers, filters and shaders are recorded like everything else. Handles the target only creates while replaying
+ * (pushed layers, textures and masks saved from a layer) are stand-ins on the UI thread, replays map them to the
+ * target's handles of that replay.
+ * Only depends on RmlUi and the standard library.
+ */
+
+#ifndef RMLUI_BACKENDS_RENDERER_DEFERRED_H
+#define RMLUI_BACKENDS_RENDERER_DEFERRED_H
+
+#include <RmlUi/Core/RenderInterface.h>
+#include <RmlUi/Core/Types.h>
+#include <RmlUi/Core/Variant.h>
+#include <cstdint>
+#include <mutex>
+
+class RenderInterface_Deferred : public Rml::RenderInterface {
+public:
+	struct Counters {
+		uint64_t lists_published = 0;
+		uint64_t lists_replayed = 0;
+		// Lists replaced by a newer one before the present side picked them up
+		uint64_t lists_dropped = 0;
+	};
+
+	static constexpr int MAX_STREAMS = 2;
+
+	RenderInterface_Deferred();
+	~RenderInterface_Deferred();
+
+	// -- UI thread --
+
+	// Starts recording a new command list of the stream, call before Context::Render.
+	void BeginRecording(int stream = 0);
+	// Publishes the recorded list as the latest complete one of the stream.
+	void EndRecording(int stream = 0);
+
+	// -- Present side --
+
+	// Replays the latest complete list of the stream into target, creating and destroying resources as needed.
+	// The same list is replayed again until a newer one is published. Returns false if no list was published yet.
+	bool Replay(Rml::RenderInterface* target, int stream = 0);
+	// Destroys all released resources and drops the published lists, call once neither side is running anymore,
+	// e.g. after Rml::Shutdown or after releasing RmlUi's geometry and textures.
+	void ReleaseResources(Rml::RenderInterface* target);
+
+	Counters GetCounters();
+
+	// -- Inherited from Rml::RenderInterface --
+
+	Rml::CompiledGeometryHandle CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices) override;
+	void ReleaseGeometry(Rml::CompiledGeometryHandle geometry) override;
+	void RenderGeometry(Rml::CompiledGeometryHandle handle, Rml::Vector2f translation, Rml::TextureHandle texture) override;
+
+	Rml::TextureHandle LoadTexture(Rml::Vector2i& texture_dimensions, const Rml::String& source) override;
+	Rml::TextureHandle GenerateTexture(Rml::Span<const Rml::byte> source, Rml::Vector2i source_dimensions) override;
+	void ReleaseTexture(Rml::TextureHandle texture_handle) override;
+
+	void EnableScissorRegion(bool enable) override;
+	void SetScissorRegion(Rml::Rectanglei region) override;
+
+	void EnableClipMask(bool enable) override;
+	void RenderToClipMask(Rml::ClipMaskOperation operation, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation) override;
+
+	void SetTransform(const Rml::Matrix4f* transform) override;
+
+	Rml::LayerHandle PushLayer() override;
+	void CompositeLayers(Rml::LayerHandle source, Rml::LayerHandle destination, Rml::BlendMode blend_mode,
+		Rml::Span<const Rml::CompiledFilterHandle> filters) override;
+	void PopLayer() override;
+
+	Rml::TextureHandle SaveLayerAsTexture() override;
+	Rml::CompiledFilterHandle SaveLayerAsMaskImage() override;
+
+	Rml::CompiledFilterHandle CompileFilter(const Rml::String& name, const Rml::Dictionary& parameters) override;
+	void ReleaseFilter(Rml::CompiledFilterHandle filter) override;
+
+	Rml::CompiledShaderHandle CompileShader(const Rml::String& name, const Rml::Dictionary& parameters) override;
+	void RenderShader(Rml::CompiledShaderHandle shader, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation,
+		Rml::TextureHandle texture) override;
+	void ReleaseShader(Rml::CompiledShaderHandle shader) override;
+
+private:
+	// CPU copies are dropped once the target handle exists
+	struct Geometry {
+		Rml::Vector<Rml::Vertex> vertices;
+		Rml::Vector<int> indices;
+		Rml::CompiledGeometryHandle handle = 0;
+	};
+
+	struct Texture {
+		Rml::Vector<Rml::byte> pixels;
+		Rml::Vector2i dimensions;
+		Rml::TextureHandle handle = 0;
+		// Generated under a DistanceFieldMark, marked again when the target generates it
+		bool distance_field = false;
+		// Saved from the top layer by every replay of its SaveLayerAsTexture command, has no pixels
+		bool saved_layer = false;
+	};
+
+	// Parameters are dropped once the target compiled it
+	struct Filter {
+		Rml::String name;
+		Rml::Dictionary parameters;
+		Rml::CompiledFilterHandle handle = 0;
+		bool compiled = false;
+		// Saved from the top layer by every replay of its SaveLayerAsMaskImage command instead
+		bool mask_image = false;
+	};
+
+	struct Shader {
+		Rml::String name;
+		Rml::Dictionary parameters;
+		Rml::CompiledShaderHandle handle = 0;
+		bool compiled = false;
+	};
+
+	enum class CommandType : uint8_t {
+		RenderGeometry,
+		EnableScissorRegion,
+		SetScissorRegion,
+		EnableClipMask,
+		RenderToClipMask,
+		SetTransform,
+		PushLayer,
+		CompositeLayers,
+		PopLayer,
+		SaveLayerAsTexture,
+		SaveLayerAsMaskImage,
+		RenderShader,
+	};
+
+	struct Command {
+		CommandType type;
+		// Enable flag, clip mask operation, whether a transform is set, or blend mode
+		uint8_t value;
+		Geometry* geometry;
+		Texture* texture;
+		Filter* filter;
+		Shader* shader;
+		Rml::Vector2f translation;
+		Rml::Rectanglei region;
+		// Index into CommandList::transforms, or of the first of CompositeLayers' filters in CommandList::filters
+		uint32_t index;
+		uint32_t filter_count;
+		// Layer ids of the list: the one pushed, or CompositeLayers' source and destination. 0 is the base layer.
+		uint32_t layers[2];
+	};
+
+	struct CommandList {
+		// 0 until the slot holds a complete list
+		uint64_t sequence = 0;
+		Rml::Vector<Command> commands;
+		Rml::Vector<Rml::Matrix4f> transforms;
+		Rml::Vector<Filter*> filters;
+		// Layers pushed while recording, ids are 1 to layer_count
+		uint32_t layer_count = 0;
+	};
+
+	struct Stream {
+		CommandList lists[3];
+		CommandList* recording = &lists[0];
+		CommandList* ready = &lists[1];
+		CommandList* replaying = &lists[2];
+		bool ready_fresh = false;
+		uint64_t recording_sequence = 0;
+	};
+
+	// Resources can be destroyed once every stream only has lists with sequence >= safe_sequence left to replay
+	struct PendingRelease {
+		Geometry* geometry;
+		Texture* texture;
+		Filter* filter;
+		Shader* shader;
+		uint64_t safe_sequence;
+	};
+
+	Rml::CompiledGeometryHandle Resolve(Rml::RenderInterface* target, Geometry* geometry);
+	Rml::TextureHandle Resolve(Rml::RenderInterface* target, Texture* texture);
+	Rml::CompiledFilterHandle Resolve(Rml::RenderInterface* target, Filter* filter);
+	Rml::CompiledShaderHandle Resolve(Rml::RenderInterface* target, Shader* shader);
+	void Destroy(Rml::RenderInterface* target, const PendingRelease& release);
+	// Sequence of the oldest list any stream may still replay, call with handoff_mutex held
+	uint64_t GetOldestReplayableSequence() const;
+
+	Stream streams[MAX_STREAMS];
+	// Stream being recorded, render calls go to its recording list
+	Stream* recording_stream = &streams[0];
+	uint64_t next_sequence = 1;
+	std::mutex handoff_mutex;
+
+	Rml::Vector<PendingRelease> pending_releases;
+	std::mutex release_mutex;
+
+	Counters counters;
+};
+
+#endif
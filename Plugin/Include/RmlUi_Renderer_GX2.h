@@ -10,32 +10,102 @@
 #include <RmlUi/Core/RenderInterface.h>
 #include <gx2/texture.h>
 #include <gx2/sampler.h>
+#include <gx2/surface.h>
 #include <whb/gfx.h>
 #include <cstdint>
+#include "release_queue.hpp"
+#include "render_target_pool.hpp"
+#include "screen_bounds.hpp"
+#include "shader_variant.hpp"
+#include "slot_map.hpp"
 
 class RenderInterface_GX2 : public Rml::RenderInterface {
 public:
-	// Texture data structure
+	// Texture data structure, stored in place in the texture slot map
 	struct TextureData {
-		GX2Texture* texture;
-		GX2Sampler* sampler;
-		
-		TextureData() : texture(nullptr), sampler(nullptr) {}
+		GX2Texture texture;
+		GX2Sampler sampler;
+		// One byte per texel, an alpha mask sampled as white unless it's a distance field
+		bool single_channel;
+		// Single-channel signed distance field of a DistanceFieldMark, drawn with the text shader
+		bool distance_field;
+		// Pixels still queued for UploadPendingTextures, the texture isn't drawn until they are copied
+		bool uploading;
 	};
 
+	// Renderer counters. Plain integers touched only by the render thread, cheap enough for release builds.
+	struct Stats {
+		// Per-frame counters, reset in BeginFrame
+		uint32_t draw_calls = 0;
+		// Draws skipped because their geometry is outside the viewport or the scissor region
+		uint32_t draws_culled = 0;
+		uint32_t triangles = 0;
+		uint32_t uniform_uploads = 0;
+		uint32_t uniform_bytes = 0;
+		uint32_t texture_binds = 0;
+		uint32_t scissor_changes = 0;
+		uint32_t shader_switches = 0;
+		uint32_t geometry_compiled = 0;
+		uint32_t geometry_released = 0;
+		// Compiled geometry that reused the buffers of identical geometry
+		uint32_t geometry_dedup_hits = 0;
+		// Compiled geometry that got a private copy because the dedup table was full
+		uint32_t geometry_dedup_table_full = 0;
+		uint32_t textures_generated = 0;
+		uint32_t layers_pushed = 0;
+		uint32_t filter_passes = 0;
+
+		// Live mapped memory by category, carried across frames
+		uint32_t geometry_bytes = 0;
+		// Geometry bytes not uploaded because identical geometry already was
+		uint32_t geometry_dedup_saved_bytes = 0;
+		// Distinct payloads in the dedup table, at most MAX_SHARED_GEOMETRY
+		uint32_t geometry_dedup_entries = 0;
+		uint32_t texture_bytes = 0;
+		// Loaded texture pixels not copied into their texture yet
+		uint32_t pending_upload_bytes = 0;
+		uint32_t uniform_buffer_bytes = 0;
+		// Released but still waiting for the GPU to retire the frames that used it
+		uint32_t pending_release_bytes = 0;
+		// Pooled offscreen targets of layers and filter passes
+		uint32_t render_target_bytes = 0;
+		uint32_t render_targets_created = 0;
+		// Everything the plugin holds in mapped memory, including shaders and display lists
+		uint32_t mapped_bytes = 0;
+		uint32_t mapped_high_water_bytes = 0;
+	};
+
+	// Frames can alternate between targets, e.g. one per screen, each with its own uniform buffers and frame record.
+	// Textures and geometry are shared by all of them.
+	static constexpr int MAX_TARGETS = 2;
+	// Distinct geometry payloads tracked for deduplication, geometry compiled while the table is full gets a private copy
+	static constexpr size_t MAX_SHARED_GEOMETRY = 2048;
+
 	RenderInterface_GX2();
 	~RenderInterface_GX2();
 
-	// The viewport should be updated whenever the screen size changes.
+	// The viewport should be updated whenever the screen size changes, or before the frame of another target.
 	void SetViewport(int viewport_width, int viewport_height);
 
-	// Sets up GX2 states for taking rendering commands from RmlUi.
-	void BeginFrame();
+	// Sets up GX2 states for taking rendering commands from RmlUi. color_buffer is the buffer the frame is drawn into,
+	// layers are composited back into it and backdrop filters sample it. Without it, layers and filters are ignored.
+	void BeginFrame(int target = 0, const GX2ColorBuffer* color_buffer = nullptr);
 	void EndFrame();
 
 	// Optional, can be used to clear the framebuffer.
 	void Clear();
 
+	// Creates the shaders, uniform buffers and default texture, BeginFrame does so if not done before.
+	// Must not be called while recording a display list, the uploads would be recorded with it.
+	void CreateDeviceObjects();
+	// Waits for the GPU and frees everything the renderer created itself, e.g. before the application's GX2 goes away.
+	// Geometry and textures of RmlUi have to be released through it first. Compiled shaders stay valid, their uniform
+	// buffers are recreated on the next draw, and everything else with the next CreateDeviceObjects.
+	void ReleaseDeviceObjects();
+	// Sets blending, culling, depth and shaders. Once applied from outside, e.g. recorded into a display list
+	// that is called at the start of every frame, BeginFrame only sets the per-frame state.
+	void ApplyPipelineState();
+
 	// -- Inherited from Rml::RenderInterface --
 
 	Rml::CompiledGeometryHandle CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices) override;
@@ -54,9 +124,49 @@ public:
 
 	void SetTransform(const Rml::Matrix4f* transform) override;
 
-	// Helper method for font engine to get texture data
+	Rml::LayerHandle PushLayer() override;
+	void CompositeLayers(Rml::LayerHandle source, Rml::LayerHandle destination, Rml::BlendMode blend_mode,
+		Rml::Span<const Rml::CompiledFilterHandle> filters) override;
+	void PopLayer() override;
+
+	Rml::TextureHandle SaveLayerAsTexture() override;
+	Rml::CompiledFilterHandle SaveLayerAsMaskImage() override;
+
+	Rml::CompiledFilterHandle CompileFilter(const Rml::String& name, const Rml::Dictionary& parameters) override;
+	void ReleaseFilter(Rml::CompiledFilterHandle filter) override;
+
+	// Linear, radial and conic gradients, and the procedural effects of the shader decorator: shader(rainbow) and shader(starry)
+	Rml::CompiledShaderHandle CompileShader(const Rml::String& name, const Rml::Dictionary& parameters) override;
+	void RenderShader(Rml::CompiledShaderHandle shader, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation,
+		Rml::TextureHandle texture) override;
+	void ReleaseShader(Rml::CompiledShaderHandle shader) override;
+
+	// With deferred uploads, LoadTexture only creates the texture and queues the decoded pixels, UploadPendingTextures
+	// copies them in slices. Generated textures, e.g. font atlases, are always copied right away.
+	void SetDeferredUploads(bool deferred) { deferred_uploads = deferred; }
+	bool GetDeferredUploads() const { return deferred_uploads; }
+	bool HasPendingUploads() const { return !pending_uploads.empty(); }
+	// Copies at least one row and otherwise up to max_bytes of the oldest queued texture.
+	// Returns true once no texture is left to upload.
+	bool UploadPendingTextures(uint32_t max_bytes);
+
+	// Helper method for font engine to get texture data, nullptr for stale handles
 	TextureData* GetTextureData(Rml::TextureHandle texture_handle);
 
+	// Counters of the last completed frame
+	const Stats& GetStats() const { return last_stats; }
+	// Counters of the frame being recorded
+	const Stats& GetCurrentStats() const { return stats; }
+
+	// Draws the calls of the last frame of the current target again without going through RmlUi, call between BeginFrame and EndFrame.
+	// Returns false if there is no such frame or one of its resources has been released since.
+	bool RepeatLastFrame();
+	// Frees uniform buffers the last frame did not use and the idle pooled render targets, they are recreated on demand.
+	void TrimTransientBuffers();
+	// Waits for the GPU and frees all released resources right away. Stalls, meant for tools and shutdown;
+	// during normal frames BeginFrame reclaims whatever the GPU has retired.
+	void FlushReleases();
+
 private:
 	// Geometry data structure matching RmlUi::Vertex layout
 	struct GeometryData {
@@ -64,29 +174,214 @@ private:
 		void* index_buffer;       // GX2 index buffer
 		uint32_t num_vertices;
 		uint32_t num_indices;
+		// Key of the buffers in shared_geometry, if they are in there
+		uint64_t content_hash;
+		bool shared;
+		// Of the vertex positions, before translation and transform
+		ScreenBounds::Rect bounds;
 		
 		GeometryData() : vertex_buffer(nullptr), index_buffer(nullptr), 
-		                 num_vertices(0), num_indices(0) {}
+		                 num_vertices(0), num_indices(0), content_hash(0), shared(false), bounds(ScreenBounds::EMPTY) {}
+	};
+
+	// Buffers of one geometry payload, referenced by every GeometryData compiled from identical vertices and indices
+	struct SharedGeometry {
+		void* vertex_buffer;
+		void* index_buffer;
+		uint32_t vertex_bytes;
+		uint32_t index_bytes;
+		uint32_t references;
+	};
+
+	// CompiledGeometryHandle and TextureHandle are slot map handles, records are reused without going through the heap
+	using GeometryHandle = SlotMap<GeometryData>::Handle;
+	using TextureHandle = SlotMap<TextureData>::Handle;
+	SlotMap<GeometryData> geometries;
+	SlotMap<TextureData> textures;
+
+	// Creates the texture with its memory, the pixels are copied in with CopyTextureRows
+	TextureHandle AllocateTexture(Rml::Vector2i dimensions, bool single_channel, bool distance_field);
+	// rows points at the pixels of first_row, tightly packed
+	void CopyTextureRows(TextureData* data, const Rml::byte* rows, int first_row, int row_count);
+
+	struct PendingUpload {
+		TextureHandle handle;
+		Rml::Vector<Rml::byte> pixels;
+		int next_row;
+	};
+	// Oldest first
+	Rml::Vector<PendingUpload> pending_uploads;
+	bool deferred_uploads = false;
+	// Content hash to buffers, bounded by MAX_SHARED_GEOMETRY
+	Rml::UnorderedMap<uint64_t, SharedGeometry> shared_geometry;
+
+	// Offscreen layer or the game's color buffer, textures sample the part covered by the viewport
+	struct RenderTarget {
+		GX2ColorBuffer color_buffer;
+		GX2Texture texture;
+		GX2Sampler sampler;
+		int width;
+		int height;
+		float uv_scale_x;
+		float uv_scale_y;
+	};
+
+	enum class FilterType : uint8_t { ColorMatrix, Blur, DropShadow, MaskImage };
+	struct Filter {
+		FilterType type;
+		// Blur and DropShadow
+		float sigma;
+		// DropShadow
+		Rml::ColourbPremultiplied color;
+		Rml::Vector2f offset;
+		// ColorMatrix, applied to premultiplied colors
+		Rml::Matrix4f color_matrix;
 	};
 
+	// Post-process shaders, they draw a fullscreen quad sampling a render target
+	enum PostShader { POST_FILTER, POST_BLUR, POST_SHADOW, POST_MASK, POST_SHADER_COUNT };
+
+	// Programs behind CompileShader, loaded on first use and shared by every compiled shader using them
+	enum DecoratorShader { DECORATOR_GRADIENT, DECORATOR_RAINBOW, DECORATOR_STARRY, DECORATOR_SHADER_COUNT };
+	struct CompiledShader {
+		DecoratorShader program;
+		// Gradients only, written once by CompileShader and bound by every draw
+		GX2RBuffer gradient_buffer = {};
+		// The block written into gradient_buffer, kept to create it again after ReleaseDeviceObjects
+		Rml::Vector<Rml::byte> gradient_block;
+	};
+	// Live compiled shaders, for ReleaseDeviceObjects
+	Rml::UnorderedSet<CompiledShader*> compiled_shaders;
+
 	int viewport_width = 1280;
 	int viewport_height = 720;
 	bool scissor_enabled = false;
 	bool transform_enabled = false;
-    GX2RBuffer projection_buffer = {};
-    Rml::Vector<GX2RBuffer> transform_buffer = {};
     int current_transform_buffer_index = 0;
     
     Rml::Matrix4f transform_matrix = Rml::Matrix4f::Identity();
 
-	// Shader group for rendering (similar to ImGui implementation)
+	// Shader group for rendering (similar to ImGui implementation), the generic variant
 	WHBGfxShaderGroup* shader_group = nullptr;
+	// Shader of each ShaderVariant, and the variant that draws it, itself or the generic one if it failed to load
+	WHBGfxShaderGroup* shader_variants[ShaderVariant::COUNT] = {};
+	uint32_t resolved_variants[ShaderVariant::COUNT] = {};
+	uint32_t bound_variant = ShaderVariant::GENERIC;
     
     // Default white texture for untextured geometry
     TextureData* default_texture = nullptr;
+    Rml::TextureHandle default_texture_handle = 0;
+
+	// Mapped memory released by RmlUi, freed once the GPU is past the last submission that could read it
+	ReleaseQueue release_queue;
+
+	// Layers and filter passes draw into pooled viewport sized targets, blur levels into smaller ones
+	RenderTargetPool render_target_pool;
+	// Wraps the game's buffer, its texture is only set up if it can be sampled
+	RenderTarget base_layer = {};
+	bool base_layer_valid = false;
+	// Layer stack of the frame, the base layer first, LayerHandle is the index
+	Rml::Vector<RenderTarget*> layers;
+	// Last SaveLayerAsMaskImage result, handed back to the pool at the end of the frame
+	RenderTarget* mask_target = nullptr;
+	WHBGfxShaderGroup* post_shaders[POST_SHADER_COUNT] = {};
+	GeometryData* fullscreen_quad = nullptr;
+	// Smoothstep over distance field textures, glyphs of any size from one atlas
+	WHBGfxShaderGroup* text_shader = nullptr;
+	Rml::CompiledGeometryHandle fullscreen_quad_handle = 0;
+	// Scissor rectangle currently applied, restored after filter passes
+	int scissor_x = 0, scissor_y = 0, scissor_width = 0, scissor_height = 0;
+	bool frame_used_layers = false;
+	WHBGfxShaderGroup* decorator_shaders[DECORATOR_SHADER_COUNT] = {};
+	bool decorator_shader_failed[DECORATOR_SHADER_COUNT] = {};
+	// Seconds since the system interface started, sampled once per frame
+	float frame_time = 0.0f;
+
+	Stats stats;
+	Stats last_stats;
+	GX2Texture* bound_texture = nullptr;
+
+	// Render calls of the current frame and the last completed one of each target, for RepeatLastFrame
+	enum class FrameCallType : uint8_t { RenderGeometry, RenderShader, EnableScissorRegion, SetScissorRegion, SetTransform };
+	struct FrameCall {
+		FrameCallType type;
+		bool enable;
+		Rml::CompiledShaderHandle shader;
+		Rml::CompiledGeometryHandle geometry;
+		Rml::TextureHandle texture;
+		Rml::Vector2f translation;
+		Rml::Rectanglei region;
+		Rml::Matrix4f transform;
+	};
+	Rml::Vector<FrameCall> frame_calls;
+	bool repeating = false;
+	bool frame_repeated = false;
+
+	// The GPU may still read the uniforms of one target while the frame of the next one is set up
+	struct FrameTarget {
+		GX2RBuffer projection_buffer = {};
+		// iTime and iResolution of the procedural shaders, uploaded by the first draw of a frame that needs them
+		GX2RBuffer frame_uniform_buffer = {};
+		bool frame_uniforms_uploaded = false;
+		Rml::Vector<GX2RBuffer> transform_buffer;
+		Rml::Vector<FrameCall> last_frame_calls;
+		bool last_frame_valid = false;
+		int last_transform_buffer_count = 0;
+	};
+	FrameTarget targets[MAX_TARGETS];
+	FrameTarget* frame_target = &targets[0];
 	
+	bool pipeline_state_external = false;
+
 	// Helper to set up render state
 	void SetupRenderState();
+	void SetupPipelineState();
+	// Released resources may be referenced by the frame record of any target
+	void InvalidateLastFrames();
+	// Sets a scissor rectangle and counts the state change
+	void ApplyScissor(int x, int y, int width, int height);
+	// False if the geometry can't cover a pixel inside the viewport and the scissor rectangle, counting the culled draw
+	bool IsVisible(const GeometryData* data, Rml::Vector2f translation);
+	// Creates a uniform buffer and accounts for its memory
+	void CreateUniformBuffer(GX2RBuffer* buffer, size_t size);
+	// Next per-draw uniform buffer of the current target
+	GX2RBuffer* NextTransformBuffer();
+	// Uploads the transform combined with the translation into TransformBlock
+	void UploadTransformBlock(WHBGfxShaderGroup* group, Rml::Vector2f translation);
+	// Loads the program on first use, nullptr if it failed to load
+	WHBGfxShaderGroup* GetDecoratorShader(DecoratorShader program);
+	// Binds FrameBlock of the current target, uploading it first if no draw of the frame did yet
+	void BindFrameUniforms(WHBGfxShaderGroup* group);
+
+	// Render target pool callbacks, targets are RGBA8 color buffers that can be sampled
+	static void* CreateRenderTarget(void* user, const RenderTargetPool::Key& key, uint32_t* bytes);
+	static void DestroyRenderTarget(void* user, void* target);
+	RenderTarget* AcquireRenderTarget(int width, int height);
+	void ReleaseRenderTarget(RenderTarget* target);
+	// Binds the target as color buffer with a matching viewport and a full scissor
+	void BindRenderTarget(RenderTarget* target);
+	// Rebinds the top layer and the RmlUi draw state after offscreen passes
+	void RestoreLayerState();
+	void SetBlendMode(Rml::BlendMode blend_mode);
+	// Makes the GPU writes to the target visible to texture reads
+	void FlushRenderTarget(RenderTarget* target);
+	// Draws a fullscreen quad into the bound target, sampling the area of source starting at source_offset (in its pixels)
+	// and spanning source_scale of its size. Without source the white texture is sampled.
+	void DrawPostPass(PostShader shader, RenderTarget* source, const void* pixel_uniforms, size_t pixel_uniforms_size, const char* block_name,
+		Rml::Vector2f source_offset = Rml::Vector2f(0.0f, 0.0f), Rml::Vector2f source_scale = Rml::Vector2f(1.0f, 1.0f));
+	bool CanSample(const RenderTarget* target) const { return target->texture.surface.image != nullptr; }
+	void ClearRenderTarget(RenderTarget* target);
+	void CopyRenderTarget(RenderTarget* source, RenderTarget* destination);
+	// Filter passes work on full viewport targets, the result ends up in target, temp is scratch space
+	void RenderBlur(float sigma, RenderTarget* target, RenderTarget* temp);
+	void RenderFilter(const Filter& filter, RenderTarget*& target, RenderTarget*& temp);
+
+	// Draw path specialized for a ShaderVariant, texture is only used by textured variants and never null for them
+	template <uint32_t Variant>
+	void DrawGeometry(GeometryData* data, Rml::Vector2f translation, TextureData* texture);
+	void DrawDistanceField(GeometryData* data, Rml::Vector2f translation, TextureData* texture);
+	using DrawFunction = void (RenderInterface_GX2::*)(GeometryData* data, Rml::Vector2f translation, TextureData* texture);
+	static const DrawFunction draw_functions[ShaderVariant::COUNT];
 };
 
 #endif
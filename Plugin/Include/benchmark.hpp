@@ -0,0 +1,19 @@
+#pragma once
+
+class RenderInterface_GX2;
+
+namespace Benchmark
+{
+
+// Queues a run of the suite, executed by the next RunPending call
+void Request();
+
+// Runs a queued suite. Called from the overlay render path so the renderer is not in use by RmlUi.
+void RunPending(RenderInterface_GX2* render_interface);
+
+// Runs the renderer and I/O micro-benchmarks and writes the results as JSON to output_path. The documents and images
+// read are those of data_directory, with its trailing separator. When baseline_path points to the output of a previous
+// run, every result is compared against it.
+bool Run(RenderInterface_GX2* render_interface, const char* data_directory, const char* output_path, const char* baseline_path);
+
+} // namespace Benchmark
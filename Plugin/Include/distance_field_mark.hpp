@@ -0,0 +1,19 @@
+#pragma once
+
+// Marks the textures generated on this thread while it is alive as signed distance fields. RmlUi's GenerateTexture
+// only passes pixels and dimensions, and one byte per texel is also what a plain alpha mask looks like, so
+// FontEngineInterface_SDF wraps the generation of its atlas in a mark and the renderers ask IsActive.
+class DistanceFieldMark
+{
+public:
+    DistanceFieldMark() { depth++; }
+    ~DistanceFieldMark() { depth--; }
+
+    DistanceFieldMark(const DistanceFieldMark&) = delete;
+    DistanceFieldMark& operator=(const DistanceFieldMark&) = delete;
+
+    static bool IsActive() { return depth > 0; }
+
+private:
+    static inline thread_local int depth = 0;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Keeps the overlay's share of a frame within a time budget. Work that counts against the budget (event processing,
+// updating, rendering) is bracketed with Begin/End, from whichever hook runs it. Sections of different threads that
+// overlap count once. Whatever is left of the budget runs deferred tasks one slice at a time, a task that isn't done
+// after its slice carries over to later frames. Tasks go into one of MAX_QUEUES queues and only run when that queue
+// is run, so work tied to a thread (data models on the context thread, uploads on the GX2 one) stays there.
+// Frames whose bracketed work went over the budget are counted in a histogram by how far over they went.
+// Every call is safe from any thread.
+class FrameScheduler
+{
+public:
+    // Microseconds, monotonic
+    using ClockSource = uint64_t (*)();
+    // Runs one slice of the work, returns true once all of it is done
+    using Task = bool (*)(void* user);
+
+    // About an eighth of a 60 Hz frame
+    static constexpr uint32_t DEFAULT_BUDGET_US = 2000;
+    // Over budget by up to 25%, 50%, 100%, 200%, 400% and more
+    static constexpr uint32_t HISTOGRAM_BUCKETS = 6;
+    // Once tasks have waited this many frames without a slice, one runs even if no budget is left
+    static constexpr uint32_t MAX_STARVED_FRAMES = 8;
+    static constexpr uint32_t MAX_QUEUES = 2;
+
+    struct Stats
+    {
+        uint32_t frames;
+        uint32_t frames_over_budget;
+        uint32_t over_budget[HISTOGRAM_BUCKETS];
+        uint32_t slices;
+        // Slices run without budget left, see MAX_STARVED_FRAMES
+        uint32_t forced_slices;
+        uint32_t tasks_completed;
+        uint32_t pending_tasks;
+        // Bracketed work of the last closed frame, deferred slices included
+        uint32_t last_frame_us;
+    };
+
+    // OSGetSystemTime on Wii U, steady_clock elsewhere. Tests can pass a fake clock.
+    FrameScheduler();
+    explicit FrameScheduler(ClockSource clock);
+
+    FrameScheduler(const FrameScheduler&) = delete;
+    FrameScheduler& operator=(const FrameScheduler&) = delete;
+
+    // 0 leaves nothing for deferred tasks, they only run once starved
+    void SetBudget(uint32_t microseconds);
+    uint32_t GetBudget() const;
+
+    // Queues the task into the given queue. The same task and user are only queued once, returns false if they
+    // already were.
+    bool Defer(Task task, void* user, uint32_t queue = 0);
+    // Drops every queued task without running it, while no queue is being run
+    void Clear();
+
+    // Brackets work counting against the budget. Sections may nest.
+    void Begin();
+    void End();
+    // Budget left in the current frame, 0 once it's used up
+    uint32_t GetRemaining() const;
+
+    // Runs slices of the tasks in the queue while the expected cost of one fits into the remaining budget, call inside
+    // Begin/End on the thread the queue's tasks belong to. Tasks take turns, one that isn't done goes to the back of
+    // the queue. Returns the slices run.
+    uint32_t RunDeferred(uint32_t queue = 0);
+
+    // Closes the frame and counts it in the histogram if it went over the budget, once per presented frame
+    void NextFrame();
+
+    Stats GetStats();
+    void ResetStats();
+
+private:
+    struct Entry
+    {
+        Task task;
+        void* user;
+        uint32_t queue;
+        // Moving average of its slices, 0 until the first one ran
+        uint32_t cost_us;
+    };
+
+    // With the mutex held
+    uint64_t GetSpent() const;
+    uint32_t GetRemainingLocked() const;
+
+    ClockSource clock;
+
+    // Guards everything below, released while a task runs so it can defer again
+    mutable std::mutex mutex;
+    uint32_t budget_us = DEFAULT_BUDGET_US;
+
+    uint32_t section_depth = 0;
+    uint64_t section_start = 0;
+    uint64_t spent_us = 0;
+    bool sliced_this_frame[MAX_QUEUES] = {};
+    uint32_t starved_frames[MAX_QUEUES] = {};
+
+    std::vector<Entry> entries;
+
+    Stats stats = {};
+};
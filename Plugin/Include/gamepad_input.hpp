@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include <vpad/input.h>
+
+// GamePad samples handed over by the VPADRead hook, queued oldest first and replayed into handlers on the thread
+// owning the context. Every sample's buttons are passed on, touch moves between presses and releases are coalesced
+// so only the latest valid position is reported.
+class GamepadInput
+{
+public:
+    static constexpr uint32_t MAX_SAMPLES = 16;
+
+    struct Handlers
+    {
+        void* user;
+        // Latest valid raw touch before a press, a release or the end of the samples, still to be calibrated
+        void (*move)(void* user, const VPADTouchData& raw_touch);
+        void (*touch)(void* user, bool down);
+        // trigger/release are relative to the previous sample
+        void (*buttons)(void* user, const VPADStatus& status);
+    };
+
+    // Samples as returned by VPADRead, newest first. Once full the oldest queued samples are dropped.
+    void Submit(const VPADStatus* samples, uint32_t count);
+    // Moves the queued samples out, oldest first. Returns how many there were.
+    uint32_t Take(VPADStatus (&samples)[MAX_SAMPLES]);
+
+    // Replays taken samples into the handlers, touch state carries over between calls
+    void Process(const VPADStatus* samples, uint32_t count, const Handlers& handlers);
+
+    // Samples RmlUi would react to, held buttons without changes don't count
+    static bool HasInput(const VPADStatus* samples, uint32_t count);
+
+private:
+    std::mutex mutex;
+    VPADStatus queue[MAX_SAMPLES];
+    uint32_t queue_count = 0;
+
+    // Consumer only
+    bool was_touched = false;
+};
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <string>
+#include <gx2/enum.h>
 #include <gx2r/buffer.h>
 #include <whb/gfx.h>
 
@@ -16,9 +17,12 @@ int32_t GX2GetUniformBlockLocation(T* shader, const char* name);
 template<typename T>
 int32_t GX2GetUniformVarLocation(T* shader, const char* name);
 
-// Initialize uniform buffer
+// Initialize uniform buffer in mapped memory tagged UniformBuffer, buffer->buffer stays null if that fails
 void GX2InitUniformBuffer(GX2RBuffer* buffer, size_t size, uint32_t count);
 
+// Destroy a uniform buffer of GX2InitUniformBuffer and free its memory
+void GX2DestroyUniformBuffer(GX2RBuffer* buffer);
+
 // Set shader group (vertex + pixel + fetch shaders)
 void GX2SetShaderGroup(WHBGfxShaderGroup* shaderGroup);
 
@@ -31,3 +35,27 @@ void GX2RSetVertexUniformBlockEx(WHBGfxShaderGroup* shaderGroup, GX2RBuffer* buf
 
 // Set pixel uniform block with data (includes lock/unlock and endian swap)
 void GX2RSetPixelUniformBlockEx(WHBGfxShaderGroup* shaderGroup, GX2RBuffer* buffer, void* data, size_t size, std::string name);
+
+// Write uniform block data without binding it, e.g. for blocks filled once and bound by later draws
+void GX2RUpdateUniformBlock(GX2RBuffer* buffer, const void* data, size_t size);
+
+// Invalidation for resources that may be created off the GX2 thread. While deferred, only the CPU cache is flushed
+// and the GPU part of the mode is collected instead of written to the command buffer, which belongs to the GX2
+// thread. Deferring is global, nothing else may use GX2 resources of the plugin in the meantime.
+void GX2InvalidateDeferrable(GX2InvalidateMode mode, void* buffer, uint32_t size);
+void GX2BeginDeferredInvalidations();
+void GX2EndDeferredInvalidations();
+// Writes the collected GPU invalidations as one over all memory, call on the GX2 thread before the resources are used
+void GX2FlushDeferredInvalidations();
+
+
+// GPU timestamp writes exported by gx2.rpl
+extern "C"
+{
+// Writes the GPU clock when the command reaches the top of the pipe
+void GX2SampleTopGPUCycle(uint64_t* result);
+// Writes the GPU clock once all previous commands have completed
+void GX2SampleBottomGPUCycle(uint64_t* result);
+// Converts a GPU clock value to OSTime ticks
+uint64_t GX2GPUTimeToCPUTime(uint64_t time);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+// Tagged wrapper around the mapped-memory heap. Every allocation of the plugin goes through here so the live, peak
+// and high-water bytes of each kind of resource are known, live allocations can be dumped with their source, and
+// whatever is still allocated at exit can be reported as a leak.
+namespace MappedMemory
+{
+
+enum class Tag : uint8_t
+{
+    Geometry,
+    Texture,
+    RenderTarget,
+    Shader,
+    FetchShader,
+    ContextState,
+    DisplayList,
+    UniformBuffer,
+    Profiler,
+    Other,
+    Count
+};
+
+constexpr uint32_t TAG_COUNT = (uint32_t)Tag::Count;
+// Longest source kept per allocation, longer ones keep their end (the file name)
+constexpr uint32_t MAX_SOURCE_LENGTH = 47;
+
+constexpr uint32_t TagBit(Tag tag)
+{
+    return 1u << (uint32_t)tag;
+}
+
+const char* TagName(Tag tag);
+
+// MEMAllocFromMappedMemoryForGX2Ex on Wii U, for anything the GPU reads or writes. source describes the allocation
+// in dumps (e.g. a texture path) and is copied. Returns nullptr on failure.
+void* Alloc(Tag tag, uint32_t size, uint32_t alignment, const char* source = nullptr);
+// MEMAllocFromMappedMemoryEx on Wii U, for CPU-only data such as shader headers
+void* AllocCpu(Tag tag, uint32_t size, uint32_t alignment, const char* source = nullptr);
+// Frees memory from either Alloc function, usable as a ReleaseQueue::FreeFunction. nullptr is ignored.
+void Free(void* memory);
+
+// Replaces the source of a live allocation, for allocations made before their source is known
+void SetSource(void* memory, const char* source);
+
+struct TagStats
+{
+    uint32_t live_bytes = 0;
+    uint32_t live_count = 0;
+    // Highest live_bytes since the last ResetPeaks
+    uint32_t peak_bytes = 0;
+    // Highest live_bytes ever
+    uint32_t high_water_bytes = 0;
+    uint32_t total_allocs = 0;
+    uint32_t failed_allocs = 0;
+};
+
+TagStats GetTagStats(Tag tag);
+uint32_t GetLiveBytes();
+uint32_t GetHighWaterBytes();
+// Starts a new peak window for every tag
+void ResetPeaks();
+
+// Logs the per-tag stats and every live allocation, largest first
+void DumpLive();
+
+// Logs the allocations still live, except those of the tags in expected_tag_mask (e.g. memory freed after the
+// report on purpose). Call once everything else has shut down. Returns the number of leaked allocations.
+uint32_t ReportLeaks(uint32_t expected_tag_mask = 0);
+
+} // namespace MappedMemory
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <gx2/surface.h>
+
+namespace OverlayState
+{
+
+// Color buffers with a recorded list, TV and GamePad scan buffers are usually double or triple buffered
+constexpr uint32_t MAX_TARGETS = 6;
+// Space for GX2SetDefaultState, render target, viewport and the renderer pipeline state
+constexpr uint32_t DISPLAY_LIST_SIZE = 0x4000;
+
+// Sets the overlay default state, render target, viewport, scissor and the renderer pipeline state for color_buffer.
+// The state is recorded into a display list the first time a color buffer configuration is seen, after that it is
+// applied with a single GX2CallDisplayList. Call with the overlay context state active.
+void Apply(const GX2ColorBuffer* color_buffer);
+
+// Frees the display lists, call on application exit or after changing the renderer viewport
+void Release();
+
+} // namespace OverlayState
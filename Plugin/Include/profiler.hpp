@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Rml { class Context; }
+
+namespace Profiler
+{
+
+// Number of frames kept in the ring buffer
+constexpr uint32_t FRAME_HISTORY = 128;
+// Maximum number of CPU scopes recorded per frame, extra scopes are dropped
+constexpr uint32_t MAX_SCOPES_PER_FRAME = 64;
+// Maximum number of GPU begin/end pairs per frame (one per scan buffer copy)
+constexpr uint32_t MAX_GPU_RANGES_PER_FRAME = 4;
+
+// Monotonic clock (OSGetTime on Wii U, CLOCK_MONOTONIC elsewhere)
+uint64_t GetTicks();
+uint64_t TicksToMicroseconds(uint64_t ticks);
+uint64_t TicksToNanoseconds(uint64_t ticks);
+
+// Allocates the ring buffer and the GPU timestamp memory
+void Initialize();
+void Shutdown();
+bool IsInitialized();
+
+// Closes the current frame and opens the next one, call once per presented frame
+void NextFrame();
+
+// Records a finished CPU scope into the current frame
+void RecordScope(const char* name, uint64_t begin, uint64_t end);
+
+// Writes GPU timestamps around the overlay command stream
+void GpuBegin();
+void GpuEnd();
+
+// Frame cost percentiles over the completed frames in the ring buffer
+struct Summary
+{
+    uint32_t frames = 0;
+    float cpu_p50_ms = 0.0f;
+    float cpu_p95_ms = 0.0f;
+    float cpu_p99_ms = 0.0f;
+    float cpu_max_ms = 0.0f;
+    float gpu_p50_ms = 0.0f;
+    float gpu_p95_ms = 0.0f;
+    float gpu_max_ms = 0.0f;
+};
+Summary GetSummary();
+
+// Writes the ring buffer as Chrome trace JSON (chrome://tracing, Perfetto)
+bool DumpChromeTrace(const char* path);
+
+// Optional on-screen HUD, the "profiler" data model is created before the document is loaded
+bool LoadHud(Rml::Context* context, const char* path);
+void ToggleHud();
+// Refreshes the HUD values every few frames, call from the thread that updates the context.
+// Returns true if the data model was dirtied.
+bool UpdateHud();
+void UnloadHud();
+
+class Scope
+{
+public:
+    explicit Scope(const char* name) : name(name), begin(GetTicks()) {}
+    ~Scope() { RecordScope(name, begin, GetTicks()); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* name;
+    uint64_t begin;
+};
+
+} // namespace Profiler
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILER_CONCAT(profile_scope_, __LINE__)(name)
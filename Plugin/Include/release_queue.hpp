@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Defers freeing memory the GPU may still read until every command buffer that could reference it has retired.
+// Releases are tagged with the next submission timestamp and reclaimed by Drain once the retired timestamp reaches
+// the tag, so no GX2DrawDone stall is needed.
+class ReleaseQueue
+{
+public:
+    using TimestampSource = uint64_t (*)();
+    using FreeFunction = void (*)(void* memory);
+
+    // GX2GetLastSubmittedTimeStamp and GX2GetRetiredTimeStamp on Wii U. Elsewhere the GPU counts as idle unless
+    // sources are set, which lets tests drive the queue with fake timestamps.
+    ReleaseQueue();
+    ReleaseQueue(TimestampSource submitted, TimestampSource retired);
+    ~ReleaseQueue();
+
+    ReleaseQueue(const ReleaseQueue&) = delete;
+    ReleaseQueue& operator=(const ReleaseQueue&) = delete;
+
+    // Queues memory for free_function, size is only used for accounting
+    void Release(void* memory, uint32_t size, FreeFunction free_function);
+
+    // Frees everything the GPU is done with, call once per frame. Returns the number of entries freed.
+    uint32_t Drain();
+
+    // Frees everything right away, only valid once the GPU is idle (after GX2DrawDone)
+    void Flush();
+
+    uint32_t GetPendingCount() const { return (uint32_t)entries.size(); }
+    uint32_t GetPendingBytes() const { return pending_bytes; }
+
+private:
+    struct Entry
+    {
+        uint64_t tag;
+        void* memory;
+        uint32_t size;
+        FreeFunction free_function;
+    };
+
+    TimestampSource submitted;
+    TimestampSource retired;
+
+    // Tags are monotonic, so entries are in retirement order
+    std::vector<Entry> entries;
+    uint32_t pending_bytes = 0;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Keeps offscreen render targets alive across frames so layers and filter passes reuse them instead of allocating
+// every frame. Targets are matched by size and format; free ones that go unused for a while are destroyed.
+// The pool only handles bookkeeping, the owner creates and destroys the actual targets.
+class RenderTargetPool
+{
+public:
+    struct Key
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;
+
+        bool operator==(const Key& other) const { return width == other.width && height == other.height && format == other.format; }
+    };
+
+    // Returns the new target and its size in bytes, or nullptr
+    using CreateFunction = void* (*)(void* user, const Key& key, uint32_t* bytes);
+    using DestroyFunction = void (*)(void* user, void* target);
+
+    RenderTargetPool(CreateFunction create, DestroyFunction destroy, void* user);
+    ~RenderTargetPool();
+
+    RenderTargetPool(const RenderTargetPool&) = delete;
+    RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+    // A free target with the key, or a new one. Returns nullptr if creating fails.
+    void* Acquire(const Key& key);
+    // Hands the target back, it can be acquired again right away
+    void Release(void* target);
+
+    // Call once per frame, destroys free targets not acquired for more than max_idle_frames
+    void NextFrame(uint32_t max_idle_frames);
+    // Destroys all free targets
+    void Trim();
+
+    uint32_t GetCount() const { return (uint32_t)entries.size(); }
+    uint32_t GetInUseCount() const;
+    uint32_t GetBytes() const { return bytes; }
+    // Targets created since the pool was made, stays put once the pool has warmed up
+    uint32_t GetCreatedCount() const { return created; }
+
+private:
+    struct Entry
+    {
+        Key key;
+        void* target;
+        uint32_t bytes;
+        uint32_t last_used;
+        bool in_use;
+    };
+
+    void Destroy(size_t index);
+
+    CreateFunction create;
+    DestroyFunction destroy;
+    void* user;
+
+    std::vector<Entry> entries;
+    uint32_t frame = 0;
+    uint32_t bytes = 0;
+    uint32_t created = 0;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+// Axis-aligned bounds of geometry, computed once when it is compiled and tested against the clip rectangle (viewport
+// and scissor) before every draw, so draws that can't touch a pixel skip their uniform uploads and state changes.
+namespace ScreenBounds
+{
+
+// Empty when left > right, which never intersects anything
+struct Rect
+{
+    float left;
+    float top;
+    float right;
+    float bottom;
+};
+
+constexpr Rect EMPTY = { 1.0f, 1.0f, 0.0f, 0.0f };
+
+// Bounds of the positions of vertex_count vertices stride bytes apart, the position being the first two floats of each
+Rect Compute(const void* vertices, uint32_t vertex_count, uint32_t stride);
+
+Rect Intersect(const Rect& a, const Rect& b);
+
+// Whether bounds, moved by the translation and then put through transform (column-major 4x4 as RmlUi passes it,
+// nullptr for none), overlap clip. Points of a perspective transform on or behind the eye plane can't be projected,
+// such bounds always count as visible.
+bool IsVisible(const Rect& bounds, float translation_x, float translation_y, const float* transform, const Rect& clip);
+
+} // namespace ScreenBounds
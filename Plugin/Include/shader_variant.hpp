@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+// Shader permutations of the RmlUi renderer. Each flag strips work from the generic path: untextured draws don't bind
+// or sample a texture, and draws without a transform upload a translation instead of a full matrix.
+// The GLSL of every variant lives in Shader/Source, named by Name().
+namespace ShaderVariant
+{
+    enum Flags : uint32_t
+    {
+        TEXTURED = 1 << 0,
+        TRANSFORM = 1 << 1,
+    };
+
+    constexpr uint32_t COUNT = 4;
+    // Handles every draw, the fallback if another variant is not available
+    constexpr uint32_t GENERIC = TEXTURED | TRANSFORM;
+
+    constexpr uint32_t Select(bool textured, bool transform)
+    {
+        return (textured ? TEXTURED : 0u) | (transform ? TRANSFORM : 0u);
+    }
+
+    constexpr const char* Name(uint32_t variant)
+    {
+        switch (variant)
+        {
+        case 0:
+            return "rmlui_color_translate";
+        case TEXTURED:
+            return "rmlui_translate";
+        case TRANSFORM:
+            return "rmlui_color";
+        default:
+            return "rmlui";
+        }
+    }
+
+    static_assert(Select(true, true) == GENERIC, "the generic variant must take every flag");
+    static_assert(Select(false, false) == 0 && Select(true, false) == TEXTURED && Select(false, true) == TRANSFORM, "flags map to bits");
+    static_assert(Select(true, true) < COUNT, "every selection has a slot");
+}
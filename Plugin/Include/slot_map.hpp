@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#ifdef DEBUG
+#ifdef __WIIU__
+#include <whb/log.h>
+#define SLOT_MAP_REPORT(...) WHBLogPrintf(__VA_ARGS__)
+#else
+#include <cstdio>
+#define SLOT_MAP_REPORT(...) (std::fprintf(stderr, __VA_ARGS__), std::fputc('\n', stderr))
+#endif
+#endif
+
+// Records addressed by 32-bit generational handles. Slots live in fixed-size pages that are never moved, so pointers
+// to records stay valid until they are erased, and freed slots are reused before new pages are added. A handle keeps
+// the generation of its slot, once the slot is erased (or reused) the handle resolves to nothing instead of to
+// someone else's record. 0 is never a valid handle.
+template <typename T, uint32_t PageSize = 256>
+class SlotMap
+{
+public:
+    using Handle = uint32_t;
+
+    static constexpr uint32_t INDEX_BITS = 20;
+    static constexpr uint32_t MAX_SLOTS = 1u << INDEX_BITS;
+    static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+    static_assert((PageSize & (PageSize - 1)) == 0, "PageSize must be a power of two");
+
+    SlotMap() = default;
+    SlotMap(const SlotMap&) = delete;
+    SlotMap& operator=(const SlotMap&) = delete;
+
+    // Returns 0 if every slot is taken
+    Handle Insert(T value)
+    {
+        uint32_t index;
+        if (free_head != NO_SLOT) {
+            index = free_head;
+            free_head = SlotAt(index).next_free;
+        } else {
+            if (slot_count == MAX_SLOTS)
+                return 0;
+            if (slot_count % PageSize == 0) {
+                pages.emplace_back(new Slot[PageSize]);
+            }
+            index = slot_count++;
+        }
+
+        Slot& slot = SlotAt(index);
+        slot.value = std::move(value);
+        slot.occupied = true;
+        count++;
+        return (slot.generation << INDEX_BITS) | index;
+    }
+
+    // Checked lookup, nullptr for 0 and stale handles
+    T* Get(Handle handle)
+    {
+        Slot* slot = Find(handle);
+        return slot ? &slot->value : nullptr;
+    }
+
+    // Lookup for handles expected to be live, e.g. on every draw. Checked like Get in every build, since a stale
+    // handle reaching the renderer would otherwise draw with whatever record reused its slot. Debug builds report them.
+    T* Resolve(Handle handle)
+    {
+        Slot* slot = Find(handle);
+        if (!slot) {
+#ifdef DEBUG
+            if (handle) {
+                SLOT_MAP_REPORT("SlotMap: Stale handle %08x (slot %u)", handle, handle & (MAX_SLOTS - 1));
+            }
+#endif
+            return nullptr;
+        }
+        return &slot->value;
+    }
+
+    // Frees the slot and invalidates every handle to it. Returns false for stale handles.
+    bool Erase(Handle handle)
+    {
+        Slot* slot = Find(handle);
+        if (!slot)
+            return false;
+
+        slot->value = T();
+        slot->occupied = false;
+        // Generation 0 is skipped so that no handle is ever 0
+        slot->generation = (slot->generation + 1) & GENERATION_MASK;
+        if (slot->generation == 0) {
+            slot->generation = 1;
+        }
+        slot->next_free = free_head;
+        free_head = handle & (MAX_SLOTS - 1);
+        count--;
+        return true;
+    }
+
+    // Calls func(handle, value) for every live record, in slot order
+    template <typename Func>
+    void ForEach(Func&& func)
+    {
+        for (uint32_t index = 0; index < slot_count; index++) {
+            Slot& slot = SlotAt(index);
+            if (slot.occupied) {
+                func((slot.generation << INDEX_BITS) | index, slot.value);
+            }
+        }
+    }
+
+    uint32_t GetCount() const { return count; }
+    uint32_t GetCapacity() const { return (uint32_t)pages.size() * PageSize; }
+
+private:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    struct Slot
+    {
+        T value = T();
+        uint32_t generation = 1;
+        uint32_t next_free = NO_SLOT;
+        bool occupied = false;
+    };
+
+    Slot& SlotAt(uint32_t index) { return pages[index / PageSize][index % PageSize]; }
+
+    Slot* Find(Handle handle)
+    {
+        uint32_t index = handle & (MAX_SLOTS - 1);
+        if (!handle || index >= slot_count)
+            return nullptr;
+        Slot& slot = SlotAt(index);
+        if (!slot.occupied || slot.generation != (handle >> INDEX_BITS))
+            return nullptr;
+        return &slot;
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> pages;
+    uint32_t slot_count = 0;
+    uint32_t count = 0;
+    uint32_t free_head = NO_SLOT;
+};
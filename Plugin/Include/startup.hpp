@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+// Runs the plugin's initialization on a background thread so the application start hook returns right away.
+// The overlay checks IsReady and stays inactive until the init function has returned true. Phases of the init
+// function are timed and logged at the end.
+namespace Startup
+{
+
+using InitFunction = bool (*)();
+
+// Off the game's core like the UI thread, with room for RmlUi's recursive document parsing
+constexpr uint32_t CORE = 2;
+constexpr uint32_t STACK_SIZE = 256 * 1024;
+constexpr uint32_t MAX_PHASES = 16;
+
+// Starts init on the background thread, false if it could not be started or is still running
+bool Start(InitFunction init);
+// Joins the thread, call before tearing down anything init may still be creating
+void Wait();
+// True once init has returned true, until the next Start
+bool IsReady();
+
+// Ends the running phase and starts the named one, name must outlive the startup
+void BeginPhase(const char* name);
+// Ends the running phase and logs every phase with its duration and the total, kind tells starts apart in the log
+// (e.g. "cold" or "warm")
+void LogPhases(const char* kind);
+// Appends the phases of the last startup as one JSON line to path, only if the file already exists. Creating an empty
+// file collects every following start, cold and warm, to compare them.
+bool AppendPhases(const char* path, const char* kind);
+
+struct Phase
+{
+    const char* name;
+    uint64_t microseconds;
+};
+// Completed phases of the last startup, in order
+uint32_t GetPhases(Phase* phases, uint32_t max_phases);
+
+} // namespace Startup
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Rml { class Context; }
+
+// Live game and system values for the overlay, written by producers on any thread and shown through the "telemetry"
+// data model. Producers store into the back buffer, one atomic value per field plus a pending bit, without locks.
+// Once per UI tick Sync diffs the pending fields against the front buffer the data model is bound to, and only
+// dirties the variables whose value moved by at least the field's threshold, at most once per its minimum interval.
+// Everything that would be dirtied more often or by less is held back, sparing RmlUi relayouts and text geometry.
+namespace Telemetry
+{
+
+constexpr uint32_t MAX_FIELDS = 32;
+constexpr uint32_t INVALID_FIELD = 0xFFFFFFFF;
+
+// Adds a float variable to the model, call before CreateModel, e.g. during static initialization of the producer.
+// threshold is the smallest change worth showing (0 shows any change), min_interval_ms the shortest time between two
+// updates of the variable. name must outlive the model. Returns INVALID_FIELD once MAX_FIELDS are registered.
+uint32_t Register(const char* name, float threshold = 0.0f, uint32_t min_interval_ms = 0);
+
+// Lock-free, from any thread. Invalid fields are ignored.
+void Set(uint32_t field, float value);
+
+// Creates the "telemetry" data model with every registered field, before loading documents that use it.
+bool CreateModel(Rml::Context* context);
+// Forgets the model, it is owned by the context, which is destroyed by Rml::Shutdown
+void ReleaseModel();
+
+struct TickStats
+{
+    // Pending fields looked at
+    uint32_t changed = 0;
+    // Variables dirtied
+    uint32_t dirtied = 0;
+    // Changes smaller than the threshold, dropped
+    uint32_t below_threshold = 0;
+    // Changes held back by the minimum interval, they stay pending
+    uint32_t rate_limited = 0;
+};
+
+// Diffs and dirties, call once per UI tick from the thread that updates the context, with a monotonic time.
+// Returns true if any variable was dirtied.
+bool Sync(uint64_t now_us);
+
+TickStats GetLastTick();
+// Totals since the start
+TickStats GetTotals();
+uint32_t GetTickCount();
+
+} // namespace Telemetry
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+namespace UiThread
+{
+
+using FrameFunction = void (*)(void* user);
+
+// Core the thread is pinned to on Wii U, games mostly run on core 1
+constexpr uint32_t CORE = 2;
+constexpr uint32_t STACK_SIZE = 128 * 1024;
+
+// Starts a thread that runs frame_function once per Kick
+bool Start(FrameFunction frame_function, void* user);
+// Lets the current frame finish and joins the thread
+void Stop();
+bool IsRunning();
+
+// Requests one frame, kicks arriving while a frame runs are coalesced into the next one
+void Kick();
+
+} // namespace UiThread
@@ -6,19 +6,376 @@
 #include "RmlUi_Backend.h"
 #include "RmlUi_Platform_WiiU.h"
 #include "RmlUi_Renderer_GX2.h"
+#include "RmlUi_Capture.h"
+#include "RmlUi_Renderer_Deferred.h"
+#include "mapped_memory.hpp"
+#include "profiler.hpp"
+#include "benchmark.hpp"
+#include "ui_thread.hpp"
+#include "telemetry.hpp"
+#include "frame_scheduler.hpp"
+#include "gamepad_input.hpp"
+#include "gx2_extra.hpp"
 #include <RmlUi/Core/Context.h>
+#include <RmlUi/Core/Core.h>
+#include <RmlUi/Core/DataModelHandle.h>
+#include <RmlUi/Core/ElementDocument.h>
 
 // Wii U input headers
 #include <vpad/input.h>
 #include <padscore/wpad.h>
+#include <whb/log.h>
+#include <atomic>
+#include <mutex>
 
 static SystemInterface_WiiU* system_interface = nullptr;
 static RenderInterface_GX2* render_interface = nullptr;
+// RmlUi talks to the capture wrapper, which passes everything through to the GX2 renderer unless recording
+static RenderInterface_Capture* capture_interface = nullptr;
+// UI thread mode only: RmlUi records into the deferred interface, PresentFrame replays it into the capture wrapper
+static RenderInterface_Deferred* deferred_interface = nullptr;
 static bool initialized = false;
 static bool request_exit = false;
 
-// Input state
-static bool was_touched = false;
+// One context per scan target, all rendered through the same interfaces
+static const int SCREEN_COUNT = 2;
+static Rml::Context* screen_contexts[SCREEN_COUNT] = {};
+static Backend::Screen frame_screen = Backend::Screen::TV;
+
+// Input state, samples are handed over by the VPADRead hook and consumed in ProcessEvents
+static GamepadInput gamepad_input;
+
+// Power save, evaluated by ProcessEvents on the thread owning the context. The flags are read by the hooks and the render side.
+static const uint32_t IDLE_FRAMES = 60;
+static uint32_t quiet_frames = 0;
+static std::atomic<bool> idle{ false };
+static std::atomic<bool> wake_requested{ false };
+static std::atomic<bool> trim_requested{ false };
+static std::atomic<uint32_t> frames_skipped{ 0 };
+
+// Frame budget of the overlay's hooks, the VPADRead one updating the contexts unless the UI thread runs and the GX2
+// ones rendering them, which can be different threads. Data model syncs and texture uploads wait for what's left of it,
+// each on the thread it has to run on.
+static FrameScheduler frame_scheduler;
+enum DeferredQueue : uint32_t {
+	// The thread owning the contexts, drained in ProcessEvents
+	CONTEXT_QUEUE,
+	// The thread submitting GX2 commands, drained in PresentFrame
+	RENDER_QUEUE,
+};
+// Texture pixels copied per slice
+static const uint32_t UPLOAD_SLICE_BYTES = 64 * 1024;
+// Set by the deferred model sync, consumed by the next ProcessEvents
+static bool models_synced = false;
+
+static const char* const PROFILER_TRACE_PATH = "fs:/vol/external01/wiiu/plugins/RmlUI/trace.json";
+static const char* const CAPTURE_PATH = "fs:/vol/external01/wiiu/plugins/RmlUI/capture.rmlc";
+static const uint32_t CAPTURE_MAX_FRAMES = 600;
+
+// Stats panel, the data model reads from a published copy so only changed counters are dirtied
+struct StatsBinding {
+	const char* name;
+	uint32_t RenderInterface_GX2::Stats::*field;
+};
+
+static const StatsBinding stats_bindings[] = {
+	{ "draw_calls", &RenderInterface_GX2::Stats::draw_calls },
+	{ "draws_culled", &RenderInterface_GX2::Stats::draws_culled },
+	{ "triangles", &RenderInterface_GX2::Stats::triangles },
+	{ "uniform_uploads", &RenderInterface_GX2::Stats::uniform_uploads },
+	{ "uniform_bytes", &RenderInterface_GX2::Stats::uniform_bytes },
+	{ "texture_binds", &RenderInterface_GX2::Stats::texture_binds },
+	{ "scissor_changes", &RenderInterface_GX2::Stats::scissor_changes },
+	{ "shader_switches", &RenderInterface_GX2::Stats::shader_switches },
+	{ "geometry_compiled", &RenderInterface_GX2::Stats::geometry_compiled },
+	{ "geometry_released", &RenderInterface_GX2::Stats::geometry_released },
+	{ "geometry_dedup_hits", &RenderInterface_GX2::Stats::geometry_dedup_hits },
+	{ "geometry_dedup_saved_bytes", &RenderInterface_GX2::Stats::geometry_dedup_saved_bytes },
+	{ "geometry_dedup_entries", &RenderInterface_GX2::Stats::geometry_dedup_entries },
+	{ "geometry_dedup_table_full", &RenderInterface_GX2::Stats::geometry_dedup_table_full },
+	{ "textures_generated", &RenderInterface_GX2::Stats::textures_generated },
+	{ "geometry_bytes", &RenderInterface_GX2::Stats::geometry_bytes },
+	{ "texture_bytes", &RenderInterface_GX2::Stats::texture_bytes },
+	{ "pending_upload_bytes", &RenderInterface_GX2::Stats::pending_upload_bytes },
+	{ "uniform_buffer_bytes", &RenderInterface_GX2::Stats::uniform_buffer_bytes },
+	{ "pending_release_bytes", &RenderInterface_GX2::Stats::pending_release_bytes },
+	{ "layers_pushed", &RenderInterface_GX2::Stats::layers_pushed },
+	{ "filter_passes", &RenderInterface_GX2::Stats::filter_passes },
+	{ "render_target_bytes", &RenderInterface_GX2::Stats::render_target_bytes },
+	{ "render_targets_created", &RenderInterface_GX2::Stats::render_targets_created },
+	{ "mapped_bytes", &RenderInterface_GX2::Stats::mapped_bytes },
+	{ "mapped_high_water_bytes", &RenderInterface_GX2::Stats::mapped_high_water_bytes },
+};
+
+static RenderInterface_GX2::Stats published_stats;
+static Rml::DataModelHandle stats_model;
+static Rml::ElementDocument* stats_document = nullptr;
+
+// Copied on the render side in BeginFrame, published on the thread owning the context
+static RenderInterface_GX2::Stats stats_snapshot;
+static std::mutex stats_mutex;
+static uint32_t published_frames_skipped = 0;
+// Of the last telemetry tick: variables looked at, dirtied, and held back by their threshold or interval
+static uint32_t published_telemetry_changed = 0;
+static uint32_t published_telemetry_dirtied = 0;
+static uint32_t published_telemetry_held = 0;
+
+// Frame budget counters, shown without waking the overlay like frames_skipped
+static const char* const over_budget_names[FrameScheduler::HISTOGRAM_BUCKETS] = {
+	"over_budget_25", "over_budget_50", "over_budget_100", "over_budget_200", "over_budget_400", "over_budget_more",
+};
+static FrameScheduler::Stats published_budget = {};
+static uint32_t published_budget_us = 0;
+
+static void PublishFrameBudget() {
+	const FrameScheduler::Stats latest = frame_scheduler.GetStats();
+	if (published_budget_us != frame_scheduler.GetBudget()) {
+		published_budget_us = frame_scheduler.GetBudget();
+		stats_model.DirtyVariable("budget_us");
+	}
+	if (published_budget.frames_over_budget != latest.frames_over_budget) {
+		stats_model.DirtyVariable("frames_over_budget");
+		for (uint32_t i = 0; i < FrameScheduler::HISTOGRAM_BUCKETS; i++) {
+			if (published_budget.over_budget[i] != latest.over_budget[i]) {
+				stats_model.DirtyVariable(over_budget_names[i]);
+			}
+		}
+	}
+	if (published_budget.pending_tasks != latest.pending_tasks) {
+		stats_model.DirtyVariable("deferred_pending");
+	}
+	if (published_budget.forced_slices != latest.forced_slices) {
+		stats_model.DirtyVariable("deferred_forced");
+	}
+	published_budget = latest;
+}
+
+// Returns true if any renderer counter changed
+static bool PublishStats() {
+	if (!stats_model || !stats_document || !stats_document->IsVisible())
+		return false;
+
+	// Counts up while idle, shown once the overlay wakes up again so it doesn't keep it awake
+	if (published_frames_skipped != frames_skipped.load(std::memory_order_relaxed)) {
+		published_frames_skipped = frames_skipped.load(std::memory_order_relaxed);
+		stats_model.DirtyVariable("frames_skipped");
+	}
+
+	PublishFrameBudget();
+
+	// Follows the telemetry, which wakes the overlay by itself when it dirties anything
+	const Telemetry::TickStats tick = Telemetry::GetLastTick();
+	const uint32_t held = tick.below_threshold + tick.rate_limited;
+	if (published_telemetry_changed != tick.changed || published_telemetry_dirtied != tick.dirtied || published_telemetry_held != held) {
+		published_telemetry_changed = tick.changed;
+		published_telemetry_dirtied = tick.dirtied;
+		published_telemetry_held = held;
+		stats_model.DirtyVariable("telemetry_changed");
+		stats_model.DirtyVariable("telemetry_dirtied");
+		stats_model.DirtyVariable("telemetry_held");
+	}
+
+	bool changed = false;
+
+	RenderInterface_GX2::Stats latest;
+	{
+		std::lock_guard<std::mutex> lock(stats_mutex);
+		latest = stats_snapshot;
+	}
+	for (const StatsBinding& binding : stats_bindings) {
+		if (published_stats.*binding.field != latest.*binding.field) {
+			published_stats.*binding.field = latest.*binding.field;
+			stats_model.DirtyVariable(binding.name);
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+// Buttons, hotkeys and navigation keys of one sample, trigger/release are relative to the previous sample
+static void ProcessGamepadButtons(Rml::Context* context, const VPADStatus& status, KeyDownCallback key_down_callback) {
+	// Check for HOME button to exit
+	if (status.trigger & VPAD_BUTTON_HOME) {
+		request_exit = true;
+	}
+	
+	// Debug hotkeys: ZL + MINUS dumps a Chrome trace, ZL + PLUS toggles the profiler HUD, ZL + X toggles the stats panel,
+	// ZL + Y runs the benchmark suite on the next frame, ZL + R starts/stops a render capture,
+	// ZL + ZR logs every live mapped-memory allocation
+	if (status.hold & VPAD_BUTTON_ZL) {
+		if (status.trigger & VPAD_BUTTON_MINUS) {
+			Profiler::DumpChromeTrace(PROFILER_TRACE_PATH);
+		}
+		if (status.trigger & VPAD_BUTTON_PLUS) {
+			Profiler::ToggleHud();
+		}
+		if (status.trigger & VPAD_BUTTON_Y) {
+			Benchmark::Request();
+		}
+		if ((status.trigger & VPAD_BUTTON_R) && deferred_interface) {
+			// Starting a capture releases all RmlUi resources from the render side
+			WHBLogPrintf("Capture is not available in UI thread mode");
+		} else if (status.trigger & VPAD_BUTTON_R) {
+			if (capture_interface->IsCapturing()) {
+				capture_interface->Stop();
+			} else {
+				capture_interface->Start(CAPTURE_PATH, CAPTURE_MAX_FRAMES);
+			}
+		}
+		if (status.trigger & VPAD_BUTTON_ZR) {
+			MappedMemory::DumpLive();
+		}
+		if ((status.trigger & VPAD_BUTTON_X) && stats_document) {
+			if (stats_document->IsVisible()) {
+				stats_document->Hide();
+			} else {
+				stats_document->Show(Rml::ModalFlag::None, Rml::FocusFlag::None);
+			}
+		}
+	}
+	
+	// Process buttons as keyboard input (example)
+	if (status.trigger & VPAD_BUTTON_A) {
+		context->ProcessKeyDown(Rml::Input::KI_RETURN, 0);
+		if (key_down_callback) {
+			key_down_callback(context, Rml::Input::KI_RETURN, 0, context->GetDensityIndependentPixelRatio(), false);
+		}
+	}
+	if (status.release & VPAD_BUTTON_A) {
+		context->ProcessKeyUp(Rml::Input::KI_RETURN, 0);
+	}
+	
+	// D-Pad navigation
+	if (status.trigger & VPAD_BUTTON_UP) {
+		context->ProcessKeyDown(Rml::Input::KI_UP, 0);
+	}
+	if (status.release & VPAD_BUTTON_UP) {
+		context->ProcessKeyUp(Rml::Input::KI_UP, 0);
+	}
+	
+	if (status.trigger & VPAD_BUTTON_DOWN) {
+		context->ProcessKeyDown(Rml::Input::KI_DOWN, 0);
+	}
+	if (status.release & VPAD_BUTTON_DOWN) {
+		context->ProcessKeyUp(Rml::Input::KI_DOWN, 0);
+	}
+	
+	if (status.trigger & VPAD_BUTTON_LEFT) {
+		context->ProcessKeyDown(Rml::Input::KI_LEFT, 0);
+	}
+	if (status.release & VPAD_BUTTON_LEFT) {
+		context->ProcessKeyUp(Rml::Input::KI_LEFT, 0);
+	}
+	
+	if (status.trigger & VPAD_BUTTON_RIGHT) {
+		context->ProcessKeyDown(Rml::Input::KI_RIGHT, 0);
+	}
+	if (status.release & VPAD_BUTTON_RIGHT) {
+		context->ProcessKeyUp(Rml::Input::KI_RIGHT, 0);
+	}
+	
+	// B button as ESC/Back
+	if (status.trigger & VPAD_BUTTON_B) {
+		context->ProcessKeyDown(Rml::Input::KI_ESCAPE, 0);
+	}
+	if (status.release & VPAD_BUTTON_B) {
+		context->ProcessKeyUp(Rml::Input::KI_ESCAPE, 0);
+	}
+}
+
+// Animations and transitions ask for the next update right away, hidden documents don't matter
+static bool IsAnimating(Rml::Context* context) {
+	bool visible = false;
+	for (int i = 0; i < context->GetNumDocuments() && !visible; i++) {
+		visible = context->GetDocument(i)->IsVisible();
+	}
+	return visible && context->GetNextUpdateDelay() <= 0.0;
+}
+
+static void UpdatePowerState(Rml::Context* context, bool active) {
+	if (wake_requested.exchange(false) || active || capture_interface->IsCapturing()) {
+		quiet_frames = 0;
+		idle = false;
+		return;
+	}
+
+	bool animating = IsAnimating(context);
+	for (Rml::Context* screen_context : screen_contexts) {
+		if (screen_context && screen_context != context && !animating) {
+			animating = IsAnimating(screen_context);
+		}
+	}
+	if (animating) {
+		quiet_frames = 0;
+		idle = false;
+		return;
+	}
+
+	if (quiet_frames < IDLE_FRAMES && ++quiet_frames == IDLE_FRAMES) {
+		idle = true;
+		trim_requested = true;
+	}
+}
+
+// Range of calibrated touch points, independent of the GamePad's 854x480 panel
+static const float TOUCH_WIDTH = 1280.0f;
+static const float TOUCH_HEIGHT = 720.0f;
+
+// Receiver of the GamePad samples of one ProcessEvents call
+struct GamepadTarget {
+	Rml::Context* context;
+	KeyDownCallback key_down_callback;
+};
+
+// Touch moves are coalesced by GamepadInput, only the latest position is calibrated and sent to RmlUi
+static void OnTouchMove(void* user, const VPADTouchData& raw_touch) {
+	Rml::Context* context = static_cast<GamepadTarget*>(user)->context;
+	VPADTouchData touch;
+	VPADGetTPCalibratedPoint(VPAD_CHAN_0, &touch, &raw_touch);
+
+	// Scale to the context size, whatever layout it uses
+	float scale_x = (float)context->GetDimensions().x / TOUCH_WIDTH;
+	float scale_y = (float)context->GetDimensions().y / TOUCH_HEIGHT;
+	context->ProcessMouseMove((int)(touch.x * scale_x), (int)(touch.y * scale_y), 0);
+}
+
+static void OnTouch(void* user, bool down) {
+	Rml::Context* context = static_cast<GamepadTarget*>(user)->context;
+	if (down) {
+		context->ProcessMouseButtonDown(0, 0);
+	} else {
+		context->ProcessMouseButtonUp(0, 0);
+	}
+}
+
+static void OnButtons(void* user, const VPADStatus& status) {
+	GamepadTarget* target = static_cast<GamepadTarget*>(user);
+	ProcessGamepadButtons(target->context, status, target->key_down_callback);
+}
+
+// Data model refreshes have to happen on the thread that updates the context
+static bool SyncModels(void* user) {
+	(void)user;
+	// Only the stats panel shows telemetry, while it's hidden a dirtied field mustn't keep the overlay out of power save
+	bool telemetry_dirtied = Telemetry::Sync(Profiler::TicksToMicroseconds(Profiler::GetTicks()));
+	models_synced |= telemetry_dirtied && stats_document && stats_document->IsVisible();
+	models_synced |= PublishStats();
+	models_synced |= Profiler::UpdateHud();
+	return true;
+}
+
+static bool UploadTextures(void* user) {
+	(void)user;
+	return render_interface->UploadPendingTextures(UPLOAD_SLICE_BYTES);
+}
+
+static void LogFrameBudget() {
+	const FrameScheduler::Stats budget = frame_scheduler.GetStats();
+	WHBLogPrintf("Frame budget %u us: %u of %u frames over (%u/%u/%u/%u/%u/%u by 25/50/100/200/400/more %%), "
+		"%u deferred slices (%u forced)", frame_scheduler.GetBudget(), budget.frames_over_budget, budget.frames,
+		budget.over_budget[0], budget.over_budget[1], budget.over_budget[2], budget.over_budget[3], budget.over_budget[4],
+		budget.over_budget[5], budget.slices, budget.forced_slices);
+}
 
 namespace Backend {
 
@@ -29,9 +386,15 @@ bool Initialize(const char* window_name, int width, int height, bool allow_resiz
 	// Create system and render interfaces
 	system_interface = new SystemInterface_WiiU();
 	render_interface = new RenderInterface_GX2();
+	capture_interface = new RenderInterface_Capture(render_interface);
+#ifdef RMLUI_UI_THREAD
+	deferred_interface = new RenderInterface_Deferred();
+#endif
 	
 	// Set viewport to Wii U screen size
 	render_interface->SetViewport(width, height);
+	// Image uploads are sliced into the frame budget, the deferred interface already marshals them to the present side
+	render_interface->SetDeferredUploads(deferred_interface == nullptr);
 	
 	initialized = true;
 	request_exit = false;
@@ -43,117 +406,125 @@ void Shutdown() {
 	if (!initialized)
 		return;
 
+	// The stats document and data model are owned by the context
+	stats_document = nullptr;
+	stats_model = Rml::DataModelHandle();
+
+	StopUiThread();
+	LogFrameBudget();
+	frame_scheduler.Clear();
+	models_synced = false;
+	if (deferred_interface) {
+		deferred_interface->ReleaseResources(capture_interface);
+		delete deferred_interface;
+		deferred_interface = nullptr;
+	}
+
+	delete capture_interface;
 	delete render_interface;
 	delete system_interface;
 	
+	capture_interface = nullptr;
 	render_interface = nullptr;
 	system_interface = nullptr;
+
+	for (Rml::Context*& context : screen_contexts) {
+		context = nullptr;
+	}
 	
 	initialized = false;
 }
 
+void Suspend() {
+	if (!initialized)
+		return;
+
+	StopUiThread();
+	LogFrameBudget();
+	frame_scheduler.Clear();
+	frame_scheduler.ResetStats();
+
+	// RmlUi keeps the meshes and texture sources, it compiles and loads them again when they are next rendered
+	Rml::ReleaseCompiledGeometry();
+	Rml::ReleaseTextures();
+	if (deferred_interface) {
+		deferred_interface->ReleaseResources(capture_interface);
+	}
+	render_interface->ReleaseDeviceObjects();
+	// The next frame of each screen draws everything again
+	Wake();
+}
+
 Rml::SystemInterface* GetSystemInterface() {
 	return system_interface;
 }
 
 Rml::RenderInterface* GetRenderInterface() {
-	return render_interface;
+	if (deferred_interface)
+		return deferred_interface;
+	return capture_interface;
+}
+
+void SetScreenContext(Screen screen, Rml::Context* context) {
+	screen_contexts[(int)screen] = context;
+	Wake();
+}
+
+Rml::Context* GetScreenContext(Screen screen) {
+	return screen_contexts[(int)screen];
+}
+
+Rml::Context* GetInputContext() {
+	// Touch comes from the GamePad, so its screen takes the input whenever it shows something
+	if (Rml::Context* context = screen_contexts[(int)Screen::GamePad])
+		return context;
+	return screen_contexts[(int)Screen::TV];
+}
+
+void UpdateScreenContexts() {
+	PROFILE_SCOPE("Context::Update");
+	frame_scheduler.Begin();
+	for (Rml::Context* context : screen_contexts) {
+		if (context) {
+			context->Update();
+		}
+	}
+	frame_scheduler.End();
+}
+
+void SubmitGamepadSamples(const VPADStatus* samples, uint32_t count) {
+	gamepad_input.Submit(samples, count);
 }
 
 bool ProcessEvents(Rml::Context* context, KeyDownCallback key_down_callback, bool power_save) {
-	(void)power_save;
-	
+	// Take the queued samples, the VPADRead hook may add more while they are processed
+	VPADStatus samples[GamepadInput::MAX_SAMPLES];
+	uint32_t sample_count = gamepad_input.Take(samples);
+
 	if (!context)
 		return !request_exit;
-	
-	// Read VPAD (GamePad) input
-	VPADStatus vpad_status;
-	VPADReadError vpad_error;
-	VPADRead(VPAD_CHAN_0, &vpad_status, 1, &vpad_error);
-	
-	if (vpad_error == VPAD_READ_SUCCESS) {
-		// Process touch input
-		VPADTouchData touch;
-		VPADGetTPCalibratedPoint(VPAD_CHAN_0, &touch, &vpad_status.tpNormal);
-		
-		if (touch.touched) {
-			// Convert touch coordinates to screen coordinates
-			// GamePad touchscreen is 854x480, but we scale to context size
-			int ctx_width = context->GetDimensions().x;
-			int ctx_height = context->GetDimensions().y;
-			
-			float scale_x = (float)ctx_width / 1280.0f;
-			float scale_y = (float)ctx_height / 720.0f;
-			
-			int mouse_x = (int)(touch.x * scale_x);
-			int mouse_y = (int)(touch.y * scale_y);
-			
-			context->ProcessMouseMove(mouse_x, mouse_y, 0);
-		}
-		
-		// Handle touch press/release
-		if (touch.touched != was_touched) {
-			if (touch.touched) {
-				context->ProcessMouseButtonDown(0, 0);
-			} else {
-				context->ProcessMouseButtonUp(0, 0);
-			}
-			was_touched = touch.touched;
-		}
-		
-		// Check for HOME button to exit
-		if (vpad_status.trigger & VPAD_BUTTON_HOME) {
-			request_exit = true;
-		}
-		
-		// Process buttons as keyboard input (example)
-		if (vpad_status.trigger & VPAD_BUTTON_A) {
-			context->ProcessKeyDown(Rml::Input::KI_RETURN, 0);
-			if (key_down_callback) {
-				key_down_callback(context, Rml::Input::KI_RETURN, 0, 1.0f, false);
-			}
-		}
-		if (vpad_status.release & VPAD_BUTTON_A) {
-			context->ProcessKeyUp(Rml::Input::KI_RETURN, 0);
-		}
-		
-		// D-Pad navigation
-		if (vpad_status.trigger & VPAD_BUTTON_UP) {
-			context->ProcessKeyDown(Rml::Input::KI_UP, 0);
-		}
-		if (vpad_status.release & VPAD_BUTTON_UP) {
-			context->ProcessKeyUp(Rml::Input::KI_UP, 0);
-		}
-		
-		if (vpad_status.trigger & VPAD_BUTTON_DOWN) {
-			context->ProcessKeyDown(Rml::Input::KI_DOWN, 0);
-		}
-		if (vpad_status.release & VPAD_BUTTON_DOWN) {
-			context->ProcessKeyUp(Rml::Input::KI_DOWN, 0);
-		}
-		
-		if (vpad_status.trigger & VPAD_BUTTON_LEFT) {
-			context->ProcessKeyDown(Rml::Input::KI_LEFT, 0);
-		}
-		if (vpad_status.release & VPAD_BUTTON_LEFT) {
-			context->ProcessKeyUp(Rml::Input::KI_LEFT, 0);
-		}
-		
-		if (vpad_status.trigger & VPAD_BUTTON_RIGHT) {
-			context->ProcessKeyDown(Rml::Input::KI_RIGHT, 0);
-		}
-		if (vpad_status.release & VPAD_BUTTON_RIGHT) {
-			context->ProcessKeyUp(Rml::Input::KI_RIGHT, 0);
-		}
-		
-		// B button as ESC/Back
-		if (vpad_status.trigger & VPAD_BUTTON_B) {
-			context->ProcessKeyDown(Rml::Input::KI_ESCAPE, 0);
-		}
-		if (vpad_status.release & VPAD_BUTTON_B) {
-			context->ProcessKeyUp(Rml::Input::KI_ESCAPE, 0);
+
+	PROFILE_SCOPE("ProcessEvents");
+	frame_scheduler.Begin();
+
+	GamepadTarget target = { context, key_down_callback };
+	gamepad_input.Process(samples, sample_count, { &target, OnTouchMove, OnTouch, OnButtons });
+
+	// Synced here with what's left of the frame budget, a sync that has to wait counts once a later call ran it
+	frame_scheduler.Defer(SyncModels, nullptr, CONTEXT_QUEUE);
+	frame_scheduler.RunDeferred(CONTEXT_QUEUE);
+	bool models_changed = models_synced;
+	models_synced = false;
+
+	if (power_save) {
+		UpdatePowerState(context, models_changed || GamepadInput::HasInput(samples, sample_count));
+		if (idle) {
+			frames_skipped++;
 		}
+	} else {
+		idle = false;
 	}
+	frame_scheduler.End();
 	
 	// Return false if user wants to exit
 	return !request_exit;
@@ -163,15 +534,111 @@ void RequestExit() {
 	request_exit = true;
 }
 
-void BeginFrame() {
+bool IsIdle() {
+	return idle;
+}
+
+void Wake() {
+	wake_requested = true;
+	idle = false;
+}
+
+uint32_t GetFramesSkipped() {
+	return frames_skipped;
+}
+
+void SetFrameBudget(uint32_t microseconds) {
+	frame_scheduler.SetBudget(microseconds);
+}
+
+void NextFrame() {
+	// The UI thread closes its own frames
+	if (!UiThread::IsRunning()) {
+		frame_scheduler.NextFrame();
+	}
+}
+
+bool RepeatFrame() {
+	if (!idle || !render_interface)
+		return false;
+	// A frame without visible documents repeats as nothing at all
+	return render_interface->RepeatLastFrame();
+}
+
+void BeginFrame(Screen screen, const GX2ColorBuffer* color_buffer) {
+	if (render_interface) {
+		// Updating and rendering on the game thread counts against the budget
+		if (!UiThread::IsRunning()) {
+			frame_scheduler.Begin();
+		}
+		frame_screen = screen;
+		if (Rml::Context* context = screen_contexts[(int)screen]) {
+			render_interface->SetViewport(context->GetDimensions().x, context->GetDimensions().y);
+		}
+
+		Benchmark::RunPending(render_interface);
+		render_interface->BeginFrame((int)screen, color_buffer);
+		capture_interface->BeginFrame();
+		if (trim_requested.exchange(false)) {
+			render_interface->TrimTransientBuffers();
+		}
+
+		std::lock_guard<std::mutex> lock(stats_mutex);
+		stats_snapshot = render_interface->GetStats();
+	}
+}
+
+void PrepareRenderer() {
+	if (render_interface) {
+		render_interface->CreateDeviceObjects();
+		GX2FlushDeferredInvalidations();
+	}
+}
+
+void PrepareRendererAsync() {
+	if (render_interface) {
+		GX2BeginDeferredInvalidations();
+		render_interface->CreateDeviceObjects();
+		GX2EndDeferredInvalidations();
+	}
+}
+
+void ApplyPipelineState() {
 	if (render_interface) {
-		render_interface->BeginFrame();
+		render_interface->ApplyPipelineState();
 	}
 }
 
+bool ReplayFrame() {
+	if (!deferred_interface || !UiThread::IsRunning())
+		return false;
+
+	deferred_interface->Replay(capture_interface, (int)frame_screen);
+
+	// The UI thread prepares the next lists while the GPU draws these, once per frame however many screens show a context
+	for (int i = 0; i < SCREEN_COUNT; i++) {
+		if (screen_contexts[i]) {
+			if (i == (int)frame_screen) {
+				UiThread::Kick();
+			}
+			break;
+		}
+	}
+	return true;
+}
+
 void PresentFrame() {
 	if (render_interface) {
+		capture_interface->EndFrame();
 		render_interface->EndFrame();
+
+		if (!UiThread::IsRunning()) {
+			if (render_interface->HasPendingUploads()) {
+				frame_scheduler.Defer(UploadTextures, nullptr, RENDER_QUEUE);
+			}
+			frame_scheduler.RunDeferred(RENDER_QUEUE);
+			frame_scheduler.End();
+		}
 	}
 	
 	// Note: Frame presentation is typically handled by your main graphics loop
@@ -179,4 +646,85 @@ void PresentFrame() {
 	// This depends on your rendering setup (WHBGfx or manual GX2)
 }
 
+static void UiThreadFrame(void* user) {
+	(void)user;
+
+	// One UI thread frame per presented frame, all of it counts against the budget
+	frame_scheduler.Begin();
+
+	// While idle the present hook keeps replaying the last lists
+	ProcessEvents(GetInputContext(), nullptr, true);
+	if (!idle) {
+		UpdateScreenContexts();
+
+		for (int i = 0; i < SCREEN_COUNT; i++) {
+			if (!screen_contexts[i])
+				continue;
+
+			deferred_interface->BeginRecording(i);
+			{
+				PROFILE_SCOPE("Context::Render");
+				screen_contexts[i]->Render();
+			}
+			deferred_interface->EndRecording(i);
+		}
+	}
+
+	frame_scheduler.End();
+	frame_scheduler.NextFrame();
+}
+
+bool StartUiThread() {
+	if (!GetInputContext() || !deferred_interface || UiThread::IsRunning())
+		return false;
+
+	if (!UiThread::Start(UiThreadFrame, nullptr))
+		return false;
+
+	// Record the first list right away so the overlay shows up on the next present
+	UiThread::Kick();
+	return true;
+}
+
+void StopUiThread() {
+	UiThread::Stop();
+}
+
+bool IsUiThreadRunning() {
+	return UiThread::IsRunning();
+}
+
+bool LoadStatsPanel(Rml::Context* context, const char* path) {
+	if (!context || !render_interface || stats_document)
+		return false;
+
+	Rml::DataModelConstructor constructor = context->CreateDataModel("render_stats");
+	if (!constructor)
+		return false;
+
+	for (const StatsBinding& binding : stats_bindings) {
+		constructor.Bind(binding.name, &(published_stats.*binding.field));
+	}
+	constructor.Bind("frames_skipped", &published_frames_skipped);
+	constructor.Bind("telemetry_changed", &published_telemetry_changed);
+	constructor.Bind("telemetry_dirtied", &published_telemetry_dirtied);
+	constructor.Bind("telemetry_held", &published_telemetry_held);
+	constructor.Bind("budget_us", &published_budget_us);
+	constructor.Bind("frames_over_budget", &published_budget.frames_over_budget);
+	for (uint32_t i = 0; i < FrameScheduler::HISTOGRAM_BUCKETS; i++) {
+		constructor.Bind(over_budget_names[i], &published_budget.over_budget[i]);
+	}
+	constructor.Bind("deferred_pending", &published_budget.pending_tasks);
+	constructor.Bind("deferred_forced", &published_budget.forced_slices);
+	stats_model = constructor.GetModelHandle();
+
+	stats_document = context->LoadDocument(path);
+	if (!stats_document) {
+		context->RemoveDataModel("render_stats");
+		stats_model = Rml::DataModelHandle();
+		return false;
+	}
+	return true;
+}
+
 } // namespace Backend
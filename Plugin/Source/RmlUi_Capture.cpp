@@ -0,0 +1,285 @@
+/*
+ * RmlUi render call-stream capture implementation
+ */
+
+#include "RmlUi_Capture.h"
+#include "RmlUi_Image_TGA.h"
+#include <RmlUi/Core.h>
+#include <whb/log.h>
+#include <cstring>
+
+RenderInterface_Capture::RenderInterface_Capture(Rml::RenderInterface* target) : target(target) {}
+
+RenderInterface_Capture::~RenderInterface_Capture() {
+	Stop();
+}
+
+void RenderInterface_Capture::Start(const char* path, uint32_t max_frames) {
+	if (IsCapturing())
+		return;
+
+	pending_path = path;
+	frames_left = max_frames;
+}
+
+void RenderInterface_Capture::Stop() {
+	pending_path.clear();
+	if (!file)
+		return;
+
+	if (!frame_buffer.empty()) {
+		WriteOp(Capture::Op::EndFrame);
+		fwrite(frame_buffer.data(), 1, frame_buffer.size(), file);
+		frame_buffer.clear();
+	}
+
+	fclose(file);
+	file = nullptr;
+	geometry_ids.clear();
+	texture_ids.clear();
+	WHBLogPrintf("Capture: Stopped after %u frames", frame);
+}
+
+void RenderInterface_Capture::BeginFrame() {
+	if (!pending_path.empty()) {
+		// Drop all resources before the file is open, RmlUi recreates them on demand during the capture
+		Rml::ReleaseTextures();
+		Rml::ReleaseCompiledGeometry();
+
+		file = fopen(pending_path.c_str(), "wb");
+		if (!file) {
+			WHBLogPrintf("Capture: Failed to open %s", pending_path.c_str());
+			pending_path.clear();
+			return;
+		}
+		WHBLogPrintf("Capture: Recording to %s", pending_path.c_str());
+		pending_path.clear();
+
+		fwrite(Capture::MAGIC, 1, sizeof(Capture::MAGIC), file);
+		uint32_t header[2] = { Capture::VERSION, Capture::ENDIAN_MARKER };
+		fwrite(header, 1, sizeof(header), file);
+
+		frame = 0;
+		next_id = 1;
+	}
+
+	if (!Recording())
+		return;
+
+	WriteOp(Capture::Op::BeginFrame);
+	Write<uint32_t>(frame);
+}
+
+void RenderInterface_Capture::EndFrame() {
+	if (!Recording())
+		return;
+
+	WriteOp(Capture::Op::EndFrame);
+	fwrite(frame_buffer.data(), 1, frame_buffer.size(), file);
+	frame_buffer.clear();
+	frame++;
+
+	if (--frames_left == 0) {
+		Stop();
+	}
+}
+
+void RenderInterface_Capture::WriteOp(Capture::Op op) {
+	frame_buffer.push_back(static_cast<uint8_t>(op));
+}
+
+void RenderInterface_Capture::WriteBytes(const void* data, size_t size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	frame_buffer.insert(frame_buffer.end(), bytes, bytes + size);
+}
+
+uint32_t RenderInterface_Capture::GeometryId(Rml::CompiledGeometryHandle handle) const {
+	auto it = geometry_ids.find(handle);
+	return it != geometry_ids.end() ? it->second : 0;
+}
+
+uint32_t RenderInterface_Capture::TextureId(Rml::TextureHandle handle) const {
+	auto it = texture_ids.find(handle);
+	return it != texture_ids.end() ? it->second : 0;
+}
+
+void RenderInterface_Capture::RecordTexture(Rml::TextureHandle handle, Rml::Span<const Rml::byte> pixels, Rml::Vector2i dimensions) {
+	uint32_t id = next_id++;
+	texture_ids[handle] = id;
+
+	WriteOp(Capture::Op::GenerateTexture);
+	Write<uint32_t>(id);
+	Write<int32_t>(dimensions.x);
+	Write<int32_t>(dimensions.y);
+	Write<uint32_t>(pixels.size());
+	WriteBytes(pixels.data(), pixels.size());
+}
+
+Rml::CompiledGeometryHandle RenderInterface_Capture::CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices) {
+	Rml::CompiledGeometryHandle handle = target->CompileGeometry(vertices, indices);
+	if (!Recording() || !handle)
+		return handle;
+
+	uint32_t id = next_id++;
+	geometry_ids[handle] = id;
+
+	static_assert(sizeof(Rml::Vertex) == 20, "Capture format expects the packed RmlUi vertex layout");
+	WriteOp(Capture::Op::CompileGeometry);
+	Write<uint32_t>(id);
+	Write<uint32_t>(vertices.size());
+	Write<uint32_t>(indices.size());
+	WriteBytes(vertices.data(), vertices.size() * sizeof(Rml::Vertex));
+	WriteBytes(indices.data(), indices.size() * sizeof(int));
+	return handle;
+}
+
+void RenderInterface_Capture::ReleaseGeometry(Rml::CompiledGeometryHandle geometry) {
+	if (Recording()) {
+		WriteOp(Capture::Op::ReleaseGeometry);
+		Write<uint32_t>(GeometryId(geometry));
+		geometry_ids.erase(geometry);
+	}
+	target->ReleaseGeometry(geometry);
+}
+
+void RenderInterface_Capture::RenderGeometry(Rml::CompiledGeometryHandle handle, Rml::Vector2f translation, Rml::TextureHandle texture) {
+	if (Recording()) {
+		WriteOp(Capture::Op::RenderGeometry);
+		Write<uint32_t>(GeometryId(handle));
+		Write<float>(translation.x);
+		Write<float>(translation.y);
+		Write<uint32_t>(TextureId(texture));
+	}
+	target->RenderGeometry(handle, translation, texture);
+}
+
+Rml::TextureHandle RenderInterface_Capture::LoadTexture(Rml::Vector2i& texture_dimensions, const Rml::String& source) {
+	Rml::TextureHandle handle = target->LoadTexture(texture_dimensions, source);
+	if (!Recording() || !handle)
+		return handle;
+
+	// Record decoded pixels so replay doesn't depend on files from the SD card
+	Rml::FileInterface* file_interface = Rml::GetFileInterface();
+	Rml::FileHandle file_handle = file_interface->Open(source);
+	if (!file_handle)
+		return handle;
+
+	Rml::Vector<Rml::byte> file_data(file_interface->Length(file_handle));
+	file_interface->Read(file_data.data(), file_data.size(), file_handle);
+	file_interface->Close(file_handle);
+
+	Rml::Vector<Rml::byte> pixels;
+	Rml::Vector2i dimensions;
+	if (TGA::Decode(Rml::Span<const Rml::byte>(file_data.data(), file_data.size()), pixels, dimensions)) {
+		RecordTexture(handle, Rml::Span<const Rml::byte>(pixels.data(), pixels.size()), dimensions);
+	}
+	return handle;
+}
+
+Rml::TextureHandle RenderInterface_Capture::GenerateTexture(Rml::Span<const Rml::byte> source, Rml::Vector2i source_dimensions) {
+	Rml::TextureHandle handle = target->GenerateTexture(source, source_dimensions);
+	if (Recording() && handle) {
+		RecordTexture(handle, source, source_dimensions);
+	}
+	return handle;
+}
+
+void RenderInterface_Capture::ReleaseTexture(Rml::TextureHandle texture_handle) {
+	if (Recording()) {
+		WriteOp(Capture::Op::ReleaseTexture);
+		Write<uint32_t>(TextureId(texture_handle));
+		texture_ids.erase(texture_handle);
+	}
+	target->ReleaseTexture(texture_handle);
+}
+
+void RenderInterface_Capture::EnableScissorRegion(bool enable) {
+	if (Recording()) {
+		WriteOp(Capture::Op::EnableScissorRegion);
+		Write<uint8_t>(enable ? 1 : 0);
+	}
+	target->EnableScissorRegion(enable);
+}
+
+void RenderInterface_Capture::SetScissorRegion(Rml::Rectanglei region) {
+	if (Recording()) {
+		WriteOp(Capture::Op::SetScissorRegion);
+		Write<int32_t>(region.Left());
+		Write<int32_t>(region.Top());
+		Write<int32_t>(region.Width());
+		Write<int32_t>(region.Height());
+	}
+	target->SetScissorRegion(region);
+}
+
+void RenderInterface_Capture::EnableClipMask(bool enable) {
+	if (Recording()) {
+		WriteOp(Capture::Op::EnableClipMask);
+		Write<uint8_t>(enable ? 1 : 0);
+	}
+	target->EnableClipMask(enable);
+}
+
+void RenderInterface_Capture::RenderToClipMask(Rml::ClipMaskOperation operation, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation) {
+	if (Recording()) {
+		WriteOp(Capture::Op::RenderToClipMask);
+		Write<uint8_t>(static_cast<uint8_t>(operation));
+		Write<uint32_t>(GeometryId(geometry));
+		Write<float>(translation.x);
+		Write<float>(translation.y);
+	}
+	target->RenderToClipMask(operation, geometry, translation);
+}
+
+void RenderInterface_Capture::SetTransform(const Rml::Matrix4f* transform) {
+	if (Recording()) {
+		WriteOp(Capture::Op::SetTransform);
+		Write<uint8_t>(transform ? 1 : 0);
+		if (transform) {
+			WriteBytes(transform->data(), sizeof(float) * 16);
+		}
+	}
+	target->SetTransform(transform);
+}
+
+Rml::LayerHandle RenderInterface_Capture::PushLayer() {
+	return target->PushLayer();
+}
+
+void RenderInterface_Capture::CompositeLayers(Rml::LayerHandle source, Rml::LayerHandle destination, Rml::BlendMode blend_mode,
+	Rml::Span<const Rml::CompiledFilterHandle> filters) {
+	target->CompositeLayers(source, destination, blend_mode, filters);
+}
+
+void RenderInterface_Capture::PopLayer() {
+	target->PopLayer();
+}
+
+Rml::TextureHandle RenderInterface_Capture::SaveLayerAsTexture() {
+	return target->SaveLayerAsTexture();
+}
+
+Rml::CompiledFilterHandle RenderInterface_Capture::SaveLayerAsMaskImage() {
+	return target->SaveLayerAsMaskImage();
+}
+
+Rml::CompiledFilterHandle RenderInterface_Capture::CompileFilter(const Rml::String& name, const Rml::Dictionary& parameters) {
+	return target->CompileFilter(name, parameters);
+}
+
+void RenderInterface_Capture::ReleaseFilter(Rml::CompiledFilterHandle filter) {
+	target->ReleaseFilter(filter);
+}
+
+Rml::CompiledShaderHandle RenderInterface_Capture::CompileShader(const Rml::String& name, const Rml::Dictionary& parameters) {
+	return target->CompileShader(name, parameters);
+}
+
+void RenderInterface_Capture::RenderShader(Rml::CompiledShaderHandle shader, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation,
+	Rml::TextureHandle texture) {
+	target->RenderShader(shader, geometry, translation, texture);
+}
+
+void RenderInterface_Capture::ReleaseShader(Rml::CompiledShaderHandle shader) {
+	target->ReleaseShader(shader);
+}
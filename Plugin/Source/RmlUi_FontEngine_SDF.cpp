@@ -0,0 +1,623 @@
+/*
+ * RmlUi signed distance field font engine
+ */
+
+#include "RmlUi_FontEngine_SDF.h"
+#include "RmlUi_GlyphCache.h"
+#include "distance_field_mark.hpp"
+#include <RmlUi/Core.h>
+#include <whb/log.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_MODULE_H
+
+namespace {
+// Empty texels between glyphs, keeps bilinear filtering from reading the neighbour's distances
+constexpr int ATLAS_PADDING = 1;
+// The texture grows in steps of this many rows as shelves are added
+constexpr int ATLAS_ROW_STEP = 64;
+// Rasterized (or restored from the cache) when a face is loaded, printable ASCII
+constexpr uint32_t PRELOAD_FIRST = 32;
+constexpr uint32_t PRELOAD_LAST = 126;
+
+Rml::String ToLower(const Rml::String& string) {
+	Rml::String result = string;
+	std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	return result;
+}
+} // namespace
+
+FontEngineInterface_SDF::FontEngineInterface_SDF() {}
+
+FontEngineInterface_SDF::~FontEngineInterface_SDF() {
+	Shutdown();
+}
+
+void FontEngineInterface_SDF::Initialize() {
+	if (library)
+		return;
+
+	if (FT_Init_FreeType(&library) != 0) {
+		WHBLogPrintf("FontEngineInterface_SDF: Failed to initialize FreeType");
+		library = nullptr;
+		return;
+	}
+
+	// Distances are encoded from -SPREAD to +SPREAD pixels around the outline, 128 being the outline itself
+	FT_Int spread = SPREAD;
+	FT_Property_Set(library, "sdf", "spread", &spread);
+}
+
+void FontEngineInterface_SDF::Shutdown() {
+	atlas_texture = Rml::CallbackTextureSource();
+	instances.clear();
+	for (auto& face : faces) {
+		FT_Done_Face(face->ft_face);
+	}
+	faces.clear();
+	if (library) {
+		FT_Done_FreeType(library);
+		library = nullptr;
+	}
+
+	atlas_pixels.clear();
+	atlas_pixels.shrink_to_fit();
+	shelf_x = shelf_y = shelf_height = 0;
+	atlas_texture_height = 0;
+	atlas_dirty = false;
+	glyph_count = 0;
+	cache_hits = 0;
+	load_time_ms = 0.0;
+}
+
+bool FontEngineInterface_SDF::LoadFontFace(const Rml::String& file_name, int face_index, bool fallback_face, Rml::Style::FontWeight weight) {
+	const double start = Rml::GetSystemInterface()->GetElapsedTime();
+	Rml::Vector<Rml::byte> data;
+	// Family and style come from the face itself
+	bool loaded = ReadFontFile(file_name, data) &&
+		LoadFace(std::move(data), face_index, Rml::String(), Rml::Style::FontStyle::Normal, weight, fallback_face);
+	load_time_ms += (Rml::GetSystemInterface()->GetElapsedTime() - start) * 1000.0;
+	return loaded;
+}
+
+bool FontEngineInterface_SDF::LoadFontFace(Rml::Span<const Rml::byte> data, int face_index, const Rml::String& family,
+	Rml::Style::FontStyle style, Rml::Style::FontWeight weight, bool fallback_face) {
+	const double start = Rml::GetSystemInterface()->GetElapsedTime();
+	bool loaded = LoadFace(Rml::Vector<Rml::byte>(data.begin(), data.end()), face_index, family, style, weight, fallback_face);
+	load_time_ms += (Rml::GetSystemInterface()->GetElapsedTime() - start) * 1000.0;
+	return loaded;
+}
+
+void FontEngineInterface_SDF::RegisterFontFace(const Rml::String& file_name, const Rml::String& family, Rml::Style::FontStyle style,
+	Rml::Style::FontWeight weight, bool fallback_face, int face_index) {
+	auto face = Rml::MakeUnique<Face>();
+	face->path = file_name;
+	face->face_index = face_index;
+	face->family = ToLower(family);
+	face->style = style;
+	face->weight = weight == Rml::Style::FontWeight::Auto ? Rml::Style::FontWeight::Normal : weight;
+	face->fallback = fallback_face;
+	faces.push_back(std::move(face));
+}
+
+FontEngineInterface_SDF::Stats FontEngineInterface_SDF::GetStats() const {
+	Stats stats = {};
+	for (const auto& face : faces) {
+		stats.registered_faces++;
+		if (face->ft_face) {
+			stats.loaded_faces++;
+			stats.font_data_bytes += (uint32_t)face->data.size();
+		}
+	}
+	stats.atlas_bytes = (uint32_t)atlas_pixels.size();
+	stats.glyph_count = glyph_count;
+	stats.cache_hits = cache_hits;
+	stats.load_time_ms = load_time_ms;
+	return stats;
+}
+
+bool FontEngineInterface_SDF::ReadFontFile(const Rml::String& file_name, Rml::Vector<Rml::byte>& data) {
+	Rml::FileInterface* file_interface = Rml::GetFileInterface();
+	Rml::FileHandle file = file_interface->Open(file_name);
+	if (!file) {
+		WHBLogPrintf("FontEngineInterface_SDF: Failed to open %s", file_name.c_str());
+		return false;
+	}
+
+	// One read of the whole file, FreeType then parses it from memory
+	size_t length = file_interface->Length(file);
+	data.resize(length);
+	size_t read = file_interface->Read(data.data(), length, file);
+	file_interface->Close(file);
+	if (read != length) {
+		WHBLogPrintf("FontEngineInterface_SDF: Failed to read %s", file_name.c_str());
+		data.clear();
+		return false;
+	}
+	return true;
+}
+
+bool FontEngineInterface_SDF::LoadFace(Rml::Vector<Rml::byte>&& data, int face_index, const Rml::String& family,
+	Rml::Style::FontStyle style, Rml::Style::FontWeight weight, bool fallback_face) {
+	auto face = Rml::MakeUnique<Face>();
+	face->face_index = face_index;
+	face->family = ToLower(family);
+	face->style = style;
+	face->weight = weight;
+	face->fallback = fallback_face;
+	face->data = std::move(data);
+
+	if (!OpenFace(face.get()))
+		return false;
+	faces.push_back(std::move(face));
+	return true;
+}
+
+bool FontEngineInterface_SDF::EnsureLoaded(Face* face) {
+	if (face->ft_face)
+		return true;
+	if (face->load_failed)
+		return false;
+
+	const double start = Rml::GetSystemInterface()->GetElapsedTime();
+	bool loaded = ReadFontFile(face->path, face->data) && OpenFace(face);
+	load_time_ms += (Rml::GetSystemInterface()->GetElapsedTime() - start) * 1000.0;
+
+	if (!loaded) {
+		// Not retried, the family falls back to its other faces
+		face->load_failed = true;
+		face->data.clear();
+		face->data.shrink_to_fit();
+	}
+	return loaded;
+}
+
+bool FontEngineInterface_SDF::OpenFace(Face* face) {
+	if (!library)
+		return false;
+
+	if (FT_New_Memory_Face(library, face->data.data(), (FT_Long)face->data.size(), face->face_index, &face->ft_face) != 0) {
+		WHBLogPrintf("FontEngineInterface_SDF: Failed to load face %d of %s", face->face_index,
+			face->path.empty() ? face->family.c_str() : face->path.c_str());
+		face->ft_face = nullptr;
+		return false;
+	}
+	FT_Face ft_face = face->ft_face;
+	if (!FT_IS_SCALABLE(ft_face)) {
+		WHBLogPrintf("FontEngineInterface_SDF: %s is not a scalable font", ft_face->family_name);
+		FT_Done_Face(ft_face);
+		face->ft_face = nullptr;
+		return false;
+	}
+	FT_Select_Charmap(ft_face, FT_ENCODING_UNICODE);
+	FT_Set_Pixel_Sizes(ft_face, 0, BASE_SIZE);
+
+	if (face->family.empty()) {
+		face->family = ToLower(ft_face->family_name ? ft_face->family_name : "");
+		face->style = (ft_face->style_flags & FT_STYLE_FLAG_ITALIC) ? Rml::Style::FontStyle::Italic : Rml::Style::FontStyle::Normal;
+	}
+	if (face->weight == Rml::Style::FontWeight::Auto) {
+		face->weight = (ft_face->style_flags & FT_STYLE_FLAG_BOLD) ? Rml::Style::FontWeight::Bold : Rml::Style::FontWeight::Normal;
+	}
+	face->has_kerning = FT_HAS_KERNING(ft_face);
+
+	const bool cached = LoadPreloadedGlyphs(face);
+
+	WHBLogPrintf("FontEngineInterface_SDF: Loaded %s (%s, weight %d)%s, %u KiB of font data, %u glyphs in %d atlas rows",
+		face->family.c_str(), face->style == Rml::Style::FontStyle::Italic ? "italic" : "normal", (int)face->weight,
+		cached ? " from the cache" : "", (uint32_t)face->data.size() / 1024, glyph_count, shelf_y + shelf_height);
+	return true;
+}
+
+void FontEngineInterface_SDF::SetCacheDirectory(const Rml::String& directory) {
+	cache_directory = directory;
+	if (!cache_directory.empty()) {
+		mkdir(cache_directory.c_str(), 0777);
+	}
+}
+
+bool FontEngineInterface_SDF::LoadPreloadedGlyphs(Face* face) {
+	// The face's glyphs start on a shelf of their own, so that their rows can be cached and restored as one block
+	shelf_y += shelf_height;
+	shelf_x = 0;
+	shelf_height = 0;
+	const int first_row = shelf_y;
+
+	const uint32_t preload_range[2] = { PRELOAD_FIRST, PRELOAD_LAST };
+	GlyphCache::Key key = {};
+	key.font_hash = GlyphCache::Hash(face->data.data(), face->data.size());
+	key.glyph_set_hash = GlyphCache::Hash(preload_range, sizeof(preload_range));
+	key.face_index = (uint32_t)face->face_index;
+	key.size = BASE_SIZE;
+	key.spread = SPREAD;
+	key.atlas_width = ATLAS_WIDTH;
+
+	char cache_path[256] = {};
+	if (!cache_directory.empty()) {
+		snprintf(cache_path, sizeof(cache_path), "%s/%016llx-%d.sdf", cache_directory.c_str(), (unsigned long long)key.font_hash,
+			face->face_index);
+
+		Rml::Vector<Rml::byte> contents;
+		GlyphCache::View view;
+		if (GlyphCache::ReadFile(cache_path, contents) &&
+			GlyphCache::Parse(Rml::Span<const Rml::byte>(contents.data(), contents.size()), key, view) &&
+			first_row + (int)view.atlas_rows <= ATLAS_MAX_HEIGHT)
+		{
+			ReserveAtlasRows(first_row + (int)view.atlas_rows);
+			std::memcpy(&atlas_pixels[(size_t)first_row * ATLAS_WIDTH], view.atlas, (size_t)view.atlas_rows * ATLAS_WIDTH);
+			for (const GlyphCache::Glyph& cached : view.glyphs) {
+				Glyph glyph;
+				glyph.advance = cached.advance;
+				glyph.left = cached.left;
+				glyph.top = cached.top;
+				glyph.width = cached.width;
+				glyph.height = cached.height;
+				glyph.atlas_x = cached.atlas_x;
+				glyph.atlas_y = first_row + cached.atlas_y;
+				glyph.in_atlas = cached.width > 0 && cached.height > 0;
+				face->glyphs.emplace((Rml::Character)cached.character, glyph);
+				glyph_count += glyph.in_atlas ? 1 : 0;
+			}
+
+			const GlyphCache::Metrics& metrics = *view.metrics;
+			face->metrics.size = BASE_SIZE;
+			face->metrics.ascent = metrics.ascent;
+			face->metrics.descent = metrics.descent;
+			face->metrics.line_spacing = metrics.line_spacing;
+			face->metrics.x_height = metrics.x_height;
+			face->metrics.underline_position = metrics.underline_position;
+			face->metrics.underline_thickness = metrics.underline_thickness;
+
+			shelf_y = first_row + (int)view.atlas_rows;
+			atlas_dirty = true;
+			cache_hits++;
+			return true;
+		}
+	}
+
+	ComputeMetrics(face);
+
+	// Only glyphs of this face, characters it lacks are left to the fallback faces' own blocks
+	bool complete = true;
+	for (uint32_t character = PRELOAD_FIRST; character <= PRELOAD_LAST; character++) {
+		if (FT_Get_Char_Index(face->ft_face, character) == 0)
+			continue;
+		Glyph glyph;
+		if (RasterizeGlyph(face, (Rml::Character)character, glyph)) {
+			complete &= glyph.in_atlas || glyph.width == 0;
+			face->glyphs.emplace((Rml::Character)character, glyph);
+		}
+	}
+
+	// A block that didn't fit entirely would restore glyphs without their bitmaps
+	if (cache_path[0] && complete) {
+		Rml::Vector<GlyphCache::Glyph> records;
+		records.reserve(face->glyphs.size());
+		for (const auto& entry : face->glyphs) {
+			const Glyph& glyph = entry.second;
+			GlyphCache::Glyph record = {};
+			record.character = (uint32_t)entry.first;
+			record.advance = glyph.advance;
+			record.left = (int16_t)glyph.left;
+			record.top = (int16_t)glyph.top;
+			if (glyph.in_atlas) {
+				record.width = (uint16_t)glyph.width;
+				record.height = (uint16_t)glyph.height;
+				record.atlas_x = (uint16_t)glyph.atlas_x;
+				record.atlas_y = (uint16_t)(glyph.atlas_y - first_row);
+			}
+			records.push_back(record);
+		}
+
+		const GlyphCache::Metrics metrics = { face->metrics.ascent, face->metrics.descent, face->metrics.line_spacing,
+			face->metrics.x_height, face->metrics.underline_position, face->metrics.underline_thickness };
+		const uint32_t rows = (uint32_t)(shelf_y + shelf_height - first_row);
+		Rml::Vector<Rml::byte> contents = GlyphCache::Serialize(key, metrics,
+			Rml::Span<const GlyphCache::Glyph>(records.data(), records.size()), &atlas_pixels[(size_t)first_row * ATLAS_WIDTH], rows);
+		if (!GlyphCache::WriteFile(cache_path, contents)) {
+			WHBLogPrintf("FontEngineInterface_SDF: Failed to write %s", cache_path);
+		}
+	}
+	return false;
+}
+
+void FontEngineInterface_SDF::ComputeMetrics(Face* face) {
+	FT_Face ft_face = face->ft_face;
+	const FT_Size_Metrics& size_metrics = ft_face->size->metrics;
+	Rml::FontMetrics& metrics = face->metrics;
+	metrics.size = BASE_SIZE;
+	metrics.ascent = size_metrics.ascender / 64.0f;
+	metrics.descent = -size_metrics.descender / 64.0f;
+	metrics.line_spacing = size_metrics.height / 64.0f;
+	metrics.underline_position = FT_MulFix(-ft_face->underline_position, size_metrics.y_scale) / 64.0f;
+	metrics.underline_thickness = std::max(FT_MulFix(ft_face->underline_thickness, size_metrics.y_scale) / 64.0f, 1.0f);
+	if (FT_Load_Char(ft_face, 'x', FT_LOAD_NO_BITMAP) == 0) {
+		metrics.x_height = ft_face->glyph->metrics.height / 64.0f;
+	} else {
+		metrics.x_height = metrics.ascent * 0.5f;
+	}
+}
+
+Rml::FontFaceHandle FontEngineInterface_SDF::GetFontFaceHandle(const Rml::String& family, Rml::Style::FontStyle style,
+	Rml::Style::FontWeight weight, int size) {
+	if (size <= 0)
+		return 0;
+
+	const Rml::String family_lower = ToLower(family);
+	if (weight == Rml::Style::FontWeight::Auto) {
+		weight = Rml::Style::FontWeight::Normal;
+	}
+
+	// Closest weight among the faces of the family, preferring the requested style. Registered faces are loaded once
+	// they are picked, a face that fails to load is skipped from then on.
+	Face* best = nullptr;
+	do {
+		best = nullptr;
+		int best_score = 0;
+		for (auto& face : faces) {
+			if (face->family != family_lower || face->load_failed)
+				continue;
+			int score = std::abs((int)face->weight - (int)weight) + (face->style == style ? 0 : 10000);
+			if (!best || score < best_score) {
+				best = face.get();
+				best_score = score;
+			}
+		}
+		if (!best)
+			return 0;
+	} while (!EnsureLoaded(best));
+
+	for (auto& instance : instances) {
+		if (instance->face == best && instance->size == size)
+			return (Rml::FontFaceHandle)instance.get();
+	}
+
+	auto instance = Rml::MakeUnique<Instance>();
+	instance->face = best;
+	instance->size = size;
+	instance->scale = (float)size / (float)BASE_SIZE;
+
+	const Rml::FontMetrics& base = best->metrics;
+	const float scale = instance->scale;
+	instance->metrics.size = size;
+	instance->metrics.ascent = base.ascent * scale;
+	instance->metrics.descent = base.descent * scale;
+	instance->metrics.line_spacing = base.line_spacing * scale;
+	instance->metrics.x_height = base.x_height * scale;
+	instance->metrics.underline_position = base.underline_position * scale;
+	instance->metrics.underline_thickness = std::max(base.underline_thickness * scale, 1.0f);
+
+	Rml::FontFaceHandle handle = (Rml::FontFaceHandle)instance.get();
+	instances.push_back(std::move(instance));
+	return handle;
+}
+
+Rml::FontEffectsHandle FontEngineInterface_SDF::PrepareFontEffects(Rml::FontFaceHandle /*handle*/, const Rml::FontEffectList& /*font_effects*/) {
+	// Effects would need their own layers in the atlas, text is drawn without them
+	return 0;
+}
+
+const Rml::FontMetrics& FontEngineInterface_SDF::GetFontMetrics(Rml::FontFaceHandle handle) {
+	return ((Instance*)handle)->metrics;
+}
+
+int FontEngineInterface_SDF::GetStringWidth(Rml::FontFaceHandle handle, Rml::StringView string,
+	const Rml::TextShapingContext& text_shaping_context, Rml::Character prior_character) {
+	Instance* instance = (Instance*)handle;
+	float width = 0.0f;
+
+	for (auto it = Rml::StringIteratorU8(string.begin(), string.begin(), string.end()); it; ++it) {
+		Rml::Character character = *it;
+		Face* glyph_face = nullptr;
+		const Glyph* glyph = GetGlyph(instance->face, character, &glyph_face);
+		if (!glyph)
+			continue;
+
+		if (glyph_face == instance->face) {
+			width += GetKerning(glyph_face, prior_character, character) * instance->scale;
+		}
+		width += glyph->advance * instance->scale + text_shaping_context.letter_spacing;
+		prior_character = character;
+	}
+
+	return std::max((int)std::round(width), 0);
+}
+
+int FontEngineInterface_SDF::GenerateString(Rml::RenderManager& render_manager, Rml::FontFaceHandle face_handle,
+	Rml::FontEffectsHandle /*font_effects_handle*/, Rml::StringView string, Rml::Vector2f position, Rml::ColourbPremultiplied colour,
+	float /*opacity*/, const Rml::TextShapingContext& text_shaping_context, Rml::TexturedMeshList& mesh_list) {
+	Instance* instance = (Instance*)face_handle;
+	const float scale = instance->scale;
+
+	// Rasterize whatever is missing before the texture is created, so the string only needs one
+	for (auto it = Rml::StringIteratorU8(string.begin(), string.begin(), string.end()); it; ++it) {
+		Face* glyph_face = nullptr;
+		GetGlyph(instance->face, *it, &glyph_face);
+	}
+	UpdateAtlasTexture();
+
+	mesh_list.push_back(Rml::TexturedMesh{ Rml::Mesh(), atlas_texture.GetTexture(render_manager) });
+	Rml::Mesh& mesh = mesh_list.back().mesh;
+	mesh.vertices.reserve(string.size() * 4);
+	mesh.indices.reserve(string.size() * 6);
+
+	const float u_scale = 1.0f / (float)ATLAS_WIDTH;
+	const float v_scale = 1.0f / (float)std::max(atlas_texture_height, 1);
+	position.x = std::round(position.x);
+	position.y = std::round(position.y);
+
+	float pen = 0.0f;
+	Rml::Character prior_character = Rml::Character::Null;
+	for (auto it = Rml::StringIteratorU8(string.begin(), string.begin(), string.end()); it; ++it) {
+		Rml::Character character = *it;
+		Face* glyph_face = nullptr;
+		const Glyph* glyph = GetGlyph(instance->face, character, &glyph_face);
+		if (!glyph)
+			continue;
+
+		if (glyph_face == instance->face) {
+			pen += GetKerning(glyph_face, prior_character, character) * scale;
+		}
+
+		if (glyph->in_atlas) {
+			const Rml::Vector2f origin(position.x + pen + glyph->left * scale, position.y - glyph->top * scale);
+			const Rml::Vector2f size(glyph->width * scale, glyph->height * scale);
+			const Rml::Vector2f uv0(glyph->atlas_x * u_scale, glyph->atlas_y * v_scale);
+			const Rml::Vector2f uv1((glyph->atlas_x + glyph->width) * u_scale, (glyph->atlas_y + glyph->height) * v_scale);
+
+			const int first = (int)mesh.vertices.size();
+			mesh.vertices.push_back(Rml::Vertex{ origin, colour, uv0 });
+			mesh.vertices.push_back(Rml::Vertex{ Rml::Vector2f(origin.x + size.x, origin.y), colour, Rml::Vector2f(uv1.x, uv0.y) });
+			mesh.vertices.push_back(Rml::Vertex{ origin + size, colour, uv1 });
+			mesh.vertices.push_back(Rml::Vertex{ Rml::Vector2f(origin.x, origin.y + size.y), colour, Rml::Vector2f(uv0.x, uv1.y) });
+			const int quad[6] = { first, first + 3, first + 1, first + 1, first + 3, first + 2 };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+
+		pen += glyph->advance * scale + text_shaping_context.letter_spacing;
+		prior_character = character;
+	}
+
+	return std::max((int)std::round(pen), 0);
+}
+
+int FontEngineInterface_SDF::GetVersion(Rml::FontFaceHandle /*handle*/) {
+	return version;
+}
+
+void FontEngineInterface_SDF::ReleaseFontResources() {
+	// The glyphs stay in the CPU copy of the atlas, the texture is recreated from it when text is generated again
+	atlas_texture = Rml::CallbackTextureSource();
+	atlas_texture_height = 0;
+	atlas_dirty = glyph_count > 0;
+}
+
+const FontEngineInterface_SDF::Glyph* FontEngineInterface_SDF::GetGlyph(Face* face, Rml::Character character, Face** glyph_face) {
+	auto it = face->glyphs.find(character);
+	if (it != face->glyphs.end()) {
+		*glyph_face = face;
+		return &it->second;
+	}
+
+	if (FT_Get_Char_Index(face->ft_face, (FT_ULong)character) == 0 && !face->fallback) {
+		for (auto& fallback : faces) {
+			if (fallback->fallback && EnsureLoaded(fallback.get()) && FT_Get_Char_Index(fallback->ft_face, (FT_ULong)character) != 0)
+				return GetGlyph(fallback.get(), character, glyph_face);
+		}
+	}
+
+	// Missing glyphs are kept too, they draw the face's .notdef glyph
+	Glyph glyph;
+	if (!RasterizeGlyph(face, character, glyph))
+		return nullptr;
+
+	*glyph_face = face;
+	return &face->glyphs.emplace(character, glyph).first->second;
+}
+
+bool FontEngineInterface_SDF::RasterizeGlyph(Face* face, Rml::Character character, Glyph& glyph) {
+	FT_Face ft_face = face->ft_face;
+	// Unhinted, the outline is scaled to every size so it shouldn't be fitted to BASE_SIZE's pixel grid
+	if (FT_Load_Char(ft_face, (FT_ULong)character, FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING) != 0)
+		return false;
+
+	FT_GlyphSlot slot = ft_face->glyph;
+	glyph.advance = slot->advance.x / 64.0f;
+
+	// Whitespace has no outline to render
+	if (slot->format != FT_GLYPH_FORMAT_OUTLINE || slot->outline.n_contours <= 0)
+		return true;
+
+	if (FT_Render_Glyph(slot, FT_RENDER_MODE_SDF) != 0) {
+		WHBLogPrintf("FontEngineInterface_SDF: Failed to render U+%04X of %s", (unsigned)character, face->family.c_str());
+		return true;
+	}
+
+	const FT_Bitmap& bitmap = slot->bitmap;
+	glyph.left = slot->bitmap_left;
+	glyph.top = slot->bitmap_top;
+	glyph.width = (int)bitmap.width;
+	glyph.height = (int)bitmap.rows;
+	if (glyph.width == 0 || glyph.height == 0)
+		return true;
+
+	if (!AllocateAtlasRegion(glyph.width, glyph.height, glyph.atlas_x, glyph.atlas_y)) {
+		WHBLogPrintf("FontEngineInterface_SDF: Atlas full, U+%04X of %s is not drawn", (unsigned)character, face->family.c_str());
+		return true;
+	}
+
+	for (int row = 0; row < glyph.height; row++) {
+		const unsigned char* source = bitmap.buffer + row * bitmap.pitch;
+		std::memcpy(&atlas_pixels[(size_t)(glyph.atlas_y + row) * ATLAS_WIDTH + glyph.atlas_x], source, glyph.width);
+	}
+	glyph.in_atlas = true;
+	glyph_count++;
+	atlas_dirty = true;
+	return true;
+}
+
+bool FontEngineInterface_SDF::AllocateAtlasRegion(int width, int height, int& x, int& y) {
+	width += ATLAS_PADDING;
+	height += ATLAS_PADDING;
+	if (width > ATLAS_WIDTH)
+		return false;
+
+	if (shelf_x + width > ATLAS_WIDTH) {
+		shelf_y += shelf_height;
+		shelf_x = 0;
+		shelf_height = 0;
+	}
+	if (shelf_y + height > ATLAS_MAX_HEIGHT)
+		return false;
+	ReserveAtlasRows(shelf_y + height);
+
+	x = shelf_x;
+	y = shelf_y;
+	shelf_x += width;
+	shelf_height = std::max(shelf_height, height);
+	return true;
+}
+
+float FontEngineInterface_SDF::GetKerning(Face* face, Rml::Character left, Rml::Character right) const {
+	if (!face->has_kerning || left == Rml::Character::Null)
+		return 0.0f;
+
+	FT_Vector kerning;
+	if (FT_Get_Kerning(face->ft_face, FT_Get_Char_Index(face->ft_face, (FT_ULong)left), FT_Get_Char_Index(face->ft_face, (FT_ULong)right),
+			FT_KERNING_UNFITTED, &kerning) != 0)
+		return 0.0f;
+	return kerning.x / 64.0f;
+}
+
+void FontEngineInterface_SDF::ReserveAtlasRows(int rows) {
+	// Grown in steps like the texture, so the CPU copy is never larger than what is uploaded
+	rows = std::min((rows + ATLAS_ROW_STEP - 1) / ATLAS_ROW_STEP * ATLAS_ROW_STEP, ATLAS_MAX_HEIGHT);
+	if ((size_t)rows * ATLAS_WIDTH > atlas_pixels.size()) {
+		atlas_pixels.resize((size_t)rows * ATLAS_WIDTH, 0);
+	}
+}
+
+void FontEngineInterface_SDF::UpdateAtlasTexture() {
+	if (!atlas_dirty)
+		return;
+	atlas_dirty = false;
+
+	ReserveAtlasRows(std::max(shelf_y + shelf_height, 1));
+	atlas_texture_height = (int)(atlas_pixels.size() / ATLAS_WIDTH);
+
+	// Strings generated against the previous texture are regenerated once RmlUi sees the new version. Replacing the
+	// source releases the old texture, the renderer keeps it alive until the GPU is done with it.
+	atlas_texture = Rml::CallbackTextureSource([this](const Rml::CallbackTextureInterface& texture_interface) -> bool {
+		// One byte per texel on its own would be an alpha mask to the renderer
+		DistanceFieldMark mark;
+		return texture_interface.GenerateTexture({ atlas_pixels.data(), (size_t)ATLAS_WIDTH * atlas_texture_height },
+			Rml::Vector2i(ATLAS_WIDTH, atlas_texture_height));
+	});
+	version++;
+}
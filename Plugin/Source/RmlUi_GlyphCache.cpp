@@ -0,0 +1,118 @@
+/*
+ * RmlUi glyph atlas cache
+ */
+
+#include "RmlUi_GlyphCache.h"
+#include <cstdio>
+#include <cstring>
+
+static_assert(sizeof(GlyphCache::Header) % 4 == 0, "Glyph records must stay aligned after the header");
+static_assert(sizeof(GlyphCache::Glyph) == 20, "Glyph records are written as they are laid out in memory");
+
+namespace GlyphCache {
+
+uint64_t Hash(const void* data, size_t size, uint64_t hash) {
+	const Rml::byte* bytes = (const Rml::byte*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+Rml::Vector<Rml::byte> Serialize(const Key& key, const Metrics& metrics, Rml::Span<const Glyph> glyphs, const Rml::byte* atlas,
+	uint32_t atlas_rows) {
+	Header header = {};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.endian_marker = ENDIAN_MARKER;
+	header.glyph_count = (uint32_t)glyphs.size();
+	header.atlas_rows = atlas_rows;
+	header.key = key;
+	header.metrics = metrics;
+
+	const size_t glyph_bytes = glyphs.size() * sizeof(Glyph);
+	const size_t atlas_bytes = (size_t)atlas_rows * key.atlas_width;
+
+	Rml::Vector<Rml::byte> contents(sizeof(Header) + glyph_bytes + atlas_bytes);
+	std::memcpy(contents.data(), &header, sizeof(Header));
+	if (glyph_bytes) {
+		std::memcpy(contents.data() + sizeof(Header), glyphs.data(), glyph_bytes);
+	}
+	if (atlas_bytes) {
+		std::memcpy(contents.data() + sizeof(Header) + glyph_bytes, atlas, atlas_bytes);
+	}
+	return contents;
+}
+
+bool Parse(Rml::Span<const Rml::byte> contents, const Key& key, View& view) {
+	if (contents.size() < sizeof(Header))
+		return false;
+
+	const Header* header = (const Header*)contents.data();
+	if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->endian_marker != ENDIAN_MARKER ||
+		header->version != VERSION)
+		return false;
+
+	if (header->key.font_hash != key.font_hash || header->key.glyph_set_hash != key.glyph_set_hash ||
+		header->key.face_index != key.face_index || header->key.size != key.size || header->key.spread != key.spread ||
+		header->key.atlas_width != key.atlas_width)
+		return false;
+
+	const size_t glyph_bytes = (size_t)header->glyph_count * sizeof(Glyph);
+	const size_t atlas_bytes = (size_t)header->atlas_rows * key.atlas_width;
+	if (contents.size() != sizeof(Header) + glyph_bytes + atlas_bytes)
+		return false;
+
+	const Glyph* glyphs = (const Glyph*)(contents.data() + sizeof(Header));
+	for (uint32_t i = 0; i < header->glyph_count; i++) {
+		const Glyph& glyph = glyphs[i];
+		if (glyph.atlas_x + glyph.width > key.atlas_width || glyph.atlas_y + glyph.height > header->atlas_rows)
+			return false;
+	}
+
+	view.metrics = &header->metrics;
+	view.glyphs = Rml::Span<const Glyph>(glyphs, header->glyph_count);
+	view.atlas = contents.data() + sizeof(Header) + glyph_bytes;
+	view.atlas_rows = header->atlas_rows;
+	return true;
+}
+
+bool ReadFile(const char* path, Rml::Vector<Rml::byte>& contents) {
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (length < 0) {
+		fclose(file);
+		return false;
+	}
+
+	contents.resize((size_t)length);
+	size_t read = fread(contents.data(), 1, contents.size(), file);
+	fclose(file);
+	return read == contents.size();
+}
+
+bool WriteFile(const char* path, const Rml::Vector<Rml::byte>& contents) {
+	Rml::String temporary_path = Rml::String(path) + ".tmp";
+	FILE* file = fopen(temporary_path.c_str(), "wb");
+	if (!file)
+		return false;
+
+	size_t written = fwrite(contents.data(), 1, contents.size(), file);
+	bool ok = fclose(file) == 0 && written == contents.size();
+	if (ok) {
+		std::remove(path);
+		ok = std::rename(temporary_path.c_str(), path) == 0;
+	}
+	if (!ok) {
+		std::remove(temporary_path.c_str());
+	}
+	return ok;
+}
+
+} // namespace GlyphCache
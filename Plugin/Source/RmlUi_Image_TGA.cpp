@@ -0,0 +1,176 @@
+/*
+ * Minimal TGA decoder implementation
+ */
+
+#include "RmlUi_Image_TGA.h"
+#include <RmlUi/Core.h>
+#include <mutex>
+
+namespace TGA {
+
+namespace {
+	struct DecodedImage {
+		Rml::Vector<Rml::byte> rgba;
+		Rml::Vector2i dimensions;
+	};
+
+	bool keep_decoded = false;
+	Rml::UnorderedMap<Rml::String, DecodedImage> decoded_images;
+	CacheStats cache_stats = {};
+	std::mutex cache_mutex;
+} // namespace
+
+bool Decode(
+	Rml::Span<const Rml::byte> file_data,
+	Rml::Vector<Rml::byte>& rgba,
+	Rml::Vector2i& dimensions)
+{
+	const Rml::byte* buffer = file_data.data();
+	size_t file_size = file_data.size();
+
+	if (file_size < 18) {
+		return false;
+	}
+
+	// TGA Header
+	// 0: ID length
+	// 1: Color map type
+	// 2: Image type (2 = uncompressed RGB)
+	// 12: Width (lo)
+	// 13: Width (hi)
+	// 14: Height (lo)
+	// 15: Height (hi)
+	// 16: Pixel depth (24 or 32)
+	// 17: Image descriptor
+
+	Rml::byte id_length = buffer[0];
+	Rml::byte color_map_type = buffer[1];
+	Rml::byte image_type = buffer[2];
+	
+	if (image_type != 2 && image_type != 3) { // Only support uncompressed RGB/RGBA or Grayscale
+		return false;
+	}
+
+	int width = buffer[12] | (buffer[13] << 8);
+	int height = buffer[14] | (buffer[15] << 8);
+	int pixel_depth = buffer[16];
+	int image_descriptor = buffer[17];
+
+	if (width <= 0 || height <= 0 || (pixel_depth != 24 && pixel_depth != 32 && pixel_depth != 8)) {
+		return false;
+	}
+
+	int bytes_per_pixel = pixel_depth / 8;
+	size_t image_data_offset = 18 + id_length;
+	
+	// Skip color map if present (though type 2 shouldn't have one usually, but spec says check)
+	if (color_map_type == 1) {
+		int color_map_len = buffer[5] | (buffer[6] << 8);
+		int color_map_entry_size = buffer[7];
+		image_data_offset += color_map_len * (color_map_entry_size / 8);
+	}
+
+	if (image_data_offset + width * height * bytes_per_pixel > file_size) {
+		return false;
+	}
+
+	const Rml::byte* image_data = buffer + image_data_offset;
+	
+	// Convert to RGBA8
+	int dest_bytes_per_pixel = 4;
+	rgba.resize(width * height * dest_bytes_per_pixel);
+	Rml::byte* dest_buffer = rgba.data();
+
+	bool flip_vertical = !(image_descriptor & 0x20); // Bit 5 set = top-to-bottom
+
+	for (int y = 0; y < height; y++) {
+		int src_y = flip_vertical ? (height - 1 - y) : y;
+		const Rml::byte* src_row = image_data + (src_y * width * bytes_per_pixel);
+		Rml::byte* dest_row = dest_buffer + (y * width * dest_bytes_per_pixel);
+
+		for (int x = 0; x < width; x++) {
+			const Rml::byte* src_pixel = src_row + (x * bytes_per_pixel);
+			Rml::byte* dest_pixel = dest_row + (x * dest_bytes_per_pixel);
+
+			if (bytes_per_pixel == 3) {
+				// BGR -> RGBA
+				dest_pixel[0] = src_pixel[2]; // R
+				dest_pixel[1] = src_pixel[1]; // G
+				dest_pixel[2] = src_pixel[0]; // B
+				dest_pixel[3] = 255;          // A
+			} else if (bytes_per_pixel == 4) {
+				// BGRA -> RGBA
+				dest_pixel[0] = src_pixel[2]; // R
+				dest_pixel[1] = src_pixel[1]; // G
+				dest_pixel[2] = src_pixel[0]; // B
+				dest_pixel[3] = src_pixel[3]; // A
+			} else if (bytes_per_pixel == 1) {
+				// Grayscale -> RGBA
+				dest_pixel[0] = src_pixel[0];
+				dest_pixel[1] = src_pixel[0];
+				dest_pixel[2] = src_pixel[0];
+				dest_pixel[3] = 255;
+			}
+		}
+	}
+
+	dimensions.x = width;
+	dimensions.y = height;
+	return true;
+}
+
+bool Load(const Rml::String& source, Rml::Vector<Rml::byte>& rgba, Rml::Vector2i& dimensions) {
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		auto it = decoded_images.find(source);
+		if (it != decoded_images.end()) {
+			rgba = it->second.rgba;
+			dimensions = it->second.dimensions;
+			cache_stats.hits++;
+			return true;
+		}
+	}
+
+	Rml::FileInterface* file_interface = Rml::GetFileInterface();
+	Rml::FileHandle file_handle = file_interface->Open(source);
+	if (!file_handle)
+		return false;
+
+	Rml::Vector<Rml::byte> file_data(file_interface->Length(file_handle));
+	const size_t read = file_interface->Read(file_data.data(), file_data.size(), file_handle);
+	file_interface->Close(file_handle);
+	if (read != file_data.size())
+		return false;
+
+	if (!Decode(Rml::Span<const Rml::byte>(file_data.data(), file_data.size()), rgba, dimensions))
+		return false;
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	if (keep_decoded) {
+		decoded_images[source] = DecodedImage{ rgba, dimensions };
+		cache_stats.images = (uint32_t)decoded_images.size();
+		cache_stats.bytes += (uint32_t)rgba.size();
+	}
+	return true;
+}
+
+void KeepDecoded(bool keep) {
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	keep_decoded = keep;
+	if (!keep) {
+		decoded_images.clear();
+		cache_stats = {};
+	}
+}
+
+bool IsKeepingDecoded() {
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	return keep_decoded;
+}
+
+CacheStats GetCacheStats() {
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	return cache_stats;
+}
+
+} // namespace TGA
@@ -0,0 +1,462 @@
+/*
+ * RmlUi deferred render interface implementation
+ */
+
+#include "RmlUi_Renderer_Deferred.h"
+#include "RmlUi_Image_TGA.h"
+#include "distance_field_mark.hpp"
+#include "profiler.hpp"
+#include <RmlUi/Core.h>
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+RenderInterface_Deferred::RenderInterface_Deferred() {}
+
+RenderInterface_Deferred::~RenderInterface_Deferred() {
+	// Target handles must have been released with ReleaseResources, only the CPU side is left
+	for (const PendingRelease& release : pending_releases) {
+		delete release.geometry;
+		delete release.texture;
+		delete release.filter;
+		delete release.shader;
+	}
+}
+
+static int ClampStream(int stream) {
+	return std::min(std::max(stream, 0), RenderInterface_Deferred::MAX_STREAMS - 1);
+}
+
+void RenderInterface_Deferred::BeginRecording(int stream) {
+	recording_stream = &streams[ClampStream(stream)];
+	CommandList* recording = recording_stream->recording;
+	recording->sequence = 0;
+	recording->commands.clear();
+	recording->transforms.clear();
+	recording->filters.clear();
+	recording->layer_count = 0;
+	recording_stream->recording_sequence = next_sequence++;
+}
+
+void RenderInterface_Deferred::EndRecording(int stream) {
+	Stream& recorded = streams[ClampStream(stream)];
+	recorded.recording->sequence = recorded.recording_sequence;
+
+	std::lock_guard<std::mutex> lock(handoff_mutex);
+	if (recorded.ready_fresh) {
+		counters.lists_dropped++;
+	}
+	std::swap(recorded.recording, recorded.ready);
+	recorded.ready_fresh = true;
+	counters.lists_published++;
+}
+
+uint64_t RenderInterface_Deferred::GetOldestReplayableSequence() const {
+	// Lists published later have higher sequences, so the one being replayed is the oldest of its stream
+	uint64_t oldest = UINT64_MAX;
+	for (const Stream& stream : streams) {
+		if (stream.replaying->sequence != 0) {
+			oldest = std::min(oldest, stream.replaying->sequence);
+		} else if (stream.ready_fresh) {
+			oldest = std::min(oldest, stream.ready->sequence);
+		}
+	}
+	return oldest;
+}
+
+bool RenderInterface_Deferred::Replay(Rml::RenderInterface* target, int stream) {
+	PROFILE_SCOPE("Deferred::Replay");
+
+	Stream& replayed = streams[ClampStream(stream)];
+	CommandList* replaying = nullptr;
+	uint64_t oldest_sequence = 0;
+	{
+		std::lock_guard<std::mutex> lock(handoff_mutex);
+		if (replayed.ready_fresh) {
+			std::swap(replayed.ready, replayed.replaying);
+			replayed.ready_fresh = false;
+		}
+		replaying = replayed.replaying;
+		if (replaying->sequence == 0)
+			return false;
+		counters.lists_replayed++;
+		oldest_sequence = GetOldestReplayableSequence();
+	}
+
+	// Older lists are never replayed again, so everything released before the oldest remaining one was recorded can go
+	{
+		std::lock_guard<std::mutex> lock(release_mutex);
+		auto it = std::partition(pending_releases.begin(), pending_releases.end(),
+			[oldest_sequence](const PendingRelease& release) { return release.safe_sequence > oldest_sequence; });
+		for (auto release = it; release != pending_releases.end(); ++release) {
+			Destroy(target, *release);
+		}
+		pending_releases.erase(it, pending_releases.end());
+	}
+
+	// Layer ids of the list to the target's handles of this replay
+	Rml::Vector<Rml::LayerHandle> layer_handles(replaying->layer_count + 1, 0);
+	auto layer = [&layer_handles](uint32_t id) { return id < layer_handles.size() ? layer_handles[id] : 0; };
+	Rml::Vector<Rml::CompiledFilterHandle> filter_handles;
+
+	for (const Command& command : replaying->commands) {
+		switch (command.type) {
+		case CommandType::RenderGeometry:
+			if (Rml::CompiledGeometryHandle geometry = Resolve(target, command.geometry)) {
+				target->RenderGeometry(geometry, command.translation, command.texture ? Resolve(target, command.texture) : 0);
+			}
+			break;
+		case CommandType::EnableScissorRegion:
+			target->EnableScissorRegion(command.value != 0);
+			break;
+		case CommandType::SetScissorRegion:
+			target->SetScissorRegion(command.region);
+			break;
+		case CommandType::EnableClipMask:
+			target->EnableClipMask(command.value != 0);
+			break;
+		case CommandType::RenderToClipMask:
+			if (Rml::CompiledGeometryHandle geometry = Resolve(target, command.geometry)) {
+				target->RenderToClipMask(static_cast<Rml::ClipMaskOperation>(command.value), geometry, command.translation);
+			}
+			break;
+		case CommandType::SetTransform:
+			target->SetTransform(command.value ? &replaying->transforms[command.index] : nullptr);
+			break;
+		case CommandType::PushLayer:
+			layer_handles[command.layers[0]] = target->PushLayer();
+			break;
+		case CommandType::CompositeLayers:
+			filter_handles.clear();
+			for (uint32_t i = 0; i < command.filter_count; i++) {
+				filter_handles.push_back(Resolve(target, replaying->filters[command.index + i]));
+			}
+			target->CompositeLayers(layer(command.layers[0]), layer(command.layers[1]), static_cast<Rml::BlendMode>(command.value),
+				Rml::Span<const Rml::CompiledFilterHandle>(filter_handles.data(), filter_handles.size()));
+			break;
+		case CommandType::PopLayer:
+			target->PopLayer();
+			break;
+		case CommandType::SaveLayerAsTexture:
+			// A list replayed again saves the layer again, into a texture of its own
+			if (command.texture->handle) {
+				target->ReleaseTexture(command.texture->handle);
+			}
+			command.texture->handle = target->SaveLayerAsTexture();
+			break;
+		case CommandType::SaveLayerAsMaskImage:
+			if (command.filter->handle) {
+				target->ReleaseFilter(command.filter->handle);
+			}
+			command.filter->handle = target->SaveLayerAsMaskImage();
+			break;
+		case CommandType::RenderShader:
+			if (Rml::CompiledShaderHandle shader = Resolve(target, command.shader)) {
+				Rml::CompiledGeometryHandle geometry = Resolve(target, command.geometry);
+				if (geometry) {
+					target->RenderShader(shader, geometry, command.translation, command.texture ? Resolve(target, command.texture) : 0);
+				}
+			}
+			break;
+		}
+	}
+	return true;
+}
+
+void RenderInterface_Deferred::ReleaseResources(Rml::RenderInterface* target) {
+	// The lists may reference what is destroyed below, nothing is replayed until a new one is published
+	{
+		std::lock_guard<std::mutex> lock(handoff_mutex);
+		for (Stream& stream : streams) {
+			for (CommandList& list : stream.lists) {
+				list.sequence = 0;
+				list.commands.clear();
+				list.transforms.clear();
+				list.filters.clear();
+				list.layer_count = 0;
+			}
+			stream.ready_fresh = false;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(release_mutex);
+	for (const PendingRelease& release : pending_releases) {
+		Destroy(target, release);
+	}
+	pending_releases.clear();
+}
+
+RenderInterface_Deferred::Counters RenderInterface_Deferred::GetCounters() {
+	std::lock_guard<std::mutex> lock(handoff_mutex);
+	return counters;
+}
+
+Rml::CompiledGeometryHandle RenderInterface_Deferred::Resolve(Rml::RenderInterface* target, Geometry* geometry) {
+	if (!geometry->handle && !geometry->vertices.empty()) {
+		geometry->handle = target->CompileGeometry(Rml::Span<const Rml::Vertex>(geometry->vertices.data(), geometry->vertices.size()),
+			Rml::Span<const int>(geometry->indices.data(), geometry->indices.size()));
+		Rml::Vector<Rml::Vertex>().swap(geometry->vertices);
+		Rml::Vector<int>().swap(geometry->indices);
+	}
+	return geometry->handle;
+}
+
+Rml::TextureHandle RenderInterface_Deferred::Resolve(Rml::RenderInterface* target, Texture* texture) {
+	if (!texture->handle && !texture->pixels.empty()) {
+		std::optional<DistanceFieldMark> mark;
+		if (texture->distance_field) {
+			mark.emplace();
+		}
+		texture->handle = target->GenerateTexture(Rml::Span<const Rml::byte>(texture->pixels.data(), texture->pixels.size()), texture->dimensions);
+		Rml::Vector<Rml::byte>().swap(texture->pixels);
+	}
+	return texture->handle;
+}
+
+Rml::CompiledFilterHandle RenderInterface_Deferred::Resolve(Rml::RenderInterface* target, Filter* filter) {
+	if (!filter->compiled && !filter->mask_image) {
+		filter->handle = target->CompileFilter(filter->name, filter->parameters);
+		filter->compiled = true;
+		Rml::Dictionary().swap(filter->parameters);
+	}
+	return filter->handle;
+}
+
+Rml::CompiledShaderHandle RenderInterface_Deferred::Resolve(Rml::RenderInterface* target, Shader* shader) {
+	if (!shader->compiled) {
+		shader->handle = target->CompileShader(shader->name, shader->parameters);
+		shader->compiled = true;
+		Rml::Dictionary().swap(shader->parameters);
+	}
+	return shader->handle;
+}
+
+void RenderInterface_Deferred::Destroy(Rml::RenderInterface* target, const PendingRelease& release) {
+	if (release.geometry) {
+		if (release.geometry->handle) {
+			target->ReleaseGeometry(release.geometry->handle);
+		}
+		delete release.geometry;
+	}
+	if (release.texture) {
+		if (release.texture->handle) {
+			target->ReleaseTexture(release.texture->handle);
+		}
+		delete release.texture;
+	}
+	if (release.filter) {
+		if (release.filter->handle) {
+			target->ReleaseFilter(release.filter->handle);
+		}
+		delete release.filter;
+	}
+	if (release.shader) {
+		if (release.shader->handle) {
+			target->ReleaseShader(release.shader->handle);
+		}
+		delete release.shader;
+	}
+}
+
+Rml::CompiledGeometryHandle RenderInterface_Deferred::CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices) {
+	Geometry* geometry = new Geometry();
+	geometry->vertices.assign(vertices.begin(), vertices.end());
+	geometry->indices.assign(indices.begin(), indices.end());
+	return reinterpret_cast<Rml::CompiledGeometryHandle>(geometry);
+}
+
+void RenderInterface_Deferred::ReleaseGeometry(Rml::CompiledGeometryHandle geometry) {
+	if (!geometry)
+		return;
+
+	// The list being recorded, or the last published one, may still draw it
+	std::lock_guard<std::mutex> lock(release_mutex);
+	pending_releases.push_back({ reinterpret_cast<Geometry*>(geometry), nullptr, nullptr, nullptr, next_sequence });
+}
+
+void RenderInterface_Deferred::RenderGeometry(Rml::CompiledGeometryHandle handle, Rml::Vector2f translation, Rml::TextureHandle texture) {
+	if (!handle)
+		return;
+
+	Command command = {};
+	command.type = CommandType::RenderGeometry;
+	command.geometry = reinterpret_cast<Geometry*>(handle);
+	command.texture = reinterpret_cast<Texture*>(texture);
+	command.translation = translation;
+	recording_stream->recording->commands.push_back(command);
+}
+
+Rml::TextureHandle RenderInterface_Deferred::LoadTexture(Rml::Vector2i& texture_dimensions, const Rml::String& source) {
+	// Decoded here since RmlUi needs the dimensions right away
+	Texture* texture = new Texture();
+	if (!TGA::Load(source, texture->pixels, texture_dimensions)) {
+		delete texture;
+		return 0;
+	}
+	texture->dimensions = texture_dimensions;
+	return reinterpret_cast<Rml::TextureHandle>(texture);
+}
+
+Rml::TextureHandle RenderInterface_Deferred::GenerateTexture(Rml::Span<const Rml::byte> source, Rml::Vector2i source_dimensions) {
+	if (source.empty())
+		return 0;
+
+	Texture* texture = new Texture();
+	texture->pixels.assign(source.begin(), source.end());
+	texture->dimensions = source_dimensions;
+	texture->distance_field = DistanceFieldMark::IsActive();
+	return reinterpret_cast<Rml::TextureHandle>(texture);
+}
+
+void RenderInterface_Deferred::ReleaseTexture(Rml::TextureHandle texture_handle) {
+	if (!texture_handle)
+		return;
+
+	std::lock_guard<std::mutex> lock(release_mutex);
+	pending_releases.push_back({ nullptr, reinterpret_cast<Texture*>(texture_handle), nullptr, nullptr, next_sequence });
+}
+
+void RenderInterface_Deferred::EnableScissorRegion(bool enable) {
+	Command command = {};
+	command.type = CommandType::EnableScissorRegion;
+	command.value = enable ? 1 : 0;
+	recording_stream->recording->commands.push_back(command);
+}
+
+void RenderInterface_Deferred::SetScissorRegion(Rml::Rectanglei region) {
+	Command command = {};
+	command.type = CommandType::SetScissorRegion;
+	command.region = region;
+	recording_stream->recording->commands.push_back(command);
+}
+
+void RenderInterface_Deferred::EnableClipMask(bool enable) {
+	Command command = {};
+	command.type = CommandType::EnableClipMask;
+	command.value = enable ? 1 : 0;
+	recording_stream->recording->commands.push_back(command);
+}
+
+void RenderInterface_Deferred::RenderToClipMask(Rml::ClipMaskOperation operation, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation) {
+	if (!geometry)
+		return;
+
+	Command command = {};
+	command.type = CommandType::RenderToClipMask;
+	command.value = static_cast<uint8_t>(operation);
+	command.geometry = reinterpret_cast<Geometry*>(geometry);
+	command.translation = translation;
+	recording_stream->recording->commands.push_back(command);
+}
+
+void RenderInterface_Deferred::SetTransform(const Rml::Matrix4f* transform) {
+	Command command = {};
+	command.type = CommandType::SetTransform;
+	command.value = transform ? 1 : 0;
+	if (transform) {
+		CommandList* recording = recording_stream->recording;
+		command.index = (uint32_t)recording->transforms.size();
+		recording->transforms.push_back(*transform);
+	}
+	recording_stream->recording->commands.push_back(command);
+}
+
+Rml::LayerHandle RenderInterface_Deferred::PushLayer() {
+	CommandList* recording = recording_stream->recording;
+	Command command = {};
+	command.type = CommandType::PushLayer;
+	command.layers[0] = ++recording->layer_count;
+	recording->commands.push_back(command);
+	return (Rml::LayerHandle)command.layers[0];
+}
+
+void RenderInterface_Deferred::CompositeLayers(Rml::LayerHandle source, Rml::LayerHandle destination, Rml::BlendMode blend_mode,
+	Rml::Span<const Rml::CompiledFilterHandle> filters) {
+	CommandList* recording = recording_stream->recording;
+	Command command = {};
+	command.type = CommandType::CompositeLayers;
+	command.value = static_cast<uint8_t>(blend_mode);
+	command.layers[0] = (uint32_t)source;
+	command.layers[1] = (uint32_t)destination;
+	command.index = (uint32_t)recording->filters.size();
+	for (Rml::CompiledFilterHandle filter : filters) {
+		if (filter) {
+			recording->filters.push_back(reinterpret_cast<Filter*>(filter));
+		}
+	}
+	command.filter_count = (uint32_t)recording->filters.size() - command.index;
+	recording->commands.push_back(command);
+}
+
+void RenderInterface_Deferred::PopLayer() {
+	Command command = {};
+	command.type = CommandType::PopLayer;
+	recording_stream->recording->commands.push_back(command);
+}
+
+Rml::TextureHandle RenderInterface_Deferred::SaveLayerAsTexture() {
+	// The target saves the layer when the list is replayed, until then the texture draws nothing
+	Texture* texture = new Texture();
+	texture->saved_layer = true;
+
+	Command command = {};
+	command.type = CommandType::SaveLayerAsTexture;
+	command.texture = texture;
+	recording_stream->recording->commands.push_back(command);
+	return reinterpret_cast<Rml::TextureHandle>(texture);
+}
+
+Rml::CompiledFilterHandle RenderInterface_Deferred::SaveLayerAsMaskImage() {
+	Filter* filter = new Filter();
+	filter->mask_image = true;
+
+	Command command = {};
+	command.type = CommandType::SaveLayerAsMaskImage;
+	command.filter = filter;
+	recording_stream->recording->commands.push_back(command);
+	return reinterpret_cast<Rml::CompiledFilterHandle>(filter);
+}
+
+Rml::CompiledFilterHandle RenderInterface_Deferred::CompileFilter(const Rml::String& name, const Rml::Dictionary& parameters) {
+	Filter* filter = new Filter();
+	filter->name = name;
+	filter->parameters = parameters;
+	return reinterpret_cast<Rml::CompiledFilterHandle>(filter);
+}
+
+void RenderInterface_Deferred::ReleaseFilter(Rml::CompiledFilterHandle filter) {
+	if (!filter)
+		return;
+
+	std::lock_guard<std::mutex> lock(release_mutex);
+	pending_releases.push_back({ nullptr, nullptr, reinterpret_cast<Filter*>(filter), nullptr, next_sequence });
+}
+
+Rml::CompiledShaderHandle RenderInterface_Deferred::CompileShader(const Rml::String& name, const Rml::Dictionary& parameters) {
+	Shader* shader = new Shader();
+	shader->name = name;
+	shader->parameters = parameters;
+	return reinterpret_cast<Rml::CompiledShaderHandle>(shader);
+}
+
+void RenderInterface_Deferred::RenderShader(Rml::CompiledShaderHandle shader, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation,
+	Rml::TextureHandle texture) {
+	if (!shader || !geometry)
+		return;
+
+	Command command = {};
+	command.type = CommandType::RenderShader;
+	command.shader = reinterpret_cast<Shader*>(shader);
+	command.geometry = reinterpret_cast<Geometry*>(geometry);
+	command.texture = reinterpret_cast<Texture*>(texture);
+	command.translation = translation;
+	recording_stream->recording->commands.push_back(command);
+}
+
+void RenderInterface_Deferred::ReleaseShader(Rml::CompiledShaderHandle shader) {
+	if (!shader)
+		return;
+
+	std::lock_guard<std::mutex> lock(release_mutex);
+	pending_releases.push_back({ nullptr, nullptr, nullptr, reinterpret_cast<Shader*>(shader), next_sequence });
+}
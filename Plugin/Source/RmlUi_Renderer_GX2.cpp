@@ -11,42 +11,224 @@
 #include <whb/log.h>
 #include <gx2/registers.h>
 #include <gx2/draw.h>
+#include <gx2/event.h>
 #include <gx2/utils.h>
 #include <gx2/mem.h>
 #include <gx2/clear.h>
 #include <gx2/state.h>
 #include <gx2r/buffer.h>
-#include <memory/mappedmemory.h>
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include "gfx_shader_mappedmem.h"
 #include "gx2_extra.hpp"
+#include "distance_field_mark.hpp"
+#include "mapped_memory.hpp"
+#include "profiler.hpp"
+#include "RmlUi_Image_TGA.h"
 
 // Include your shader data
 #include "rmlui_gsh.h"
+#include "rmlui_color_gsh.h"
+#include "rmlui_translate_gsh.h"
+#include "rmlui_color_translate_gsh.h"
+#include "rmlui_post_filter_gsh.h"
+#include "rmlui_post_blur_gsh.h"
+#include "rmlui_post_shadow_gsh.h"
+#include "rmlui_post_mask_gsh.h"
+#include "rmlui_gradient_gsh.h"
+#include "rmlui_text_gsh.h"
+#include "Rainbow_gsh.h"
+#include "Starry_gsh.h"
 
-RenderInterface_GX2::RenderInterface_GX2() {
+// Compiled shader of each ShaderVariant
+static const unsigned char* const shader_variant_data[ShaderVariant::COUNT] = {
+	rmlui_color_translate_gsh,
+	rmlui_translate_gsh,
+	rmlui_color_gsh,
+	rmlui_gsh,
+};
+
+// Draw routine of each ShaderVariant, the per-draw flags only pick the entry
+const RenderInterface_GX2::DrawFunction RenderInterface_GX2::draw_functions[ShaderVariant::COUNT] = {
+	&RenderInterface_GX2::DrawGeometry<0>,
+	&RenderInterface_GX2::DrawGeometry<ShaderVariant::TEXTURED>,
+	&RenderInterface_GX2::DrawGeometry<ShaderVariant::TRANSFORM>,
+	&RenderInterface_GX2::DrawGeometry<ShaderVariant::GENERIC>,
+};
+
+// Compiled shader of each PostShader
+static const unsigned char* const post_shader_data[] = {
+	rmlui_post_filter_gsh,
+	rmlui_post_blur_gsh,
+	rmlui_post_shadow_gsh,
+	rmlui_post_mask_gsh,
+};
+
+// Compiled shader of each DecoratorShader
+static const unsigned char* const decorator_shader_data[] = {
+	rmlui_gradient_gsh,
+	Rainbow_gsh,
+	Starry_gsh,
+};
+
+// Matches GradientBlock of rmlui_gradient.frag
+static const int MAX_GRADIENT_STOPS = 16;
+struct GradientBlock {
+	float parameters[4];
+	float points[4];
+	float stop_positions[MAX_GRADIENT_STOPS];
+	float stop_colors[MAX_GRADIENT_STOPS][4];
+};
+static_assert(sizeof(GradientBlock) == 352, "GradientBlock must match the std140 layout of the shader");
+
+// bound_variant while the text shader is bound, ShaderVariant::COUNT stands for any other shader
+static const uint32_t TEXT_SHADER_BOUND = ShaderVariant::COUNT + 1;
+
+// Pooled targets nobody acquired for this many frames are freed, frames of both screens count
+static const uint32_t RENDER_TARGET_IDLE_FRAMES = 120;
+// Blur sigma drawn in a single pass, larger ones are drawn on halved targets first, like the GL3 renderer does
+static const float MAX_SINGLE_PASS_SIGMA = 3.0f;
+static const int MAX_BLUR_LEVELS = 10;
+
+// FNV-1a over 32-bit words, vertices and indices are whole words. Matches are compared in full, so collisions only cost a copy.
+static uint64_t HashWords(uint64_t hash, const void* data, size_t size) {
+	const uint32_t* words = static_cast<const uint32_t*>(data);
+	for (size_t i = 0; i < size / sizeof(uint32_t); i++) {
+		hash ^= words[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+static WHBGfxShaderGroup* LoadShaderGroup(const unsigned char* data, bool textured, bool colored = true) {
+	WHBGfxShaderGroup* group = new WHBGfxShaderGroup();
+	if (!WHBGfxLoadGFDShaderGroupMappedMem(group, 0, data)) {
+		delete group;
+		return nullptr;
+	}
+
+	WHBGfxInitShaderAttribute(group, "Position", 0, 0, GX2_ATTRIB_FORMAT_FLOAT_32_32);
+	if (colored) {
+		WHBGfxInitShaderAttribute(group, "Color", 0, 8, GX2_ATTRIB_FORMAT_UNORM_8_8_8_8);
+	}
+	if (textured) {
+		WHBGfxInitShaderAttribute(group, "TexCoord", 0, 12, GX2_ATTRIB_FORMAT_FLOAT_32_32);
+	}
+	WHBGfxInitFetchShaderMappedMem(group);
+	return group;
+}
+
+RenderInterface_GX2::RenderInterface_GX2() : render_target_pool(CreateRenderTarget, DestroyRenderTarget, this) {
 	// Shader group will be initialized in BeginFrame
 }
 
 RenderInterface_GX2::~RenderInterface_GX2() {
+	ReleaseDeviceObjects();
+}
+
+void RenderInterface_GX2::ReleaseDeviceObjects() {
+	// After an earlier release there may be no GX2 to wait for anymore, e.g. between two applications
+	if (!shader_group && !default_texture && compiled_shaders.empty() && render_target_pool.GetBytes() == 0 &&
+		release_queue.GetPendingBytes() == 0)
+		return;
+
+	// Nothing may be in flight once the memory below goes away
+	GX2DrawDone();
+
+	// Layers are handed back at the end of every frame, only the mask may be left
+	if (mask_target) {
+		ReleaseRenderTarget(mask_target);
+		mask_target = nullptr;
+	}
+	render_target_pool.Trim();
+	for (WHBGfxShaderGroup*& group : post_shaders) {
+		if (group) {
+			WHBGfxFreeShaderGroupMappedMem(group);
+			delete group;
+			group = nullptr;
+		}
+	}
+	if (text_shader) {
+		WHBGfxFreeShaderGroupMappedMem(text_shader);
+		delete text_shader;
+		text_shader = nullptr;
+	}
+	if (fullscreen_quad) {
+		ReleaseGeometry(fullscreen_quad_handle);
+		fullscreen_quad = nullptr;
+		fullscreen_quad_handle = 0;
+	}
+	for (WHBGfxShaderGroup*& group : decorator_shaders) {
+		if (group) {
+			WHBGfxFreeShaderGroupMappedMem(group);
+			delete group;
+			group = nullptr;
+		}
+	}
+
+	for (WHBGfxShaderGroup*& group : shader_variants) {
+		if (group && group != shader_group) {
+			WHBGfxFreeShaderGroupMappedMem(group);
+			delete group;
+		}
+		group = nullptr;
+	}
 	if (shader_group) {
 		WHBGfxFreeShaderGroupMappedMem(shader_group);
 		delete shader_group;
 		shader_group = nullptr;
 	}
-    if (projection_buffer.buffer) {
-        GX2RDestroyBufferEx(&projection_buffer, GX2R_RESOURCE_BIND_NONE);
-    }
-    for (auto& buffer : transform_buffer) {
-        if (buffer.buffer) {
-            GX2RDestroyBufferEx(&buffer, GX2R_RESOURCE_BIND_NONE);
+    for (FrameTarget& target : targets) {
+        if (target.projection_buffer.buffer) {
+            GX2DestroyUniformBuffer(&target.projection_buffer);
+        }
+        if (target.frame_uniform_buffer.buffer) {
+            GX2DestroyUniformBuffer(&target.frame_uniform_buffer);
         }
+        for (auto& buffer : target.transform_buffer) {
+            if (buffer.buffer) {
+                GX2DestroyUniformBuffer(&buffer);
+            }
+        }
+        target.transform_buffer.clear();
     }
-    transform_buffer.clear();
     if (default_texture) {
-        ReleaseTexture(reinterpret_cast<Rml::TextureHandle>(default_texture));
+        ReleaseTexture(default_texture_handle);
         default_texture = nullptr;
+        default_texture_handle = 0;
     }
+
+	// Compiled shaders stay with RmlUi, their buffers are created again from the CPU copy on the next draw
+	for (CompiledShader* shader : compiled_shaders) {
+		if (shader->gradient_buffer.buffer) {
+			GX2DestroyUniformBuffer(&shader->gradient_buffer);
+			shader->gradient_buffer = {};
+		}
+	}
+	release_queue.Flush();
+
+	// Everything above is created again on demand
+	for (FrameTarget& target : targets) {
+		target.projection_buffer = {};
+		target.frame_uniform_buffer = {};
+		target.frame_uniforms_uploaded = false;
+		target.last_frame_calls.clear();
+		target.last_frame_valid = false;
+		target.last_transform_buffer_count = 0;
+	}
+	for (uint32_t variant = 0; variant < ShaderVariant::COUNT; variant++) {
+		resolved_variants[variant] = 0;
+	}
+	for (bool& failed : decorator_shader_failed) {
+		failed = false;
+	}
+	bound_variant = ShaderVariant::GENERIC;
+	bound_texture = nullptr;
+	pipeline_state_external = false;
+	stats.uniform_buffer_bytes = 0;
+	stats.pending_release_bytes = 0;
+	stats.render_target_bytes = render_target_pool.GetBytes();
 }
 
 void RenderInterface_GX2::SetViewport(int width, int height) {
@@ -56,27 +238,21 @@ void RenderInterface_GX2::SetViewport(int width, int height) {
 	// Viewport will be set in SetupRenderState()
 }
 
-void RenderInterface_GX2::SetupRenderState() {
+void RenderInterface_GX2::ApplyPipelineState() {
+	pipeline_state_external = true;
+	SetupPipelineState();
+}
+
+void RenderInterface_GX2::SetupPipelineState() {
 	// Based on ImGui implementation
 	// Setup render state: alpha-blending enabled, no face culling, no depth testing
 	GX2SetColorControl(GX2_LOGIC_OP_COPY, 0xFF, FALSE, TRUE);
 	
-	// Premultiplied alpha blending (GL_ONE, GL_ONE_MINUS_SRC_ALPHA)
-	GX2SetBlendControl(GX2_RENDER_TARGET_0,
-		GX2_BLEND_MODE_ONE,                    // src color
-		GX2_BLEND_MODE_INV_SRC_ALPHA,         // dst color
-		GX2_BLEND_COMBINE_MODE_ADD,
-		TRUE,
-		GX2_BLEND_MODE_ONE,                    // src alpha
-		GX2_BLEND_MODE_INV_SRC_ALPHA,         // dst alpha
-		GX2_BLEND_COMBINE_MODE_ADD);
+	SetBlendMode(Rml::BlendMode::Blend);
 	
 	GX2SetCullOnlyControl(GX2_FRONT_FACE_CCW, FALSE, FALSE);
 	GX2SetDepthOnlyControl(FALSE, FALSE, GX2_COMPARE_FUNC_NEVER);
 	
-	// Setup viewport
-	GX2SetViewport(0, 0, (float)viewport_width, (float)viewport_height, 0.0f, 1.0f);
-	
 	// Set shaders
 	if (shader_group) {
 		GX2SetFetchShader(&shader_group->fetchShader);
@@ -86,7 +262,46 @@ void RenderInterface_GX2::SetupRenderState() {
 		// CRITICAL: Set shader mode to use uniform blocks
 		GX2SetShaderMode(GX2_SHADER_MODE_UNIFORM_BLOCK);
 	}
-	
+}
+
+void RenderInterface_GX2::SetBlendMode(Rml::BlendMode blend_mode) {
+	if (blend_mode == Rml::BlendMode::Replace) {
+		GX2SetBlendControl(GX2_RENDER_TARGET_0,
+			GX2_BLEND_MODE_ONE,
+			GX2_BLEND_MODE_ZERO,
+			GX2_BLEND_COMBINE_MODE_ADD,
+			TRUE,
+			GX2_BLEND_MODE_ONE,
+			GX2_BLEND_MODE_ZERO,
+			GX2_BLEND_COMBINE_MODE_ADD);
+		return;
+	}
+
+	// Premultiplied alpha blending (GL_ONE, GL_ONE_MINUS_SRC_ALPHA)
+	GX2SetBlendControl(GX2_RENDER_TARGET_0,
+		GX2_BLEND_MODE_ONE,                    // src color
+		GX2_BLEND_MODE_INV_SRC_ALPHA,         // dst color
+		GX2_BLEND_COMBINE_MODE_ADD,
+		TRUE,
+		GX2_BLEND_MODE_ONE,                    // src alpha
+		GX2_BLEND_MODE_INV_SRC_ALPHA,         // dst alpha
+		GX2_BLEND_COMBINE_MODE_ADD);
+}
+
+void RenderInterface_GX2::SetupRenderState() {
+	if (!pipeline_state_external) {
+		SetupPipelineState();
+	} else if (shader_group) {
+		// GX2 also tracks the shader mode on the CPU side, which a display list does not update
+		GX2SetShaderMode(GX2_SHADER_MODE_UNIFORM_BLOCK);
+	}
+
+	// Per frame rather than in the pipeline state, targets can differ in size
+	GX2SetViewport(0, 0, (float)viewport_width, (float)viewport_height, 0.0f, 1.0f);
+
+	// The pipeline state binds the generic variant
+	bound_variant = ShaderVariant::GENERIC;
+
 	// Setup orthographic projection matrix
 	// RmlUi uses top-left origin (0,0) to bottom-right (width, height)
 	float L = 0.0f;
@@ -102,44 +317,261 @@ void RenderInterface_GX2::SetupRenderState() {
 	};
 	
 	// Use helper function to set uniform block (handles lock/unlock and endian swap)
-	if (projection_buffer.buffer && shader_group) {
-		GX2RSetVertexUniformBlockEx(shader_group, &projection_buffer, (void*)ortho_projection, sizeof(ortho_projection), "ProjectionBlock");
+	// Every shader variant binds ProjectionBlock to slot 0, so this stays bound across variant switches
+	if (frame_target->projection_buffer.buffer && shader_group) {
+		GX2RSetVertexUniformBlockEx(shader_group, &frame_target->projection_buffer, (void*)ortho_projection, sizeof(ortho_projection), "ProjectionBlock");
+		stats.uniform_uploads++;
+		stats.uniform_bytes += sizeof(ortho_projection);
+	}
+
+	// Texture bindings of the previous frame are not known anymore
+	bound_texture = nullptr;
+}
+
+void RenderInterface_GX2::InvalidateLastFrames() {
+	for (FrameTarget& target : targets) {
+		target.last_frame_valid = false;
+	}
+}
+
+void RenderInterface_GX2::ApplyScissor(int x, int y, int width, int height) {
+	scissor_x = x;
+	scissor_y = y;
+	scissor_width = width;
+	scissor_height = height;
+	GX2SetScissor(x, y, width, height);
+	stats.scissor_changes++;
+}
+
+bool RenderInterface_GX2::IsVisible(const GeometryData* data, Rml::Vector2f translation) {
+	const ScreenBounds::Rect viewport = { 0.0f, 0.0f, (float)viewport_width, (float)viewport_height };
+	const ScreenBounds::Rect scissor = { (float)scissor_x, (float)scissor_y, (float)(scissor_x + scissor_width), (float)(scissor_y + scissor_height) };
+	if (ScreenBounds::IsVisible(data->bounds, translation.x, translation.y, transform_enabled ? transform_matrix.data() : nullptr,
+			ScreenBounds::Intersect(viewport, scissor)))
+		return true;
+
+	stats.draws_culled++;
+	return false;
+}
+
+void RenderInterface_GX2::CreateUniformBuffer(GX2RBuffer* buffer, size_t size) {
+	GX2InitUniformBuffer(buffer, size, 1);
+	if (buffer->buffer) {
+		stats.uniform_buffer_bytes += size;
 	}
 }
 
-void RenderInterface_GX2::BeginFrame() {
+void RenderInterface_GX2::BeginFrame(int target, const GX2ColorBuffer* color_buffer) {
+	// Publish the counters of the previous frame, live memory carries over
+	last_stats = stats;
+	Stats next;
+	next.geometry_bytes = stats.geometry_bytes;
+	next.geometry_dedup_saved_bytes = stats.geometry_dedup_saved_bytes;
+	next.geometry_dedup_entries = stats.geometry_dedup_entries;
+	next.texture_bytes = stats.texture_bytes;
+	next.pending_upload_bytes = stats.pending_upload_bytes;
+	next.uniform_buffer_bytes = stats.uniform_buffer_bytes;
+	stats = next;
+
+	if (Rml::SystemInterface* system_interface = Rml::GetSystemInterface()) {
+		frame_time = (float)system_interface->GetElapsedTime();
+	}
+
+	render_target_pool.NextFrame(RENDER_TARGET_IDLE_FRAMES);
+	stats.render_target_bytes = render_target_pool.GetBytes();
+	stats.render_targets_created = render_target_pool.GetCreatedCount();
+
+	{
+		PROFILE_SCOPE("ReleaseQueue::Drain");
+		release_queue.Drain();
+	}
+	stats.pending_release_bytes = release_queue.GetPendingBytes();
+	stats.mapped_bytes = MappedMemory::GetLiveBytes();
+	stats.mapped_high_water_bytes = MappedMemory::GetHighWaterBytes();
+
+	CreateDeviceObjects();
+	// Objects created ahead of time off this thread left their GPU cache invalidations to the first frame
+	GX2FlushDeferredInvalidations();
+    
+    frame_target = &targets[std::min(std::max(target, 0), MAX_TARGETS - 1)];
+    frame_target->frame_uniforms_uploaded = false;
+    current_transform_buffer_index = 0;
+    frame_calls.clear();
+    frame_repeated = false;
+
+	// The game's buffer is the base layer, RmlUi draws into its top left viewport sized part
+	layers.clear();
+	base_layer_valid = color_buffer != nullptr;
+	if (color_buffer) {
+		const GX2Surface& surface = color_buffer->surface;
+		base_layer.color_buffer = *color_buffer;
+		base_layer.width = viewport_width;
+		base_layer.height = viewport_height;
+		base_layer.uv_scale_x = std::min((float)viewport_width / (float)surface.width, 1.0f);
+		base_layer.uv_scale_y = std::min((float)viewport_height / (float)surface.height, 1.0f);
+
+		// Multisampled buffers can't be sampled directly, backdrop filters skip them
+		base_layer.texture = {};
+		if (surface.aa == GX2_AA_MODE1X) {
+			base_layer.texture.surface = surface;
+			base_layer.texture.viewNumMips = 1;
+			base_layer.texture.viewNumSlices = 1;
+			base_layer.texture.compMap = GX2_COMP_MAP(GX2_SQ_SEL_R, GX2_SQ_SEL_G, GX2_SQ_SEL_B, GX2_SQ_SEL_A);
+			GX2InitTextureRegs(&base_layer.texture);
+			GX2InitSampler(&base_layer.sampler, GX2_TEX_CLAMP_MODE_CLAMP, GX2_TEX_XY_FILTER_MODE_LINEAR);
+		}
+	}
+	layers.push_back(&base_layer);
+	frame_used_layers = false;
+	scissor_x = 0;
+	scissor_y = 0;
+	scissor_width = viewport_width;
+	scissor_height = viewport_height;
+	
+	SetupRenderState();
+}
+
+void RenderInterface_GX2::CreateDeviceObjects() {
 	// Initialize shaders on first frame
 	if (!shader_group) {
-		shader_group = new WHBGfxShaderGroup();
-		WHBGfxLoadGFDShaderGroupMappedMem(shader_group, 0, rmlui_gsh);
-		
-		WHBGfxInitShaderAttribute(shader_group, "Position", 0, 0, GX2_ATTRIB_FORMAT_FLOAT_32_32);
-		WHBGfxInitShaderAttribute(shader_group, "Color", 0, 8, GX2_ATTRIB_FORMAT_UNORM_8_8_8_8);
-		WHBGfxInitShaderAttribute(shader_group, "TexCoord", 0, 12, GX2_ATTRIB_FORMAT_FLOAT_32_32);
-		WHBGfxInitFetchShaderMappedMem(shader_group);
+		shader_group = LoadShaderGroup(shader_variant_data[ShaderVariant::GENERIC], true);
+		if (!shader_group) {
+			WHBLogPrintf("RenderInterface_GX2: Failed to load the %s shader", ShaderVariant::Name(ShaderVariant::GENERIC));
+			return;
+		}
+
+		// Specialized variants are optional, draws fall back to the generic one without them
+		for (uint32_t variant = 0; variant < ShaderVariant::COUNT; variant++) {
+			if (variant == ShaderVariant::GENERIC) {
+				shader_variants[variant] = shader_group;
+			} else {
+				shader_variants[variant] = LoadShaderGroup(shader_variant_data[variant], (variant & ShaderVariant::TEXTURED) != 0);
+			}
+			if (shader_variants[variant]) {
+				resolved_variants[variant] = variant;
+			} else {
+				WHBLogPrintf("RenderInterface_GX2: Failed to load the %s shader", ShaderVariant::Name(variant));
+				resolved_variants[variant] = ShaderVariant::GENERIC;
+			}
+		}
 		
-        size_t size;
-        uint32_t count;
+		for (FrameTarget& target : targets) {
+			CreateUniformBuffer(&target.projection_buffer, sizeof(float) * 16);
+			CreateUniformBuffer(&target.frame_uniform_buffer, sizeof(float) * 4);
+		}
 
-		size = sizeof(float) * 16;
-        count = 1;
-		GX2InitUniformBuffer(&projection_buffer, size, count);
+		// Layers and filters are skipped without the post-process shaders
+		for (int shader = 0; shader < POST_SHADER_COUNT; shader++) {
+			post_shaders[shader] = LoadShaderGroup(post_shader_data[shader], true, false);
+			if (!post_shaders[shader]) {
+				WHBLogPrintf("RenderInterface_GX2: Failed to load post-process shader %d", shader);
+			}
+		}
+
+		// Without it distance field textures are drawn like any other, as blurry blobs
+		text_shader = LoadShaderGroup(rmlui_text_gsh, true);
+		if (!text_shader) {
+			WHBLogPrintf("RenderInterface_GX2: Failed to load the text shader");
+		}
+
+		// Already in clip space, the top row samples the first texture row
+		const Rml::Vertex quad_vertices[4] = {
+			{ Rml::Vector2f(-1.0f, 1.0f), Rml::ColourbPremultiplied(), Rml::Vector2f(0.0f, 0.0f) },
+			{ Rml::Vector2f(1.0f, 1.0f), Rml::ColourbPremultiplied(), Rml::Vector2f(1.0f, 0.0f) },
+			{ Rml::Vector2f(1.0f, -1.0f), Rml::ColourbPremultiplied(), Rml::Vector2f(1.0f, 1.0f) },
+			{ Rml::Vector2f(-1.0f, -1.0f), Rml::ColourbPremultiplied(), Rml::Vector2f(0.0f, 1.0f) },
+		};
+		const int quad_indices[6] = { 0, 1, 2, 0, 2, 3 };
+		fullscreen_quad_handle = CompileGeometry(Rml::Span<const Rml::Vertex>(quad_vertices, 4), Rml::Span<const int>(quad_indices, 6));
+		fullscreen_quad = geometries.Get((GeometryHandle)fullscreen_quad_handle);
 
 	}
     
-    current_transform_buffer_index = 0;
-    
     // Initialize default texture
     if (!default_texture) {
         Rml::byte white_pixel[4] = { 255, 255, 255, 255 };
-        default_texture = reinterpret_cast<TextureData*>(GenerateTexture(Rml::Span<const Rml::byte>(white_pixel, 4), Rml::Vector2i(1, 1)));
+        default_texture_handle = GenerateTexture(Rml::Span<const Rml::byte>(white_pixel, 4), Rml::Vector2i(1, 1));
+        default_texture = textures.Get((TextureHandle)default_texture_handle);
     }
-	
-	SetupRenderState();
 }
 
 void RenderInterface_GX2::EndFrame() {
-	// Restore previous GX2 state if needed
+	// RmlUi pops every layer it pushes, this only catches an interrupted frame
+	while (layers.size() > 1) {
+		PopLayer();
+	}
+	layers.clear();
+	if (mask_target) {
+		ReleaseRenderTarget(mask_target);
+		mask_target = nullptr;
+	}
+
+	// A repeated frame leaves the record of the original one in place, layers and filters are not recorded
+	if (!frame_repeated) {
+		frame_target->last_frame_calls.swap(frame_calls);
+		frame_target->last_frame_valid = !frame_used_layers;
+	}
+	frame_target->last_transform_buffer_count = current_transform_buffer_index;
+}
+
+bool RenderInterface_GX2::RepeatLastFrame() {
+	if (!frame_target->last_frame_valid)
+		return false;
+
+	repeating = true;
+	for (const FrameCall& call : frame_target->last_frame_calls) {
+		switch (call.type) {
+		case FrameCallType::RenderGeometry:
+			RenderGeometry(call.geometry, call.translation, call.texture);
+			break;
+		case FrameCallType::RenderShader:
+			RenderShader(call.shader, call.geometry, call.translation, call.texture);
+			break;
+		case FrameCallType::EnableScissorRegion:
+			EnableScissorRegion(call.enable);
+			break;
+		case FrameCallType::SetScissorRegion:
+			SetScissorRegion(call.region);
+			break;
+		case FrameCallType::SetTransform:
+			SetTransform(call.enable ? &call.transform : nullptr);
+			break;
+		}
+	}
+	repeating = false;
+	frame_repeated = true;
+	return true;
+}
+
+void RenderInterface_GX2::TrimTransientBuffers() {
+	// Buffers past the high-water mark of the last frame have not been used for at least a frame
+	for (FrameTarget& target : targets) {
+		while ((int)target.transform_buffer.size() > target.last_transform_buffer_count) {
+			GX2RBuffer& buffer = target.transform_buffer.back();
+			if (buffer.buffer) {
+				uint32_t size = buffer.elemSize * buffer.elemCount;
+				stats.uniform_buffer_bytes -= size;
+				// The last frame bound it, keep the GX2RBuffer alive with the memory
+				release_queue.Release(new GX2RBuffer(buffer), size, [](void* memory) {
+					GX2RBuffer* released = static_cast<GX2RBuffer*>(memory);
+					GX2DestroyUniformBuffer(released);
+					delete released;
+				});
+			}
+			target.transform_buffer.pop_back();
+		}
+	}
+	Rml::Vector<FrameCall>().swap(frame_calls);
+
+	render_target_pool.Trim();
+	stats.render_target_bytes = render_target_pool.GetBytes();
+	stats.pending_release_bytes = release_queue.GetPendingBytes();
+}
+
+void RenderInterface_GX2::FlushReleases() {
+	GX2DrawDone();
+	release_queue.Flush();
+	stats.pending_release_bytes = 0;
 }
 
 void RenderInterface_GX2::Clear() {
@@ -150,15 +582,43 @@ Rml::CompiledGeometryHandle RenderInterface_GX2::CompileGeometry(
 	Rml::Span<const Rml::Vertex> vertices, 
 	Rml::Span<const int> indices) 
 {
-	GeometryData* geometry = new GeometryData();
+	PROFILE_SCOPE("CompileGeometry");
 
+	GeometryData record;
+	GeometryData* geometry = &record;
+	uint32_t vtx_buffer_size = vertices.size() * sizeof(Rml::Vertex);
+	uint32_t idx_buffer_size = indices.size() * sizeof(int);
+
+	geometry->bounds = ScreenBounds::Compute(vertices.data(), (uint32_t)vertices.size(), sizeof(Rml::Vertex));
+
+	// Identical buttons, decorators and list rows draw from one copy
+	geometry->content_hash = HashWords(HashWords(0xCBF29CE484222325ull ^ vertices.size(), vertices.data(), vtx_buffer_size), indices.data(), idx_buffer_size);
+	auto shared = shared_geometry.find(geometry->content_hash);
+	if (shared != shared_geometry.end() && shared->second.vertex_bytes == vtx_buffer_size && shared->second.index_bytes == idx_buffer_size &&
+		std::memcmp(shared->second.vertex_buffer, vertices.data(), vtx_buffer_size) == 0 &&
+		std::memcmp(shared->second.index_buffer, indices.data(), idx_buffer_size) == 0)
+	{
+		geometry->vertex_buffer = shared->second.vertex_buffer;
+		geometry->index_buffer = shared->second.index_buffer;
+		geometry->num_vertices = vertices.size();
+		geometry->num_indices = indices.size();
+		geometry->shared = true;
+
+		GeometryHandle handle = geometries.Insert(record);
+		if (!handle) {
+			WHBLogPrintf("RenderInterface_GX2: Out of geometry slots");
+			return 0;
+		}
+		shared->second.references++;
+		stats.geometry_compiled++;
+		stats.geometry_dedup_hits++;
+		stats.geometry_dedup_saved_bytes += vtx_buffer_size + idx_buffer_size;
+		return (Rml::CompiledGeometryHandle)handle;
+	}
 
-	
 	// Allocate GX2 vertex buffer
-	uint32_t vtx_buffer_size = vertices.size() * sizeof(Rml::Vertex);
-	geometry->vertex_buffer = MEMAllocFromMappedMemoryForGX2Ex(vtx_buffer_size, GX2_VERTEX_BUFFER_ALIGNMENT);
+	geometry->vertex_buffer = MappedMemory::Alloc(MappedMemory::Tag::Geometry, vtx_buffer_size, GX2_VERTEX_BUFFER_ALIGNMENT, "vertices");
 	if (!geometry->vertex_buffer) {
-		delete geometry;
 		return 0;
 	}
 	
@@ -167,11 +627,9 @@ Rml::CompiledGeometryHandle RenderInterface_GX2::CompileGeometry(
 	geometry->num_vertices = vertices.size();
 	
 	// Allocate GX2 index buffer
-	uint32_t idx_buffer_size = indices.size() * sizeof(int);
-	geometry->index_buffer = MEMAllocFromMappedMemoryForGX2Ex(idx_buffer_size, GX2_INDEX_BUFFER_ALIGNMENT);
+	geometry->index_buffer = MappedMemory::Alloc(MappedMemory::Tag::Geometry, idx_buffer_size, GX2_INDEX_BUFFER_ALIGNMENT, "indices");
 	if (!geometry->index_buffer) {
-		MEMFreeToMappedMemory(geometry->vertex_buffer);
-		delete geometry;
+		MappedMemory::Free(geometry->vertex_buffer);
 		return 0;
 	}
 	
@@ -180,20 +638,67 @@ Rml::CompiledGeometryHandle RenderInterface_GX2::CompileGeometry(
 	geometry->num_indices = indices.size();
 	
 	// Flush CPU cache to GPU
-	GX2Invalidate(GX2_INVALIDATE_MODE_CPU_ATTRIBUTE_BUFFER, geometry->vertex_buffer, vtx_buffer_size);
-	GX2Invalidate(GX2_INVALIDATE_MODE_CPU, geometry->index_buffer, idx_buffer_size);
+	GX2InvalidateDeferrable(GX2_INVALIDATE_MODE_CPU_ATTRIBUTE_BUFFER, geometry->vertex_buffer, vtx_buffer_size);
+	GX2InvalidateDeferrable(GX2_INVALIDATE_MODE_CPU, geometry->index_buffer, idx_buffer_size);
+
+	// A colliding hash with other contents keeps the first payload shared, this one stays private
+	geometry->shared = shared == shared_geometry.end() && shared_geometry.size() < MAX_SHARED_GEOMETRY;
+	if (shared == shared_geometry.end() && !geometry->shared) {
+		stats.geometry_dedup_table_full++;
+	}
+
+	GeometryHandle handle = geometries.Insert(record);
+	if (!handle) {
+		WHBLogPrintf("RenderInterface_GX2: Out of geometry slots");
+		MappedMemory::Free(geometry->vertex_buffer);
+		MappedMemory::Free(geometry->index_buffer);
+		return 0;
+	}
+	if (geometry->shared) {
+		shared_geometry[geometry->content_hash] = { geometry->vertex_buffer, geometry->index_buffer, vtx_buffer_size, idx_buffer_size, 1 };
+		stats.geometry_dedup_entries = (uint32_t)shared_geometry.size();
+	}
+
+	stats.geometry_compiled++;
+	stats.geometry_bytes += vtx_buffer_size + idx_buffer_size;
 	
-	return reinterpret_cast<Rml::CompiledGeometryHandle>(geometry);
+	return (Rml::CompiledGeometryHandle)handle;
 }
 
 void RenderInterface_GX2::ReleaseGeometry(Rml::CompiledGeometryHandle geometry) {
 	if (!geometry)
 		return;
 	
-	GeometryData* data = reinterpret_cast<GeometryData*>(geometry);
-	MEMFreeToMappedMemory(data->vertex_buffer);
-	MEMFreeToMappedMemory(data->index_buffer);
-	delete data;
+	GeometryData* data = geometries.Get((GeometryHandle)geometry);
+	if (!data) {
+		WHBLogPrintf("RenderInterface_GX2: ReleaseGeometry with a stale handle %08x", (uint32_t)geometry);
+		return;
+	}
+	stats.geometry_released++;
+	InvalidateLastFrames();
+	uint32_t vtx_buffer_size = data->num_vertices * sizeof(Rml::Vertex);
+	uint32_t idx_buffer_size = data->num_indices * sizeof(int);
+
+	// Buffers shared with other geometry stay until the last reference is gone
+	if (data->shared) {
+		auto shared = shared_geometry.find(data->content_hash);
+		if (shared != shared_geometry.end() && --shared->second.references > 0) {
+			stats.geometry_dedup_saved_bytes -= vtx_buffer_size + idx_buffer_size;
+			geometries.Erase((GeometryHandle)geometry);
+			return;
+		}
+		if (shared != shared_geometry.end()) {
+			shared_geometry.erase(shared);
+			stats.geometry_dedup_entries = (uint32_t)shared_geometry.size();
+		}
+	}
+	stats.geometry_bytes -= vtx_buffer_size + idx_buffer_size;
+
+	// Draws of this frame or the previous ones may not have executed yet
+	release_queue.Release(data->vertex_buffer, vtx_buffer_size, MappedMemory::Free);
+	release_queue.Release(data->index_buffer, idx_buffer_size, MappedMemory::Free);
+	stats.pending_release_bytes = release_queue.GetPendingBytes();
+	geometries.Erase((GeometryHandle)geometry);
 }
 
 void RenderInterface_GX2::RenderGeometry(
@@ -204,284 +709,338 @@ void RenderInterface_GX2::RenderGeometry(
 	if (!geometry)
 		return;
 	
-	GeometryData* data = reinterpret_cast<GeometryData*>(geometry);
-	
-    // Combine translation and transform into a single matrix
-    // Combine translation and transform into a single matrix
-    if (shader_group) {
-        // Ensure we have a buffer for this draw call
-        if ((size_t)current_transform_buffer_index >= transform_buffer.size()) {
-            GX2RBuffer new_buffer = {};
-            GX2InitUniformBuffer(&new_buffer, sizeof(float) * 16, 1);
-            transform_buffer.push_back(new_buffer);
-        }
+	GeometryData* data = geometries.Resolve((GeometryHandle)geometry);
+	if (!data)
+		return;
 
-        GX2RBuffer* current_buffer = &transform_buffer[current_transform_buffer_index];
-
-        // Create translation matrix (column-major: translation goes in column 3)
-        Rml::Matrix4f translation_matrix = Rml::Matrix4f::Identity();
-        translation_matrix[3][0] = translation.x;
-        translation_matrix[3][1] = translation.y;
-        
-        // Combine: first translate, then apply transform
-        // Note: matrix multiplication order for column-major is reversed
-        Rml::Matrix4f combined = transform_matrix * translation_matrix;
-        
-        // Send combined matrix to shader
-        GX2RSetVertexUniformBlockEx(shader_group, current_buffer, 
-            (void*)combined.data(), sizeof(float) * 16, "TransformBlock");
-            
-        current_transform_buffer_index++;
-    }
+	if (!repeating) {
+		FrameCall call = {};
+		call.type = FrameCallType::RenderGeometry;
+		call.geometry = geometry;
+		call.texture = texture;
+		call.translation = translation;
+		frame_calls.push_back(call);
+	}
 	
-	// Set vertex attributes
+	if (!shader_group)
+		return;
+
+	// Scrolled out of its container or off screen, nothing to upload or bind
+	if (!IsVisible(data, translation))
+		return;
+
+	// Untextured geometry doesn't sample at all, draws without a transform only upload their translation
+	uint32_t variant = resolved_variants[ShaderVariant::Select(texture != 0, transform_enabled)];
+	// Textured variants always get a texture, the white one for untextured or stale handles
+	TextureData* tex = texture ? textures.Resolve((TextureHandle)texture) : nullptr;
+	if (!tex) {
+		tex = default_texture;
+	}
+	if ((variant & ShaderVariant::TEXTURED) != 0 && !tex)
+		return;
+	// Drawn once its pixels are uploaded
+	if (tex && tex->uploading)
+		return;
+	if (tex && tex->distance_field && text_shader) {
+		DrawDistanceField(data, translation, tex);
+		return;
+	}
+	(this->*draw_functions[variant])(data, translation, tex);
+}
+
+void RenderInterface_GX2::DrawDistanceField(GeometryData* data, Rml::Vector2f translation, TextureData* texture) {
+	if (bound_variant != TEXT_SHADER_BOUND) {
+		GX2SetShaderGroup(text_shader);
+		bound_variant = TEXT_SHADER_BOUND;
+		stats.shader_switches++;
+	}
+	UploadTransformBlock(text_shader, translation);
+
 	GX2SetAttribBuffer(0, data->num_vertices * sizeof(Rml::Vertex), sizeof(Rml::Vertex), data->vertex_buffer);
-	
-	// Bind texture if provided, otherwise use default white texture
-    TextureData* tex = nullptr;
-	if (texture) {
-		tex = reinterpret_cast<TextureData*>(texture);
+	GX2SetPixelTexture(&texture->texture, 0);
+	GX2SetPixelSampler(&texture->sampler, 0);
+	if (&texture->texture != bound_texture) {
+		stats.texture_binds++;
+		bound_texture = &texture->texture;
+	}
+	GX2DrawIndexedEx(GX2_PRIMITIVE_MODE_TRIANGLES, data->num_indices, GX2_INDEX_TYPE_U32, data->index_buffer, 0, 1);
+
+	stats.draw_calls++;
+	stats.triangles += data->num_indices / 3;
+}
+
+GX2RBuffer* RenderInterface_GX2::NextTransformBuffer() {
+	Rml::Vector<GX2RBuffer>& transform_buffer = frame_target->transform_buffer;
+	if ((size_t)current_transform_buffer_index >= transform_buffer.size()) {
+		GX2RBuffer new_buffer = {};
+		CreateUniformBuffer(&new_buffer, sizeof(float) * 16);
+		transform_buffer.push_back(new_buffer);
+	}
+	return &transform_buffer[current_transform_buffer_index++];
+}
+
+void RenderInterface_GX2::UploadTransformBlock(WHBGfxShaderGroup* group, Rml::Vector2f translation) {
+	// Create translation matrix (column-major: translation goes in column 3)
+	Rml::Matrix4f translation_matrix = Rml::Matrix4f::Identity();
+	translation_matrix[3][0] = translation.x;
+	translation_matrix[3][1] = translation.y;
+
+	// Combine: first translate, then apply transform
+	// Note: matrix multiplication order for column-major is reversed
+	Rml::Matrix4f combined = transform_matrix * translation_matrix;
+
+	GX2RSetVertexUniformBlockEx(group, NextTransformBuffer(), (void*)combined.data(), sizeof(float) * 16, "TransformBlock");
+	stats.uniform_uploads++;
+	stats.uniform_bytes += sizeof(float) * 16;
+}
+
+template <uint32_t Variant>
+void RenderInterface_GX2::DrawGeometry(GeometryData* data, Rml::Vector2f translation, TextureData* texture) {
+	WHBGfxShaderGroup* group = shader_variants[Variant];
+	if (bound_variant != Variant) {
+		GX2SetShaderGroup(group);
+		bound_variant = Variant;
+		stats.shader_switches++;
+	}
+
+	if constexpr ((Variant & ShaderVariant::TRANSFORM) != 0) {
+		UploadTransformBlock(group, translation);
 	} else {
-        tex = default_texture;
-    }
+		const float offset[4] = { translation.x, translation.y, 0.0f, 0.0f };
+		GX2RSetVertexUniformBlockEx(group, NextTransformBuffer(), (void*)offset, sizeof(offset), "TranslationBlock");
+		stats.uniform_uploads++;
+		stats.uniform_bytes += sizeof(offset);
+	}
+
+	// Set vertex attributes
+	GX2SetAttribBuffer(0, data->num_vertices * sizeof(Rml::Vertex), sizeof(Rml::Vertex), data->vertex_buffer);
+
+	if constexpr ((Variant & ShaderVariant::TEXTURED) != 0) {
+		// The generic variant also draws untextured geometry when the specialized one is missing, with the white texture
+		GX2SetPixelTexture(&texture->texture, 0);
+		GX2SetPixelSampler(&texture->sampler, 0);
+		if (&texture->texture != bound_texture) {
+			stats.texture_binds++;
+			bound_texture = &texture->texture;
+		}
+	}
 
-    if (tex) {
-		GX2SetPixelTexture(tex->texture, 0);
-		GX2SetPixelSampler(tex->sampler, 0);
-    }
-	
 	// Draw indexed triangles
 	GX2DrawIndexedEx(GX2_PRIMITIVE_MODE_TRIANGLES, 
 		data->num_indices,
 		GX2_INDEX_TYPE_U32,
 		data->index_buffer,
 		0, 1);
+
+	stats.draw_calls++;
+	stats.triangles += data->num_indices / 3;
 }
 
 Rml::TextureHandle RenderInterface_GX2::LoadTexture(
 	Rml::Vector2i& texture_dimensions, 
 	const Rml::String& source) 
 {
-	Rml::FileInterface* file_interface = Rml::GetFileInterface();
-	Rml::FileHandle file_handle = file_interface->Open(source);
-	if (!file_handle) {
-		return 0;
-	}
+	PROFILE_SCOPE("LoadTexture");
 
-	file_interface->Seek(file_handle, 0, SEEK_END);
-	size_t file_size = file_interface->Tell(file_handle);
-	file_interface->Seek(file_handle, 0, SEEK_SET);
-
-	if (file_size < 18) {
-		file_interface->Close(file_handle);
+	Rml::Vector<Rml::byte> dest_buffer;
+	if (!TGA::Load(source, dest_buffer, texture_dimensions)) {
 		return 0;
 	}
 
-	Rml::byte* buffer = new Rml::byte[file_size];
-	file_interface->Read(buffer, file_size, file_handle);
-	file_interface->Close(file_handle);
-
-	// TGA Header
-	// 0: ID length
-	// 1: Color map type
-	// 2: Image type (2 = uncompressed RGB)
-	// 12: Width (lo)
-	// 13: Width (hi)
-	// 14: Height (lo)
-	// 15: Height (hi)
-	// 16: Pixel depth (24 or 32)
-	// 17: Image descriptor
-
-	Rml::byte id_length = buffer[0];
-	Rml::byte color_map_type = buffer[1];
-	Rml::byte image_type = buffer[2];
-	
-	if (image_type != 2 && image_type != 3) { // Only support uncompressed RGB/RGBA or Grayscale
-		delete[] buffer;
-		return 0;
-	}
-
-	int width = buffer[12] | (buffer[13] << 8);
-	int height = buffer[14] | (buffer[15] << 8);
-	int pixel_depth = buffer[16];
-	int image_descriptor = buffer[17];
-
-	if (width <= 0 || height <= 0 || (pixel_depth != 24 && pixel_depth != 32 && pixel_depth != 8)) {
-		delete[] buffer;
-		return 0;
-	}
-
-	int bytes_per_pixel = pixel_depth / 8;
-	size_t image_data_offset = 18 + id_length;
-	
-	// Skip color map if present (though type 2 shouldn't have one usually, but spec says check)
-	if (color_map_type == 1) {
-		int color_map_len = buffer[5] | (buffer[6] << 8);
-		int color_map_entry_size = buffer[7];
-		image_data_offset += color_map_len * (color_map_entry_size / 8);
+	if (!deferred_uploads) {
+		Rml::TextureHandle texture = GenerateTexture(Rml::Span<const Rml::byte>(dest_buffer.data(), dest_buffer.size()), texture_dimensions);
+		if (texture) {
+			MappedMemory::SetSource(textures.Get((TextureHandle)texture)->texture.surface.image, source.c_str());
+		}
+		return texture;
 	}
 
-	if (image_data_offset + width * height * bytes_per_pixel > file_size) {
-		delete[] buffer;
+	// RmlUi gets the handle right away, the pixels follow in slices
+	TextureHandle handle = AllocateTexture(texture_dimensions, false, false);
+	if (!handle) {
 		return 0;
 	}
-
-	Rml::byte* image_data = buffer + image_data_offset;
-	
-	// Convert to RGBA8
-	int dest_bytes_per_pixel = 4;
-	Rml::byte* dest_buffer = new Rml::byte[width * height * dest_bytes_per_pixel];
-
-	bool flip_vertical = !(image_descriptor & 0x20); // Bit 5 set = top-to-bottom
-
-	for (int y = 0; y < height; y++) {
-		int src_y = flip_vertical ? (height - 1 - y) : y;
-		Rml::byte* src_row = image_data + (src_y * width * bytes_per_pixel);
-		Rml::byte* dest_row = dest_buffer + (y * width * dest_bytes_per_pixel);
-
-		for (int x = 0; x < width; x++) {
-			Rml::byte* src_pixel = src_row + (x * bytes_per_pixel);
-			Rml::byte* dest_pixel = dest_row + (x * dest_bytes_per_pixel);
-
-			if (bytes_per_pixel == 3) {
-				// BGR -> RGBA
-				dest_pixel[0] = src_pixel[2]; // R
-				dest_pixel[1] = src_pixel[1]; // G
-				dest_pixel[2] = src_pixel[0]; // B
-				dest_pixel[3] = 255;          // A
-			} else if (bytes_per_pixel == 4) {
-				// BGRA -> RGBA
-				dest_pixel[0] = src_pixel[2]; // R
-				dest_pixel[1] = src_pixel[1]; // G
-				dest_pixel[2] = src_pixel[0]; // B
-				dest_pixel[3] = src_pixel[3]; // A
-			} else if (bytes_per_pixel == 1) {
-				// Grayscale -> RGBA
-				dest_pixel[0] = src_pixel[0];
-				dest_pixel[1] = src_pixel[0];
-				dest_pixel[2] = src_pixel[0];
-				dest_pixel[3] = 255;
-			}
-		}
-	}
-
-	texture_dimensions.x = width;
-	texture_dimensions.y = height;
-
-	Rml::TextureHandle handle = GenerateTexture(Rml::Span<const Rml::byte>(dest_buffer, width * height * 4), texture_dimensions);
-
-	delete[] dest_buffer;
-	delete[] buffer;
-
-	return handle;
+	TextureData* tex_data = textures.Get(handle);
+	MappedMemory::SetSource(tex_data->texture.surface.image, source.c_str());
+	tex_data->uploading = true;
+	stats.pending_upload_bytes += (uint32_t)dest_buffer.size();
+	pending_uploads.push_back({ handle, std::move(dest_buffer), 0 });
+	return (Rml::TextureHandle)handle;
 }
 
 Rml::TextureHandle RenderInterface_GX2::GenerateTexture(
 	Rml::Span<const Rml::byte> source, 
 	Rml::Vector2i source_dimensions) 
 {
-	TextureData* tex_data = new TextureData();
-	
-	// Create GX2Texture
-	GX2Texture* tex = new GX2Texture();
-	std::memset(tex, 0, sizeof(GX2Texture));
-	tex_data->texture = tex;
-	
     // Determine format based on input size
     int bytes_per_pixel = source.size() / (source_dimensions.x * source_dimensions.y);
+    // Single-channel textures stay at one byte per texel, they are alpha masks unless explicitly marked as distance fields
+    TextureHandle handle = AllocateTexture(source_dimensions, bytes_per_pixel == 1, bytes_per_pixel == 1 && DistanceFieldMark::IsActive());
+    if (!handle) {
+        return 0;
+    }
+
+    if (bytes_per_pixel == 4 || bytes_per_pixel == 1) {
+        CopyTextureRows(textures.Get(handle), source.data(), 0, source_dimensions.y);
+    } else {
+        WHBLogPrintf("GenerateTexture: Unsupported bytes per pixel: %d", bytes_per_pixel);
+        // Fill with magenta to indicate error
+        // ...
+    }
+	
+	return (Rml::TextureHandle)handle;
+}
+
+RenderInterface_GX2::TextureHandle RenderInterface_GX2::AllocateTexture(Rml::Vector2i dimensions, bool single_channel, bool distance_field) {
+	// Filled in place, the slot is given back if anything fails
+	TextureHandle handle = textures.Insert(TextureData());
+	if (!handle) {
+		WHBLogPrintf("RenderInterface_GX2: Out of texture slots");
+		return 0;
+	}
+	TextureData* tex_data = textures.Get(handle);
+	GX2Texture* tex = &tex_data->texture;
+	tex_data->single_channel = single_channel;
+	tex_data->distance_field = distance_field;
     
 	tex->surface.dim = GX2_SURFACE_DIM_TEXTURE_2D;
 	tex->surface.use = GX2_SURFACE_USE_TEXTURE;
-	tex->surface.width = source_dimensions.x;
-	tex->surface.height = source_dimensions.y;
+	tex->surface.width = dimensions.x;
+	tex->surface.height = dimensions.y;
 	tex->surface.depth = 1;
 	tex->surface.mipLevels = 1;
-	tex->surface.format = GX2_SURFACE_FORMAT_UNORM_R8_G8_B8_A8;
+	tex->surface.format = single_channel ? GX2_SURFACE_FORMAT_UNORM_R8 : GX2_SURFACE_FORMAT_UNORM_R8_G8_B8_A8;
 	tex->surface.aa = GX2_AA_MODE1X;
 	tex->surface.tileMode = GX2_TILE_MODE_LINEAR_ALIGNED;
 	tex->viewNumSlices = 1;
 	tex->viewNumMips = 1;
 	
-	// Standard RGBA mapping
-	tex->compMap = GX2_COMP_MAP(GX2_SQ_SEL_R, GX2_SQ_SEL_G, GX2_SQ_SEL_B, GX2_SQ_SEL_A);
+	// Standard RGBA mapping, distance fields are replicated so the regular shaders still draw something sensible with them
+	// and alpha masks sample as white with the mask as alpha
+	if (distance_field) {
+		tex->compMap = GX2_COMP_MAP(GX2_SQ_SEL_R, GX2_SQ_SEL_R, GX2_SQ_SEL_R, GX2_SQ_SEL_R);
+	} else if (single_channel) {
+		tex->compMap = GX2_COMP_MAP(GX2_SQ_SEL_1, GX2_SQ_SEL_1, GX2_SQ_SEL_1, GX2_SQ_SEL_R);
+	} else {
+		tex->compMap = GX2_COMP_MAP(GX2_SQ_SEL_R, GX2_SQ_SEL_G, GX2_SQ_SEL_B, GX2_SQ_SEL_A);
+	}
 	
 	GX2CalcSurfaceSizeAndAlignment(&tex->surface);
 	GX2InitTextureRegs(tex);
 	
 	// Allocate texture memory
-	tex->surface.image = MEMAllocFromMappedMemoryForGX2Ex(tex->surface.imageSize, tex->surface.alignment);
+	tex->surface.image = MappedMemory::Alloc(MappedMemory::Tag::Texture, tex->surface.imageSize, tex->surface.alignment, "generated");
 	if (!tex->surface.image) {
-		delete tex;
-		delete tex_data;
+		textures.Erase(handle);
 		return 0;
 	}
 	
-	// Copy image data (row by row to account for pitch)
-	unsigned char* dst_pixels = (unsigned char*)tex->surface.image;
-	const unsigned char* src_pixels = (const unsigned char*)source.data();
-	
-    if (bytes_per_pixel == 4) {
-        // RGBA8 input
-        for (int y = 0; y < source_dimensions.y; y++) {
-            std::memcpy(dst_pixels + (y * tex->surface.pitch * 4), 
-                       src_pixels + (y * source_dimensions.x * 4), 
-                       source_dimensions.x * 4);
-        }
-    } else if (bytes_per_pixel == 1) {
-        // A8 input (font) - Expand to RGBA8 (White + Alpha)
-        for (int y = 0; y < source_dimensions.y; y++) {
-            unsigned char* row_dst = dst_pixels + (y * tex->surface.pitch * 4);
-            const unsigned char* row_src = src_pixels + (y * source_dimensions.x);
-            
-            for (int x = 0; x < source_dimensions.x; x++) {
-                unsigned char alpha = row_src[x];
-                row_dst[x * 4 + 0] = 255; // R
-                row_dst[x * 4 + 1] = 255; // G
-                row_dst[x * 4 + 2] = 255; // B
-                row_dst[x * 4 + 3] = alpha; // A
-            }
-        }
-    } else {
-        WHBLogPrintf("GenerateTexture: Unsupported bytes per pixel: %d", bytes_per_pixel);
-        // Fill with magenta to indicate error
-        // ...
-    }
-	
-	// Flush CPU cache to GPU
-	GX2Invalidate(GX2_INVALIDATE_MODE_CPU_TEXTURE, dst_pixels, tex->surface.imageSize);
-	
 	// Create sampler
-	tex_data->sampler = new GX2Sampler();
-	GX2InitSampler(tex_data->sampler, GX2_TEX_CLAMP_MODE_CLAMP, GX2_TEX_XY_FILTER_MODE_LINEAR);
+	GX2InitSampler(&tex_data->sampler, GX2_TEX_CLAMP_MODE_CLAMP, GX2_TEX_XY_FILTER_MODE_LINEAR);
+
+	stats.textures_generated++;
+	stats.texture_bytes += tex->surface.imageSize;
 	
-	return reinterpret_cast<Rml::TextureHandle>(tex_data);
+	return handle;
+}
+
+void RenderInterface_GX2::CopyTextureRows(TextureData* data, const Rml::byte* rows, int first_row, int row_count) {
+	// Copied row by row to account for the pitch
+	GX2Surface& surface = data->texture.surface;
+	const int bytes_per_pixel = data->single_channel ? 1 : 4;
+	const uint32_t row_bytes = surface.width * bytes_per_pixel;
+	const uint32_t pitch_bytes = surface.pitch * bytes_per_pixel;
+	unsigned char* dst_pixels = (unsigned char*)surface.image + first_row * pitch_bytes;
+	for (int y = 0; y < row_count; y++) {
+		std::memcpy(dst_pixels + y * pitch_bytes, rows + y * row_bytes, row_bytes);
+	}
+
+	// Flush CPU cache to GPU
+	GX2InvalidateDeferrable(GX2_INVALIDATE_MODE_CPU_TEXTURE, dst_pixels, row_count * pitch_bytes);
+}
+
+bool RenderInterface_GX2::UploadPendingTextures(uint32_t max_bytes) {
+	if (pending_uploads.empty())
+		return true;
+
+	PROFILE_SCOPE("UploadPendingTextures");
+
+	PendingUpload& upload = pending_uploads.front();
+	TextureData* data = textures.Get(upload.handle);
+	const int height = (int)data->texture.surface.height;
+	const uint32_t row_bytes = data->texture.surface.width * 4;
+	const int rows = std::clamp((int)(max_bytes / row_bytes), 1, height - upload.next_row);
+
+	CopyTextureRows(data, upload.pixels.data() + upload.next_row * row_bytes, upload.next_row, rows);
+	upload.next_row += rows;
+	stats.pending_upload_bytes -= rows * row_bytes;
+
+	if (upload.next_row == height) {
+		data->uploading = false;
+		pending_uploads.erase(pending_uploads.begin());
+	}
+	return pending_uploads.empty();
 }
 
 void RenderInterface_GX2::ReleaseTexture(Rml::TextureHandle texture_handle) {
 	if (!texture_handle)
 		return;
 	
-	TextureData* data = reinterpret_cast<TextureData*>(texture_handle);
-	if (data->texture && data->texture->surface.image) {
-		MEMFreeToMappedMemory(data->texture->surface.image);
+	TextureData* data = textures.Get((TextureHandle)texture_handle);
+	if (!data) {
+		WHBLogPrintf("RenderInterface_GX2: ReleaseTexture with a stale handle %08x", (uint32_t)texture_handle);
+		return;
 	}
-	delete data->texture;
-	delete data->sampler;
-	delete data;
+	InvalidateLastFrames();
+	if (data->uploading) {
+		// Released before its pixels were all copied
+		auto upload = std::find_if(pending_uploads.begin(), pending_uploads.end(),
+			[texture_handle](const PendingUpload& pending) { return pending.handle == (TextureHandle)texture_handle; });
+		if (upload != pending_uploads.end()) {
+			stats.pending_upload_bytes -= (uint32_t)(upload->pixels.size() - upload->next_row * data->texture.surface.width * 4);
+			pending_uploads.erase(upload);
+		}
+	}
+	if (data->texture.surface.image) {
+		stats.texture_bytes -= data->texture.surface.imageSize;
+		release_queue.Release(data->texture.surface.image, data->texture.surface.imageSize, MappedMemory::Free);
+		stats.pending_release_bytes = release_queue.GetPendingBytes();
+	}
+	if (&data->texture == bound_texture) {
+		bound_texture = nullptr;
+	}
+	textures.Erase((TextureHandle)texture_handle);
 }
 
 void RenderInterface_GX2::EnableScissorRegion(bool enable) {
+	if (!repeating) {
+		FrameCall call = {};
+		call.type = FrameCallType::EnableScissorRegion;
+		call.enable = enable;
+		frame_calls.push_back(call);
+	}
+
+	if (scissor_enabled && !enable) {
+		// GX2 always has scissor enabled, reset it to full screen when disabled
+		ApplyScissor(0, 0, viewport_width, viewport_height);
+	}
 	scissor_enabled = enable;
-	// GX2 always has scissor enabled, we'll just set it to full screen when disabled
 }
 
 void RenderInterface_GX2::SetScissorRegion(Rml::Rectanglei region) {
+	if (!repeating) {
+		FrameCall call = {};
+		call.type = FrameCallType::SetScissorRegion;
+		call.region = region;
+		frame_calls.push_back(call);
+	}
+
 	if (scissor_enabled) {
 		// GX2 scissor uses same coordinate system as RmlUI (top-left origin)
-		GX2SetScissor(region.Left(), region.Top(), region.Width(), region.Height());
+		ApplyScissor(region.Left(), region.Top(), region.Width(), region.Height());
 	} else {
 		// Disable scissor by setting to full viewport
-		GX2SetScissor(0, 0, viewport_width, viewport_height);
+		ApplyScissor(0, 0, viewport_width, viewport_height);
 	}
 }
 
@@ -502,6 +1061,14 @@ void RenderInterface_GX2::RenderToClipMask(
 }
 
 void RenderInterface_GX2::SetTransform(const Rml::Matrix4f* transform) {
+	if (!repeating) {
+		FrameCall call = {};
+		call.type = FrameCallType::SetTransform;
+		call.enable = (transform != nullptr);
+		call.transform = transform ? *transform : Rml::Matrix4f::Identity();
+		frame_calls.push_back(call);
+	}
+
 	transform_enabled = (transform != nullptr);
 	
     if (transform) {
@@ -512,8 +1079,692 @@ void RenderInterface_GX2::SetTransform(const Rml::Matrix4f* transform) {
 }
 
 RenderInterface_GX2::TextureData* RenderInterface_GX2::GetTextureData(Rml::TextureHandle texture_handle) {
-	if (!texture_handle)
+	return textures.Get((TextureHandle)texture_handle);
+}
+
+
+void* RenderInterface_GX2::CreateRenderTarget(void* user, const RenderTargetPool::Key& key, uint32_t* bytes) {
+	(void)user;
+	RenderTarget* target = new RenderTarget();
+	std::memset(target, 0, sizeof(RenderTarget));
+
+	GX2Surface& surface = target->color_buffer.surface;
+	surface.dim = GX2_SURFACE_DIM_TEXTURE_2D;
+	surface.use = (GX2SurfaceUse)(GX2_SURFACE_USE_TEXTURE | GX2_SURFACE_USE_COLOR_BUFFER);
+	surface.width = key.width;
+	surface.height = key.height;
+	surface.depth = 1;
+	surface.mipLevels = 1;
+	surface.format = (GX2SurfaceFormat)key.format;
+	surface.aa = GX2_AA_MODE1X;
+	surface.tileMode = GX2_TILE_MODE_DEFAULT;
+	target->color_buffer.viewNumSlices = 1;
+	GX2CalcSurfaceSizeAndAlignment(&surface);
+	GX2InitColorBufferRegs(&target->color_buffer);
+
+	surface.image = MappedMemory::Alloc(MappedMemory::Tag::RenderTarget, surface.imageSize, surface.alignment, "layer");
+	if (!surface.image) {
+		WHBLogPrintf("RenderInterface_GX2: Failed to allocate a %ux%u render target", key.width, key.height);
+		delete target;
 		return nullptr;
-	return reinterpret_cast<TextureData*>(texture_handle);
+	}
+	// Only the GPU writes it, dirty cache lines of the memory's previous owner must not land on top
+	GX2Invalidate(GX2_INVALIDATE_MODE_CPU, surface.image, surface.imageSize);
+
+	target->texture.surface = surface;
+	target->texture.viewNumMips = 1;
+	target->texture.viewNumSlices = 1;
+	target->texture.compMap = GX2_COMP_MAP(GX2_SQ_SEL_R, GX2_SQ_SEL_G, GX2_SQ_SEL_B, GX2_SQ_SEL_A);
+	GX2InitTextureRegs(&target->texture);
+	GX2InitSampler(&target->sampler, GX2_TEX_CLAMP_MODE_CLAMP, GX2_TEX_XY_FILTER_MODE_LINEAR);
+
+	target->width = (int)key.width;
+	target->height = (int)key.height;
+	target->uv_scale_x = 1.0f;
+	target->uv_scale_y = 1.0f;
+	*bytes = surface.imageSize;
+	return target;
+}
+
+void RenderInterface_GX2::DestroyRenderTarget(void* user, void* target) {
+	RenderInterface_GX2* self = static_cast<RenderInterface_GX2*>(user);
+	RenderTarget* render_target = static_cast<RenderTarget*>(target);
+
+	// Passes of the frames still in flight may draw into or sample it
+	const GX2Surface& surface = render_target->color_buffer.surface;
+	self->release_queue.Release(surface.image, surface.imageSize, MappedMemory::Free);
+	delete render_target;
+}
+
+RenderInterface_GX2::RenderTarget* RenderInterface_GX2::AcquireRenderTarget(int width, int height) {
+	RenderTargetPool::Key key = { (uint32_t)std::max(width, 1), (uint32_t)std::max(height, 1), GX2_SURFACE_FORMAT_UNORM_R8_G8_B8_A8 };
+	RenderTarget* target = static_cast<RenderTarget*>(render_target_pool.Acquire(key));
+	stats.render_target_bytes = render_target_pool.GetBytes();
+	stats.render_targets_created = render_target_pool.GetCreatedCount();
+	return target;
+}
+
+void RenderInterface_GX2::ReleaseRenderTarget(RenderTarget* target) {
+	render_target_pool.Release(target);
+}
+
+void RenderInterface_GX2::BindRenderTarget(RenderTarget* target) {
+	GX2SetColorBuffer(&target->color_buffer, GX2_RENDER_TARGET_0);
+	GX2SetViewport(0.0f, 0.0f, (float)target->width, (float)target->height, 0.0f, 1.0f);
+	GX2SetScissor(0, 0, target->width, target->height);
+}
+
+void RenderInterface_GX2::RestoreLayerState() {
+	RenderTarget* top = layers.empty() ? nullptr : layers.back();
+	if (top && (top != &base_layer || base_layer_valid)) {
+		GX2SetColorBuffer(&top->color_buffer, GX2_RENDER_TARGET_0);
+	}
+	GX2SetViewport(0.0f, 0.0f, (float)viewport_width, (float)viewport_height, 0.0f, 1.0f);
+	ApplyScissor(scissor_x, scissor_y, scissor_width, scissor_height);
+	SetBlendMode(Rml::BlendMode::Blend);
+
+	// Post-process passes bound their own shaders and textures
+	bound_variant = ShaderVariant::COUNT;
+	bound_texture = nullptr;
+}
+
+void RenderInterface_GX2::FlushRenderTarget(RenderTarget* target) {
+	const GX2Surface& surface = target->color_buffer.surface;
+	GX2Invalidate(GX2_INVALIDATE_MODE_COLOR_BUFFER | GX2_INVALIDATE_MODE_TEXTURE, surface.image, surface.imageSize);
+}
+
+void RenderInterface_GX2::DrawPostPass(PostShader shader, RenderTarget* source, const void* pixel_uniforms, size_t pixel_uniforms_size,
+	const char* block_name, Rml::Vector2f source_offset, Rml::Vector2f source_scale)
+{
+	WHBGfxShaderGroup* group = post_shaders[shader];
+	if (!group || !fullscreen_quad || (!source && !default_texture))
+		return;
+
+	GX2SetShaderGroup(group);
+	bound_variant = ShaderVariant::COUNT;
+	stats.shader_switches++;
+
+	const GX2Texture* texture = source ? &source->texture : &default_texture->texture;
+	const GX2Sampler* sampler = source ? &source->sampler : &default_texture->sampler;
+	float scale_x = source ? source->uv_scale_x : 1.0f;
+	float scale_y = source ? source->uv_scale_y : 1.0f;
+	float width = source ? (float)source->width : 1.0f;
+	float height = source ? (float)source->height : 1.0f;
+
+	const float tex_coord_transform[4] = {
+		source_scale.x * scale_x,
+		source_scale.y * scale_y,
+		source_offset.x / width * scale_x,
+		source_offset.y / height * scale_y,
+	};
+	GX2RSetVertexUniformBlockEx(group, NextTransformBuffer(), (void*)tex_coord_transform, sizeof(tex_coord_transform), "TexCoordBlock");
+	stats.uniform_uploads++;
+	stats.uniform_bytes += sizeof(tex_coord_transform);
+
+	if (pixel_uniforms) {
+		GX2RSetPixelUniformBlockEx(group, NextTransformBuffer(), (void*)pixel_uniforms, pixel_uniforms_size, block_name);
+		stats.uniform_uploads++;
+		stats.uniform_bytes += pixel_uniforms_size;
+	}
+
+	GX2SetPixelTexture(texture, 0);
+	GX2SetPixelSampler(sampler, 0);
+	bound_texture = nullptr;
+	stats.texture_binds++;
+
+	GX2SetAttribBuffer(0, fullscreen_quad->num_vertices * sizeof(Rml::Vertex), sizeof(Rml::Vertex), fullscreen_quad->vertex_buffer);
+	GX2DrawIndexedEx(GX2_PRIMITIVE_MODE_TRIANGLES, fullscreen_quad->num_indices, GX2_INDEX_TYPE_U32, fullscreen_quad->index_buffer, 0, 1);
+
+	stats.draw_calls++;
+	stats.triangles += fullscreen_quad->num_indices / 3;
+	stats.filter_passes++;
+}
+
+void RenderInterface_GX2::ClearRenderTarget(RenderTarget* target) {
+	// Drawn rather than GX2ClearColor, which would leave the context state to be restored
+	const Rml::Matrix4f zero = Rml::Matrix4f::Diag(0.0f, 0.0f, 0.0f, 0.0f);
+	BindRenderTarget(target);
+	SetBlendMode(Rml::BlendMode::Replace);
+	DrawPostPass(POST_FILTER, nullptr, zero.data(), sizeof(float) * 16, "FilterBlock");
 }
 
+void RenderInterface_GX2::CopyRenderTarget(RenderTarget* source, RenderTarget* destination) {
+	const Rml::Matrix4f identity = Rml::Matrix4f::Identity();
+	FlushRenderTarget(source);
+	BindRenderTarget(destination);
+	SetBlendMode(Rml::BlendMode::Replace);
+	DrawPostPass(POST_FILTER, source, identity.data(), sizeof(float) * 16, "FilterBlock");
+}
+
+void RenderInterface_GX2::RenderBlur(float sigma, RenderTarget* target, RenderTarget* temp) {
+	if (sigma < 0.5f)
+		return;
+
+	// Each level halves the target and the sigma left to blur, until what's left fits into a single pass
+	int levels = 0;
+	float level_sigma = sigma;
+	while (level_sigma > MAX_SINGLE_PASS_SIGMA && levels < MAX_BLUR_LEVELS) {
+		level_sigma *= 0.5f;
+		levels++;
+	}
+
+	RenderTarget* chain[MAX_BLUR_LEVELS + 1] = { target };
+	int level = 0;
+	while (level < levels) {
+		RenderTarget* half = AcquireRenderTarget(chain[level]->width / 2, chain[level]->height / 2);
+		if (!half)
+			break;
+		// Linear filtering averages each 2x2 block
+		CopyRenderTarget(chain[level], half);
+		chain[++level] = half;
+	}
+
+	// Fewer levels if the pool ran out, the pass then blurs as much as it can
+	level_sigma = std::min(sigma / (float)(1 << level), MAX_SINGLE_PASS_SIGMA);
+	RenderTarget* small = chain[level];
+	RenderTarget* small_temp = level == 0 ? temp : AcquireRenderTarget(small->width, small->height);
+	if (small_temp) {
+		float weights[4];
+		float total = 0.0f;
+		for (int i = 0; i < 4; i++) {
+			weights[i] = std::exp(-(float)(i * i) / (2.0f * level_sigma * level_sigma));
+			total += i == 0 ? weights[i] : 2.0f * weights[i];
+		}
+		for (float& weight : weights) {
+			weight /= total;
+		}
+
+		// Separable, horizontally into the temp target and vertically back
+		const float horizontal[8] = { 1.0f / (float)small->width, 0.0f, 0.0f, 0.0f, weights[0], weights[1], weights[2], weights[3] };
+		const float vertical[8] = { 0.0f, 1.0f / (float)small->height, 0.0f, 0.0f, weights[0], weights[1], weights[2], weights[3] };
+		FlushRenderTarget(small);
+		BindRenderTarget(small_temp);
+		SetBlendMode(Rml::BlendMode::Replace);
+		DrawPostPass(POST_BLUR, small, horizontal, sizeof(horizontal), "BlurBlock");
+		FlushRenderTarget(small_temp);
+		BindRenderTarget(small);
+		DrawPostPass(POST_BLUR, small_temp, vertical, sizeof(vertical), "BlurBlock");
+		if (small_temp != temp) {
+			ReleaseRenderTarget(small_temp);
+		}
+	}
+
+	if (level > 0) {
+		CopyRenderTarget(small, target);
+	}
+	for (int i = 1; i <= level; i++) {
+		ReleaseRenderTarget(chain[i]);
+	}
+}
+
+void RenderInterface_GX2::RenderFilter(const Filter& filter, RenderTarget*& target, RenderTarget*& temp) {
+	switch (filter.type) {
+	case FilterType::ColorMatrix:
+		FlushRenderTarget(target);
+		BindRenderTarget(temp);
+		SetBlendMode(Rml::BlendMode::Replace);
+		DrawPostPass(POST_FILTER, target, filter.color_matrix.data(), sizeof(float) * 16, "FilterBlock");
+		std::swap(target, temp);
+		break;
+	case FilterType::MaskImage:
+		if (!mask_target)
+			break;
+		FlushRenderTarget(target);
+		BindRenderTarget(temp);
+		SetBlendMode(Rml::BlendMode::Replace);
+		GX2SetPixelTexture(&mask_target->texture, 1);
+		GX2SetPixelSampler(&mask_target->sampler, 1);
+		DrawPostPass(POST_MASK, target, nullptr, 0, nullptr);
+		std::swap(target, temp);
+		break;
+	case FilterType::Blur:
+		RenderBlur(filter.sigma, target, temp);
+		break;
+	case FilterType::DropShadow: {
+		// The shadow goes into temp, gets blurred, and the source is drawn on top of it
+		const float color[4] = { filter.color.red / 255.0f, filter.color.green / 255.0f, filter.color.blue / 255.0f, filter.color.alpha / 255.0f };
+		FlushRenderTarget(target);
+		BindRenderTarget(temp);
+		SetBlendMode(Rml::BlendMode::Replace);
+		DrawPostPass(POST_SHADOW, target, color, sizeof(color), "ShadowBlock", Rml::Vector2f(-filter.offset.x, -filter.offset.y));
+		if (filter.sigma >= 0.5f) {
+			if (RenderTarget* blur_temp = AcquireRenderTarget(temp->width, temp->height)) {
+				RenderBlur(filter.sigma, temp, blur_temp);
+				ReleaseRenderTarget(blur_temp);
+			}
+		}
+
+		const Rml::Matrix4f identity = Rml::Matrix4f::Identity();
+		BindRenderTarget(temp);
+		SetBlendMode(Rml::BlendMode::Blend);
+		DrawPostPass(POST_FILTER, target, identity.data(), sizeof(float) * 16, "FilterBlock");
+		std::swap(target, temp);
+		break;
+	}
+	}
+}
+
+Rml::LayerHandle RenderInterface_GX2::PushLayer() {
+	frame_used_layers = true;
+
+	// Without the game's buffer or the shaders, layers draw straight into the base
+	RenderTarget* target = nullptr;
+	if (base_layer_valid && post_shaders[POST_FILTER]) {
+		target = AcquireRenderTarget(viewport_width, viewport_height);
+	}
+	if (target) {
+		ClearRenderTarget(target);
+		stats.layers_pushed++;
+	} else {
+		target = &base_layer;
+	}
+
+	layers.push_back(target);
+	RestoreLayerState();
+	return (Rml::LayerHandle)(layers.size() - 1);
+}
+
+void RenderInterface_GX2::CompositeLayers(Rml::LayerHandle source, Rml::LayerHandle destination, Rml::BlendMode blend_mode,
+	Rml::Span<const Rml::CompiledFilterHandle> filters)
+{
+	if (source >= layers.size() || destination >= layers.size())
+		return;
+
+	RenderTarget* source_target = layers[source];
+	RenderTarget* destination_target = layers[destination];
+	// Only happens when layers are not available, the content is already in place then
+	if (source_target == destination_target)
+		return;
+	if (!CanSample(source_target)) {
+		static bool logged = false;
+		if (!logged) {
+			WHBLogPrintf("RenderInterface_GX2: The game's buffer is multisampled, backdrop filters are skipped");
+			logged = true;
+		}
+		return;
+	}
+
+	// Filters ping-pong between two scratch targets, the source layer itself stays untouched
+	RenderTarget* result = source_target;
+	RenderTarget* target = nullptr;
+	RenderTarget* temp = nullptr;
+	if (!filters.empty()) {
+		target = AcquireRenderTarget(viewport_width, viewport_height);
+		temp = AcquireRenderTarget(viewport_width, viewport_height);
+		if (target && temp) {
+			CopyRenderTarget(source_target, target);
+			for (Rml::CompiledFilterHandle handle : filters) {
+				if (handle) {
+					RenderFilter(*reinterpret_cast<const Filter*>(handle), target, temp);
+				}
+			}
+			result = target;
+		}
+	}
+
+	FlushRenderTarget(result);
+	GX2SetColorBuffer(&destination_target->color_buffer, GX2_RENDER_TARGET_0);
+	GX2SetViewport(0.0f, 0.0f, (float)viewport_width, (float)viewport_height, 0.0f, 1.0f);
+	GX2SetScissor(scissor_x, scissor_y, scissor_width, scissor_height);
+	SetBlendMode(blend_mode);
+	const Rml::Matrix4f identity = Rml::Matrix4f::Identity();
+	DrawPostPass(POST_FILTER, result, identity.data(), sizeof(float) * 16, "FilterBlock");
+
+	if (target) {
+		ReleaseRenderTarget(target);
+	}
+	if (temp) {
+		ReleaseRenderTarget(temp);
+	}
+	RestoreLayerState();
+}
+
+void RenderInterface_GX2::PopLayer() {
+	if (layers.size() <= 1)
+		return;
+
+	RenderTarget* top = layers.back();
+	layers.pop_back();
+	if (top != &base_layer) {
+		ReleaseRenderTarget(top);
+	}
+	RestoreLayerState();
+}
+
+Rml::TextureHandle RenderInterface_GX2::SaveLayerAsTexture() {
+	RenderTarget* top = layers.empty() ? nullptr : layers.back();
+	if (!top || !CanSample(top) || !post_shaders[POST_FILTER] || scissor_width <= 0 || scissor_height <= 0)
+		return 0;
+
+	// A regular texture of the scissor region, released with ReleaseTexture like any other
+	TextureHandle handle = textures.Insert(TextureData());
+	if (!handle)
+		return 0;
+	TextureData* tex_data = textures.Get(handle);
+	GX2Texture* tex = &tex_data->texture;
+
+	tex->surface.dim = GX2_SURFACE_DIM_TEXTURE_2D;
+	tex->surface.use = (GX2SurfaceUse)(GX2_SURFACE_USE_TEXTURE | GX2_SURFACE_USE_COLOR_BUFFER);
+	tex->surface.width = scissor_width;
+	tex->surface.height = scissor_height;
+	tex->surface.depth = 1;
+	tex->surface.mipLevels = 1;
+	tex->surface.format = GX2_SURFACE_FORMAT_UNORM_R8_G8_B8_A8;
+	tex->surface.aa = GX2_AA_MODE1X;
+	tex->surface.tileMode = GX2_TILE_MODE_DEFAULT;
+	tex->viewNumSlices = 1;
+	tex->viewNumMips = 1;
+	tex->compMap = GX2_COMP_MAP(GX2_SQ_SEL_R, GX2_SQ_SEL_G, GX2_SQ_SEL_B, GX2_SQ_SEL_A);
+	GX2CalcSurfaceSizeAndAlignment(&tex->surface);
+	GX2InitTextureRegs(tex);
+
+	tex->surface.image = MappedMemory::Alloc(MappedMemory::Tag::Texture, tex->surface.imageSize, tex->surface.alignment, "saved layer");
+	if (!tex->surface.image) {
+		textures.Erase(handle);
+		return 0;
+	}
+	GX2Invalidate(GX2_INVALIDATE_MODE_CPU, tex->surface.image, tex->surface.imageSize);
+
+	RenderTarget destination = {};
+	destination.color_buffer.surface = tex->surface;
+	destination.color_buffer.viewNumSlices = 1;
+	GX2InitColorBufferRegs(&destination.color_buffer);
+	destination.width = scissor_width;
+	destination.height = scissor_height;
+
+	const Rml::Matrix4f identity = Rml::Matrix4f::Identity();
+	FlushRenderTarget(top);
+	BindRenderTarget(&destination);
+	SetBlendMode(Rml::BlendMode::Replace);
+	DrawPostPass(POST_FILTER, top, identity.data(), sizeof(float) * 16, "FilterBlock", Rml::Vector2f((float)scissor_x, (float)scissor_y),
+		Rml::Vector2f((float)scissor_width / (float)top->width, (float)scissor_height / (float)top->height));
+	FlushRenderTarget(&destination);
+	RestoreLayerState();
+
+	GX2InitSampler(&tex_data->sampler, GX2_TEX_CLAMP_MODE_CLAMP, GX2_TEX_XY_FILTER_MODE_LINEAR);
+
+	stats.textures_generated++;
+	stats.texture_bytes += tex->surface.imageSize;
+	return (Rml::TextureHandle)handle;
+}
+
+Rml::CompiledFilterHandle RenderInterface_GX2::SaveLayerAsMaskImage() {
+	RenderTarget* top = layers.empty() ? nullptr : layers.back();
+	if (!top || !CanSample(top) || !post_shaders[POST_MASK])
+		return 0;
+
+	// One mask per frame is enough, RmlUi applies it before saving the next one
+	if (!mask_target) {
+		mask_target = AcquireRenderTarget(viewport_width, viewport_height);
+		if (!mask_target)
+			return 0;
+	}
+	CopyRenderTarget(top, mask_target);
+	FlushRenderTarget(mask_target);
+	RestoreLayerState();
+
+	Filter* filter = new Filter();
+	filter->type = FilterType::MaskImage;
+	return reinterpret_cast<Rml::CompiledFilterHandle>(filter);
+}
+
+Rml::CompiledFilterHandle RenderInterface_GX2::CompileFilter(const Rml::String& name, const Rml::Dictionary& parameters) {
+	Filter filter = {};
+	filter.type = FilterType::ColorMatrix;
+	filter.color_matrix = Rml::Matrix4f::Identity();
+
+	// Color matrices of the GL3 renderer, the last row keeps alpha except for opacity
+	if (name == "opacity") {
+		const float value = Rml::Get(parameters, "value", 1.0f);
+		filter.color_matrix = Rml::Matrix4f::Diag(value, value, value, value);
+	} else if (name == "blur") {
+		filter.type = FilterType::Blur;
+		filter.sigma = Rml::Get(parameters, "sigma", 1.0f);
+	} else if (name == "drop-shadow") {
+		filter.type = FilterType::DropShadow;
+		filter.sigma = Rml::Get(parameters, "sigma", 0.0f);
+		filter.color = Rml::Get(parameters, "color", Rml::Colourb()).ToPremultiplied();
+		filter.offset = Rml::Get(parameters, "offset", Rml::Vector2f(0.0f, 0.0f));
+	} else if (name == "brightness") {
+		const float value = Rml::Get(parameters, "value", 1.0f);
+		filter.color_matrix = Rml::Matrix4f::Diag(value, value, value, 1.0f);
+	} else if (name == "contrast") {
+		const float value = Rml::Get(parameters, "value", 1.0f);
+		const float grayness = 0.5f - 0.5f * value;
+		filter.color_matrix = Rml::Matrix4f::FromRows(
+			Rml::Vector4f(value, 0.0f, 0.0f, grayness),
+			Rml::Vector4f(0.0f, value, 0.0f, grayness),
+			Rml::Vector4f(0.0f, 0.0f, value, grayness),
+			Rml::Vector4f(0.0f, 0.0f, 0.0f, 1.0f));
+	} else if (name == "invert") {
+		const float value = std::min(std::max(Rml::Get(parameters, "value", 1.0f), 0.0f), 1.0f);
+		const float inverted = 1.0f - 2.0f * value;
+		filter.color_matrix = Rml::Matrix4f::FromRows(
+			Rml::Vector4f(inverted, 0.0f, 0.0f, value),
+			Rml::Vector4f(0.0f, inverted, 0.0f, value),
+			Rml::Vector4f(0.0f, 0.0f, inverted, value),
+			Rml::Vector4f(0.0f, 0.0f, 0.0f, 1.0f));
+	} else if (name == "grayscale") {
+		const float value = Rml::Get(parameters, "value", 1.0f);
+		const float rev = 1.0f - value;
+		const float r = 0.2126f * value, g = 0.7152f * value, b = 0.0722f * value;
+		filter.color_matrix = Rml::Matrix4f::FromRows(
+			Rml::Vector4f(r + rev, g, b, 0.0f),
+			Rml::Vector4f(r, g + rev, b, 0.0f),
+			Rml::Vector4f(r, g, b + rev, 0.0f),
+			Rml::Vector4f(0.0f, 0.0f, 0.0f, 1.0f));
+	} else if (name == "sepia") {
+		const float value = Rml::Get(parameters, "value", 1.0f);
+		const float rev = 1.0f - value;
+		filter.color_matrix = Rml::Matrix4f::FromRows(
+			Rml::Vector4f(0.393f * value + rev, 0.769f * value, 0.189f * value, 0.0f),
+			Rml::Vector4f(0.349f * value, 0.686f * value + rev, 0.168f * value, 0.0f),
+			Rml::Vector4f(0.272f * value, 0.534f * value, 0.131f * value + rev, 0.0f),
+			Rml::Vector4f(0.0f, 0.0f, 0.0f, 1.0f));
+	} else if (name == "hue-rotate") {
+		const float value = Rml::Get(parameters, "value", 1.0f);
+		const float s = std::sin(value);
+		const float c = std::cos(value);
+		filter.color_matrix = Rml::Matrix4f::FromRows(
+			Rml::Vector4f(0.213f + 0.787f * c - 0.213f * s, 0.715f - 0.715f * c - 0.715f * s, 0.072f - 0.072f * c + 0.928f * s, 0.0f),
+			Rml::Vector4f(0.213f - 0.213f * c + 0.143f * s, 0.715f + 0.285f * c + 0.140f * s, 0.072f - 0.072f * c - 0.283f * s, 0.0f),
+			Rml::Vector4f(0.213f - 0.213f * c - 0.787f * s, 0.715f - 0.715f * c + 0.715f * s, 0.072f + 0.928f * c + 0.072f * s, 0.0f),
+			Rml::Vector4f(0.0f, 0.0f, 0.0f, 1.0f));
+	} else if (name == "saturate") {
+		const float value = Rml::Get(parameters, "value", 1.0f);
+		filter.color_matrix = Rml::Matrix4f::FromRows(
+			Rml::Vector4f(0.213f + 0.787f * value, 0.715f - 0.715f * value, 0.072f - 0.072f * value, 0.0f),
+			Rml::Vector4f(0.213f - 0.213f * value, 0.715f + 0.285f * value, 0.072f - 0.072f * value, 0.0f),
+			Rml::Vector4f(0.213f - 0.213f * value, 0.715f - 0.715f * value, 0.072f + 0.928f * value, 0.0f),
+			Rml::Vector4f(0.0f, 0.0f, 0.0f, 1.0f));
+	} else {
+		WHBLogPrintf("RenderInterface_GX2: Unsupported filter '%s'", name.c_str());
+		return 0;
+	}
+
+	return reinterpret_cast<Rml::CompiledFilterHandle>(new Filter(filter));
+}
+
+void RenderInterface_GX2::ReleaseFilter(Rml::CompiledFilterHandle filter) {
+	delete reinterpret_cast<Filter*>(filter);
+}
+
+WHBGfxShaderGroup* RenderInterface_GX2::GetDecoratorShader(DecoratorShader program) {
+	if (!decorator_shaders[program] && !decorator_shader_failed[program]) {
+		decorator_shaders[program] = LoadShaderGroup(decorator_shader_data[program], true);
+		if (!decorator_shaders[program]) {
+			WHBLogPrintf("RenderInterface_GX2: Failed to load decorator shader %d", program);
+			decorator_shader_failed[program] = true;
+		}
+	}
+	return decorator_shaders[program];
+}
+
+void RenderInterface_GX2::BindFrameUniforms(WHBGfxShaderGroup* group) {
+	GX2RBuffer* buffer = &frame_target->frame_uniform_buffer;
+	if (!frame_target->frame_uniforms_uploaded) {
+		const float frame_uniforms[4] = { (float)viewport_width, (float)viewport_height, frame_time, 0.0f };
+		GX2RSetPixelUniformBlockEx(group, buffer, (void*)frame_uniforms, sizeof(frame_uniforms), "FrameBlock");
+		frame_target->frame_uniforms_uploaded = true;
+		stats.uniform_uploads++;
+		stats.uniform_bytes += sizeof(frame_uniforms);
+		return;
+	}
+	GX2RSetPixelUniformBlock(buffer, GX2GetUniformBlockLocation(group->pixelShader, "FrameBlock"), 0);
+}
+
+Rml::CompiledShaderHandle RenderInterface_GX2::CompileShader(const Rml::String& name, const Rml::Dictionary& parameters) {
+	if (name == "linear-gradient" || name == "radial-gradient" || name == "conic-gradient") {
+		if (!GetDecoratorShader(DECORATOR_GRADIENT))
+			return 0;
+
+		// Same parametrization as the GL3 renderer, the geometry's texture coordinates are in pixels
+		GradientBlock block = {};
+		Rml::Vector2f p, v;
+		if (name == "linear-gradient") {
+			p = Rml::Get(parameters, "p0", Rml::Vector2f(0.0f, 0.0f));
+			v = Rml::Get(parameters, "p1", Rml::Vector2f(0.0f, 0.0f)) - p;
+		} else if (name == "radial-gradient") {
+			block.parameters[0] = 1.0f;
+			p = Rml::Get(parameters, "center", Rml::Vector2f(0.0f, 0.0f));
+			const Rml::Vector2f radius = Rml::Get(parameters, "radius", Rml::Vector2f(1.0f, 1.0f));
+			v = Rml::Vector2f(1.0f / radius.x, 1.0f / radius.y);
+		} else {
+			block.parameters[0] = 2.0f;
+			p = Rml::Get(parameters, "center", Rml::Vector2f(0.0f, 0.0f));
+			const float angle = Rml::Get(parameters, "angle", 0.0f);
+			v = Rml::Vector2f(std::cos(angle), std::sin(angle));
+		}
+		block.parameters[2] = Rml::Get(parameters, "repeating", false) ? 1.0f : 0.0f;
+		block.points[0] = p.x;
+		block.points[1] = p.y;
+		block.points[2] = v.x;
+		block.points[3] = v.y;
+
+		const auto it = parameters.find("color_stop_list");
+		if (it == parameters.end())
+			return 0;
+		const Rml::ColorStopList& color_stop_list = it->second.GetReference<Rml::ColorStopList>();
+		const int num_stops = std::min((int)color_stop_list.size(), MAX_GRADIENT_STOPS);
+		if (num_stops == 0)
+			return 0;
+		block.parameters[1] = (float)num_stops;
+		for (int i = 0; i < num_stops; i++) {
+			const Rml::ColorStop& stop = color_stop_list[i];
+			block.stop_positions[i] = stop.position.number;
+			block.stop_colors[i][0] = stop.color.red / 255.0f;
+			block.stop_colors[i][1] = stop.color.green / 255.0f;
+			block.stop_colors[i][2] = stop.color.blue / 255.0f;
+			block.stop_colors[i][3] = stop.color.alpha / 255.0f;
+		}
+
+		CompiledShader* shader = new CompiledShader();
+		shader->program = DECORATOR_GRADIENT;
+		shader->gradient_block.assign((const Rml::byte*)&block, (const Rml::byte*)&block + sizeof(block));
+		CreateUniformBuffer(&shader->gradient_buffer, sizeof(block));
+		GX2RUpdateUniformBlock(&shader->gradient_buffer, &block, sizeof(block));
+		compiled_shaders.insert(shader);
+		return reinterpret_cast<Rml::CompiledShaderHandle>(shader);
+	}
+
+	if (name == "shader") {
+		const Rml::String value = Rml::Get(parameters, "value", Rml::String());
+		DecoratorShader program;
+		if (value == "rainbow") {
+			program = DECORATOR_RAINBOW;
+		} else if (value == "starry") {
+			program = DECORATOR_STARRY;
+		} else {
+			WHBLogPrintf("RenderInterface_GX2: Unknown shader '%s'", value.c_str());
+			return 0;
+		}
+		if (!GetDecoratorShader(program))
+			return 0;
+
+		CompiledShader* shader = new CompiledShader();
+		shader->program = program;
+		compiled_shaders.insert(shader);
+		return reinterpret_cast<Rml::CompiledShaderHandle>(shader);
+	}
+
+	WHBLogPrintf("RenderInterface_GX2: Unsupported shader '%s'", name.c_str());
+	return 0;
+}
+
+void RenderInterface_GX2::RenderShader(Rml::CompiledShaderHandle shader, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation,
+	Rml::TextureHandle texture)
+{
+	GeometryData* data = geometries.Resolve((GeometryHandle)geometry);
+	if (!shader || !data)
+		return;
+
+	if (!repeating) {
+		FrameCall call = {};
+		call.type = FrameCallType::RenderShader;
+		call.shader = shader;
+		call.geometry = geometry;
+		call.texture = texture;
+		call.translation = translation;
+		frame_calls.push_back(call);
+	}
+
+	CompiledShader* compiled = reinterpret_cast<CompiledShader*>(shader);
+	WHBGfxShaderGroup* group = GetDecoratorShader(compiled->program);
+	if (!group || !shader_group || !IsVisible(data, translation))
+		return;
+	TextureData* tex = texture ? textures.Resolve((TextureHandle)texture) : default_texture;
+	if (tex && tex->uploading)
+		return;
+	if (compiled->program == DECORATOR_GRADIENT && !compiled->gradient_buffer.buffer) {
+		// Released with the device objects since it was compiled
+		CreateUniformBuffer(&compiled->gradient_buffer, compiled->gradient_block.size());
+		GX2RUpdateUniformBlock(&compiled->gradient_buffer, compiled->gradient_block.data(), compiled->gradient_block.size());
+	}
+
+	GX2SetShaderGroup(group);
+	bound_variant = ShaderVariant::COUNT;
+	stats.shader_switches++;
+
+	UploadTransformBlock(group, translation);
+	if (compiled->program == DECORATOR_GRADIENT) {
+		GX2RSetPixelUniformBlock(&compiled->gradient_buffer, GX2GetUniformBlockLocation(group->pixelShader, "GradientBlock"), 0);
+	} else {
+		BindFrameUniforms(group);
+	}
+
+	if (tex) {
+		GX2SetPixelTexture(&tex->texture, 0);
+		GX2SetPixelSampler(&tex->sampler, 0);
+		if (&tex->texture != bound_texture) {
+			stats.texture_binds++;
+			bound_texture = &tex->texture;
+		}
+	}
+
+	GX2SetAttribBuffer(0, data->num_vertices * sizeof(Rml::Vertex), sizeof(Rml::Vertex), data->vertex_buffer);
+	GX2DrawIndexedEx(GX2_PRIMITIVE_MODE_TRIANGLES, data->num_indices, GX2_INDEX_TYPE_U32, data->index_buffer, 0, 1);
+
+	stats.draw_calls++;
+	stats.triangles += data->num_indices / 3;
+}
+
+void RenderInterface_GX2::ReleaseShader(Rml::CompiledShaderHandle shader) {
+	if (!shader)
+		return;
+
+	CompiledShader* compiled = reinterpret_cast<CompiledShader*>(shader);
+	compiled_shaders.erase(compiled);
+	InvalidateLastFrames();
+	if (compiled->gradient_buffer.buffer) {
+		uint32_t size = compiled->gradient_buffer.elemSize * compiled->gradient_buffer.elemCount;
+		stats.uniform_buffer_bytes -= size;
+		// Draws of the frames in flight may still read it
+		release_queue.Release(new GX2RBuffer(compiled->gradient_buffer), size, [](void* memory) {
+			GX2RBuffer* released = static_cast<GX2RBuffer*>(memory);
+			GX2DestroyUniformBuffer(released);
+			delete released;
+		});
+		stats.pending_release_bytes = release_queue.GetPendingBytes();
+	}
+	delete compiled;
+}
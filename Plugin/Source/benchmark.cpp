@@ -0,0 +1,418 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gx2r/buffer.h>
+#include <gx2/mem.h>
+#include <whb/log.h>
+
+#include <RmlUi/Core.h>
+#include "RmlUi_Renderer_GX2.h"
+#include "RmlUi_Image_TGA.h"
+#include "gx2_extra.hpp"
+#include "profiler.hpp"
+#include "slot_map.hpp"
+
+namespace
+{
+    // Each benchmark runs ROUNDS times, the median round is reported
+    constexpr uint32_t ROUNDS = 5;
+    constexpr double REGRESSION_THRESHOLD_PERCENT = 10.0;
+
+    const char* const DATA_DIRECTORY = "fs:/vol/external01/wiiu/plugins/RmlUI/";
+    const char* const DOCUMENT_NAME = "demo.rml";
+    const char* const TGA_NAME = "invader.tga";
+
+    bool pending = false;
+    // Released resources queue up behind the GPU, reclaimed between rounds so the suite doesn't run out of mapped memory
+    RenderInterface_GX2* reclaim_interface = nullptr;
+
+    struct Result
+    {
+        const char* name;
+        uint32_t iterations;
+        uint32_t bytes_per_op;
+        double ns_per_op;
+        bool has_baseline;
+        double baseline_ns_per_op;
+    };
+
+    template<typename Func>
+    Result Measure(const char* name, uint32_t iterations, uint32_t bytes_per_op, Func&& func)
+    {
+        // Warm up caches and lazily created state
+        func();
+
+        uint64_t rounds[ROUNDS];
+        for (uint32_t round = 0; round < ROUNDS; round++)
+        {
+            uint64_t start = Profiler::GetTicks();
+            for (uint32_t i = 0; i < iterations; i++)
+            {
+                func();
+            }
+            rounds[round] = Profiler::GetTicks() - start;
+
+            if (reclaim_interface)
+            {
+                reclaim_interface->FlushReleases();
+            }
+        }
+        std::sort(rounds, rounds + ROUNDS);
+
+        Result result = {};
+        result.name = name;
+        result.iterations = iterations;
+        result.bytes_per_op = bytes_per_op;
+        result.ns_per_op = (double)Profiler::TicksToNanoseconds(rounds[ROUNDS / 2]) / (double)iterations;
+        return result;
+    }
+
+    // Grid of quads laid out like RmlUi box geometry
+    void MakeQuads(uint32_t count, std::vector<Rml::Vertex>& vertices, std::vector<int>& indices)
+    {
+        vertices.resize(count * 4);
+        indices.resize(count * 6);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            float x = (float)(i % 16) * 20.0f;
+            float y = (float)(i / 16) * 20.0f;
+            const Rml::Vector2f corners[4] = { { x, y }, { x + 16.0f, y }, { x + 16.0f, y + 16.0f }, { x, y + 16.0f } };
+            for (int c = 0; c < 4; c++)
+            {
+                Rml::Vertex& vertex = vertices[i * 4 + c];
+                vertex.position = corners[c];
+                vertex.colour = Rml::ColourbPremultiplied(255, 255, 255, 255);
+                vertex.tex_coord = Rml::Vector2f((c == 1 || c == 2) ? 1.0f : 0.0f, (c >= 2) ? 1.0f : 0.0f);
+            }
+            const int base = (int)i * 4;
+            const int quad[6] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+            std::memcpy(&indices[i * 6], quad, sizeof(quad));
+        }
+    }
+
+    // Stand-in for the renderer's geometry record, the churn benchmarks only measure how records are stored and found
+    struct ChurnRecord
+    {
+        void* vertex_buffer;
+        void* index_buffer;
+        uint32_t num_vertices;
+        uint32_t num_indices;
+    };
+
+    // Live records, replaced per round, and draws per round of the churn benchmarks, roughly a busy document
+    constexpr uint32_t CHURN_LIVE = 1024;
+    constexpr uint32_t CHURN_REPLACED = 64;
+    constexpr uint32_t CHURN_DRAWS = 512;
+
+    // Handles are replaced in a scattered order, like elements of a document coming and going
+    uint32_t ChurnIndex(uint32_t round, uint32_t i)
+    {
+        return (round * 7919u + i * 104729u) % CHURN_LIVE;
+    }
+
+    // Layout before slot maps: every record is its own heap allocation and the handle is the pointer
+    uint32_t ChurnHeap(std::vector<uintptr_t>& handles, uint32_t round)
+    {
+        for (uint32_t i = 0; i < CHURN_REPLACED; i++)
+        {
+            uintptr_t& handle = handles[ChurnIndex(round, i)];
+            delete reinterpret_cast<ChurnRecord*>(handle);
+            handle = reinterpret_cast<uintptr_t>(new ChurnRecord{ nullptr, nullptr, 4, 6 + i });
+        }
+        uint32_t indices = 0;
+        for (uint32_t i = 0; i < CHURN_DRAWS; i++)
+        {
+            indices += reinterpret_cast<const ChurnRecord*>(handles[(i * 13u) % CHURN_LIVE])->num_indices;
+        }
+        return indices;
+    }
+
+    uint32_t ChurnSlotMap(SlotMap<ChurnRecord>& records, std::vector<uintptr_t>& handles, uint32_t round)
+    {
+        for (uint32_t i = 0; i < CHURN_REPLACED; i++)
+        {
+            uintptr_t& handle = handles[ChurnIndex(round, i)];
+            records.Erase((SlotMap<ChurnRecord>::Handle)handle);
+            handle = records.Insert(ChurnRecord{ nullptr, nullptr, 4, 6 + i });
+        }
+        uint32_t indices = 0;
+        for (uint32_t i = 0; i < CHURN_DRAWS; i++)
+        {
+            indices += records.Resolve((SlotMap<ChurnRecord>::Handle)handles[(i * 13u) % CHURN_LIVE])->num_indices;
+        }
+        return indices;
+    }
+
+    size_t ReadWholeFile(const char* path, std::vector<Rml::byte>& buffer)
+    {
+        Rml::FileInterface* file_interface = Rml::GetFileInterface();
+        Rml::FileHandle file = file_interface->Open(path);
+        if (!file)
+            return 0;
+
+        size_t length = file_interface->Length(file);
+        buffer.resize(length);
+        size_t read = file_interface->Read(buffer.data(), length, file);
+        file_interface->Close(file);
+        return read;
+    }
+
+    // Finds "ns_per_op" of the named result in a file written by WriteResults
+    bool FindBaseline(const std::string& baseline, const char* name, double& ns_per_op)
+    {
+        std::string key = std::string("\"name\": \"") + name + "\"";
+        size_t entry = baseline.find(key);
+        if (entry == std::string::npos)
+            return false;
+
+        size_t field = baseline.find("\"ns_per_op\":", entry);
+        size_t next_entry = baseline.find("\"name\":", entry + key.size());
+        if (field == std::string::npos || (next_entry != std::string::npos && field > next_entry))
+            return false;
+
+        ns_per_op = std::strtod(baseline.c_str() + field + std::strlen("\"ns_per_op\":"), nullptr);
+        return ns_per_op > 0.0;
+    }
+
+    bool WriteResults(const char* path, const std::vector<Result>& results)
+    {
+        FILE* file = std::fopen(path, "w");
+        if (!file)
+        {
+            WHBLogPrintf("Benchmark: Failed to open %s", path);
+            return false;
+        }
+
+        std::fputs("{\n  \"suite\": \"rmlui-gx2\",\n  \"version\": 1,\n  \"results\": [\n", file);
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result& result = results[i];
+            std::fprintf(file, "    {\"name\": \"%s\", \"iterations\": %u, \"bytes_per_op\": %u, \"ns_per_op\": %.1f",
+                result.name, result.iterations, result.bytes_per_op, result.ns_per_op);
+            if (result.has_baseline)
+            {
+                double delta = (result.ns_per_op - result.baseline_ns_per_op) / result.baseline_ns_per_op * 100.0;
+                std::fprintf(file, ", \"baseline_ns_per_op\": %.1f, \"delta_percent\": %.1f, \"regression\": %s",
+                    result.baseline_ns_per_op, delta, delta > REGRESSION_THRESHOLD_PERCENT ? "true" : "false");
+            }
+            std::fputs(i + 1 < results.size() ? "},\n" : "}\n", file);
+        }
+        std::fputs("  ]\n}\n", file);
+        std::fclose(file);
+        return true;
+    }
+}
+
+namespace Benchmark
+{
+
+void Request()
+{
+    pending = true;
+}
+
+void RunPending(RenderInterface_GX2* render_interface)
+{
+    if (!pending || !render_interface)
+        return;
+
+    pending = false;
+    std::string directory = DATA_DIRECTORY;
+    Run(render_interface, DATA_DIRECTORY, (directory + "bench.json").c_str(), (directory + "bench_baseline.json").c_str());
+}
+
+bool Run(RenderInterface_GX2* render_interface, const char* data_directory, const char* output_path, const char* baseline_path)
+{
+    WHBLogPrintf("Benchmark: Running suite...");
+    const std::string document_path = std::string(data_directory) + DOCUMENT_NAME;
+    const std::string tga_path = std::string(data_directory) + TGA_NAME;
+    std::vector<Result> results;
+    reclaim_interface = render_interface;
+
+    // CompileGeometry + ReleaseGeometry of a typical document sized mesh
+    {
+        std::vector<Rml::Vertex> vertices;
+        std::vector<int> indices;
+        MakeQuads(64, vertices, indices);
+        uint32_t bytes = vertices.size() * sizeof(Rml::Vertex) + indices.size() * sizeof(int);
+        results.push_back(Measure("compile_geometry_64_quads", 200, bytes, [&]() {
+            Rml::CompiledGeometryHandle handle = render_interface->CompileGeometry(
+                Rml::Span<const Rml::Vertex>(vertices.data(), vertices.size()), Rml::Span<const int>(indices.data(), indices.size()));
+            render_interface->ReleaseGeometry(handle);
+        }));
+
+        // Same mesh while an identical one is alive, found by hash instead of uploaded
+        Rml::CompiledGeometryHandle original = render_interface->CompileGeometry(
+            Rml::Span<const Rml::Vertex>(vertices.data(), vertices.size()), Rml::Span<const int>(indices.data(), indices.size()));
+        results.push_back(Measure("compile_geometry_64_quads_duplicate", 200, bytes, [&]() {
+            Rml::CompiledGeometryHandle handle = render_interface->CompileGeometry(
+                Rml::Span<const Rml::Vertex>(vertices.data(), vertices.size()), Rml::Span<const int>(indices.data(), indices.size()));
+            render_interface->ReleaseGeometry(handle);
+        }));
+        render_interface->ReleaseGeometry(original);
+    }
+
+    // Compile/release/render churn of geometry records, heap pointers against slot map handles. Only touches the CPU
+    // side, so the numbers are comparable with a host build of the same loops.
+    {
+        volatile uint32_t sink = 0;
+        uint32_t round = 0;
+
+        std::vector<uintptr_t> heap_handles(CHURN_LIVE);
+        for (uintptr_t& handle : heap_handles)
+        {
+            handle = reinterpret_cast<uintptr_t>(new ChurnRecord{ nullptr, nullptr, 4, 6 });
+        }
+        results.push_back(Measure("handle_churn_heap", 200, 0, [&]() {
+            sink = sink + ChurnHeap(heap_handles, round++);
+        }));
+        for (uintptr_t handle : heap_handles)
+        {
+            delete reinterpret_cast<ChurnRecord*>(handle);
+        }
+
+        SlotMap<ChurnRecord> records;
+        std::vector<uintptr_t> slot_handles(CHURN_LIVE);
+        for (uintptr_t& handle : slot_handles)
+        {
+            handle = records.Insert(ChurnRecord{ nullptr, nullptr, 4, 6 });
+        }
+        round = 0;
+        results.push_back(Measure("handle_churn_slot_map", 200, 0, [&]() {
+            sink = sink + ChurnSlotMap(records, slot_handles, round++);
+        }));
+    }
+
+    // GenerateTexture for RGBA images and A8 font atlases
+    {
+        const Rml::Vector2i dimensions(256, 256);
+        std::vector<Rml::byte> rgba(dimensions.x * dimensions.y * 4, 0x80);
+        std::vector<Rml::byte> alpha(dimensions.x * dimensions.y, 0x80);
+        results.push_back(Measure("generate_texture_rgba_256", 50, rgba.size(), [&]() {
+            Rml::TextureHandle handle = render_interface->GenerateTexture(Rml::Span<const Rml::byte>(rgba.data(), rgba.size()), dimensions);
+            render_interface->ReleaseTexture(handle);
+        }));
+        results.push_back(Measure("generate_texture_a8_256", 50, alpha.size(), [&]() {
+            Rml::TextureHandle handle = render_interface->GenerateTexture(Rml::Span<const Rml::byte>(alpha.data(), alpha.size()), dimensions);
+            render_interface->ReleaseTexture(handle);
+        }));
+    }
+
+    // LoadTexture, TGA read and decode plus the copy into the texture. Kept images would skip the read and decode
+    // after the first load and deferred uploads the copy, so both are off while it runs.
+    {
+        std::vector<Rml::byte> file_data;
+        uint32_t bytes = ReadWholeFile(tga_path.c_str(), file_data);
+        if (bytes > 0)
+        {
+            const bool keep_decoded = TGA::IsKeepingDecoded();
+            const bool deferred_uploads = render_interface->GetDeferredUploads();
+            TGA::KeepDecoded(false);
+            render_interface->SetDeferredUploads(false);
+
+            results.push_back(Measure("load_texture_tga", 10, bytes, [&]() {
+                Rml::Vector2i dimensions;
+                Rml::TextureHandle handle = render_interface->LoadTexture(dimensions, tga_path);
+                render_interface->ReleaseTexture(handle);
+            }));
+
+            // The same load from the kept image, what a warm start pays per texture instead of the read and decode
+            TGA::KeepDecoded(true);
+            results.push_back(Measure("load_texture_tga_kept", 10, bytes, [&]() {
+                Rml::Vector2i dimensions;
+                Rml::TextureHandle handle = render_interface->LoadTexture(dimensions, tga_path);
+                render_interface->ReleaseTexture(handle);
+            }));
+
+            TGA::KeepDecoded(keep_decoded);
+            render_interface->SetDeferredUploads(deferred_uploads);
+        }
+        else
+        {
+            WHBLogPrintf("Benchmark: Skipping load_texture_tga, %s not found", tga_path.c_str());
+        }
+    }
+
+    // SwapMemcpy used by every uniform upload
+    {
+        std::vector<uint32_t> src(1024, 0x3F800000);
+        std::vector<uint32_t> dst(1024);
+        results.push_back(Measure("swap_memcpy_64", 2000, 64, [&]() {
+            SwapMemcpy(dst.data(), src.data(), 64);
+        }));
+        results.push_back(Measure("swap_memcpy_4k", 2000, 4096, [&]() {
+            SwapMemcpy(dst.data(), src.data(), 4096);
+        }));
+    }
+
+    // Uniform upload of one matrix (lock, invalidate, swap copy, unlock)
+    {
+        GX2RBuffer buffer = {};
+        GX2InitUniformBuffer(&buffer, sizeof(float) * 16, 1);
+        const Rml::Matrix4f matrix = Rml::Matrix4f::Identity();
+        results.push_back(Measure("uniform_upload_mat4", 2000, sizeof(float) * 16, [&]() {
+            void* locked = GX2RLockBufferEx(&buffer, GX2R_RESOURCE_BIND_UNIFORM_BLOCK);
+            GX2Invalidate(GX2_INVALIDATE_MODE_CPU | GX2_INVALIDATE_MODE_UNIFORM_BLOCK, locked, buffer.elemSize * buffer.elemCount);
+            SwapMemcpy(locked, matrix.data(), sizeof(float) * 16);
+            GX2RUnlockBufferEx(&buffer, GX2R_RESOURCE_BIND_UNIFORM_BLOCK);
+        }));
+        GX2DestroyUniformBuffer(&buffer);
+    }
+
+    // File reads through the RmlUi file interface
+    {
+        std::vector<Rml::byte> buffer;
+        uint32_t document_bytes = ReadWholeFile(document_path.c_str(), buffer);
+        if (document_bytes > 0)
+        {
+            results.push_back(Measure("file_read_document", 20, document_bytes, [&]() {
+                ReadWholeFile(document_path.c_str(), buffer);
+            }));
+        }
+        uint32_t tga_bytes = ReadWholeFile(tga_path.c_str(), buffer);
+        if (tga_bytes > 0)
+        {
+            results.push_back(Measure("file_read_tga", 10, tga_bytes, [&]() {
+                ReadWholeFile(tga_path.c_str(), buffer);
+            }));
+        }
+    }
+
+    reclaim_interface->FlushReleases();
+    reclaim_interface = nullptr;
+
+    // Compare against the baseline of a previous run
+    std::vector<Rml::byte> baseline_data;
+    if (baseline_path && ReadWholeFile(baseline_path, baseline_data) > 0)
+    {
+        std::string baseline(baseline_data.begin(), baseline_data.end());
+        for (Result& result : results)
+        {
+            result.has_baseline = FindBaseline(baseline, result.name, result.baseline_ns_per_op);
+        }
+    }
+
+    for (const Result& result : results)
+    {
+        if (result.has_baseline)
+        {
+            double delta = (result.ns_per_op - result.baseline_ns_per_op) / result.baseline_ns_per_op * 100.0;
+            WHBLogPrintf("Benchmark: %-28s %12.1f ns/op (%+.1f%%)%s", result.name, result.ns_per_op, delta,
+                delta > REGRESSION_THRESHOLD_PERCENT ? " REGRESSION" : "");
+        }
+        else
+        {
+            WHBLogPrintf("Benchmark: %-28s %12.1f ns/op", result.name, result.ns_per_op);
+        }
+    }
+
+    return WriteResults(output_path, results);
+}
+
+} // namespace Benchmark
@@ -0,0 +1,215 @@
+#include "frame_scheduler.hpp"
+
+#ifdef __WIIU__
+#include <coreinit/time.h>
+#else
+#include <chrono>
+#endif
+
+namespace
+{
+    uint64_t GetMicroseconds()
+    {
+#ifdef __WIIU__
+        return (uint64_t)OSTicksToMicroseconds(OSGetSystemTime());
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Bucket upper bounds in quarters of the budget, the last bucket takes the rest
+    const uint64_t HISTOGRAM_QUARTERS[FrameScheduler::HISTOGRAM_BUCKETS - 1] = { 1, 2, 4, 8, 16 };
+}
+
+FrameScheduler::FrameScheduler() : clock(GetMicroseconds) {}
+
+FrameScheduler::FrameScheduler(ClockSource clock) : clock(clock) {}
+
+void FrameScheduler::SetBudget(uint32_t microseconds)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    budget_us = microseconds;
+}
+
+uint32_t FrameScheduler::GetBudget() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return budget_us;
+}
+
+bool FrameScheduler::Defer(Task task, void* user, uint32_t queue)
+{
+    if (queue >= MAX_QUEUES)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Entry& entry : entries) {
+        if (entry.task == task && entry.user == user)
+            return false;
+    }
+    entries.push_back({ task, user, queue, 0 });
+    return true;
+}
+
+void FrameScheduler::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    for (uint32_t& starved : starved_frames) {
+        starved = 0;
+    }
+}
+
+void FrameScheduler::Begin()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (section_depth++ == 0) {
+        section_start = clock();
+    }
+}
+
+void FrameScheduler::End()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (section_depth == 0)
+        return;
+    if (--section_depth == 0) {
+        spent_us += clock() - section_start;
+    }
+}
+
+uint64_t FrameScheduler::GetSpent() const
+{
+    if (section_depth == 0)
+        return spent_us;
+    return spent_us + (clock() - section_start);
+}
+
+uint32_t FrameScheduler::GetRemainingLocked() const
+{
+    uint64_t spent = GetSpent();
+    return spent < budget_us ? (uint32_t)(budget_us - spent) : 0;
+}
+
+uint32_t FrameScheduler::GetRemaining() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return GetRemainingLocked();
+}
+
+uint32_t FrameScheduler::RunDeferred(uint32_t queue)
+{
+    if (queue >= MAX_QUEUES)
+        return 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    uint32_t count = 0;
+    // Tasks queued during this call wait for the next one, so a task deferring itself can't keep the loop going
+    size_t turns = 0;
+    for (const Entry& entry : entries) {
+        turns += entry.queue == queue;
+    }
+
+    while (turns > 0) {
+        bool forced = starved_frames[queue] >= MAX_STARVED_FRAMES && count == 0;
+        uint32_t remaining = GetRemainingLocked();
+        if (remaining == 0 && !forced)
+            break;
+
+        // Oldest task of the queue expected to fit, a task without a cost yet is tried as long as any budget is left
+        size_t index = 0;
+        while (index < entries.size()) {
+            const Entry& candidate = entries[index];
+            if (candidate.queue == queue && (candidate.cost_us <= remaining || forced))
+                break;
+            index++;
+        }
+        if (index == entries.size())
+            break;
+        Entry entry = entries[index];
+        entries.erase(entries.begin() + index);
+
+        lock.unlock();
+        uint64_t start = clock();
+        bool done = entry.task(entry.user);
+        uint32_t cost = (uint32_t)(clock() - start);
+        lock.lock();
+        entry.cost_us = entry.cost_us == 0 ? cost : (entry.cost_us * 3 + cost) / 4;
+
+        count++;
+        turns--;
+        stats.slices++;
+        if (forced) {
+            stats.forced_slices++;
+        }
+
+        if (done) {
+            stats.tasks_completed++;
+            continue;
+        }
+
+        bool queued_again = false;
+        for (const Entry& queued : entries) {
+            queued_again |= queued.task == entry.task && queued.user == entry.user;
+        }
+        if (!queued_again) {
+            entries.push_back(entry);
+        }
+    }
+
+    if (count > 0) {
+        sliced_this_frame[queue] = true;
+        starved_frames[queue] = 0;
+    }
+    return count;
+}
+
+void FrameScheduler::NextFrame()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t spent = GetSpent();
+    if (section_depth > 0) {
+        // A section still open carries on in the next frame
+        section_start = clock();
+    }
+    spent_us = 0;
+
+    stats.frames++;
+    stats.last_frame_us = (uint32_t)spent;
+    if (spent > budget_us) {
+        stats.frames_over_budget++;
+        uint64_t over = spent - budget_us;
+        uint32_t bucket = 0;
+        while (bucket < HISTOGRAM_BUCKETS - 1 && over * 4 > budget_us * HISTOGRAM_QUARTERS[bucket]) {
+            bucket++;
+        }
+        stats.over_budget[bucket]++;
+    }
+
+    // Each queue starves on its own, one that is run every frame doesn't hold back the others
+    bool pending[MAX_QUEUES] = {};
+    for (const Entry& entry : entries) {
+        pending[entry.queue] = true;
+    }
+    for (uint32_t queue = 0; queue < MAX_QUEUES; queue++) {
+        if (pending[queue] && !sliced_this_frame[queue]) {
+            starved_frames[queue]++;
+        }
+        sliced_this_frame[queue] = false;
+    }
+}
+
+FrameScheduler::Stats FrameScheduler::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats result = stats;
+    result.pending_tasks = (uint32_t)entries.size();
+    return result;
+}
+
+void FrameScheduler::ResetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stats = {};
+}
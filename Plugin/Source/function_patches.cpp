@@ -15,10 +15,14 @@
 #include <whb/log.h>
 #include <RmlUi/Core.h>
 #include "RmlUi_Backend.h"
+#include "overlay_state.hpp"
+#include "profiler.hpp"
+#include "telemetry.hpp"
 
-// External context from main.cpp
-extern Rml::Context* g_RmlContext;
-extern bool g_RmlInitialized;
+#include <atomic>
+
+// External state from main.cpp
+extern std::atomic<bool> g_RmlInitialized;
 extern GX2ContextState* gOverlayContextState;
 
 namespace
@@ -26,6 +30,11 @@ namespace
     GX2ContextState* gOriginalContextState = nullptr;
     bool gOverlayContextInitialized = false;
     bool gFirstCopyCall = false;
+
+    // Game frame pacing for the stats panel, measured between the game's swaps
+    const uint32_t gGameFrameTimeField = Telemetry::Register("game_frame_ms", 0.5f, 500);
+    const uint32_t gGameFpsField = Telemetry::Register("game_fps", 1.0f, 500);
+    uint64_t gLastSwapTicks = 0;
 }
 
 // GX2SetContextState Hook
@@ -65,12 +74,16 @@ static void InitOverlayContext() {
 }
 
 DECL_FUNCTION(void, GX2CopyColorBufferToScanBuffer, const GX2ColorBuffer *colorBuffer, GX2ScanTarget scan_target) {
+    PROFILE_SCOPE("GX2CopyColorBufferToScanBuffer");
+
     if (!gFirstCopyCall) {
         gFirstCopyCall = true;
     }
     
-    // Draw our overlay before the copy happens
-    if (g_RmlInitialized && g_RmlContext) {
+    // Draw our overlay before the copy happens, each scan target shows the context of its screen
+    Backend::Screen screen = scan_target == GX2_SCAN_TARGET_TV ? Backend::Screen::TV : Backend::Screen::GamePad;
+    Rml::Context* context = g_RmlInitialized ? Backend::GetScreenContext(screen) : nullptr;
+    if (context) {
         // Initialize overlay context on first call
         if (!gOverlayContextInitialized) {
             InitOverlayContext();
@@ -78,29 +91,26 @@ DECL_FUNCTION(void, GX2CopyColorBufferToScanBuffer, const GX2ColorBuffer *colorB
 
         // Set our overlay context
         real_GX2SetContextState(gOverlayContextState);
+        Profiler::GpuBegin();
 
-        GX2SetDefaultState();
-
-        // Setup render target
-        GX2SetColorBuffer(colorBuffer, GX2_RENDER_TARGET_0);
-        GX2SetViewport(0.0f, 0.0f, colorBuffer->surface.width, colorBuffer->surface.height, 0.0f, 1.0f);
-        GX2SetScissor(0, 0, colorBuffer->surface.width, colorBuffer->surface.height);
-
-        // Setup blending/depth for overlay
-        GX2SetDepthOnlyControl(GX2_FALSE, GX2_FALSE, GX2_COMPARE_FUNC_NEVER);
-        GX2SetColorControl(GX2_LOGIC_OP_COPY, GX2_ENABLE, GX2_DISABLE, GX2_ENABLE);
-        // Enable alpha blending
-        GX2SetBlendControl(GX2_RENDER_TARGET_0, 
-                           GX2_BLEND_MODE_SRC_ALPHA, GX2_BLEND_MODE_INV_SRC_ALPHA, GX2_BLEND_COMBINE_MODE_ADD,
-                           TRUE,
-                           GX2_BLEND_MODE_SRC_ALPHA, GX2_BLEND_MODE_INV_SRC_ALPHA, GX2_BLEND_COMBINE_MODE_ADD);
+        // Default state, render target, viewport and the renderer's blend/depth/shader state from one display list
+        OverlayState::Apply(colorBuffer);
 
         // Render RmlUi
-        Backend::BeginFrame();
-        g_RmlContext->Update();
-        g_RmlContext->Render();
+        Backend::BeginFrame(screen, colorBuffer);
+        if (!Backend::ReplayFrame() && !Backend::RepeatFrame()) {
+            {
+                PROFILE_SCOPE("Context::Update");
+                context->Update();
+            }
+            {
+                PROFILE_SCOPE("Context::Render");
+                context->Render();
+            }
+        }
         Backend::PresentFrame();
 
+        Profiler::GpuEnd();
         GX2Flush();
 
         // Restore original context
@@ -119,6 +129,18 @@ DECL_FUNCTION(void, GX2SwapScanBuffers)
         first_call = false;
     }
     real_GX2SwapScanBuffers();
+
+    // One swap per presented frame, close the profiler frame and the overlay's frame budget here
+    Profiler::NextFrame();
+    Backend::NextFrame();
+
+    uint64_t now = Profiler::GetTicks();
+    if (gLastSwapTicks != 0 && now > gLastSwapTicks) {
+        float frame_ms = Profiler::TicksToMicroseconds(now - gLastSwapTicks) / 1000.0f;
+        Telemetry::Set(gGameFrameTimeField, frame_ms);
+        Telemetry::Set(gGameFpsField, 1000.0f / frame_ms);
+    }
+    gLastSwapTicks = now;
 }
 
 // GX2Init Hook
@@ -140,13 +162,21 @@ DECL_FUNCTION(int32_t, VPADRead, VPADChan chan, VPADStatus* buffers, uint32_t co
     VPADReadError real_error;
     int32_t result = real_VPADRead(chan, buffers, count, &real_error);
 
-    if (result > 0 && real_error == VPAD_READ_SUCCESS && g_RmlInitialized && g_RmlContext)
+    if (result > 0 && real_error == VPAD_READ_SUCCESS && chan == VPAD_CHAN_0 && g_RmlInitialized && Backend::GetInputContext())
     {
-        // Feed input to RmlUi
-        bool consumed = !Backend::ProcessEvents(g_RmlContext, nullptr, false); 
-        (void)consumed; 
-        
-        g_RmlContext->Update();
+        // Feed the game's samples to RmlUi instead of reading the GamePad a second time
+        Backend::SubmitGamepadSamples(buffers, (uint32_t)result);
+
+        // The UI thread consumes the samples itself
+        if (!Backend::IsUiThreadRunning()) {
+            bool consumed = !Backend::ProcessEvents(Backend::GetInputContext(), nullptr, true); 
+            (void)consumed; 
+            
+            // Nothing changed for a while, the present hook repeats the last frame
+            if (!Backend::IsIdle()) {
+                Backend::UpdateScreenContexts();
+            }
+        }
     }
 
     if (error)
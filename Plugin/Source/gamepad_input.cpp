@@ -0,0 +1,64 @@
+#include "gamepad_input.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+void GamepadInput::Submit(const VPADStatus* samples, uint32_t count)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    count = std::min(count, MAX_SAMPLES);
+    for (uint32_t i = count; i-- > 0;) {
+        if (queue_count == MAX_SAMPLES) {
+            std::memmove(&queue[0], &queue[1], sizeof(VPADStatus) * (MAX_SAMPLES - 1));
+            queue_count--;
+        }
+        queue[queue_count++] = samples[i];
+    }
+}
+
+uint32_t GamepadInput::Take(VPADStatus (&samples)[MAX_SAMPLES])
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t count = queue_count;
+    std::memcpy(samples, queue, sizeof(VPADStatus) * count);
+    queue_count = 0;
+    return count;
+}
+
+void GamepadInput::Process(const VPADStatus* samples, uint32_t count, const Handlers& handlers)
+{
+    const VPADTouchData* pending_move = nullptr;
+    for (uint32_t i = 0; i < count; i++) {
+        const VPADStatus& status = samples[i];
+        const VPADTouchData& raw_touch = status.tpNormal;
+        bool touched = raw_touch.touched != 0;
+
+        if (touched && raw_touch.validity == VPAD_VALID) {
+            pending_move = &raw_touch;
+        }
+
+        // Press and release land on the position of the latest touch before them
+        if (touched != was_touched) {
+            if (pending_move) {
+                handlers.move(handlers.user, *pending_move);
+                pending_move = nullptr;
+            }
+            handlers.touch(handlers.user, touched);
+            was_touched = touched;
+        }
+
+        handlers.buttons(handlers.user, status);
+    }
+    if (pending_move) {
+        handlers.move(handlers.user, *pending_move);
+    }
+}
+
+bool GamepadInput::HasInput(const VPADStatus* samples, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if (samples[i].trigger || samples[i].release || samples[i].tpNormal.touched)
+            return true;
+    }
+    return false;
+}
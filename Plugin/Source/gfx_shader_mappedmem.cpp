@@ -12,8 +12,8 @@
 #include <whb/gfx.h>
 #include <whb/log.h>
 
-// wums
-#include <memory/mappedmemory.h>
+#include "gx2_extra.hpp"
+#include "mapped_memory.hpp"
 
 GX2PixelShader* WHBGfxLoadGFDPixelShaderMappedMem(uint32_t index, const void *file)
 {
@@ -41,17 +41,17 @@ GX2PixelShader* WHBGfxLoadGFDPixelShaderMappedMem(uint32_t index, const void *fi
       goto error;
    }
 
-   shader = (GX2PixelShader *)MEMAllocFromMappedMemoryEx(headerSize, 64);
+   shader = (GX2PixelShader *)MappedMemory::AllocCpu(MappedMemory::Tag::Shader, headerSize, 64, "pixel shader header");
    if (!shader)
    {
-      WHBLogPrintf("%s: MEMAllocFromMappedMemoryEx(%u, 64) failed", __FUNCTION__, headerSize);
+      WHBLogPrintf("%s: MappedMemory::AllocCpu(%u, 64) failed", __FUNCTION__, headerSize);
       goto error;
    }
 
-   program = MEMAllocFromMappedMemoryForGX2Ex(programSize, GX2_SHADER_PROGRAM_ALIGNMENT);
+   program = MappedMemory::Alloc(MappedMemory::Tag::Shader, programSize, GX2_SHADER_PROGRAM_ALIGNMENT, "pixel shader program");
    if (!program)
    {
-      WHBLogPrintf("%s: MEMAllocFromMappedMemoryForGX2Ex failed", __FUNCTION__);
+      WHBLogPrintf("%s: MappedMemory::Alloc failed", __FUNCTION__);
       goto error;
    }
 
@@ -65,7 +65,7 @@ GX2PixelShader* WHBGfxLoadGFDPixelShaderMappedMem(uint32_t index, const void *fi
    shader->program = program;
    shader->size = programSize;
 
-   GX2Invalidate(GX2_INVALIDATE_MODE_CPU_SHADER, shader->program, shader->size);
+   GX2InvalidateDeferrable(GX2_INVALIDATE_MODE_CPU_SHADER, shader->program, shader->size);
    return shader;
 
 error:
@@ -73,10 +73,10 @@ error:
    {
       if (shader->program)
       {
-         MEMFreeToMappedMemory(shader->program);
+         MappedMemory::Free(shader->program);
       }
 
-      MEMFreeToMappedMemory(shader);
+      MappedMemory::Free(shader);
    }
 
    return NULL;
@@ -86,10 +86,10 @@ BOOL WHBGfxFreePixelShaderMappedMem(GX2PixelShader *shader)
 {
    if (shader->program)
    {
-      MEMFreeToMappedMemory(shader->program);
+      MappedMemory::Free(shader->program);
    }
 
-   MEMFreeToMappedMemory(shader);
+   MappedMemory::Free(shader);
    return TRUE;
 }
 
@@ -119,17 +119,17 @@ GX2VertexShader* WHBGfxLoadGFDVertexShaderMappedMem(uint32_t index, const void *
       goto error;
    }
 
-   shader = (GX2VertexShader *)MEMAllocFromMappedMemoryEx(headerSize, 64);
+   shader = (GX2VertexShader *)MappedMemory::AllocCpu(MappedMemory::Tag::Shader, headerSize, 64, "vertex shader header");
    if (!shader)
    {
-      WHBLogPrintf("%s: MEMAllocFromMappedMemoryEx(%u, 64) failed", __FUNCTION__, headerSize);
+      WHBLogPrintf("%s: MappedMemory::AllocCpu(%u, 64) failed", __FUNCTION__, headerSize);
       goto error;
    }
 
-   program = MEMAllocFromMappedMemoryForGX2Ex(programSize, GX2_SHADER_PROGRAM_ALIGNMENT);
+   program = MappedMemory::Alloc(MappedMemory::Tag::Shader, programSize, GX2_SHADER_PROGRAM_ALIGNMENT, "vertex shader program");
    if (!program)
    {
-      WHBLogPrintf("%s: MEMAllocFromMappedMemoryForGX2Ex failed", __FUNCTION__);
+      WHBLogPrintf("%s: MappedMemory::Alloc failed", __FUNCTION__);
       goto error;
    }
 
@@ -143,7 +143,7 @@ GX2VertexShader* WHBGfxLoadGFDVertexShaderMappedMem(uint32_t index, const void *
    shader->program = program;
    shader->size = programSize;
 
-   GX2Invalidate(GX2_INVALIDATE_MODE_CPU_SHADER, shader->program, shader->size);
+   GX2InvalidateDeferrable(GX2_INVALIDATE_MODE_CPU_SHADER, shader->program, shader->size);
    return shader;
 
 error:
@@ -151,10 +151,10 @@ error:
    {
       if (shader->program)
       {
-         MEMFreeToMappedMemory(shader->program);
+         MappedMemory::Free(shader->program);
       }
 
-      MEMFreeToMappedMemory(shader);
+      MappedMemory::Free(shader);
    }
 
    return NULL;
@@ -164,10 +164,10 @@ BOOL WHBGfxFreeVertexShaderMappedMem(GX2VertexShader *shader)
 {
    if (shader->program)
    {
-      MEMFreeToMappedMemory(shader->program);
+      MappedMemory::Free(shader->program);
    }
 
-   MEMFreeToMappedMemory(shader);
+   MappedMemory::Free(shader);
    return TRUE;
 }
 
@@ -196,7 +196,12 @@ BOOL WHBGfxInitFetchShaderMappedMem(WHBGfxShaderGroup *group)
       GX2_FETCH_SHADER_TESSELLATION_NONE,
       GX2_TESSELLATION_MODE_DISCRETE
    );
-   group->fetchShaderProgram = MEMAllocFromMappedMemoryForGX2Ex(size, GX2_SHADER_PROGRAM_ALIGNMENT);
+   group->fetchShaderProgram = MappedMemory::Alloc(MappedMemory::Tag::FetchShader, size, GX2_SHADER_PROGRAM_ALIGNMENT);
+   if (!group->fetchShaderProgram)
+   {
+      WHBLogPrintf("%s: MappedMemory::Alloc(%u) failed", __FUNCTION__, size);
+      return FALSE;
+   }
 
    GX2InitFetchShaderEx
    (
@@ -208,7 +213,7 @@ BOOL WHBGfxInitFetchShaderMappedMem(WHBGfxShaderGroup *group)
       GX2_TESSELLATION_MODE_DISCRETE
    );
 
-   GX2Invalidate(GX2_INVALIDATE_MODE_CPU_SHADER, group->fetchShaderProgram, size);
+   GX2InvalidateDeferrable(GX2_INVALIDATE_MODE_CPU_SHADER, group->fetchShaderProgram, size);
    return TRUE;
 }
 
@@ -216,7 +221,7 @@ BOOL WHBGfxFreeShaderGroupMappedMem(WHBGfxShaderGroup *group)
 {
    if (group->fetchShaderProgram)
    {
-      MEMFreeToMappedMemory(group->fetchShaderProgram);
+      MappedMemory::Free(group->fetchShaderProgram);
       group->fetchShaderProgram = NULL;
    }
 
@@ -11,6 +11,7 @@
 #include <whb/gfx.h>
 
 #include "gfx_shader_mappedmem.h"
+#include "mapped_memory.hpp"
 
 WHBGfxShaderGroup* WHBGfxCreateShaderGroup(unsigned char* shaderData)
 {
@@ -58,11 +59,27 @@ void GX2InitUniformBuffer(GX2RBuffer* buffer, size_t size, uint32_t count)
     GX2R_RESOURCE_USAGE_CPU_WRITE | GX2R_RESOURCE_USAGE_GPU_READ;
     buffer->elemSize = size;
     buffer->elemCount = count;
-    GX2RCreateBuffer(buffer);
+    // The GX2R allocator belongs to the game, the memory comes from the plugin heap like every other GPU resource
+    uint32_t bytes = GX2RGetBufferAllocationSize(buffer);
+    void* memory = MappedMemory::Alloc(MappedMemory::Tag::UniformBuffer, bytes, GX2RGetBufferAlignment(buffer->flags), "uniform block");
+    if (!memory) {
+        buffer->buffer = nullptr;
+        return;
+    }
+    GX2RCreateBufferUserMemory(buffer, memory, bytes);
 
     void* lockedBuffer = GX2RLockBufferEx(buffer, GX2R_RESOURCE_BIND_UNIFORM_BLOCK);
-    GX2Invalidate(GX2_INVALIDATE_MODE_CPU | GX2_INVALIDATE_MODE_UNIFORM_BLOCK, lockedBuffer, buffer->elemSize * buffer->elemCount);
-    GX2RUnlockBufferEx(buffer, GX2R_RESOURCE_BIND_UNIFORM_BLOCK);
+    GX2InvalidateDeferrable(GX2_INVALIDATE_MODE_CPU | GX2_INVALIDATE_MODE_UNIFORM_BLOCK, lockedBuffer, buffer->elemSize * buffer->elemCount);
+    // The invalidation above already covers the buffer
+    GX2RUnlockBufferEx(buffer, GX2R_RESOURCE_BIND_UNIFORM_BLOCK | GX2R_RESOURCE_DISABLE_CPU_INVALIDATE | GX2R_RESOURCE_DISABLE_GPU_INVALIDATE);
+}
+
+void GX2DestroyUniformBuffer(GX2RBuffer* buffer)
+{
+    void* memory = buffer->buffer;
+    GX2RDestroyBufferEx(buffer, GX2R_RESOURCE_BIND_NONE);
+    MappedMemory::Free(memory);
+    buffer->buffer = nullptr;
 }
 
 void GX2SetShaderGroup(WHBGfxShaderGroup* shaderGroup)
@@ -94,6 +111,10 @@ void SwapMemcpy(void* dst, const void* src, size_t size)
 
 void GX2RSetVertexUniformBlockEx(WHBGfxShaderGroup* shaderGroup, GX2RBuffer* buffer, void* data, size_t size, std::string name)
 {
+    // Never created, mapped memory ran out
+    if (!buffer->buffer)
+        return;
+
     void* lockedBuffer = GX2RLockBufferEx(buffer, GX2R_RESOURCE_BIND_UNIFORM_BLOCK);
     GX2Invalidate(GX2_INVALIDATE_MODE_CPU | GX2_INVALIDATE_MODE_UNIFORM_BLOCK, lockedBuffer, buffer->elemSize * buffer->elemCount);
     SwapMemcpy(lockedBuffer, data, size);
@@ -103,8 +124,22 @@ void GX2RSetVertexUniformBlockEx(WHBGfxShaderGroup* shaderGroup, GX2RBuffer* buf
     GX2RSetVertexUniformBlock(const_cast<GX2RBuffer *>(buffer), location, 0);
 }
 
+void GX2RUpdateUniformBlock(GX2RBuffer* buffer, const void* data, size_t size)
+{
+    if (!buffer->buffer)
+        return;
+
+    void* lockedBuffer = GX2RLockBufferEx(buffer, GX2R_RESOURCE_BIND_UNIFORM_BLOCK);
+    GX2Invalidate(GX2_INVALIDATE_MODE_CPU | GX2_INVALIDATE_MODE_UNIFORM_BLOCK, lockedBuffer, buffer->elemSize * buffer->elemCount);
+    SwapMemcpy(lockedBuffer, data, size);
+    GX2RUnlockBufferEx(buffer, GX2R_RESOURCE_BIND_UNIFORM_BLOCK);
+}
+
 void GX2RSetPixelUniformBlockEx(WHBGfxShaderGroup* shaderGroup, GX2RBuffer* buffer, void* data, size_t size, std::string name)
 {
+    if (!buffer->buffer)
+        return;
+
     void* lockedBuffer = GX2RLockBufferEx(buffer, GX2R_RESOURCE_BIND_UNIFORM_BLOCK);
     GX2Invalidate(GX2_INVALIDATE_MODE_CPU | GX2_INVALIDATE_MODE_UNIFORM_BLOCK, lockedBuffer, buffer->elemSize * buffer->elemCount);
     SwapMemcpy(lockedBuffer, data, size);
@@ -113,3 +148,42 @@ void GX2RSetPixelUniformBlockEx(WHBGfxShaderGroup* shaderGroup, GX2RBuffer* buff
     int32_t location = GX2GetUniformBlockLocation(shaderGroup->pixelShader, name.c_str());
     GX2RSetPixelUniformBlock(const_cast<GX2RBuffer *>(buffer), location, 0);
 }
+
+namespace
+{
+    bool invalidations_deferred = false;
+    uint32_t deferred_invalidate_mode = 0;
+}
+
+void GX2InvalidateDeferrable(GX2InvalidateMode mode, void* buffer, uint32_t size)
+{
+    if (!invalidations_deferred) {
+        GX2Invalidate(mode, buffer, size);
+        return;
+    }
+
+    // A CPU-only invalidation is a cache flush and writes no commands
+    if (mode & GX2_INVALIDATE_MODE_CPU) {
+        GX2Invalidate(GX2_INVALIDATE_MODE_CPU, buffer, size);
+    }
+    deferred_invalidate_mode |= mode & ~GX2_INVALIDATE_MODE_CPU;
+}
+
+void GX2BeginDeferredInvalidations()
+{
+    invalidations_deferred = true;
+}
+
+void GX2EndDeferredInvalidations()
+{
+    invalidations_deferred = false;
+}
+
+void GX2FlushDeferredInvalidations()
+{
+    if (!deferred_invalidate_mode)
+        return;
+
+    GX2Invalidate((GX2InvalidateMode)deferred_invalidate_mode, nullptr, 0xFFFFFFFF);
+    deferred_invalidate_mode = 0;
+}
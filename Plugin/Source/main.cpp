@@ -1,5 +1,4 @@
 #include <wups.h>
-#include <memory/mappedmemory.h>
 #include <coreinit/thread.h>
 #include <coreinit/time.h>
 
@@ -11,6 +10,15 @@
 #include <RmlUi/Core.h>
 #include "RmlUi_Backend.h"
 #include "RmlUi_File_WiiU.h"
+#include "RmlUi_FontEngine_SDF.h"
+#include "RmlUi_Image_TGA.h"
+#include "mapped_memory.hpp"
+#include "overlay_state.hpp"
+#include "profiler.hpp"
+#include "startup.hpp"
+#include "telemetry.hpp"
+
+#include <atomic>
 
 WUPS_PLUGIN_NAME("RmlUI Example");
 WUPS_PLUGIN_DESCRIPTION("Overlay Plugin");
@@ -22,18 +30,25 @@ WUPS_USE_WUT_DEVOPTAB();
 WUPS_USE_STORAGE("RmlUI");
 
 // Globals for function_patches.cpp
-Rml::Context* g_RmlContext = nullptr;
-bool g_RmlInitialized = false;
+std::atomic<bool> g_RmlInitialized{ false };
 GX2ContextState* gOverlayContextState = nullptr;
 
+#ifdef RMLUI_WARM_START
+// Set once RmlUi is initialized. RmlUi, the contexts, documents and fonts then outlive the application, the next one
+// only creates the GPU resources again.
+static bool g_RmlWarm = false;
+#endif
+
 INITIALIZE_PLUGIN()
 {
     // Allocate overlay context state early
-    // Use MEMAllocFromMappedMemoryForGX2Ex as suggested by reference
-    gOverlayContextState = (GX2ContextState *)MEMAllocFromMappedMemoryForGX2Ex
+    // Mapped memory for GX2 as suggested by reference, it lives as long as the plugin
+    gOverlayContextState = (GX2ContextState *)MappedMemory::Alloc
     (
+        MappedMemory::Tag::ContextState,
         sizeof(GX2ContextState),
-        GX2_CONTEXT_STATE_ALIGNMENT
+        GX2_CONTEXT_STATE_ALIGNMENT,
+        "overlay context state"
     );
 
     if (gOverlayContextState == nullptr)
@@ -45,50 +60,116 @@ INITIALIZE_PLUGIN()
     }
 }
 
-ON_APPLICATION_START()
+// Last part of every startup, cold or warm
+static void StartOverlay(const char* kind)
 {
-    WHBLogUdpInit();
-    WHBLogPrintf("Initializing RmlUi Plugin...");
+    // Shaders, uniform buffers and the default texture, the first frame would otherwise stall on them
+    Startup::BeginPhase("gpu resources");
+    Backend::PrepareRendererAsync();
+
+#ifdef RMLUI_UI_THREAD
+    // Update and record on a dedicated core, the hooks only submit input and replay
+    Startup::BeginPhase("ui thread");
+    if (!Backend::StartUiThread()) {
+        WHBLogPrintf("UI thread not available, updating on the game thread");
+    }
+#endif
+
+    Startup::LogPhases(kind);
+    Startup::AppendPhases("fs:/vol/external01/wiiu/plugins/RmlUI/startup.jsonl", kind);
+    g_RmlInitialized.store(true, std::memory_order_release);
+    WHBLogPrintf("RmlUi Initialized (%s start)", kind);
+}
+
+// Runs on the startup thread, the hooks leave the overlay alone until it sets g_RmlInitialized
+static bool InitializeOverlay()
+{
+#ifdef RMLUI_WARM_START
+    if (g_RmlWarm) {
+        // Textures are loaded again from the decoded images on their first draw
+        StartOverlay("warm");
+        const TGA::CacheStats image_stats = TGA::GetCacheStats();
+        WHBLogPrintf("Images: %u kept, %u KiB", image_stats.images, image_stats.bytes / 1024);
+        return true;
+    }
+#endif
+
+    Startup::BeginPhase("backend");
 
     // Initialize Backend (System, Render Interface, Window)
     // Wii U GamePad resolution is 854x480, but we render at 1280x720 and scale down usually.
     if (!Backend::Initialize("RmlUi Example", 1280, 720, true)) {
         WHBLogPrintf("Backend::Initialize failed");
-        return;
+        return false;
     }
 
+    Profiler::Initialize();
+#ifdef RMLUI_FRAME_BUDGET_US
+    Backend::SetFrameBudget(RMLUI_FRAME_BUDGET_US);
+#endif
+
     // Set RmlUi interfaces
     static FileInterface_WiiU file_interface;
     Rml::SetFileInterface(&file_interface);
     Rml::SetSystemInterface(Backend::GetSystemInterface());
     Rml::SetRenderInterface(Backend::GetRenderInterface());
+#ifdef RMLUI_SDF_FONTS
+    // One distance field atlas for every font size instead of an RGBA atlas per size
+    static FontEngineInterface_SDF font_engine;
+    font_engine.SetCacheDirectory("fs:/vol/external01/wiiu/plugins/RmlUI/cache");
+    Rml::SetFontEngineInterface(&font_engine);
+#endif
 
     // Initialize RmlUi
+    Startup::BeginPhase("rmlui");
     Rml::Initialise();
+#ifdef RMLUI_WARM_START
+    // The textures are released with the application's GX2, loading them again should not have to read and decode them
+    TGA::KeepDecoded(true);
+#endif
 
-    // Create a context
-    g_RmlContext = Rml::CreateContext("main", Rml::Vector2i(1280, 720));
-    if (!g_RmlContext) {
+    // One context per screen, sharing all textures and fonts through the render interface.
+    // The GamePad layout keeps dp sizes proportional to the TV one on its 854x480 panel.
+    Startup::BeginPhase("contexts");
+    Rml::Context* tv_context = Rml::CreateContext("tv", Rml::Vector2i(1280, 720));
+    if (!tv_context) {
         WHBLogPrintf("Rml::CreateContext failed");
         Rml::Shutdown();
         Backend::Shutdown();
-        return;
+        return false;
+    }
+    Backend::SetScreenContext(Backend::Screen::TV, tv_context);
+
+    Rml::Context* gamepad_context = Rml::CreateContext("gamepad", Rml::Vector2i(854, 480));
+    if (gamepad_context) {
+        gamepad_context->SetDensityIndependentPixelRatio(854.0f / 1280.0f);
+        Backend::SetScreenContext(Backend::Screen::GamePad, gamepad_context);
+    } else {
+        WHBLogPrintf("GamePad context not available, showing the TV one only");
     }
 
     // Load fonts
+    Startup::BeginPhase("fonts");
     // You need to put a font file at this path!
+#ifdef RMLUI_SDF_FONTS
+    // Read when the first document asks for it, a missing file is reported then
+    font_engine.RegisterFontFace("fs:/vol/external01/wiiu/plugins/RmlUI/fonts/Lato-Regular.ttf", "Lato",
+        Rml::Style::FontStyle::Normal, Rml::Style::FontWeight::Normal);
+#else
     if (!Rml::LoadFontFace("fs:/vol/external01/wiiu/plugins/RmlUI/fonts/Lato-Regular.ttf")) {
         WHBLogPrintf("Failed to load font: fs:/vol/external01/wiiu/plugins/RmlUI/fonts/Lato-Regular.ttf");
     } else {
         WHBLogPrintf("Font loaded successfully");
     }
+#endif
 
     // Load the Demo document
+    Startup::BeginPhase("documents");
     // Using absolute path on SD card for safety
     const char* docPath = "fs:/vol/external01/wiiu/plugins/RmlUI/demo.rml";
     WHBLogPrintf("Loading document from: %s", docPath);
     
-    Rml::ElementDocument* document = g_RmlContext->LoadDocument(docPath);
+    Rml::ElementDocument* document = tv_context->LoadDocument(docPath);
     if (document) {
         document->Show();
         WHBLogPrintf("Document loaded successfully");
@@ -112,7 +193,7 @@ ON_APPLICATION_START()
         }
         
         // Check context dimensions
-        auto ctx_dims = g_RmlContext->GetDimensions();
+        auto ctx_dims = tv_context->GetDimensions();
         WHBLogPrintf("Context dimensions: %dx%d", ctx_dims.x, ctx_dims.y);
         
         // Check document dimensions
@@ -122,19 +203,108 @@ ON_APPLICATION_START()
         WHBLogPrintf("Document load failed");
     }
 
-    g_RmlInitialized = true;
-    WHBLogPrintf("RmlUi Initialized");
+    if (gamepad_context) {
+        if (Rml::ElementDocument* gamepad_document = gamepad_context->LoadDocument(docPath)) {
+            gamepad_document->Show();
+        } else {
+            WHBLogPrintf("GamePad document load failed");
+        }
+    }
+
+    // Profiler HUD, hidden until toggled with ZL + PLUS
+    Startup::BeginPhase("panels");
+    if (!Profiler::LoadHud(tv_context, "fs:/vol/external01/wiiu/plugins/RmlUI/profiler.rml")) {
+        WHBLogPrintf("Profiler HUD not available");
+    }
+
+    // Game values published by the hooks, the stats panel shows them
+    if (!Telemetry::CreateModel(tv_context)) {
+        WHBLogPrintf("Telemetry data model not available");
+    }
+
+    // Renderer stats panel, hidden until toggled with ZL + X
+    if (!Backend::LoadStatsPanel(tv_context, "fs:/vol/external01/wiiu/plugins/RmlUI/stats.rml")) {
+        WHBLogPrintf("Stats panel not available");
+    }
+
+#ifdef RMLUI_SDF_FONTS
+    // Faces no document has asked for yet are not counted, they load on the first layout that needs them
+    const FontEngineInterface_SDF::Stats font_stats = font_engine.GetStats();
+    WHBLogPrintf("Fonts: %u of %u faces loaded in %.1f ms (%u from the cache), %u KiB font data, %u KiB atlas",
+        font_stats.loaded_faces, font_stats.registered_faces, font_stats.load_time_ms, font_stats.cache_hits,
+        font_stats.font_data_bytes / 1024, font_stats.atlas_bytes / 1024);
+#endif
+
+    StartOverlay("cold");
+#ifdef RMLUI_WARM_START
+    g_RmlWarm = true;
+#endif
+    return true;
+}
+
+static void ShutdownOverlay()
+{
+    Backend::StopUiThread();
+    Profiler::UnloadHud();
+    Telemetry::ReleaseModel();
+    Rml::Shutdown();
+    Backend::Shutdown();
+    OverlayState::Release();
+    Profiler::Shutdown();
+    TGA::KeepDecoded(false);
+}
+
+ON_APPLICATION_START()
+{
+    WHBLogUdpInit();
+    WHBLogPrintf("Initializing RmlUi Plugin...");
+
+    // Loading documents, fonts and shaders takes a while, the game starts in the meantime
+    if (!Startup::Start(InitializeOverlay)) {
+        WHBLogPrintf("Startup thread not available, initializing on the game thread");
+        InitializeOverlay();
+    }
 }
 
 ON_APPLICATION_REQUESTS_EXIT()
 {
     WHBLogPrintf("Shutting down RmlUi Plugin...");
     
+    // A startup that is still running sets the flag when it's done
+    Startup::Wait();
     g_RmlInitialized = false;
 
+#ifdef RMLUI_WARM_START
+    if (g_RmlWarm) {
+        // Only what lives in the application's GX2 goes, the rest waits for the next application
+        Backend::Suspend();
+        OverlayState::Release();
+
+        // The profiler keeps its timestamp memory along with the HUD
+        MappedMemory::ReportLeaks(MappedMemory::TagBit(MappedMemory::Tag::ContextState) |
+            MappedMemory::TagBit(MappedMemory::Tag::Profiler));
+
+        WHBLogUdpDeinit();
+        return;
+    }
+#endif
+
     // Shutdown
-    Rml::Shutdown();
-    Backend::Shutdown();
+    ShutdownOverlay();
+
+    // Everything but the context state allocated in INITIALIZE_PLUGIN should be gone by now
+    MappedMemory::ReportLeaks(MappedMemory::TagBit(MappedMemory::Tag::ContextState));
 
     WHBLogUdpDeinit();
 }
+
+DEINITIALIZE_PLUGIN()
+{
+#ifdef RMLUI_WARM_START
+    // Suspended by the last application, its GPU resources are already gone
+    if (g_RmlWarm) {
+        ShutdownOverlay();
+        g_RmlWarm = false;
+    }
+#endif
+}
@@ -0,0 +1,277 @@
+#include "mapped_memory.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __WIIU__
+#include <memory/mappedmemory.h>
+#include <whb/log.h>
+#else
+#define WHBLogPrintf(...) (std::fprintf(stderr, __VA_ARGS__), std::fputc('\n', stderr))
+#endif
+
+namespace
+{
+    struct Record
+    {
+        uint32_t size;
+        MappedMemory::Tag tag;
+        // Allocation order, tells apart records of the same size in dumps
+        uint32_t serial;
+        char source[MappedMemory::MAX_SOURCE_LENGTH + 1];
+    };
+
+    struct LiveAllocation
+    {
+        const void* memory;
+        Record record;
+    };
+
+    const char* const TAG_NAMES[MappedMemory::TAG_COUNT] = {
+        "Geometry",
+        "Texture",
+        "RenderTarget",
+        "Shader",
+        "FetchShader",
+        "ContextState",
+        "DisplayList",
+        "UniformBuffer",
+        "Profiler",
+        "Other",
+    };
+
+    std::mutex mutex;
+    std::unordered_map<const void*, Record> records;
+    MappedMemory::TagStats tag_stats[MappedMemory::TAG_COUNT];
+    uint32_t live_bytes = 0;
+    uint32_t high_water_bytes = 0;
+    uint32_t next_serial = 0;
+
+    void CopySource(char* destination, const char* source)
+    {
+        if (!source) {
+            destination[0] = '\0';
+            return;
+        }
+        size_t length = std::strlen(source);
+        if (length > MappedMemory::MAX_SOURCE_LENGTH) {
+            source += length - MappedMemory::MAX_SOURCE_LENGTH;
+            length = MappedMemory::MAX_SOURCE_LENGTH;
+        }
+        std::memcpy(destination, source, length);
+        destination[length] = '\0';
+    }
+
+    void* HeapAlloc(bool gpu, uint32_t size, uint32_t alignment)
+    {
+#ifdef __WIIU__
+        return gpu ? MEMAllocFromMappedMemoryForGX2Ex(size, alignment) : MEMAllocFromMappedMemoryEx(size, alignment);
+#else
+        (void)gpu;
+        alignment = std::max<uint32_t>(alignment, sizeof(void*));
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+    }
+
+    void HeapFree(void* memory)
+    {
+#ifdef __WIIU__
+        MEMFreeToMappedMemory(memory);
+#else
+        std::free(memory);
+#endif
+    }
+
+    void* TrackedAlloc(bool gpu, MappedMemory::Tag tag, uint32_t size, uint32_t alignment, const char* source)
+    {
+        if ((uint32_t)tag >= MappedMemory::TAG_COUNT) {
+            tag = MappedMemory::Tag::Other;
+        }
+
+        void* memory = HeapAlloc(gpu, size, alignment);
+
+        MappedMemory::TagStats stats_copy;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            MappedMemory::TagStats& stats = tag_stats[(uint32_t)tag];
+            if (!memory) {
+                stats.failed_allocs++;
+                stats_copy = stats;
+            } else {
+                Record& record = records[memory];
+                record.size = size;
+                record.tag = tag;
+                record.serial = next_serial++;
+                CopySource(record.source, source);
+
+                stats.live_bytes += size;
+                stats.live_count++;
+                stats.total_allocs++;
+                stats.peak_bytes = std::max(stats.peak_bytes, stats.live_bytes);
+                stats.high_water_bytes = std::max(stats.high_water_bytes, stats.live_bytes);
+                live_bytes += size;
+                high_water_bytes = std::max(high_water_bytes, live_bytes);
+                return memory;
+            }
+        }
+
+        // Running out is usually the game's doing, say how much of the heap is ours
+        WHBLogPrintf("MappedMemory: Failed to allocate %u bytes (%s%s%s), %u bytes live, %u of them %s",
+            size, MappedMemory::TagName(tag), source ? " " : "", source ? source : "", MappedMemory::GetLiveBytes(),
+            stats_copy.live_bytes, MappedMemory::TagName(tag));
+        return nullptr;
+    }
+
+    std::vector<LiveAllocation> CollectLive(uint32_t excluded_tag_mask)
+    {
+        std::vector<LiveAllocation> live;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            live.reserve(records.size());
+            for (const auto& entry : records) {
+                if (!(excluded_tag_mask & MappedMemory::TagBit(entry.second.tag))) {
+                    live.push_back({ entry.first, entry.second });
+                }
+            }
+        }
+        std::sort(live.begin(), live.end(), [](const LiveAllocation& a, const LiveAllocation& b) {
+            return a.record.size != b.record.size ? a.record.size > b.record.size : a.record.serial < b.record.serial;
+        });
+        return live;
+    }
+
+    void LogAllocation(const LiveAllocation& allocation)
+    {
+        WHBLogPrintf("  %p %8u B  %-12s #%u %s", allocation.memory, allocation.record.size,
+            MappedMemory::TagName(allocation.record.tag), allocation.record.serial, allocation.record.source);
+    }
+}
+
+namespace MappedMemory
+{
+
+const char* TagName(Tag tag)
+{
+    return (uint32_t)tag < TAG_COUNT ? TAG_NAMES[(uint32_t)tag] : "Unknown";
+}
+
+void* Alloc(Tag tag, uint32_t size, uint32_t alignment, const char* source)
+{
+    return TrackedAlloc(true, tag, size, alignment, source);
+}
+
+void* AllocCpu(Tag tag, uint32_t size, uint32_t alignment, const char* source)
+{
+    return TrackedAlloc(false, tag, size, alignment, source);
+}
+
+void Free(void* memory)
+{
+    if (!memory)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = records.find(memory);
+        if (it != records.end()) {
+            TagStats& stats = tag_stats[(uint32_t)it->second.tag];
+            stats.live_bytes -= it->second.size;
+            stats.live_count--;
+            live_bytes -= it->second.size;
+            records.erase(it);
+        } else {
+            // Still freed, it came from the heap some other way
+            WHBLogPrintf("MappedMemory: Freeing untracked allocation %p", memory);
+        }
+    }
+    HeapFree(memory);
+}
+
+void SetSource(void* memory, const char* source)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = records.find(memory);
+    if (it != records.end()) {
+        CopySource(it->second.source, source);
+    }
+}
+
+TagStats GetTagStats(Tag tag)
+{
+    if ((uint32_t)tag >= TAG_COUNT)
+        return TagStats();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return tag_stats[(uint32_t)tag];
+}
+
+uint32_t GetLiveBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return live_bytes;
+}
+
+uint32_t GetHighWaterBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return high_water_bytes;
+}
+
+void ResetPeaks()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (TagStats& stats : tag_stats) {
+        stats.peak_bytes = stats.live_bytes;
+    }
+}
+
+void DumpLive()
+{
+    TagStats stats[TAG_COUNT];
+    uint32_t total = 0;
+    uint32_t high_water = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::copy(std::begin(tag_stats), std::end(tag_stats), stats);
+        total = live_bytes;
+        high_water = high_water_bytes;
+    }
+
+    WHBLogPrintf("MappedMemory: %u bytes live, high-water %u bytes", total, high_water);
+    for (uint32_t i = 0; i < TAG_COUNT; i++) {
+        if (stats[i].total_allocs == 0 && stats[i].failed_allocs == 0)
+            continue;
+        WHBLogPrintf("  %-12s live %u B in %u, peak %u B, high-water %u B, %u allocs, %u failed", TAG_NAMES[i],
+            stats[i].live_bytes, stats[i].live_count, stats[i].peak_bytes, stats[i].high_water_bytes,
+            stats[i].total_allocs, stats[i].failed_allocs);
+    }
+    for (const LiveAllocation& allocation : CollectLive(0)) {
+        LogAllocation(allocation);
+    }
+}
+
+uint32_t ReportLeaks(uint32_t expected_tag_mask)
+{
+    std::vector<LiveAllocation> leaked = CollectLive(expected_tag_mask);
+    if (leaked.empty()) {
+        WHBLogPrintf("MappedMemory: No leaks");
+        return 0;
+    }
+
+    uint32_t bytes = 0;
+    for (const LiveAllocation& allocation : leaked) {
+        bytes += allocation.record.size;
+    }
+    WHBLogPrintf("MappedMemory: %u allocations (%u bytes) leaked", (uint32_t)leaked.size(), bytes);
+    for (const LiveAllocation& allocation : leaked) {
+        LogAllocation(allocation);
+    }
+    return (uint32_t)leaked.size();
+}
+
+} // namespace MappedMemory
@@ -0,0 +1,143 @@
+#include "overlay_state.hpp"
+
+#include <cstring>
+
+#include <gx2/display_list.h>
+#include <gx2/enum.h>
+#include <gx2/mem.h>
+#include <gx2/registers.h>
+#include <gx2/state.h>
+#include <whb/log.h>
+
+#include "RmlUi_Backend.h"
+#include "mapped_memory.hpp"
+#include "profiler.hpp"
+
+namespace
+{
+    struct Target
+    {
+        // Key, the color buffer struct is usually static but its image can be swapped
+        const GX2ColorBuffer* color_buffer;
+        void* image;
+        uint32_t width;
+        uint32_t height;
+        GX2SurfaceFormat format;
+        GX2AAMode aa;
+
+        void* display_list;
+        uint32_t display_list_size;
+        uint32_t last_used;
+    };
+
+    Target targets[OverlayState::MAX_TARGETS] = {};
+    uint32_t use_counter = 0;
+
+    bool Matches(const Target& target, const GX2ColorBuffer* color_buffer)
+    {
+        return target.display_list_size != 0 && target.color_buffer == color_buffer && target.image == color_buffer->surface.image &&
+               target.width == color_buffer->surface.width && target.height == color_buffer->surface.height &&
+               target.format == color_buffer->surface.format && target.aa == color_buffer->surface.aa;
+    }
+
+    void SetupState(const GX2ColorBuffer* color_buffer)
+    {
+        GX2SetDefaultState();
+
+        // Setup render target
+        GX2SetColorBuffer(color_buffer, GX2_RENDER_TARGET_0);
+        GX2SetViewport(0.0f, 0.0f, color_buffer->surface.width, color_buffer->surface.height, 0.0f, 1.0f);
+        GX2SetScissor(0, 0, color_buffer->surface.width, color_buffer->surface.height);
+
+        // Blending, depth, culling and shaders of the renderer
+        Backend::ApplyPipelineState();
+    }
+
+    // Least recently used slot, or a free one
+    Target& EvictTarget()
+    {
+        Target* oldest = &targets[0];
+        for (Target& target : targets) {
+            if (target.display_list_size == 0)
+                return target;
+            if (target.last_used < oldest->last_used)
+                oldest = &target;
+        }
+        return *oldest;
+    }
+
+    bool Record(Target& target, const GX2ColorBuffer* color_buffer)
+    {
+        if (!target.display_list) {
+            target.display_list = MappedMemory::Alloc(MappedMemory::Tag::DisplayList, OverlayState::DISPLAY_LIST_SIZE, GX2_DISPLAY_LIST_ALIGNMENT);
+            if (!target.display_list) {
+                WHBLogPrintf("OverlayState: Failed to allocate a display list");
+                return false;
+            }
+        }
+
+        // Shader and texture uploads must not end up in the list
+        Backend::PrepareRenderer();
+
+        GX2BeginDisplayList(target.display_list, OverlayState::DISPLAY_LIST_SIZE);
+        SetupState(color_buffer);
+        target.display_list_size = GX2EndDisplayList(target.display_list);
+        if (target.display_list_size == 0) {
+            WHBLogPrintf("OverlayState: Display list recording failed");
+            return false;
+        }
+        GX2Invalidate(GX2_INVALIDATE_MODE_CPU, target.display_list, target.display_list_size);
+
+        target.color_buffer = color_buffer;
+        target.image = color_buffer->surface.image;
+        target.width = color_buffer->surface.width;
+        target.height = color_buffer->surface.height;
+        target.format = color_buffer->surface.format;
+        target.aa = color_buffer->surface.aa;
+        WHBLogPrintf("OverlayState: Recorded %u bytes for a %ux%u target", target.display_list_size, target.width, target.height);
+        return true;
+    }
+}
+
+namespace OverlayState
+{
+
+void Apply(const GX2ColorBuffer* color_buffer)
+{
+    PROFILE_SCOPE("OverlayState::Apply");
+
+    Target* found = nullptr;
+    for (Target& target : targets) {
+        if (Matches(target, color_buffer)) {
+            found = &target;
+            break;
+        }
+    }
+
+    if (!found) {
+        Target& target = EvictTarget();
+        target.display_list_size = 0;
+        if (!Record(target, color_buffer)) {
+            // Set everything directly, as slow as before but correct
+            SetupState(color_buffer);
+            return;
+        }
+        found = &target;
+    }
+
+    found->last_used = ++use_counter;
+    GX2CallDisplayList(found->display_list, found->display_list_size);
+}
+
+void Release()
+{
+    for (Target& target : targets) {
+        if (target.display_list) {
+            MappedMemory::Free(target.display_list);
+        }
+        target = Target();
+    }
+    use_counter = 0;
+}
+
+} // namespace OverlayState
@@ -0,0 +1,470 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include <RmlUi/Core.h>
+
+#ifdef __WIIU__
+#include <coreinit/cache.h>
+#include <coreinit/core.h>
+#include <coreinit/time.h>
+#include <gx2/enum.h>
+#include <whb/log.h>
+#include "gx2_extra.hpp"
+#include "mapped_memory.hpp"
+#else
+#include <time.h>
+#define WHBLogPrintf(...) std::fprintf(stderr, __VA_ARGS__)
+#endif
+
+namespace
+{
+    struct ScopeRecord
+    {
+        const char* name;
+        uint64_t begin;
+        uint64_t end;
+        uint32_t core;
+    };
+
+    struct GpuRange
+    {
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    struct FrameRecord
+    {
+        uint64_t begin;
+        uint64_t end;
+        std::atomic<uint32_t> scope_count;
+        ScopeRecord scopes[Profiler::MAX_SCOPES_PER_FRAME];
+
+        // GPU ranges are converted to CPU ticks once the GPU has written them
+        uint32_t gpu_range_count;
+        bool gpu_resolved;
+        GpuRange gpu_ranges[Profiler::MAX_GPU_RANGES_PER_FRAME];
+
+        uint64_t cpu_cost;
+        uint64_t gpu_cost;
+    };
+
+    // Frames older than this are assumed to be retired by the GPU
+    constexpr uint32_t GPU_RESOLVE_LATENCY = 3;
+    constexpr uint32_t HUD_REFRESH_INTERVAL = 30;
+    constexpr uint32_t GPU_STAMPS_PER_FRAME = Profiler::MAX_GPU_RANGES_PER_FRAME * 2;
+
+    bool initialized = false;
+    FrameRecord* frames = nullptr;
+    uint64_t frame_number = 0;
+
+    // GPU writable timestamp slots, GPU_STAMPS_PER_FRAME per frame
+    uint64_t* gpu_stamps = nullptr;
+
+    Rml::ElementDocument* hud_document = nullptr;
+    Rml::DataModelHandle hud_model;
+    Profiler::Summary hud_summary;
+    // Set by NextFrame, the model itself is only touched by the thread owning the context
+    std::atomic<bool> hud_refresh_pending{false};
+
+    FrameRecord& CurrentFrame()
+    {
+        return frames[frame_number % Profiler::FRAME_HISTORY];
+    }
+
+    uint32_t GetCoreId()
+    {
+#ifdef __WIIU__
+        return OSGetCoreId();
+#else
+        return 0;
+#endif
+    }
+
+    uint64_t* GetGpuStamps(uint64_t frame)
+    {
+        return gpu_stamps + (frame % Profiler::FRAME_HISTORY) * GPU_STAMPS_PER_FRAME;
+    }
+
+    void ResetFrame(FrameRecord& frame, uint64_t now)
+    {
+        frame.begin = now;
+        frame.end = 0;
+        frame.scope_count.store(0, std::memory_order_relaxed);
+        frame.gpu_range_count = 0;
+        frame.gpu_resolved = false;
+        frame.cpu_cost = 0;
+        frame.gpu_cost = 0;
+
+        if (gpu_stamps) {
+            // Flush the cleared slots so a later cache eviction can't overwrite the GPU write
+            uint64_t* stamps = GetGpuStamps(frame_number);
+            std::memset(stamps, 0, GPU_STAMPS_PER_FRAME * sizeof(uint64_t));
+#ifdef __WIIU__
+            DCFlushRange(stamps, GPU_STAMPS_PER_FRAME * sizeof(uint64_t));
+#endif
+        }
+    }
+
+    // Sums the scopes that are not nested inside another scope on the same core
+    uint64_t ComputeCpuCost(const FrameRecord& frame)
+    {
+        uint32_t count = std::min(frame.scope_count.load(std::memory_order_relaxed), Profiler::MAX_SCOPES_PER_FRAME);
+        uint64_t cost = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            const ScopeRecord& scope = frame.scopes[i];
+            bool nested = false;
+            for (uint32_t j = 0; j < count && !nested; j++) {
+                const ScopeRecord& other = frame.scopes[j];
+                nested = j != i && other.core == scope.core && other.begin <= scope.begin && other.end >= scope.end &&
+                    (other.begin != scope.begin || other.end != scope.end || j < i);
+            }
+            if (!nested) {
+                cost += scope.end - scope.begin;
+            }
+        }
+        return cost;
+    }
+
+    void ResolveGpuFrame(uint64_t number)
+    {
+        FrameRecord& frame = frames[number % Profiler::FRAME_HISTORY];
+        if (frame.gpu_resolved || !gpu_stamps)
+            return;
+
+        uint64_t* stamps = GetGpuStamps(number);
+#ifdef __WIIU__
+        DCInvalidateRange(stamps, GPU_STAMPS_PER_FRAME * sizeof(uint64_t));
+#endif
+        uint64_t cost = 0;
+        for (uint32_t i = 0; i < frame.gpu_range_count; i++) {
+            uint64_t begin = stamps[i * 2];
+            uint64_t end = stamps[i * 2 + 1];
+            if (begin == 0 || end == 0 || end < begin) {
+                // Not written (yet), leave the range empty
+                frame.gpu_ranges[i] = { 0, 0 };
+                continue;
+            }
+#ifdef __WIIU__
+            frame.gpu_ranges[i].begin = GX2GPUTimeToCPUTime(begin);
+            frame.gpu_ranges[i].end = GX2GPUTimeToCPUTime(end);
+#endif
+            cost += frame.gpu_ranges[i].end - frame.gpu_ranges[i].begin;
+        }
+        frame.gpu_cost = cost;
+        frame.gpu_resolved = true;
+    }
+
+    float Percentile(uint64_t* sorted, uint32_t count, float fraction)
+    {
+        if (count == 0)
+            return 0.0f;
+        uint32_t index = std::min(count - 1, (uint32_t)(fraction * (float)(count - 1) + 0.5f));
+        return (float)Profiler::TicksToMicroseconds(sorted[index]) / 1000.0f;
+    }
+}
+
+namespace Profiler
+{
+
+uint64_t GetTicks()
+{
+#ifdef __WIIU__
+    return (uint64_t)OSGetTime();
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+uint64_t TicksToMicroseconds(uint64_t ticks)
+{
+#ifdef __WIIU__
+    return (uint64_t)OSTicksToMicroseconds(ticks);
+#else
+    return ticks / 1000;
+#endif
+}
+
+uint64_t TicksToNanoseconds(uint64_t ticks)
+{
+#ifdef __WIIU__
+    return (uint64_t)OSTicksToNanoseconds(ticks);
+#else
+    return ticks;
+#endif
+}
+
+void Initialize()
+{
+    if (initialized)
+        return;
+
+    frames = new FrameRecord[FRAME_HISTORY];
+    frame_number = 0;
+
+#ifdef __WIIU__
+    size_t stamps_size = FRAME_HISTORY * GPU_STAMPS_PER_FRAME * sizeof(uint64_t);
+    gpu_stamps = (uint64_t*)MappedMemory::Alloc(MappedMemory::Tag::Profiler, (uint32_t)stamps_size, 0x100, "GPU timestamps");
+    if (!gpu_stamps) {
+        WHBLogPrintf("Profiler: Failed to allocate GPU timestamp memory");
+    }
+#endif
+
+    // Frames with end == 0 were never completed and don't count towards the summary
+    uint64_t now = GetTicks();
+    for (uint32_t i = 0; i < FRAME_HISTORY; i++) {
+        frame_number = i;
+        ResetFrame(frames[i], now);
+    }
+    frame_number = 0;
+
+    initialized = true;
+}
+
+void Shutdown()
+{
+    if (!initialized)
+        return;
+
+    initialized = false;
+    UnloadHud();
+
+#ifdef __WIIU__
+    if (gpu_stamps) {
+        MappedMemory::Free(gpu_stamps);
+    }
+#endif
+    gpu_stamps = nullptr;
+
+    delete[] frames;
+    frames = nullptr;
+}
+
+bool IsInitialized()
+{
+    return initialized;
+}
+
+void NextFrame()
+{
+    if (!initialized)
+        return;
+
+    uint64_t now = GetTicks();
+    FrameRecord& finished = CurrentFrame();
+    finished.end = now;
+    finished.cpu_cost = ComputeCpuCost(finished);
+
+    if (frame_number >= GPU_RESOLVE_LATENCY) {
+        ResolveGpuFrame(frame_number - GPU_RESOLVE_LATENCY);
+    }
+
+    frame_number++;
+    ResetFrame(CurrentFrame(), now);
+
+    if ((frame_number % HUD_REFRESH_INTERVAL) == 0) {
+        hud_refresh_pending.store(true, std::memory_order_relaxed);
+    }
+}
+
+bool UpdateHud()
+{
+    if (!hud_refresh_pending.exchange(false, std::memory_order_relaxed))
+        return false;
+
+    if (!hud_model || !hud_document || !hud_document->IsVisible())
+        return false;
+
+    hud_summary = GetSummary();
+    hud_model.DirtyAllVariables();
+    return true;
+}
+
+void RecordScope(const char* name, uint64_t begin, uint64_t end)
+{
+    if (!initialized)
+        return;
+
+    FrameRecord& frame = CurrentFrame();
+    uint32_t index = frame.scope_count.fetch_add(1, std::memory_order_relaxed);
+    if (index >= MAX_SCOPES_PER_FRAME)
+        return;
+
+    frame.scopes[index] = { name, begin, end, GetCoreId() };
+}
+
+void GpuBegin()
+{
+#ifdef __WIIU__
+    if (!initialized || !gpu_stamps)
+        return;
+
+    FrameRecord& frame = CurrentFrame();
+    if (frame.gpu_range_count >= MAX_GPU_RANGES_PER_FRAME)
+        return;
+
+    GX2SampleTopGPUCycle(&GetGpuStamps(frame_number)[frame.gpu_range_count * 2]);
+#endif
+}
+
+void GpuEnd()
+{
+#ifdef __WIIU__
+    if (!initialized || !gpu_stamps)
+        return;
+
+    FrameRecord& frame = CurrentFrame();
+    if (frame.gpu_range_count >= MAX_GPU_RANGES_PER_FRAME)
+        return;
+
+    GX2SampleBottomGPUCycle(&GetGpuStamps(frame_number)[frame.gpu_range_count * 2 + 1]);
+    frame.gpu_range_count++;
+#endif
+}
+
+Summary GetSummary()
+{
+    Summary summary;
+    if (!initialized)
+        return summary;
+
+    uint64_t cpu_costs[FRAME_HISTORY];
+    uint64_t gpu_costs[FRAME_HISTORY];
+    uint32_t cpu_count = 0;
+    uint32_t gpu_count = 0;
+
+    for (uint32_t i = 0; i < FRAME_HISTORY; i++) {
+        const FrameRecord& frame = frames[i];
+        if (&frame == &CurrentFrame() || frame.end == 0)
+            continue;
+        cpu_costs[cpu_count++] = frame.cpu_cost;
+        if (frame.gpu_resolved && frame.gpu_range_count > 0) {
+            gpu_costs[gpu_count++] = frame.gpu_cost;
+        }
+    }
+
+    std::sort(cpu_costs, cpu_costs + cpu_count);
+    std::sort(gpu_costs, gpu_costs + gpu_count);
+
+    summary.frames = cpu_count;
+    summary.cpu_p50_ms = Percentile(cpu_costs, cpu_count, 0.50f);
+    summary.cpu_p95_ms = Percentile(cpu_costs, cpu_count, 0.95f);
+    summary.cpu_p99_ms = Percentile(cpu_costs, cpu_count, 0.99f);
+    summary.cpu_max_ms = Percentile(cpu_costs, cpu_count, 1.0f);
+    summary.gpu_p50_ms = Percentile(gpu_costs, gpu_count, 0.50f);
+    summary.gpu_p95_ms = Percentile(gpu_costs, gpu_count, 0.95f);
+    summary.gpu_max_ms = Percentile(gpu_costs, gpu_count, 1.0f);
+    return summary;
+}
+
+bool DumpChromeTrace(const char* path)
+{
+    if (!initialized)
+        return false;
+
+    FILE* file = std::fopen(path, "w");
+    if (!file) {
+        WHBLogPrintf("Profiler: Failed to open %s", path);
+        return false;
+    }
+
+    // Oldest frame first, the current (incomplete) frame is skipped
+    uint64_t first = frame_number >= FRAME_HISTORY - 1 ? frame_number - (FRAME_HISTORY - 1) : 0;
+    uint64_t origin = frames[first % FRAME_HISTORY].begin;
+
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    std::fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"RmlUi Overlay\"}},\n", file);
+    std::fputs("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":100,\"args\":{\"name\":\"GPU\"}}", file);
+
+    for (uint64_t number = first; number < frame_number; number++) {
+        const FrameRecord& frame = frames[number % FRAME_HISTORY];
+        if (frame.end == 0)
+            continue;
+
+        std::fprintf(file, ",\n{\"name\":\"Frame %llu\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%llu}",
+            (unsigned long long)number, (unsigned long long)TicksToMicroseconds(frame.begin - origin));
+
+        uint32_t count = std::min(frame.scope_count.load(std::memory_order_relaxed), MAX_SCOPES_PER_FRAME);
+        for (uint32_t i = 0; i < count; i++) {
+            const ScopeRecord& scope = frame.scopes[i];
+            std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu,\"dur\":%llu}",
+                scope.name, scope.core,
+                (unsigned long long)TicksToMicroseconds(scope.begin - origin),
+                (unsigned long long)TicksToMicroseconds(scope.end - scope.begin));
+        }
+
+        if (!frame.gpu_resolved)
+            continue;
+        for (uint32_t i = 0; i < frame.gpu_range_count; i++) {
+            const GpuRange& range = frame.gpu_ranges[i];
+            if (range.begin == 0 || range.begin < origin)
+                continue;
+            std::fprintf(file, ",\n{\"name\":\"Overlay GPU\",\"ph\":\"X\",\"pid\":1,\"tid\":100,\"ts\":%llu,\"dur\":%llu}",
+                (unsigned long long)TicksToMicroseconds(range.begin - origin),
+                (unsigned long long)TicksToMicroseconds(range.end - range.begin));
+        }
+    }
+
+    std::fputs("\n]}\n", file);
+    std::fclose(file);
+
+    WHBLogPrintf("Profiler: Wrote trace to %s", path);
+    return true;
+}
+
+bool LoadHud(Rml::Context* context, const char* path)
+{
+    if (!context || hud_document)
+        return false;
+
+    Rml::DataModelConstructor constructor = context->CreateDataModel("profiler");
+    if (!constructor)
+        return false;
+
+    constructor.Bind("frames", &hud_summary.frames);
+    constructor.Bind("cpu_p50", &hud_summary.cpu_p50_ms);
+    constructor.Bind("cpu_p95", &hud_summary.cpu_p95_ms);
+    constructor.Bind("cpu_p99", &hud_summary.cpu_p99_ms);
+    constructor.Bind("cpu_max", &hud_summary.cpu_max_ms);
+    constructor.Bind("gpu_p50", &hud_summary.gpu_p50_ms);
+    constructor.Bind("gpu_p95", &hud_summary.gpu_p95_ms);
+    constructor.Bind("gpu_max", &hud_summary.gpu_max_ms);
+    hud_model = constructor.GetModelHandle();
+
+    hud_document = context->LoadDocument(path);
+    if (!hud_document) {
+        WHBLogPrintf("Profiler: Failed to load HUD document %s", path);
+        context->RemoveDataModel("profiler");
+        hud_model = Rml::DataModelHandle();
+        return false;
+    }
+    return true;
+}
+
+void ToggleHud()
+{
+    if (!hud_document)
+        return;
+
+    if (hud_document->IsVisible()) {
+        hud_document->Hide();
+    } else {
+        hud_summary = GetSummary();
+        hud_model.DirtyAllVariables();
+        hud_document->Show(Rml::ModalFlag::None, Rml::FocusFlag::None);
+    }
+}
+
+void UnloadHud()
+{
+    // The document and the data model are owned by the context, which is destroyed by Rml::Shutdown
+    hud_document = nullptr;
+    hud_model = Rml::DataModelHandle();
+}
+
+} // namespace Profiler
@@ -0,0 +1,77 @@
+#include "release_queue.hpp"
+
+#ifdef __WIIU__
+#include <gx2/event.h>
+#endif
+
+namespace
+{
+#ifdef __WIIU__
+    uint64_t GetLastSubmitted()
+    {
+        return (uint64_t)GX2GetLastSubmittedTimeStamp();
+    }
+
+    uint64_t GetRetired()
+    {
+        return (uint64_t)GX2GetRetiredTimeStamp();
+    }
+#else
+    uint64_t GetLastSubmitted()
+    {
+        return 0;
+    }
+
+    uint64_t GetRetired()
+    {
+        return UINT64_MAX;
+    }
+#endif
+}
+
+ReleaseQueue::ReleaseQueue() : submitted(GetLastSubmitted), retired(GetRetired) {}
+
+ReleaseQueue::ReleaseQueue(TimestampSource submitted, TimestampSource retired) : submitted(submitted), retired(retired) {}
+
+ReleaseQueue::~ReleaseQueue()
+{
+    // The owner is expected to have waited for the GPU by now
+    Flush();
+}
+
+void ReleaseQueue::Release(void* memory, uint32_t size, FreeFunction free_function)
+{
+    if (!memory)
+        return;
+
+    // Commands recorded since the last flush end up in a later submission than the last submitted one
+    uint64_t tag = submitted() + 1;
+    entries.push_back({ tag, memory, size, free_function });
+    pending_bytes += size;
+}
+
+uint32_t ReleaseQueue::Drain()
+{
+    if (entries.empty())
+        return 0;
+
+    uint64_t retired_timestamp = retired();
+    uint32_t count = 0;
+    while (count < entries.size() && entries[count].tag <= retired_timestamp) {
+        Entry& entry = entries[count];
+        entry.free_function(entry.memory);
+        pending_bytes -= entry.size;
+        count++;
+    }
+    entries.erase(entries.begin(), entries.begin() + count);
+    return count;
+}
+
+void ReleaseQueue::Flush()
+{
+    for (Entry& entry : entries) {
+        entry.free_function(entry.memory);
+    }
+    entries.clear();
+    pending_bytes = 0;
+}
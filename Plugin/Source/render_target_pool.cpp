@@ -0,0 +1,80 @@
+#include "render_target_pool.hpp"
+
+RenderTargetPool::RenderTargetPool(CreateFunction create, DestroyFunction destroy, void* user) : create(create), destroy(destroy), user(user) {}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    // Targets still in use belong to nobody else, they go too
+    while (!entries.empty()) {
+        Destroy(entries.size() - 1);
+    }
+}
+
+void* RenderTargetPool::Acquire(const Key& key)
+{
+    for (Entry& entry : entries) {
+        if (!entry.in_use && entry.key == key) {
+            entry.in_use = true;
+            entry.last_used = frame;
+            return entry.target;
+        }
+    }
+
+    uint32_t size = 0;
+    void* target = create(user, key, &size);
+    if (!target)
+        return nullptr;
+
+    entries.push_back({ key, target, size, frame, true });
+    bytes += size;
+    created++;
+    return target;
+}
+
+void RenderTargetPool::Release(void* target)
+{
+    for (Entry& entry : entries) {
+        if (entry.target == target) {
+            entry.in_use = false;
+            entry.last_used = frame;
+            return;
+        }
+    }
+}
+
+void RenderTargetPool::NextFrame(uint32_t max_idle_frames)
+{
+    frame++;
+    for (size_t i = entries.size(); i-- > 0;) {
+        if (!entries[i].in_use && frame - entries[i].last_used > max_idle_frames) {
+            Destroy(i);
+        }
+    }
+}
+
+void RenderTargetPool::Trim()
+{
+    for (size_t i = entries.size(); i-- > 0;) {
+        if (!entries[i].in_use) {
+            Destroy(i);
+        }
+    }
+}
+
+uint32_t RenderTargetPool::GetInUseCount() const
+{
+    uint32_t count = 0;
+    for (const Entry& entry : entries) {
+        if (entry.in_use)
+            count++;
+    }
+    return count;
+}
+
+void RenderTargetPool::Destroy(size_t index)
+{
+    Entry entry = entries[index];
+    entries.erase(entries.begin() + index);
+    bytes -= entry.bytes;
+    destroy(user, entry.target);
+}
@@ -0,0 +1,87 @@
+#include "screen_bounds.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // w below this is treated as on or behind the eye plane
+    constexpr float MIN_W = 1e-5f;
+
+    bool Overlaps(const ScreenBounds::Rect& a, const ScreenBounds::Rect& b)
+    {
+        // Touching edges cover no pixel
+        return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+    }
+}
+
+namespace ScreenBounds
+{
+
+Rect Compute(const void* vertices, uint32_t vertex_count, uint32_t stride)
+{
+    if (vertex_count == 0)
+        return EMPTY;
+
+    const uint8_t* vertex = static_cast<const uint8_t*>(vertices);
+    float position[2];
+    std::memcpy(position, vertex, sizeof(position));
+    Rect bounds = { position[0], position[1], position[0], position[1] };
+    for (uint32_t i = 1; i < vertex_count; i++) {
+        vertex += stride;
+        std::memcpy(position, vertex, sizeof(position));
+        bounds.left = std::min(bounds.left, position[0]);
+        bounds.top = std::min(bounds.top, position[1]);
+        bounds.right = std::max(bounds.right, position[0]);
+        bounds.bottom = std::max(bounds.bottom, position[1]);
+    }
+    return bounds;
+}
+
+Rect Intersect(const Rect& a, const Rect& b)
+{
+    return { std::max(a.left, b.left), std::max(a.top, b.top), std::min(a.right, b.right), std::min(a.bottom, b.bottom) };
+}
+
+bool IsVisible(const Rect& bounds, float translation_x, float translation_y, const float* transform, const Rect& clip)
+{
+    // An empty clip, e.g. a scissor region outside the viewport, still "overlaps" bounds spanning across it
+    if (bounds.left > bounds.right || clip.left >= clip.right || clip.top >= clip.bottom)
+        return false;
+
+    Rect moved = { bounds.left + translation_x, bounds.top + translation_y, bounds.right + translation_x, bounds.bottom + translation_y };
+    if (!transform)
+        return Overlaps(moved, clip);
+
+    // The geometry lies in the z = 0 plane, so the third column doesn't matter. m[column * 4 + row].
+    const float* m = transform;
+    const float corners[4][2] = {
+        { moved.left, moved.top },
+        { moved.right, moved.top },
+        { moved.right, moved.bottom },
+        { moved.left, moved.bottom },
+    };
+
+    Rect projected = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 4; i++) {
+        const float x = corners[i][0];
+        const float y = corners[i][1];
+        const float w = m[3] * x + m[7] * y + m[15];
+        if (w < MIN_W)
+            return true;
+
+        const float px = (m[0] * x + m[4] * y + m[12]) / w;
+        const float py = (m[1] * x + m[5] * y + m[13]) / w;
+        if (i == 0) {
+            projected = { px, py, px, py };
+        } else {
+            projected.left = std::min(projected.left, px);
+            projected.top = std::min(projected.top, py);
+            projected.right = std::max(projected.right, px);
+            projected.bottom = std::max(projected.bottom, py);
+        }
+    }
+    return Overlaps(projected, clip);
+}
+
+} // namespace ScreenBounds
@@ -0,0 +1,195 @@
+#include "startup.hpp"
+
+#include <atomic>
+#include <cstdio>
+
+#ifdef __WIIU__
+#include <coreinit/thread.h>
+#include <coreinit/time.h>
+#include <malloc.h>
+#include <whb/log.h>
+#else
+#include <chrono>
+#include <thread>
+#define WHBLogPrintf(...) (std::fprintf(stderr, __VA_ARGS__), std::fputc('\n', stderr))
+#endif
+
+namespace
+{
+    Startup::InitFunction init_function = nullptr;
+    std::atomic<bool> ready{ false };
+    bool started = false;
+
+    Startup::Phase phases[Startup::MAX_PHASES];
+    uint32_t phase_count = 0;
+    const char* current_phase = nullptr;
+    uint64_t phase_start = 0;
+
+#ifdef __WIIU__
+    OSThread* thread = nullptr;
+    void* thread_stack = nullptr;
+#else
+    std::thread thread;
+#endif
+
+    uint64_t GetMicroseconds()
+    {
+#ifdef __WIIU__
+        return (uint64_t)OSTicksToMicroseconds(OSGetSystemTime());
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    void EndPhase()
+    {
+        if (!current_phase)
+            return;
+        if (phase_count < Startup::MAX_PHASES) {
+            phases[phase_count++] = { current_phase, GetMicroseconds() - phase_start };
+        }
+        current_phase = nullptr;
+    }
+
+    void ThreadMain()
+    {
+        bool ok = init_function();
+        EndPhase();
+        ready.store(ok, std::memory_order_release);
+    }
+
+#ifdef __WIIU__
+    int ThreadEntry(int argc, const char** argv)
+    {
+        (void)argc;
+        (void)argv;
+        ThreadMain();
+        return 0;
+    }
+#endif
+}
+
+namespace Startup
+{
+
+bool Start(InitFunction init)
+{
+    if (started || !init)
+        return false;
+
+    init_function = init;
+    ready.store(false, std::memory_order_relaxed);
+    phase_count = 0;
+    current_phase = nullptr;
+
+#ifdef __WIIU__
+    thread = (OSThread*)memalign(16, sizeof(OSThread));
+    thread_stack = memalign(16, STACK_SIZE);
+    if (!thread || !thread_stack) {
+        WHBLogPrintf("Startup: Failed to allocate the thread");
+        free(thread);
+        free(thread_stack);
+        thread = nullptr;
+        thread_stack = nullptr;
+        return false;
+    }
+
+    OSThreadAttributes affinity = (OSThreadAttributes)(1 << CORE);
+    if (!OSCreateThread(thread, ThreadEntry, 0, nullptr, (uint8_t*)thread_stack + STACK_SIZE, STACK_SIZE, 16, affinity)) {
+        WHBLogPrintf("Startup: OSCreateThread failed");
+        free(thread);
+        free(thread_stack);
+        thread = nullptr;
+        thread_stack = nullptr;
+        return false;
+    }
+    OSSetThreadName(thread, "RmlUi startup");
+    OSResumeThread(thread);
+#else
+    thread = std::thread(ThreadMain);
+#endif
+
+    started = true;
+    return true;
+}
+
+void Wait()
+{
+    if (!started)
+        return;
+
+#ifdef __WIIU__
+    int result = 0;
+    OSJoinThread(thread, &result);
+    free(thread);
+    free(thread_stack);
+    thread = nullptr;
+    thread_stack = nullptr;
+#else
+    thread.join();
+#endif
+
+    started = false;
+}
+
+bool IsReady()
+{
+    return ready.load(std::memory_order_acquire);
+}
+
+void BeginPhase(const char* name)
+{
+    EndPhase();
+    current_phase = name;
+    phase_start = GetMicroseconds();
+}
+
+void LogPhases(const char* kind)
+{
+    EndPhase();
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < phase_count; i++) {
+        total += phases[i].microseconds;
+    }
+    WHBLogPrintf("Startup (%s): %.1f ms in %u phases", kind, total / 1000.0, phase_count);
+    for (uint32_t i = 0; i < phase_count; i++) {
+        WHBLogPrintf("  %-16s %8.1f ms", phases[i].name, phases[i].microseconds / 1000.0);
+    }
+}
+
+bool AppendPhases(const char* path, const char* kind)
+{
+    // Opened for reading first, appending would create the file
+    FILE* file = fopen(path, "r");
+    if (!file)
+        return false;
+    fclose(file);
+    file = fopen(path, "a");
+    if (!file)
+        return false;
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < phase_count; i++) {
+        total += phases[i].microseconds;
+    }
+    fprintf(file, "{\"kind\": \"%s\", \"total_us\": %llu, \"phases\": {", kind, (unsigned long long)total);
+    for (uint32_t i = 0; i < phase_count; i++) {
+        fprintf(file, "%s\"%s\": %llu", i > 0 ? ", " : "", phases[i].name, (unsigned long long)phases[i].microseconds);
+    }
+    fputs("}}\n", file);
+    fclose(file);
+    return true;
+}
+
+uint32_t GetPhases(Phase* out, uint32_t max_phases)
+{
+    uint32_t count = phase_count < max_phases ? phase_count : max_phases;
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = phases[i];
+    }
+    return count;
+}
+
+} // namespace Startup
@@ -0,0 +1,148 @@
+#include "telemetry.hpp"
+
+#include <atomic>
+#include <cmath>
+
+#include <RmlUi/Core.h>
+
+namespace
+{
+    struct FieldInfo
+    {
+        const char* name;
+        float threshold;
+        uint64_t min_interval_us;
+        // Front buffer, bound to the data model and only touched by Sync
+        float published;
+        // Not published yet, or published at last_published_us
+        bool ever_published;
+        uint64_t last_published_us;
+    };
+
+    // Registration happens before the producers run, only the back buffer and the pending bits are shared
+    FieldInfo fields[Telemetry::MAX_FIELDS];
+    uint32_t field_count = 0;
+
+    // Back buffer, written by the producers
+    std::atomic<float> values[Telemetry::MAX_FIELDS];
+    std::atomic<uint32_t> pending{ 0 };
+
+    static_assert(Telemetry::MAX_FIELDS <= 32, "Pending fields are one bit each in a single word");
+
+    Rml::DataModelHandle model;
+    Telemetry::TickStats last_tick;
+    Telemetry::TickStats totals;
+    uint32_t tick_count = 0;
+}
+
+namespace Telemetry
+{
+
+uint32_t Register(const char* name, float threshold, uint32_t min_interval_ms)
+{
+    if (field_count >= MAX_FIELDS)
+        return INVALID_FIELD;
+
+    fields[field_count] = { name, threshold, (uint64_t)min_interval_ms * 1000, 0.0f, false, 0 };
+    values[field_count].store(0.0f, std::memory_order_relaxed);
+    return field_count++;
+}
+
+void Set(uint32_t field, float value)
+{
+    if (field >= MAX_FIELDS)
+        return;
+
+    values[field].store(value, std::memory_order_relaxed);
+    // Release pairs with the exchange in Sync, the value is visible once its bit is
+    pending.fetch_or(1u << field, std::memory_order_release);
+}
+
+bool CreateModel(Rml::Context* context)
+{
+    if (!context || model)
+        return false;
+
+    Rml::DataModelConstructor constructor = context->CreateDataModel("telemetry");
+    if (!constructor)
+        return false;
+
+    for (uint32_t i = 0; i < field_count; i++) {
+        constructor.Bind(fields[i].name, &fields[i].published);
+    }
+    model = constructor.GetModelHandle();
+    return true;
+}
+
+void ReleaseModel()
+{
+    model = Rml::DataModelHandle();
+}
+
+bool Sync(uint64_t now_us)
+{
+    TickStats tick;
+    uint32_t changed = pending.exchange(0, std::memory_order_acquire);
+    uint32_t held = 0;
+
+    for (uint32_t i = 0; changed != 0; i++, changed >>= 1) {
+        if (!(changed & 1) || i >= field_count)
+            continue;
+
+        FieldInfo& field = fields[i];
+        const float value = values[i].load(std::memory_order_relaxed);
+        tick.changed++;
+
+        if (field.ever_published) {
+            // Set to what is shown already
+            if (value == field.published)
+                continue;
+            if (std::fabs(value - field.published) < field.threshold) {
+                tick.below_threshold++;
+                continue;
+            }
+            if (now_us - field.last_published_us < field.min_interval_us) {
+                // Looked at again next tick, so the latest value shows up once the interval is over
+                held |= 1u << i;
+                tick.rate_limited++;
+                continue;
+            }
+        }
+
+        field.published = value;
+        field.ever_published = true;
+        field.last_published_us = now_us;
+        if (model) {
+            model.DirtyVariable(field.name);
+        }
+        tick.dirtied++;
+    }
+    if (held) {
+        pending.fetch_or(held, std::memory_order_relaxed);
+    }
+
+    last_tick = tick;
+    totals.changed += tick.changed;
+    totals.dirtied += tick.dirtied;
+    totals.below_threshold += tick.below_threshold;
+    totals.rate_limited += tick.rate_limited;
+    tick_count++;
+    return tick.dirtied != 0;
+}
+
+TickStats GetLastTick()
+{
+    return last_tick;
+}
+
+TickStats GetTotals()
+{
+    return totals;
+}
+
+uint32_t GetTickCount()
+{
+    return tick_count;
+}
+
+} // namespace Telemetry
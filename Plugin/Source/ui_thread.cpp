@@ -0,0 +1,148 @@
+#include "ui_thread.hpp"
+
+#include <condition_variable>
+#include <mutex>
+
+#ifdef __WIIU__
+#include <coreinit/thread.h>
+#include <malloc.h>
+#include <whb/log.h>
+#else
+#include <cstdio>
+#include <thread>
+#define WHBLogPrintf(...) std::fprintf(stderr, __VA_ARGS__)
+#endif
+
+namespace
+{
+    UiThread::FrameFunction frame_function = nullptr;
+    void* frame_user = nullptr;
+
+    bool running = false;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool kicked = false;
+    bool quit = false;
+
+#ifdef __WIIU__
+    OSThread* thread = nullptr;
+    void* thread_stack = nullptr;
+#else
+    std::thread thread;
+#endif
+
+    void ThreadMain()
+    {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [] { return kicked || quit; });
+                if (quit)
+                    return;
+                kicked = false;
+            }
+
+            frame_function(frame_user);
+        }
+    }
+
+#ifdef __WIIU__
+    int ThreadEntry(int argc, const char** argv)
+    {
+        (void)argc;
+        (void)argv;
+        ThreadMain();
+        return 0;
+    }
+#endif
+}
+
+namespace UiThread
+{
+
+bool Start(FrameFunction function, void* user)
+{
+    if (running || !function)
+        return false;
+
+    frame_function = function;
+    frame_user = user;
+    kicked = false;
+    quit = false;
+
+#ifdef __WIIU__
+    thread = (OSThread*)memalign(16, sizeof(OSThread));
+    thread_stack = memalign(16, STACK_SIZE);
+    if (!thread || !thread_stack) {
+        WHBLogPrintf("UiThread: Failed to allocate the thread");
+        free(thread);
+        free(thread_stack);
+        thread = nullptr;
+        thread_stack = nullptr;
+        return false;
+    }
+
+    OSThreadAttributes affinity = (OSThreadAttributes)(1 << CORE);
+    if (!OSCreateThread(thread, ThreadEntry, 0, nullptr, (uint8_t*)thread_stack + STACK_SIZE, STACK_SIZE, 16, affinity)) {
+        WHBLogPrintf("UiThread: OSCreateThread failed");
+        free(thread);
+        free(thread_stack);
+        thread = nullptr;
+        thread_stack = nullptr;
+        return false;
+    }
+    OSSetThreadName(thread, "RmlUi UI thread");
+    OSResumeThread(thread);
+#else
+    thread = std::thread(ThreadMain);
+#endif
+
+    running = true;
+    WHBLogPrintf("UiThread: Started");
+    return true;
+}
+
+void Stop()
+{
+    if (!running)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_one();
+
+#ifdef __WIIU__
+    int result = 0;
+    OSJoinThread(thread, &result);
+    free(thread);
+    free(thread_stack);
+    thread = nullptr;
+    thread_stack = nullptr;
+#else
+    thread.join();
+#endif
+
+    running = false;
+    WHBLogPrintf("UiThread: Stopped");
+}
+
+bool IsRunning()
+{
+    return running;
+}
+
+void Kick()
+{
+    if (!running)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        kicked = true;
+    }
+    wake.notify_one();
+}
+
+} // namespace UiThread
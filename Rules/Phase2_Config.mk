@@ -13,6 +13,26 @@ CXXFLAGS	:= $(CFLAGS) -std=c++23
 ASFLAGS	:=	-g $(ARCH)
 LDFLAGS	=	-g $(ARCH) $(RPXSPECS) -Wl,-Map,$(notdir $*.map) -T$(WUMS_ROOT)/share/libmappedmemory.ld -T$(WUMS_ROOT)/share/libkernel.ld $(WUPSSPECS)
 
+# UI_THREAD=1 runs Context::Update/Render on a dedicated core, see Backend::StartUiThread
+ifeq ($(UI_THREAD),1)
+CXXFLAGS += -DRMLUI_UI_THREAD
+endif
+
+# SDF_FONTS=0 goes back to RmlUi's FreeType font engine, see FontEngineInterface_SDF
+ifneq ($(SDF_FONTS),0)
+CXXFLAGS += -DRMLUI_SDF_FONTS
+endif
+
+# WARM_START=0 shuts RmlUi down with every application instead of keeping it for the next one, see Backend::Suspend
+ifneq ($(WARM_START),0)
+CXXFLAGS += -DRMLUI_WARM_START
+endif
+
+# FRAME_BUDGET_US=<microseconds> sets the overlay's per-frame budget, see Backend::SetFrameBudget
+ifneq ($(FRAME_BUDGET_US),)
+CXXFLAGS += -DRMLUI_FRAME_BUDGET_US=$(FRAME_BUDGET_US)
+endif
+
 ifeq ($(DEBUG),1)
 CXXFLAGS += -DDEBUG -g
 CFLAGS += -DDEBUG -g
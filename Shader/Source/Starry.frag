@@ -1,20 +1,17 @@
 #version 450
 
-in vec2 vUV;
-in vec4 vColor;
+layout(location = 0) in vec4 vColor;
+layout(location = 1) in vec2 vUV;
 
 layout(location = 0) out vec4 fragColor;
 
 layout(binding = 0) uniform sampler2D Texture;
 
-layout(binding = 1) uniform Time
-{
-    float iTime;
-};
-
-layout(binding = 2) uniform Resolution
+// Shared by all procedural shaders, uploaded once per frame
+layout(binding = 1) uniform FrameBlock
 {
     vec2 iResolution;
+    float iTime;
 };
 
 mat2 rotate2d(float a)
@@ -1,20 +1,26 @@
 #version 450
 
 layout(location = 0) in vec2 Position;
-layout(location = 1) in vec2 UV;
-layout(location = 2) in vec4 Color;
+layout(location = 1) in vec4 Color;
+layout(location = 2) in vec2 TexCoord;
 
-layout(binding = 0) uniform Projection
+layout(location = 0) out vec4 vColor;
+layout(location = 1) out vec2 vUV;
+
+layout(binding = 0) uniform ProjectionBlock
 {
-    mat4 iProjection;
+    mat4 Projection;
 };
 
-out vec2 vUV;
-out vec4 vColor;
+layout(binding = 1) uniform TransformBlock
+{
+    mat4 TransformMatrix;
+};
 
 void main()
 {
-    vUV = UV;
+    // UV is normalized over the decorated element, TransformMatrix includes the translation
+    vUV = TexCoord;
     vColor = Color;
-    gl_Position = iProjection * vec4(Position, 0.0, 1.0);
-}
\ No newline at end of file
+    gl_Position = Projection * TransformMatrix * vec4(Position, 0.0, 1.0);
+}
@@ -0,0 +1,10 @@
+#version 450
+
+layout(location = 0) in vec4 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // Untextured geometry, no sampling of a white texture
+    outColor = fragColor;
+}
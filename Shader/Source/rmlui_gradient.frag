@@ -0,0 +1,65 @@
+#version 450
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+#define MAX_NUM_STOPS 16
+#define PI 3.14159265
+
+#define LINEAR 0
+#define RADIAL 1
+#define CONIC 2
+
+layout(binding = 0) uniform GradientBlock
+{
+    // x function, y number of stops, z 1 if repeating
+    vec4 Parameters;
+    // xy linear: starting point, radial and conic: center
+    // zw linear: vector to the ending point, radial: inverse radius, conic: angled unit vector
+    vec4 Points;
+    // Normalized, 0 is the starting point and 1 the ending point, four per element
+    vec4 StopPositions[MAX_NUM_STOPS / 4];
+    // Premultiplied
+    vec4 StopColors[MAX_NUM_STOPS];
+};
+
+float StopPosition(int i) {
+    return StopPositions[i / 4][i % 4];
+}
+
+vec4 MixStopColors(float t, int num_stops) {
+    vec4 color = StopColors[0];
+    for (int i = 1; i < num_stops; i++) {
+        color = mix(color, StopColors[i], smoothstep(StopPosition(i - 1), StopPosition(i), t));
+    }
+    return color;
+}
+
+void main() {
+    int func = int(Parameters.x);
+    int num_stops = int(Parameters.y);
+    vec2 p = Points.xy;
+    vec2 v = Points.zw;
+
+    // Texture coordinates are in pixels of the decorated element
+    float t = 0.0;
+    if (func == LINEAR) {
+        t = dot(v, fragTexCoord - p) / dot(v, v);
+    } else if (func == RADIAL) {
+        t = length(v * (fragTexCoord - p));
+    } else {
+        mat2 R = mat2(v.x, -v.y, v.y, v.x);
+        vec2 V = R * (fragTexCoord - p);
+        t = 0.5 + atan(-V.x, V.y) / (2.0 * PI);
+    }
+
+    if (Parameters.z > 0.5) {
+        float t0 = StopPosition(0);
+        float t1 = StopPosition(num_stops - 1);
+        t = t0 + mod(t - t0, t1 - t0);
+    }
+
+    outColor = fragColor * MixStopColors(t, num_stops);
+}
@@ -0,0 +1,24 @@
+#version 450
+
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+layout(binding = 0) uniform sampler2D Texture;
+
+layout(binding = 0) uniform BlurBlock
+{
+    // One texel along the blur direction
+    vec4 TexelOffset;
+    // Gaussian weights of the center tap and the three taps on either side
+    vec4 Weights;
+};
+
+void main() {
+    vec2 offset = TexelOffset.xy;
+    vec4 color = texture(Texture, fragTexCoord) * Weights.x;
+    color += (texture(Texture, fragTexCoord - offset) + texture(Texture, fragTexCoord + offset)) * Weights.y;
+    color += (texture(Texture, fragTexCoord - 2.0 * offset) + texture(Texture, fragTexCoord + 2.0 * offset)) * Weights.z;
+    color += (texture(Texture, fragTexCoord - 3.0 * offset) + texture(Texture, fragTexCoord + 3.0 * offset)) * Weights.w;
+    outColor = color;
+}
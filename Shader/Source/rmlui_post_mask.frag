@@ -0,0 +1,12 @@
+#version 450
+
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+layout(binding = 0) uniform sampler2D Texture;
+layout(binding = 1) uniform sampler2D Mask;
+
+void main() {
+    outColor = texture(Texture, fragTexCoord) * texture(Mask, fragTexCoord).a;
+}
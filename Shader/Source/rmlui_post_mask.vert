@@ -0,0 +1,18 @@
+#version 450
+
+layout(location = 0) in vec2 Position;
+layout(location = 2) in vec2 TexCoord;
+
+layout(location = 1) out vec2 fragTexCoord;
+
+layout(binding = 1) uniform TexCoordBlock
+{
+    // xy scale, zw offset, selects the part of the source texture covering the target
+    vec4 TexCoordTransform;
+};
+
+void main() {
+    // Fullscreen quad, already in clip space
+    gl_Position = vec4(Position, 0.0, 1.0);
+    fragTexCoord = TexCoord * TexCoordTransform.xy + TexCoordTransform.zw;
+}
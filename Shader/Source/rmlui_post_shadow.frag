@@ -0,0 +1,17 @@
+#version 450
+
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+layout(binding = 0) uniform sampler2D Texture;
+
+layout(binding = 0) uniform ShadowBlock
+{
+    // Premultiplied shadow color
+    vec4 Color;
+};
+
+void main() {
+    outColor = Color * texture(Texture, fragTexCoord).a;
+}
@@ -0,0 +1,18 @@
+#version 450
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+// Single-channel signed distance field, 0.5 is the glyph outline and larger values are inside
+layout(binding = 0) uniform sampler2D Texture;
+
+void main() {
+    float distance = texture(Texture, fragTexCoord).r;
+    // About one pixel of antialiasing at any scale the atlas is drawn at
+    float width = max(fwidth(distance) * 0.5, 0.001);
+    float coverage = smoothstep(0.5 - width, 0.5 + width, distance);
+    // Vertex colors are premultiplied
+    outColor = fragColor * coverage;
+}
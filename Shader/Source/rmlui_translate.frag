@@ -0,0 +1,14 @@
+#version 450
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+layout(binding = 0) uniform sampler2D Texture;
+
+void main() {
+    // Sample texture and multiply by vertex color
+    // RmlUi uses white texture for untextured geometry
+    outColor = texture(Texture, fragTexCoord) * fragColor;
+}
@@ -0,0 +1,15 @@
+#!/bin/sh
+# Strips the glyphs our documents never use from a font before it goes on the SD card.
+# Keeps printable ASCII (the SDF font engine preloads it) and every character found in UI/.
+# Needs fonttools: pip install fonttools
+# usage: sh subset_fonts.sh Lato-Regular.ttf [Lato-Regular.subset.ttf]
+set -e
+font="$1"
+output="${2:-${font%.*}.subset.ttf}"
+text=$(mktemp)
+cat "$(dirname "$0")"/UI/*.rml "$(dirname "$0")"/UI/*.rcss > "$text"
+# Hints are dropped, the font engine loads outlines unhinted. FreeType only kerns from the legacy kern table, so that
+# one is kept and the OpenType layout tables go.
+pyftsubset "$font" --unicodes=U+0020-007E --text-file="$text" --output-file="$output" --no-hinting --legacy-kern --drop-tables+=GPOS,GSUB
+rm "$text"
+ls -l "$font" "$output"